@@ -0,0 +1,30 @@
+# - Find lz4
+#
+# LZ4_INCLUDE_DIR        - location of the lz4 header files
+# LZ4_LIBRARY            - the lz4 library, with full path
+# LZ4_FOUND
+
+find_path(
+  LZ4_INCLUDE_DIR
+  lz4.h
+  HINTS
+  ${LZ4_DIR}
+  $ENV{LZ4_DIR}
+  /usr
+  /opt
+  PATH_SUFFIXES include
+)
+
+find_library(
+  LZ4_LIBRARY
+  NAMES lz4
+  HINTS
+  ${LZ4_DIR}
+  $ENV{LZ4_DIR}
+  /usr
+  /opt
+  PATH_SUFFIXES lib
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(lz4 DEFAULT_MSG LZ4_INCLUDE_DIR LZ4_LIBRARY)
@@ -0,0 +1,30 @@
+# - Find zstd
+#
+# ZSTD_INCLUDE_DIR        - location of the zstd header files
+# ZSTD_LIBRARY            - the zstd library, with full path
+# ZSTD_FOUND
+
+find_path(
+  ZSTD_INCLUDE_DIR
+  zstd.h
+  HINTS
+  ${ZSTD_DIR}
+  $ENV{ZSTD_DIR}
+  /usr
+  /opt
+  PATH_SUFFIXES include
+)
+
+find_library(
+  ZSTD_LIBRARY
+  NAMES zstd
+  HINTS
+  ${ZSTD_DIR}
+  $ENV{ZSTD_DIR}
+  /usr
+  /opt
+  PATH_SUFFIXES lib
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(zstd DEFAULT_MSG ZSTD_INCLUDE_DIR ZSTD_LIBRARY)
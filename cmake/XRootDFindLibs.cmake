@@ -6,6 +6,10 @@ find_package( XRootD REQUIRED )
 
 find_package( ceph REQUIRED )
 
+# codecs of the compressed files, each one being optional
+find_package( lz4 )
+find_package( zstd )
+
 if( ENABLE_TESTS )
   find_package( CPPUnit )
   if( CPPUNIT_FOUND )
@@ -5,6 +5,8 @@ set( TRUE_VAR TRUE )
 component_status( CEPH     TRUE_VAR        CEPH_FOUND )
 component_status( XROOTD   TRUE_VAR        XROOTD_FOUND )
 component_status( TESTS    BUILD_TESTS     CPPUNIT_FOUND )
+component_status( LZ4      TRUE_VAR        LZ4_FOUND )
+component_status( ZSTD     TRUE_VAR        ZSTD_FOUND )
 
 message( STATUS "----------------------------------------" )
 message( STATUS "Installation path: " ${CMAKE_INSTALL_PREFIX} )
@@ -16,4 +18,6 @@ message( STATUS "" )
 message( STATUS "CEPH:              " ${STATUS_CEPH} )
 message( STATUS "XRootD:            " ${STATUS_XROOTD} )
 message( STATUS "Tests:             " ${STATUS_TESTS} )
+message( STATUS "LZ4:               " ${STATUS_LZ4} )
+message( STATUS "Zstd:              " ${STATUS_ZSTD} )
 message( STATUS "----------------------------------------" )
@@ -15,7 +15,15 @@ set( XRD_CEPH_POSIX_SOVERSION 0 )
 add_library(
   XrdCephPosix
   SHARED
-  XrdCeph/XrdCephPosix.cc     XrdCeph/XrdCephPosix.hh )
+  XrdCeph/XrdCephPosix.cc       XrdCeph/XrdCephPosix.hh
+  XrdCeph/XrdCephBloomFilter.cc XrdCeph/XrdCephBloomFilter.hh
+  XrdCeph/XrdCephMetaCache.cc   XrdCeph/XrdCephMetaCache.hh
+  XrdCeph/XrdCephBlockCache.cc  XrdCeph/XrdCephBlockCache.hh
+  XrdCeph/XrdCephDiskCache.cc   XrdCeph/XrdCephDiskCache.hh
+  XrdCeph/XrdCephTimer.cc       XrdCeph/XrdCephTimer.hh
+  XrdCeph/XrdCephAdmission.cc   XrdCeph/XrdCephAdmission.hh
+  XrdCeph/XrdCephChecksum.cc    XrdCeph/XrdCephChecksum.hh
+  XrdCeph/XrdCephCompress.cc    XrdCeph/XrdCephCompress.hh )
 
 # needed during the transition between ceph giant and ceph hammer
 # for object listing API
@@ -27,6 +35,20 @@ target_link_libraries(
   ${XROOTD_LIBRARIES}  
   ${RADOS_LIBS} )
 
+# codecs available for compressed files
+if( LZ4_FOUND )
+  set_property(SOURCE XrdCeph/XrdCephCompress.cc
+    APPEND PROPERTY COMPILE_DEFINITIONS XRDCEPH_HAVE_LZ4)
+  include_directories( ${LZ4_INCLUDE_DIR} )
+  target_link_libraries( XrdCephPosix ${LZ4_LIBRARY} )
+endif()
+if( ZSTD_FOUND )
+  set_property(SOURCE XrdCeph/XrdCephCompress.cc
+    APPEND PROPERTY COMPILE_DEFINITIONS XRDCEPH_HAVE_ZSTD)
+  include_directories( ${ZSTD_INCLUDE_DIR} )
+  target_link_libraries( XrdCephPosix ${ZSTD_LIBRARY} )
+endif()
+
 set_target_properties(
   XrdCephPosix
   PROPERTIES
@@ -79,9 +101,46 @@ set_target_properties(
   INTERFACE_LINK_LIBRARIES ""
   LINK_INTERFACE_LIBRARIES "" )
 
+#-------------------------------------------------------------------------------
+# The xrdcephindex tool
+#-------------------------------------------------------------------------------
+add_executable(
+  xrdcephindex
+  XrdCeph/XrdCephIndexTool.cc )
+
+target_link_libraries(
+  xrdcephindex
+  XrdCephPosix )
+
+#-------------------------------------------------------------------------------
+# The xrdcephrm tool
+#-------------------------------------------------------------------------------
+add_executable(
+  xrdcephrm
+  XrdCeph/XrdCephBulkDeleteTool.cc )
+
+target_link_libraries(
+  xrdcephrm
+  XrdCephPosix )
+
+#-------------------------------------------------------------------------------
+# The xrdcephcp tool
+#-------------------------------------------------------------------------------
+add_executable(
+  xrdcephcp
+  XrdCeph/XrdCephCopyTool.cc )
+
+target_link_libraries(
+  xrdcephcp
+  XrdCephPosix )
+
 #-------------------------------------------------------------------------------
 # Install
 #-------------------------------------------------------------------------------
 install(
   TARGETS ${LIB_XRD_CEPH} ${LIB_XRD_CEPH_XATTR} XrdCephPosix
   LIBRARY DESTINATION ${CMAKE_INSTALL_LIBDIR} )
+
+install(
+  TARGETS xrdcephindex xrdcephrm xrdcephcp
+  RUNTIME DESTINATION ${CMAKE_INSTALL_BINDIR} )
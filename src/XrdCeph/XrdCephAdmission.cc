@@ -0,0 +1,242 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#include <errno.h>
+
+#include "XrdCeph/XrdCephAdmission.hh"
+#include "XrdCeph/XrdCephTimer.hh"
+
+XrdCephAdmission::XrdCephAdmission(unsigned int maxOps, unsigned long long maxBytes,
+                                   unsigned int maxOpsPerOwner,
+                                   unsigned long long maxBytesPerOwner,
+                                   unsigned int targetLatencyMs, unsigned int maxQueue) :
+  m_maxOps(maxOps), m_maxBytes(maxBytes), m_maxOpsPerOwner(maxOpsPerOwner),
+  m_maxBytesPerOwner(maxBytesPerOwner), m_targetLatencyMs(targetLatencyMs),
+  m_maxQueue(maxQueue), m_window(maxOps), m_lastDecreaseMs(0), m_virtualTime(0),
+  m_nbAdmitted(0), m_nbQueued(0), m_nbRejected(0), m_nbTimedOut(0),
+  m_totalWaitMs(0), m_maxWaitMs(0), m_nbDecreases(0), m_nbCapped(0) {}
+
+bool XrdCephAdmission::ownerFits(const Waiter &w) const {
+  std::map<int, Usage>::const_iterator it = m_owners.find(w.owner);
+  if (it == m_owners.end()) return true;
+  // an operation larger than the limit still goes when the owner has nothing in flight
+  if (m_maxOpsPerOwner && it->second.nbOps >= m_maxOpsPerOwner) return false;
+  if (m_maxBytesPerOwner && it->second.nbBytes + w.nbBytes > m_maxBytesPerOwner) return false;
+  return true;
+}
+
+void XrdCephAdmission::refill(const Waiter &w) {
+  if (0 == w.clientCap) return;
+  unsigned long long now = XrdCephTimer::nowMs();
+  std::map<std::string, Bucket>::iterator it = m_buckets.find(w.client);
+  if (it == m_buckets.end()) {
+    // forget the buckets that are full again before adding a new one
+    if (m_buckets.size() >= 1024) {
+      for (std::map<std::string, Bucket>::iterator b = m_buckets.begin(); b != m_buckets.end();) {
+        if (now - b->second.lastRefillMs > 1000) m_buckets.erase(b++);
+        else b++;
+      }
+    }
+    Bucket &b = m_buckets[w.client];
+    b.tokens = w.clientCap;
+    b.lastRefillMs = now;
+    return;
+  }
+  Bucket &b = it->second;
+  b.tokens += (double)w.clientCap * (now - b.lastRefillMs) / 1000;
+  if (b.tokens > w.clientCap) b.tokens = w.clientCap;
+  b.lastRefillMs = now;
+}
+
+void XrdCephAdmission::refillQueued() {
+  for (std::list<Waiter>::const_iterator it = m_queue.begin(); it != m_queue.end(); it++) {
+    refill(*it);
+  }
+}
+
+bool XrdCephAdmission::clientFits(const Waiter &w, unsigned long long &waitMs) const {
+  if (0 == w.clientCap) return true;
+  std::map<std::string, Bucket>::const_iterator it = m_buckets.find(w.client);
+  if (it == m_buckets.end()) return true;
+  // operations larger than the bucket go as soon as it is not in debt anymore
+  if (it->second.tokens > 0) return true;
+  waitMs = (unsigned long long)(-it->second.tokens * 1000 / w.clientCap) + 1;
+  return false;
+}
+
+bool XrdCephAdmission::eligible(const Waiter &w) const {
+  unsigned long long waitMs;
+  return ownerFits(w) && clientFits(w, waitMs);
+}
+
+double XrdCephAdmission::startTag(const Flow &flow, unsigned long long nbBytes) {
+  if (m_flowFinish.size() >= 1024) {
+    // flows with nothing left beyond the virtual time can be forgotten
+    for (std::map<std::string, double>::iterator it = m_flowFinish.begin();
+         it != m_flowFinish.end();) {
+      if (it->second <= m_virtualTime) m_flowFinish.erase(it++);
+      else it++;
+    }
+  }
+  std::map<std::string, double>::iterator it = m_flowFinish.find(flow.name);
+  double start = m_virtualTime;
+  if (it != m_flowFinish.end() && it->second > start) start = it->second;
+  m_flowFinish[flow.name] = start + nbBytes / flow.weight;
+  return start;
+}
+
+bool XrdCephAdmission::globalFits(unsigned long long nbBytes) {
+  if (0 == m_usage.nbOps) return true;
+  if (m_usage.nbOps + 1 > m_window) return false;
+  unsigned long long maxBytes = (unsigned long long)(m_maxBytes * (m_window / m_maxOps));
+  return m_usage.nbBytes + nbBytes <= maxBytes;
+}
+
+bool XrdCephAdmission::canAdmit(std::list<Waiter>::iterator w) {
+  if (!eligible(*w)) return false;
+  // eligible waiters with a smaller start time go first, earlier ones on ties
+  bool earlier = true;
+  for (std::list<Waiter>::iterator it = m_queue.begin(); it != m_queue.end(); it++) {
+    if (it == w) {
+      earlier = false;
+      continue;
+    }
+    if ((it->tag < w->tag || (earlier && it->tag == w->tag)) && eligible(*it)) return false;
+  }
+  return globalFits(w->nbBytes);
+}
+
+void XrdCephAdmission::admit(const Waiter &w) {
+  m_usage.nbOps++;
+  m_usage.nbBytes += w.nbBytes;
+  Usage &u = m_owners[w.owner];
+  u.nbOps++;
+  u.nbBytes += w.nbBytes;
+  if (w.clientCap) m_buckets[w.client].tokens -= w.nbBytes;
+  if (w.tag > m_virtualTime) m_virtualTime = w.tag;
+  m_nbAdmitted++;
+}
+
+int XrdCephAdmission::acquire(int owner, unsigned long long nbBytes, unsigned int timeoutMs,
+                              const Flow &flow) {
+  XrdSysCondVarHelper lock(m_cond);
+  Waiter self(owner, nbBytes, startTag(flow, nbBytes), flow);
+  unsigned long long capWaitMs = 0;
+  refill(self);
+  if (m_queue.empty() && ownerFits(self) && clientFits(self, capWaitMs) && globalFits(nbBytes)) {
+    admit(self);
+    return 0;
+  }
+  if (m_queue.size() >= m_maxQueue) {
+    m_nbRejected++;
+    return -EBUSY;
+  }
+  m_nbQueued++;
+  if (capWaitMs) m_nbCapped++;
+  std::list<Waiter>::iterator w = m_queue.insert(m_queue.end(), self);
+  unsigned long long start = XrdCephTimer::nowMs();
+  int rc = 0;
+  while (true) {
+    refillQueued();
+    if (canAdmit(w)) break;
+    // a waiter held by its client cap is not woken up by releases
+    capWaitMs = 0;
+    clientFits(*w, capWaitMs);
+    unsigned long long waitMs = capWaitMs;
+    if (timeoutMs) {
+      unsigned long long elapsed = XrdCephTimer::nowMs() - start;
+      if (elapsed >= timeoutMs) {
+        m_nbTimedOut++;
+        rc = -ETIMEDOUT;
+        break;
+      }
+      if (0 == waitMs || timeoutMs - elapsed < waitMs) waitMs = timeoutMs - elapsed;
+    }
+    if (waitMs) m_cond.WaitMS(waitMs);
+    else m_cond.Wait();
+  }
+  m_queue.erase(w);
+  unsigned long long waitMs = XrdCephTimer::nowMs() - start;
+  m_totalWaitMs += waitMs;
+  if (waitMs > m_maxWaitMs) m_maxWaitMs = waitMs;
+  if (0 == rc) admit(self);
+  // the next waiters may now be the first ones that can go
+  m_cond.Broadcast();
+  return rc;
+}
+
+void XrdCephAdmission::unaccount(int owner, unsigned long long nbBytes) {
+  m_usage.nbOps--;
+  m_usage.nbBytes -= nbBytes;
+  std::map<int, Usage>::iterator it = m_owners.find(owner);
+  if (it != m_owners.end()) {
+    it->second.nbOps--;
+    it->second.nbBytes -= nbBytes;
+    if (0 == it->second.nbOps) m_owners.erase(it);
+  }
+  if (!m_queue.empty()) m_cond.Broadcast();
+}
+
+void XrdCephAdmission::release(int owner, unsigned long long nbBytes,
+                               unsigned long long latencyMs) {
+  XrdSysCondVarHelper lock(m_cond);
+  if (latencyMs > m_targetLatencyMs) {
+    unsigned long long now = XrdCephTimer::nowMs();
+    // decrease only once per target latency, the completions of the operations
+    // sent before the previous decrease do not reflect it yet
+    if (now - m_lastDecreaseMs >= m_targetLatencyMs) {
+      m_window = m_window / 2 < 1 ? 1 : m_window / 2;
+      m_lastDecreaseMs = now;
+      m_nbDecreases++;
+    }
+  } else {
+    m_window += 1 / m_window;
+    if (m_window > m_maxOps) m_window = m_maxOps;
+  }
+  unaccount(owner, nbBytes);
+}
+
+void XrdCephAdmission::release(int owner, unsigned long long nbBytes) {
+  XrdSysCondVarHelper lock(m_cond);
+  unaccount(owner, nbBytes);
+}
+
+void XrdCephAdmission::stats(std::ostringstream &ss) {
+  XrdSysCondVarHelper lock(m_cond);
+  ss << "<admission>"
+     << "<window>" << (unsigned int)m_window << "</window>"
+     << "<ops>" << m_usage.nbOps << "</ops>"
+     << "<bytes>" << m_usage.nbBytes << "</bytes>"
+     << "<queued>" << m_queue.size() << "</queued>"
+     << "<admitted>" << m_nbAdmitted << "</admitted>"
+     << "<waited>" << m_nbQueued << "</waited>"
+     << "<rejected>" << m_nbRejected << "</rejected>"
+     << "<timedout>" << m_nbTimedOut << "</timedout>"
+     << "<waitms>" << m_totalWaitMs << "</waitms>"
+     << "<maxwaitms>" << m_maxWaitMs << "</maxwaitms>"
+     << "<decreases>" << m_nbDecreases << "</decreases>"
+     << "<capped>" << m_nbCapped << "</capped>"
+     << "<flows>" << m_flowFinish.size() << "</flows>"
+     << "</admission>";
+}
@@ -0,0 +1,208 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#ifndef __XRD_CEPH_ADMISSION_HH__
+#define __XRD_CEPH_ADMISSION_HH__
+
+#include <list>
+#include <map>
+#include <sstream>
+#include <string>
+#include "XrdSys/XrdSysPthread.hh"
+
+//------------------------------------------------------------------------------
+//! Admission control of the operations sent to ceph.
+//!
+//! The number of operations and bytes in flight are limited globally and per
+//! owner (typically an open file). Operations over the limits wait in a queue,
+//! unless it is full, in which case they are pushed back.
+//!
+//! The queue is served by weighted fair queueing between flows of operations
+//! (start time fair queueing, on bytes) : each flow gets a share of the
+//! admissions proportional to its weight when several flows are waiting.
+//! The bandwidth of each client can also be capped, with a token bucket
+//! allowing bursts of one second.
+//!
+//! The global limits adapt to the latency of completions, AIMD style : the
+//! window of operations grows by one per window of completions faster than
+//! the target latency, and is halved, at most once per target latency, when
+//! completions are slower. The byte limit follows the window proportionally.
+//------------------------------------------------------------------------------
+
+class XrdCephAdmission {
+
+public:
+
+  //------------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param maxOps          maximum number of operations in flight
+  //! @param maxBytes        maximum number of bytes in flight
+  //! @param maxOpsPerOwner  maximum number of operations in flight per owner
+  //! @param maxBytesPerOwner maximum number of bytes in flight per owner
+  //! @param targetLatencyMs latency above which the window is decreased
+  //! @param maxQueue        maximum number of waiting operations
+  //------------------------------------------------------------------------------
+  XrdCephAdmission(unsigned int maxOps, unsigned long long maxBytes,
+                   unsigned int maxOpsPerOwner, unsigned long long maxBytesPerOwner,
+                   unsigned int targetLatencyMs, unsigned int maxQueue);
+
+  //------------------------------------------------------------------------------
+  //! Description of the flow an operation belongs to
+  //------------------------------------------------------------------------------
+  struct Flow {
+    Flow() : weight(1), clientCap(0) {}
+    /// name of the flow, operations of the same flow are served in order
+    std::string name;
+    /// weight of the flow
+    double weight;
+    /// client issuing the operation
+    std::string client;
+    /// maximum bandwidth of the client in bytes per second, 0 meaning no cap
+    unsigned long long clientCap;
+  };
+
+  //------------------------------------------------------------------------------
+  //! Admits an operation, waiting in the queue if needed
+  //!
+  //! @param timeoutMs maximum time to wait, 0 meaning no limit
+  //! @return 0, -EBUSY if the queue is full or -ETIMEDOUT
+  //------------------------------------------------------------------------------
+  int acquire(int owner, unsigned long long nbBytes, unsigned int timeoutMs,
+              const Flow &flow);
+
+  //------------------------------------------------------------------------------
+  //! Releases an admitted operation that completed in latencyMs milliseconds
+  //------------------------------------------------------------------------------
+  void release(int owner, unsigned long long nbBytes, unsigned long long latencyMs);
+
+  //------------------------------------------------------------------------------
+  //! Releases an admitted operation that was not sent, so that it does not
+  //! take part in the adaptation
+  //------------------------------------------------------------------------------
+  void release(int owner, unsigned long long nbBytes);
+
+  //------------------------------------------------------------------------------
+  //! Appends the statistics of the admission control to a stream
+  //------------------------------------------------------------------------------
+  void stats(std::ostringstream &ss);
+
+private:
+
+  /// an operation waiting for admission
+  struct Waiter {
+    Waiter(int o, unsigned long long n, double t, const Flow &f) :
+      owner(o), nbBytes(n), tag(t), client(f.client), clientCap(f.clientCap) {}
+    int owner;
+    unsigned long long nbBytes;
+    /// virtual start time of the operation in its flow
+    double tag;
+    std::string client;
+    unsigned long long clientCap;
+  };
+
+  /// token bucket capping the bandwidth of a client
+  struct Bucket {
+    Bucket() : tokens(0), lastRefillMs(0) {}
+    double tokens;
+    unsigned long long lastRefillMs;
+  };
+
+  /// operations and bytes in flight
+  struct Usage {
+    Usage() : nbOps(0), nbBytes(0) {}
+    unsigned int nbOps;
+    unsigned long long nbBytes;
+  };
+
+  /// whether the owner of a waiter is within its own limits
+  bool ownerFits(const Waiter &w) const;
+
+  /// refills the token bucket of the client of a waiter, if capped,
+  /// creating it if needed
+  void refill(const Waiter &w);
+
+  /// refills the token buckets of the clients of all waiters
+  void refillQueued();
+
+  /// whether the client of a waiter is within its bandwidth cap, as of the
+  /// last refill of its bucket
+  /// if not, waitMs is set to the time needed to get back within it
+  bool clientFits(const Waiter &w, unsigned long long &waitMs) const;
+
+  /// whether a waiter is held by neither its owner nor its client limits
+  bool eligible(const Waiter &w) const;
+
+  /// whether the global limits allow one more operation of the given size
+  bool globalFits(unsigned long long nbBytes);
+
+  /// computes the virtual start time of a new operation of a flow
+  double startTag(const Flow &flow, unsigned long long nbBytes);
+
+  /// whether a queued operation can be admitted now
+  bool canAdmit(std::list<Waiter>::iterator w);
+
+  /// accounts an admitted operation
+  void admit(const Waiter &w);
+
+  /// forgets a released operation and wakes up the waiters
+  void unaccount(int owner, unsigned long long nbBytes);
+
+  unsigned int m_maxOps;
+  unsigned long long m_maxBytes;
+  unsigned int m_maxOpsPerOwner;
+  unsigned long long m_maxBytesPerOwner;
+  unsigned int m_targetLatencyMs;
+  unsigned int m_maxQueue;
+  /// current limit of operations in flight
+  double m_window;
+  /// time of the last decrease of the window
+  unsigned long long m_lastDecreaseMs;
+  /// global usage
+  Usage m_usage;
+  /// usage per owner, only for owners with operations in flight
+  std::map<int, Usage> m_owners;
+  /// waiting operations, in arrival order
+  std::list<Waiter> m_queue;
+  /// virtual time, i.e. start time of the last admitted operation
+  double m_virtualTime;
+  /// virtual finish time of the last operation of each flow
+  std::map<std::string, double> m_flowFinish;
+  /// token buckets of capped clients
+  std::map<std::string, Bucket> m_buckets;
+  /// statistics
+  unsigned long long m_nbAdmitted;
+  unsigned long long m_nbQueued;
+  unsigned long long m_nbRejected;
+  unsigned long long m_nbTimedOut;
+  unsigned long long m_totalWaitMs;
+  unsigned long long m_maxWaitMs;
+  unsigned long long m_nbDecreases;
+  unsigned long long m_nbCapped;
+  /// protects all members above, signaled when operations are released
+  XrdSysCondVar m_cond;
+
+};
+
+#endif /* __XRD_CEPH_ADMISSION_HH__ */
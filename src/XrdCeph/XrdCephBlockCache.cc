@@ -0,0 +1,146 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#include <string.h>
+
+#include "XrdCeph/XrdCephBlockCache.hh"
+
+XrdCephBlockCache::XrdCephBlockCache(unsigned long long maxSize,
+                                     unsigned long long blockSize) :
+  m_maxSize(maxSize), m_blockSize(blockSize), m_a1inSize(0), m_usedSize(0),
+  m_nbHits(0), m_nbMisses(0), m_nbEvictions(0) {}
+
+XrdCephBlockCache::~XrdCephBlockCache() {}
+
+long long XrdCephBlockCache::get(const std::string &file, unsigned long long version,
+                                 unsigned long long block, size_t offset, size_t len,
+                                 char *buf) {
+  XrdSysMutexHelper lock(m_mutex);
+  BlockMap::iterator it = m_blocks.find(BlockKey(file, block));
+  if (it == m_blocks.end()) {
+    m_nbMisses++;
+    return -1;
+  }
+  if (it->second.version != version) {
+    // the file was modified since this block was cached
+    drop(it);
+    m_nbMisses++;
+    return -1;
+  }
+  m_nbHits++;
+  // hits in Am refresh the block, hits in A1in do not (correlated references)
+  if (AM == it->second.queue) {
+    m_am.splice(m_am.begin(), m_am, it->second.pos);
+  }
+  const std::string &data = it->second.data;
+  if (offset >= data.size()) return 0;
+  size_t n = data.size() - offset < len ? data.size() - offset : len;
+  memcpy(buf, data.c_str() + offset, n);
+  return n;
+}
+
+void XrdCephBlockCache::put(const std::string &file, unsigned long long version,
+                            unsigned long long block, const char *data, size_t len) {
+  if (len > m_blockSize || len > m_maxSize) return;
+  XrdSysMutexHelper lock(m_mutex);
+  BlockKey key(file, block);
+  BlockMap::iterator it = m_blocks.find(key);
+  if (it != m_blocks.end()) drop(it);
+  Block &b = m_blocks[key];
+  b.version = version;
+  b.data.assign(data, len);
+  m_usedSize += len;
+  std::map<BlockKey, std::list<BlockKey>::iterator>::iterator ghost = m_a1outIndex.find(key);
+  if (ghost != m_a1outIndex.end()) {
+    // seen again shortly after leaving A1in : this block is hot
+    m_a1out.erase(ghost->second);
+    m_a1outIndex.erase(ghost);
+    b.queue = AM;
+    m_am.push_front(key);
+    b.pos = m_am.begin();
+  } else {
+    b.queue = A1IN;
+    m_a1in.push_front(key);
+    b.pos = m_a1in.begin();
+    m_a1inSize += len;
+  }
+  evict();
+}
+
+void XrdCephBlockCache::invalidate(const std::string &file) {
+  XrdSysMutexHelper lock(m_mutex);
+  BlockMap::iterator it = m_blocks.lower_bound(BlockKey(file, 0));
+  while (it != m_blocks.end() && it->first.first == file) {
+    BlockMap::iterator next = it;
+    next++;
+    drop(it);
+    it = next;
+  }
+}
+
+void XrdCephBlockCache::drop(BlockMap::iterator it) {
+  m_usedSize -= it->second.data.size();
+  if (A1IN == it->second.queue) {
+    m_a1inSize -= it->second.data.size();
+    m_a1in.erase(it->second.pos);
+  } else {
+    m_am.erase(it->second.pos);
+  }
+  m_blocks.erase(it);
+}
+
+void XrdCephBlockCache::remember(const BlockKey &key) {
+  m_a1out.push_front(key);
+  m_a1outIndex[key] = m_a1out.begin();
+  // remember as many blocks as half of the cache could hold
+  while (m_a1outIndex.size() > m_maxSize / m_blockSize / 2 + 1) {
+    m_a1outIndex.erase(m_a1out.back());
+    m_a1out.pop_back();
+  }
+}
+
+void XrdCephBlockCache::evict() {
+  while (m_usedSize > m_maxSize) {
+    BlockKey victim;
+    if (m_a1inSize > m_maxSize / 4 || m_am.empty()) {
+      victim = m_a1in.back();
+      remember(victim);
+    } else {
+      victim = m_am.back();
+    }
+    drop(m_blocks.find(victim));
+    m_nbEvictions++;
+  }
+}
+
+void XrdCephBlockCache::stats(unsigned long long &usedSize, unsigned long long &nbBlocks,
+                              unsigned long long &nbHits, unsigned long long &nbMisses,
+                              unsigned long long &nbEvictions) {
+  XrdSysMutexHelper lock(m_mutex);
+  usedSize = m_usedSize;
+  nbBlocks = m_blocks.size();
+  nbHits = m_nbHits;
+  nbMisses = m_nbMisses;
+  nbEvictions = m_nbEvictions;
+}
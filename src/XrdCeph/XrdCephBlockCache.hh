@@ -0,0 +1,149 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#ifndef __XRD_CEPH_BLOCK_CACHE_HH__
+#define __XRD_CEPH_BLOCK_CACHE_HH__
+
+#include <list>
+#include <map>
+#include <string>
+#include <stdint.h>
+#include "XrdSys/XrdSysPthread.hh"
+
+//------------------------------------------------------------------------------
+//! In memory cache of file blocks, shared by all open files of the gateway.
+//!
+//! Blocks are identified by a file key, a block index and a file version.
+//! A lookup with a different version than the cached one is a miss and drops
+//! the block, so that remote modifications of a file are detected as soon as
+//! the caller notices a new version.
+//!
+//! Replacement follows the 2Q policy, making it resistant to scans : blocks
+//! seen for the first time enter a FIFO queue (A1in) limited to a quarter of
+//! the cache. Blocks evicted from there are remembered without data (A1out)
+//! and only blocks requested again while remembered enter the main LRU list
+//! (Am). The memory used by block data never exceeds the configured size.
+//------------------------------------------------------------------------------
+
+class XrdCephBlockCache {
+
+public:
+
+  //------------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param  maxSize    maximum amount of memory used by cached data, in bytes
+  //! @param  blockSize  size of the cached blocks, in bytes
+  //------------------------------------------------------------------------------
+  XrdCephBlockCache(unsigned long long maxSize, unsigned long long blockSize);
+
+  //------------------------------------------------------------------------------
+  //! Destructor
+  //------------------------------------------------------------------------------
+  ~XrdCephBlockCache();
+
+  //------------------------------------------------------------------------------
+  //! Copies part of a block from the cache
+  //!
+  //! @param  offset  offset of the data to copy within the block
+  //! @return -1 on cache miss, otherwise the number of bytes copied, which
+  //!         is smaller than len when the block is the last one of the file
+  //------------------------------------------------------------------------------
+  long long get(const std::string &file, unsigned long long version,
+                unsigned long long block, size_t offset, size_t len, char *buf);
+
+  //------------------------------------------------------------------------------
+  //! Inserts a block in the cache. len is smaller than the block size only
+  //! for the last block of a file
+  //------------------------------------------------------------------------------
+  void put(const std::string &file, unsigned long long version,
+           unsigned long long block, const char *data, size_t len);
+
+  //------------------------------------------------------------------------------
+  //! Drops all cached blocks of a file
+  //------------------------------------------------------------------------------
+  void invalidate(const std::string &file);
+
+  //------------------------------------------------------------------------------
+  //! Size of the cached blocks
+  //------------------------------------------------------------------------------
+  unsigned long long blockSize() const { return m_blockSize; }
+
+  //------------------------------------------------------------------------------
+  //! Fills the statistics of the cache
+  //------------------------------------------------------------------------------
+  void stats(unsigned long long &usedSize, unsigned long long &nbBlocks,
+             unsigned long long &nbHits, unsigned long long &nbMisses,
+             unsigned long long &nbEvictions);
+
+private:
+
+  /// identifier of a block
+  typedef std::pair<std::string, unsigned long long> BlockKey;
+
+  /// queues of the 2Q policy
+  enum Queue { A1IN, AM };
+
+  /// a cached block
+  struct Block {
+    unsigned long long version;
+    std::string data;
+    Queue queue;
+    std::list<BlockKey>::iterator pos;
+  };
+
+  typedef std::map<BlockKey, Block> BlockMap;
+
+  /// drops a block from the cache. Must be called with the mutex held
+  void drop(BlockMap::iterator it);
+
+  /// evicts blocks until the data fit into the cache. Must be called with the mutex held
+  void evict();
+
+  /// remembers a block evicted from A1in. Must be called with the mutex held
+  void remember(const BlockKey &key);
+
+  unsigned long long m_maxSize;
+  unsigned long long m_blockSize;
+  /// cached blocks
+  BlockMap m_blocks;
+  /// A1in FIFO, newest first, and the size of its data
+  std::list<BlockKey> m_a1in;
+  unsigned long long m_a1inSize;
+  /// Am LRU list, most recently used first
+  std::list<BlockKey> m_am;
+  /// A1out ghost FIFO, newest first, and its index
+  std::list<BlockKey> m_a1out;
+  std::map<BlockKey, std::list<BlockKey>::iterator> m_a1outIndex;
+  /// total size of cached data
+  unsigned long long m_usedSize;
+  /// statistics
+  unsigned long long m_nbHits;
+  unsigned long long m_nbMisses;
+  unsigned long long m_nbEvictions;
+  XrdSysMutex m_mutex;
+
+};
+
+#endif /* __XRD_CEPH_BLOCK_CACHE_HH__ */
@@ -0,0 +1,82 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#include <math.h>
+
+#include "XrdCeph/XrdCephBloomFilter.hh"
+
+XrdCephBloomFilter::XrdCephBloomFilter(unsigned long long expectedNbEntries,
+                                       double fpRate) : m_nbEntries(0) {
+  if (expectedNbEntries < 1) expectedNbEntries = 1;
+  if (fpRate <= 0 || fpRate >= 1) fpRate = 0.01;
+  // optimal sizing : m = -n.ln(p)/ln(2)^2 bits and k = m/n.ln(2) hashes
+  double ln2 = log(2.0);
+  double nbBits = -(double)expectedNbEntries * log(fpRate) / (ln2 * ln2);
+  m_nbBits = ((unsigned long long)nbBits + 63) & ~63ULL;
+  if (m_nbBits < 64) m_nbBits = 64;
+  m_nbHashes = (unsigned int)(nbBits / expectedNbEntries * ln2 + 0.5);
+  if (m_nbHashes < 1) m_nbHashes = 1;
+  m_bits.resize(m_nbBits / 64, 0);
+}
+
+void XrdCephBloomFilter::hash(const std::string &key, uint64_t &h1, uint64_t &h2) {
+  // 64 bits FNV-1a, followed by a murmur3 finalizer to derive a second hash
+  h1 = 14695981039346656037ULL;
+  for (std::string::const_iterator it = key.begin(); it != key.end(); it++) {
+    h1 ^= (unsigned char)*it;
+    h1 *= 1099511628211ULL;
+  }
+  h2 = h1;
+  h2 ^= h2 >> 33;
+  h2 *= 0xff51afd7ed558ccdULL;
+  h2 ^= h2 >> 33;
+  h2 *= 0xc4ceb9fe1a85ec53ULL;
+  h2 ^= h2 >> 33;
+  // make sure the second hash is odd so that all bits can be reached
+  h2 |= 1;
+}
+
+void XrdCephBloomFilter::add(const std::string &key) {
+  uint64_t h1, h2;
+  hash(key, h1, h2);
+  for (unsigned int i = 0; i < m_nbHashes; i++) {
+    uint64_t bit = (h1 + i * h2) % m_nbBits;
+    __sync_fetch_and_or(&m_bits[bit / 64], 1ULL << (bit % 64));
+  }
+  __sync_fetch_and_add(&m_nbEntries, 1ULL);
+}
+
+bool XrdCephBloomFilter::mayContain(const std::string &key) const {
+  uint64_t h1, h2;
+  hash(key, h1, h2);
+  for (unsigned int i = 0; i < m_nbHashes; i++) {
+    uint64_t bit = (h1 + i * h2) % m_nbBits;
+    if (0 == (m_bits[bit / 64] & (1ULL << (bit % 64)))) return false;
+  }
+  return true;
+}
+
+double XrdCephBloomFilter::expectedFpRate() const {
+  // p = (1 - e^(-k.n/m))^k
+  return pow(1 - exp(-(double)m_nbHashes * m_nbEntries / m_nbBits), (double)m_nbHashes);
+}
@@ -0,0 +1,98 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#ifndef __XRD_CEPH_BLOOM_FILTER_HH__
+#define __XRD_CEPH_BLOOM_FILTER_HH__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//------------------------------------------------------------------------------
+//! Simple Bloom filter of strings, used to answer negative lookups of file
+//! names without contacting ceph.
+//!
+//! The filter is sized at construction from the expected number of entries
+//! and the targeted false positive rate. Insertions may be done concurrently
+//! with other insertions and lookups, as bits are set atomically.
+//! Entries cannot be removed : removed entries only increase the false
+//! positive rate until the filter is rebuilt.
+//------------------------------------------------------------------------------
+
+class XrdCephBloomFilter {
+
+public:
+
+  //------------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param  expectedNbEntries  number of entries the filter is sized for
+  //! @param  fpRate             targeted false positive rate, in ]0,1[
+  //------------------------------------------------------------------------------
+  XrdCephBloomFilter(unsigned long long expectedNbEntries, double fpRate);
+
+  //------------------------------------------------------------------------------
+  //! Adds an entry to the filter
+  //------------------------------------------------------------------------------
+  void add(const std::string &key);
+
+  //------------------------------------------------------------------------------
+  //! Checks whether an entry may be in the filter
+  //!
+  //! @return false if the entry was definitely never added, true otherwise
+  //------------------------------------------------------------------------------
+  bool mayContain(const std::string &key) const;
+
+  //------------------------------------------------------------------------------
+  //! Number of entries added so far
+  //------------------------------------------------------------------------------
+  unsigned long long nbEntries() const { return m_nbEntries; }
+
+  //------------------------------------------------------------------------------
+  //! Size of the filter in bits
+  //------------------------------------------------------------------------------
+  unsigned long long nbBits() const { return m_nbBits; }
+
+  //------------------------------------------------------------------------------
+  //! Number of hash functions used
+  //------------------------------------------------------------------------------
+  unsigned int nbHashes() const { return m_nbHashes; }
+
+  //------------------------------------------------------------------------------
+  //! Theoretical false positive rate, given the current number of entries
+  //------------------------------------------------------------------------------
+  double expectedFpRate() const;
+
+private:
+
+  /// computes the two base hashes of a key, used for double hashing
+  static void hash(const std::string &key, uint64_t &h1, uint64_t &h2);
+
+  std::vector<uint64_t> m_bits;
+  unsigned long long m_nbBits;
+  unsigned int m_nbHashes;
+  unsigned long long m_nbEntries;
+
+};
+
+#endif /* __XRD_CEPH_BLOOM_FILTER_HH__ */
@@ -0,0 +1,156 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+/*
+ * Small tool deleting lists of files, typically for dataset cleanup campaigns.
+ * Usage : xrdcephrm [-d <depth>] [-n <nbShards> [-s <dirShards>]] [-m <metaPool>]
+ *                   [-t <pool>:<coldPool>]... [<listFile>...]
+ * Paths, one per line, are read from the given files or from the standard input,
+ * with the same syntax as on the gateways, e.g. [[userId@]pool[,...]:]<path>.
+ * Removals use the ceph credentials of the caller and run in parallel, at most
+ * <depth> at a time. For pools with a name index, the numbers of shards have to
+ * match the ceph.nameindex setting of the gateways, and the metadata pool their
+ * ceph.metapool setting. Tiered pools have to be given with -t, as in their
+ * ceph.tiering setting, so that the copies of their files in the cold pools are
+ * removed too.
+ * One '<rc> <path>' line is printed per file, rc being 0 or a negative errno.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "XrdCeph/XrdCephPosix.hh"
+
+// declared and used in XrdCephPosix.cc
+extern unsigned int g_cephBulkDeleteDepth;
+
+/// number of paths handed to the removal at once
+static const size_t g_batchSize = 10000;
+
+static void logwrapper(char *format, va_list argp) {
+  vfprintf(stderr, format, argp);
+  fprintf(stderr, "\n");
+}
+
+/// registers the cold pool of a tiered pool, given as <pool>:<coldPool>.
+/// The thresholds of the moves do not matter here, no move being started
+static int addTiering(const char *arg) {
+  const char *sep = strchr(arg, ':');
+  if (0 == sep || sep == arg || 0 == sep[1]) return -EINVAL;
+  return ceph_posix_set_tiering(std::string(arg, sep - arg).c_str(), sep + 1, 1, 1);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage : %s [-d <depth>] [-n <nbShards> [-s <dirShards>]] [-m <metaPool>] "
+                  "[-t <pool>:<coldPool>]... [<listFile>...]\n", prog);
+}
+
+/// removes a batch of files and prints the results
+/// returns the number of failures
+static unsigned long long removeBatch(std::vector<std::string> &paths) {
+  std::vector<int> results;
+  unsigned long long nbFailed = 0;
+  ceph_posix_unlink_bulk(0, paths, results);
+  for (size_t i = 0; i < paths.size(); i++) {
+    printf("%d %s\n", results[i], paths[i].c_str());
+    if (results[i]) nbFailed++;
+  }
+  paths.clear();
+  return nbFailed;
+}
+
+/// removes the files listed in a stream, by batches
+static unsigned long long removeList(std::istream &input) {
+  std::vector<std::string> paths;
+  std::string path;
+  unsigned long long nbFailed = 0;
+  while (std::getline(input, path)) {
+    if (path.empty()) continue;
+    paths.push_back(path);
+    if (paths.size() >= g_batchSize) nbFailed += removeBatch(paths);
+  }
+  if (!paths.empty()) nbFailed += removeBatch(paths);
+  return nbFailed;
+}
+
+int main(int argc, char **argv) {
+  int c;
+  unsigned int nbShards = 0, dirShards = 1;
+  while ((c = getopt(argc, argv, "d:n:s:m:t:h")) != -1) {
+    switch (c) {
+    case 'd':
+      g_cephBulkDeleteDepth = strtoul(optarg, 0, 10);
+      break;
+    case 'n':
+      nbShards = strtoul(optarg, 0, 10);
+      break;
+    case 's':
+      dirShards = strtoul(optarg, 0, 10);
+      break;
+    case 'm':
+      if (ceph_posix_set_metapool(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 't':
+      if (addTiering(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (0 == g_cephBulkDeleteDepth || g_cephBulkDeleteDepth > 1024 ||
+      ceph_posix_set_nameindex(nbShards, dirShards)) {
+    usage(argv[0]);
+    return 1;
+  }
+  ceph_posix_set_logfunc(logwrapper);
+  unsigned long long nbFailed = 0;
+  if (optind == argc) {
+    nbFailed = removeList(std::cin);
+  }
+  for (int i = optind; i < argc; i++) {
+    std::ifstream input(argv[i]);
+    if (!input) {
+      fprintf(stderr, "Unable to open %s\n", argv[i]);
+      nbFailed++;
+      continue;
+    }
+    nbFailed += removeList(input);
+  }
+  ceph_posix_disconnect_all();
+  return nbFailed ? 1 : 0;
+}
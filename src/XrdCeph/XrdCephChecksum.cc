@@ -0,0 +1,337 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#include <string.h>
+#include <algorithm>
+
+#include "XrdCeph/XrdCephChecksum.hh"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define XRDCEPH_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+/// modulo of adler32
+static const uint32_t ADLER_BASE = 65521;
+/// largest number of bytes that can be summed before the adler32 sums overflow
+static const size_t ADLER_NMAX = 5552;
+/// crc32c polynomial, reflected
+static const uint32_t CRC32C_POLY = 0x82f63b78;
+/// length of each of the 3 interleaved streams of the SSE4.2 crc32c kernel
+static const size_t CRC32C_BLOCK = 4096;
+
+/// tables used by the crc32c kernels, filled at load time
+struct Crc32cTables {
+  Crc32cTables();
+  /// crc32c of single bytes, for the portable kernel
+  uint32_t bytes[256];
+  /// x^(8 * CRC32C_BLOCK - 33) and x^(16 * CRC32C_BLOCK - 33) modulo the
+  /// polynomial, used to shift the crc of a stream over the following ones
+  uint64_t shift1;
+  uint64_t shift2;
+};
+
+/// multiplies two polynomials modulo the crc32c polynomial, reflected
+static uint32_t multModP(uint32_t a, uint32_t b) {
+  uint32_t m = 1U << 31;
+  uint32_t p = 0;
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if ((a & (m - 1)) == 0) break;
+    }
+    m >>= 1;
+    b = b & 1 ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+  }
+  return p;
+}
+
+/// x^n modulo the crc32c polynomial, reflected
+static uint32_t xPowModP(unsigned long long n) {
+  uint32_t result = 1U << 31;  // x^0
+  uint32_t square = 1U << 30;  // x^1
+  while (n) {
+    if (n & 1) result = multModP(result, square);
+    square = multModP(square, square);
+    n >>= 1;
+  }
+  return result;
+}
+
+Crc32cTables::Crc32cTables() {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (unsigned int j = 0; j < 8; j++) {
+      crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+    }
+    bytes[i] = crc;
+  }
+  shift1 = xPowModP(8 * CRC32C_BLOCK - 33);
+  shift2 = xPowModP(16 * CRC32C_BLOCK - 33);
+}
+
+static const Crc32cTables g_crc32cTables;
+
+const size_t XrdCephChecksum::PageSize;
+
+uint32_t XrdCephChecksum::adler32Scalar(uint32_t adler, const unsigned char *buf, size_t len) {
+  uint32_t s1 = adler & 0xffff;
+  uint32_t s2 = adler >> 16;
+  while (len > 0) {
+    size_t n = len < ADLER_NMAX ? len : ADLER_NMAX;
+    len -= n;
+    while (n--) {
+      s1 += *buf++;
+      s2 += s1;
+    }
+    s1 %= ADLER_BASE;
+    s2 %= ADLER_BASE;
+  }
+  return (s2 << 16) | s1;
+}
+
+uint32_t XrdCephChecksum::crc32cScalar(uint32_t crc, const unsigned char *buf, size_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc = g_crc32cTables.bytes[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void XrdCephChecksum::crc32cPagesScalar(const unsigned char *buf, size_t nbPages, uint32_t *crcs) {
+  for (; nbPages > 0; nbPages--, buf += PageSize, crcs++) {
+    *crcs = crc32cScalar(0, buf, PageSize);
+  }
+}
+
+#ifdef XRDCEPH_X86_KERNELS
+
+/// sum of the 32 bits lanes of an AVX2 register
+__attribute__((target("avx2")))
+static uint32_t hsum32(__m256i v) {
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+  return _mm_cvtsi128_si32(s);
+}
+
+__attribute__((target("avx2")))
+uint32_t XrdCephChecksum::adler32Avx2(uint32_t adler, const unsigned char *buf, size_t len) {
+  uint32_t s1 = adler & 0xffff;
+  uint32_t s2 = adler >> 16;
+  // weights of the bytes of a 32 bytes block in s2
+  const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                           24, 23, 22, 21, 20, 19, 18, 17,
+                                           16, 15, 14, 13, 12, 11, 10, 9,
+                                           8, 7, 6, 5, 4, 3, 2, 1);
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i zero = _mm256_setzero_si256();
+  while (len >= 32) {
+    size_t n = len < ADLER_NMAX ? len : ADLER_NMAX;
+    n -= n % 32;
+    len -= n;
+    __m256i vs1 = _mm256_setr_epi32(s1, 0, 0, 0, 0, 0, 0, 0);
+    __m256i vs2 = _mm256_setr_epi32(s2, 0, 0, 0, 0, 0, 0, 0);
+    // sum of the values of s1 before each block, each contributing 32 times to s2
+    __m256i vs1Sum = zero;
+    for (; n > 0; n -= 32, buf += 32) {
+      __m256i data = _mm256_loadu_si256((const __m256i*)buf);
+      vs1Sum = _mm256_add_epi32(vs1Sum, vs1);
+      vs1 = _mm256_add_epi32(vs1, _mm256_sad_epu8(data, zero));
+      vs2 = _mm256_add_epi32(vs2, _mm256_madd_epi16(_mm256_maddubs_epi16(data, weights), ones));
+    }
+    vs2 = _mm256_add_epi32(vs2, _mm256_slli_epi32(vs1Sum, 5));
+    s1 = hsum32(vs1) % ADLER_BASE;
+    s2 = hsum32(vs2) % ADLER_BASE;
+  }
+  return adler32Scalar((s2 << 16) | s1, buf, len);
+}
+
+/// shifts a crc over the given number of zero bits, using a precomputed
+/// power of x and a carry-less multiplication
+__attribute__((target("sse4.2,pclmul")))
+static uint32_t crc32cShift(uint32_t crc, uint64_t power) {
+  __m128i product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(crc), _mm_cvtsi64_si128(power), 0);
+  return _mm_crc32_u64(0, _mm_cvtsi128_si64(product));
+}
+
+__attribute__((target("sse4.2,pclmul")))
+uint32_t XrdCephChecksum::crc32cSse42(uint32_t crc, const unsigned char *buf, size_t len) {
+  uint64_t crc0 = ~crc;
+  // align the data on 8 bytes
+  while (len > 0 && ((uintptr_t)buf & 7)) {
+    crc0 = _mm_crc32_u8(crc0, *buf++);
+    len--;
+  }
+  // 3 independent streams hide the latency of the crc32 instruction
+  while (len >= 3 * CRC32C_BLOCK) {
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    const unsigned char *end = buf + CRC32C_BLOCK;
+    for (; buf < end; buf += 8) {
+      uint64_t w0, w1, w2;
+      memcpy(&w0, buf, 8);
+      memcpy(&w1, buf + CRC32C_BLOCK, 8);
+      memcpy(&w2, buf + 2 * CRC32C_BLOCK, 8);
+      crc0 = _mm_crc32_u64(crc0, w0);
+      crc1 = _mm_crc32_u64(crc1, w1);
+      crc2 = _mm_crc32_u64(crc2, w2);
+    }
+    crc0 = crc32cShift(crc0, g_crc32cTables.shift2) ^ crc32cShift(crc1, g_crc32cTables.shift1) ^ crc2;
+    buf += 2 * CRC32C_BLOCK;
+    len -= 3 * CRC32C_BLOCK;
+  }
+  for (; len >= 8; len -= 8, buf += 8) {
+    uint64_t w;
+    memcpy(&w, buf, 8);
+    crc0 = _mm_crc32_u64(crc0, w);
+  }
+  while (len--) {
+    crc0 = _mm_crc32_u8(crc0, *buf++);
+  }
+  return ~(uint32_t)crc0;
+}
+
+__attribute__((target("sse4.2")))
+void XrdCephChecksum::crc32cPagesSse42(const unsigned char *buf, size_t nbPages, uint32_t *crcs) {
+  // pages are independent, so 3 of them are checksummed in parallel
+  // to hide the latency of the crc32 instruction, without any combination
+  for (; nbPages >= 3; nbPages -= 3, buf += 3 * PageSize, crcs += 3) {
+    uint64_t crc0 = 0xffffffff;
+    uint64_t crc1 = 0xffffffff;
+    uint64_t crc2 = 0xffffffff;
+    for (size_t i = 0; i < PageSize; i += 8) {
+      uint64_t w0, w1, w2;
+      memcpy(&w0, buf + i, 8);
+      memcpy(&w1, buf + PageSize + i, 8);
+      memcpy(&w2, buf + 2 * PageSize + i, 8);
+      crc0 = _mm_crc32_u64(crc0, w0);
+      crc1 = _mm_crc32_u64(crc1, w1);
+      crc2 = _mm_crc32_u64(crc2, w2);
+    }
+    crcs[0] = ~(uint32_t)crc0;
+    crcs[1] = ~(uint32_t)crc1;
+    crcs[2] = ~(uint32_t)crc2;
+  }
+  for (; nbPages > 0; nbPages--, buf += PageSize, crcs++) {
+    *crcs = crc32cSse42(0, buf, PageSize);
+  }
+}
+
+bool XrdCephChecksum::hasAvx2() {
+  return __builtin_cpu_supports("avx2");
+}
+
+bool XrdCephChecksum::hasSse42() {
+  unsigned int eax, ebx, ecx, edx;
+  __asm__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1), "c"(0));
+  // SSE4.2 is bit 20 and PCLMULQDQ bit 1 of ecx
+  return (ecx & (1U << 20)) && (ecx & (1U << 1));
+}
+
+#else
+
+uint32_t XrdCephChecksum::adler32Avx2(uint32_t adler, const unsigned char *buf, size_t len) {
+  return adler32Scalar(adler, buf, len);
+}
+
+uint32_t XrdCephChecksum::crc32cSse42(uint32_t crc, const unsigned char *buf, size_t len) {
+  return crc32cScalar(crc, buf, len);
+}
+
+void XrdCephChecksum::crc32cPagesSse42(const unsigned char *buf, size_t nbPages, uint32_t *crcs) {
+  crc32cPagesScalar(buf, nbPages, crcs);
+}
+
+bool XrdCephChecksum::hasAvx2() {
+  return false;
+}
+
+bool XrdCephChecksum::hasSse42() {
+  return false;
+}
+
+#endif
+
+uint32_t XrdCephChecksum::adler32(uint32_t adler, const unsigned char *buf, size_t len) {
+  static const bool useAvx2 = hasAvx2();
+  if (useAvx2) return adler32Avx2(adler, buf, len);
+  return adler32Scalar(adler, buf, len);
+}
+
+uint32_t XrdCephChecksum::crc32c(uint32_t crc, const unsigned char *buf, size_t len) {
+  static const bool useSse42 = hasSse42();
+  if (useSse42) return crc32cSse42(crc, buf, len);
+  return crc32cScalar(crc, buf, len);
+}
+
+size_t XrdCephChecksum::pageCount(unsigned long long offset, size_t len) {
+  if (0 == len) return 0;
+  return (offset + len - 1) / PageSize - offset / PageSize + 1;
+}
+
+void XrdCephChecksum::pageCrc32c(const unsigned char *buf, size_t len, unsigned long long offset,
+                                 uint32_t *csvec) {
+  static const bool useSse42 = hasSse42();
+  // partial first page
+  size_t head = (PageSize - offset % PageSize) % PageSize;
+  if (head > 0 && len > 0) {
+    if (head > len) head = len;
+    *csvec++ = crc32c(0, buf, head);
+    buf += head;
+    len -= head;
+  }
+  size_t nbPages = len / PageSize;
+  if (useSse42) crc32cPagesSse42(buf, nbPages, csvec);
+  else crc32cPagesScalar(buf, nbPages, csvec);
+  buf += nbPages * PageSize;
+  len -= nbPages * PageSize;
+  // partial last page
+  if (len > 0) csvec[nbPages] = crc32c(0, buf, len);
+}
+
+uint32_t XrdCephChecksum::crc32cCombine(uint32_t crc1, uint32_t crc2, unsigned long long len2) {
+  // appending len2 bytes multiplies the crc of the first buffer by x^(8*len2),
+  // the initial and final inversions of both crcs cancel each other
+  return multModP(xPowModP(8 * len2), crc1) ^ crc2;
+}
+
+bool XrdCephChecksum::stripedCrc32c(const std::vector<std::vector<uint32_t> > &objectCrcs,
+                                    unsigned long long size, unsigned long long stripeUnit,
+                                    unsigned long long stripeCount, unsigned long long objectSize,
+                                    uint32_t &crc) {
+  unsigned long long stripesPerObject = objectSize / stripeUnit;
+  crc = 0;
+  // walk the stripe units in the order of the file, as libradosstriper lays
+  // them out round robin over stripeCount objects
+  for (unsigned long long blockNo = 0; blockNo * stripeUnit < size; blockNo++) {
+    unsigned long long stripeNo = blockNo / stripeCount;
+    unsigned long long objectNo = (stripeNo / stripesPerObject) * stripeCount + blockNo % stripeCount;
+    unsigned long long unitNo = stripeNo % stripesPerObject;
+    if (objectNo >= objectCrcs.size() || unitNo >= objectCrcs[objectNo].size()) return false;
+    unsigned long long len = std::min(stripeUnit, size - blockNo * stripeUnit);
+    crc = crc32cCombine(crc, objectCrcs[objectNo][unitNo], len);
+  }
+  return true;
+}
@@ -0,0 +1,104 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#ifndef __XRD_CEPH_CHECKSUM_HH__
+#define __XRD_CEPH_CHECKSUM_HH__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//! Checksum kernels used to compute adler32 and crc32c while files are written.
+//!
+//! Both functions can be called incrementally, passing the value returned for
+//! the previous part of the data, and starting from 1 for adler32 and 0 for
+//! crc32c, as zlib does. The fastest kernel supported by the CPU is used :
+//! AVX2 for adler32, SSE4.2 with 3 interleaved streams combined by carry-less
+//! multiplications (PCLMUL) for crc32c, and portable code otherwise.
+//!
+//! crc32c values can also be combined, so that the checksum of a striped file
+//! is obtained from the checksums of its pieces computed where they are stored.
+//------------------------------------------------------------------------------
+
+class XrdCephChecksum {
+
+public:
+
+  /// adler32 of a buffer, continuing from a previous value
+  static uint32_t adler32(uint32_t adler, const unsigned char *buf, size_t len);
+
+  /// crc32c (Castagnoli) of a buffer, continuing from a previous value
+  static uint32_t crc32c(uint32_t crc, const unsigned char *buf, size_t len);
+
+  /// size of the pages of page checksummed reads and writes
+  static const size_t PageSize = 4096;
+
+  /// number of page checksums covering len bytes at the given offset of a file
+  static size_t pageCount(unsigned long long offset, size_t len);
+
+  //------------------------------------------------------------------------------
+  //! crc32c of each page covered by len bytes at the given offset of a file,
+  //! as pgRead and pgWrite expect them : when offset is not aligned, the first
+  //! checksum only covers the data up to the next page boundary, and the last
+  //! one covers the end of the data. Full pages are checksummed 3 at a time
+  //------------------------------------------------------------------------------
+  static void pageCrc32c(const unsigned char *buf, size_t len, unsigned long long offset,
+                         uint32_t *csvec);
+
+  //------------------------------------------------------------------------------
+  //! Individual kernels, exposed for tests and benchmarks. The SIMD ones must
+  //! only be called when supported by the CPU
+  //------------------------------------------------------------------------------
+  static uint32_t adler32Scalar(uint32_t adler, const unsigned char *buf, size_t len);
+  static uint32_t adler32Avx2(uint32_t adler, const unsigned char *buf, size_t len);
+  static uint32_t crc32cScalar(uint32_t crc, const unsigned char *buf, size_t len);
+  static uint32_t crc32cSse42(uint32_t crc, const unsigned char *buf, size_t len);
+  static void crc32cPagesScalar(const unsigned char *buf, size_t nbPages, uint32_t *crcs);
+  static void crc32cPagesSse42(const unsigned char *buf, size_t nbPages, uint32_t *crcs);
+
+  /// crc32c of the concatenation of two buffers, from their crc32c and the
+  /// length of the second one
+  static uint32_t crc32cCombine(uint32_t crc1, uint32_t crc2, unsigned long long len2);
+
+  //------------------------------------------------------------------------------
+  //! crc32c of a file striped by libradosstriper, from the crc32c of its stripe
+  //! units as computed by the OSDs. objectCrcs[n] lists the crc32c of the stripe
+  //! units of object n, in the order they are stored in the object
+  //! returns false if the crc32c of a stripe unit is missing
+  //------------------------------------------------------------------------------
+  static bool stripedCrc32c(const std::vector<std::vector<uint32_t> > &objectCrcs,
+                            unsigned long long size, unsigned long long stripeUnit,
+                            unsigned long long stripeCount, unsigned long long objectSize,
+                            uint32_t &crc);
+
+  /// whether the CPU supports the AVX2 kernel
+  static bool hasAvx2();
+
+  /// whether the CPU supports the SSE4.2 and PCLMUL kernel
+  static bool hasSse42();
+
+};
+
+#endif /* __XRD_CEPH_CHECKSUM_HH__ */
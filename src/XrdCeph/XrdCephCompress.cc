@@ -0,0 +1,197 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "XrdCeph/XrdCephCompress.hh"
+
+#ifdef XRDCEPH_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef XRDCEPH_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/// fraction of a block a compression must save for the block to be stored
+/// compressed : decompressing nearly incompressible data is not worth it
+static const size_t MIN_SAVING_DIVISOR = 16;
+/// default zstd level, favouring speed as blocks are compressed on the write path
+static const int ZSTD_DEFAULT_LEVEL = 1;
+/// version of the encoding of the map header
+static const unsigned int HEADER_VERSION = 1;
+
+bool XrdCephCompress::codecFromName(const std::string &name, Codec &codec) {
+  if (name == "none") codec = NONE;
+  else if (name == "lz4") codec = LZ4;
+  else if (name == "zstd") codec = ZSTD;
+  else return false;
+  return true;
+}
+
+const char* XrdCephCompress::codecName(Codec codec) {
+  switch (codec) {
+  case LZ4: return "lz4";
+  case ZSTD: return "zstd";
+  default: return "none";
+  }
+}
+
+bool XrdCephCompress::available(Codec codec) {
+  switch (codec) {
+  case NONE: return true;
+#ifdef XRDCEPH_HAVE_LZ4
+  case LZ4: return true;
+#endif
+#ifdef XRDCEPH_HAVE_ZSTD
+  case ZSTD: return true;
+#endif
+  default: return false;
+  }
+}
+
+uint32_t XrdCephCompress::compress(Codec codec, int level, const char *in, size_t len,
+                                   std::string &out) {
+  out.clear();
+  size_t maxLen = len - len / MIN_SAVING_DIVISOR;
+  size_t outLen = 0;
+  switch (codec) {
+#ifdef XRDCEPH_HAVE_LZ4
+  case LZ4: {
+    out.resize(LZ4_compressBound(len));
+    // the level is the acceleration of lz4, trading ratio for speed
+    int rc = LZ4_compress_fast(in, &out[0], len, out.size(), level > 0 ? level : 1);
+    if (rc > 0) outLen = rc;
+    break;
+  }
+#endif
+#ifdef XRDCEPH_HAVE_ZSTD
+  case ZSTD: {
+    out.resize(ZSTD_compressBound(len));
+    size_t rc = ZSTD_compress(&out[0], out.size(), in, len,
+                              level > 0 ? level : ZSTD_DEFAULT_LEVEL);
+    if (!ZSTD_isError(rc)) outLen = rc;
+    break;
+  }
+#endif
+  default:
+    break;
+  }
+  if (0 == outLen || outLen > maxLen) {
+    out.clear();
+    return len | RawBlock;
+  }
+  out.resize(outLen);
+  return outLen;
+}
+
+long XrdCephCompress::decompress(Codec codec, const char *in, size_t len,
+                                 char *out, size_t outLen) {
+  switch (codec) {
+#ifdef XRDCEPH_HAVE_LZ4
+  case LZ4: {
+    int rc = LZ4_decompress_safe(in, out, len, outLen);
+    return rc < 0 ? -1 : rc;
+  }
+#endif
+#ifdef XRDCEPH_HAVE_ZSTD
+  case ZSTD: {
+    size_t rc = ZSTD_decompress(out, outLen, in, len);
+    return ZSTD_isError(rc) ? -1 : (long)rc;
+  }
+#endif
+  default:
+    return -1;
+  }
+}
+
+std::string XrdCephBlockMap::encodeHeader() const {
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%u %s %d %llu %llu %lu", HEADER_VERSION,
+           XrdCephCompress::codecName(codec), level, blockSize, size,
+           (unsigned long)entries.size());
+  return buf;
+}
+
+bool XrdCephBlockMap::decodeHeader(const std::string &header, size_t &nbEntries) {
+  unsigned int version;
+  char codecBuf[16];
+  unsigned long n;
+  if (sscanf(header.c_str(), "%u %15s %d %llu %llu %lu", &version, codecBuf, &level,
+             &blockSize, &size, &n) != 6) {
+    return false;
+  }
+  if (version != HEADER_VERSION || 0 == blockSize || !XrdCephCompress::codecFromName(codecBuf, codec)) {
+    return false;
+  }
+  // the map cannot have entries beyond the end of the file
+  if (n > (size + blockSize - 1) / blockSize) return false;
+  nbEntries = n;
+  entries.assign(n, 0);
+  return true;
+}
+
+std::string XrdCephBlockMap::encodeChunk(size_t chunkNo) const {
+  size_t first = chunkNo * ChunkEntries;
+  size_t last = std::min(entries.size(), first + ChunkEntries);
+  std::string chunk;
+  chunk.reserve((last - first) * 4);
+  // little endian, whatever the host
+  for (size_t i = first; i < last; i++) {
+    for (unsigned int b = 0; b < 4; b++) chunk += (char)((entries[i] >> (8 * b)) & 0xff);
+  }
+  return chunk;
+}
+
+bool XrdCephBlockMap::decodeChunk(size_t chunkNo, const std::string &chunk) {
+  size_t first = chunkNo * ChunkEntries;
+  if (first >= entries.size()) return false;
+  size_t last = std::min(entries.size(), first + ChunkEntries);
+  if (chunk.size() != (last - first) * 4) return false;
+  const unsigned char *p = (const unsigned char*)chunk.data();
+  for (size_t i = first; i < last; i++, p += 4) {
+    entries[i] = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    if (XrdCephCompress::storedLength(entries[i]) > blockSize) return false;
+  }
+  return true;
+}
+
+unsigned long long XrdCephBlockMap::blockLength(unsigned long long blockNo) const {
+  unsigned long long start = blockNo * blockSize;
+  if (start >= size) return 0;
+  return std::min(blockSize, size - start);
+}
+
+void XrdCephBlockMap::setEntry(unsigned long long blockNo, uint32_t entry) {
+  if (blockNo >= entries.size()) entries.resize(blockNo + 1, 0);
+  entries[blockNo] = entry;
+}
+
+void XrdCephBlockMap::truncate(unsigned long long newSize) {
+  size = newSize;
+  size_t nbBlocks = (newSize + blockSize - 1) / blockSize;
+  if (entries.size() > nbBlocks) entries.resize(nbBlocks);
+}
@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+
+#ifndef __XRD_CEPH_COMPRESS_HH__
+#define __XRD_CEPH_COMPRESS_HH__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//! Codecs of the compressed files, and map of their blocks.
+//!
+//! Compressed files are cut in blocks of one stripe unit, compressed one by
+//! one and stored at their own offset, so that a block is read and decompressed
+//! on its own and the rest of its stripe unit is left unwritten. The map gives
+//! the stored length of each block and is kept in xattrs of the first object.
+//! Blocks that would not shrink enough are stored as is. The codecs available
+//! depend on the libraries found at build time.
+//------------------------------------------------------------------------------
+
+class XrdCephCompress {
+
+public:
+
+  enum Codec { NONE = 0, LZ4 = 1, ZSTD = 2 };
+
+  /// codec of a name, as used in the configuration. Returns false if unknown
+  static bool codecFromName(const std::string &name, Codec &codec);
+
+  static const char* codecName(Codec codec);
+
+  /// whether a codec was compiled in. NONE always is
+  static bool available(Codec codec);
+
+  /// flag of the map entries of blocks stored as is
+  static const uint32_t RawBlock = 0x80000000;
+
+  //------------------------------------------------------------------------------
+  //! compresses a block with the given codec and level, 0 meaning the default
+  //! one. Returns the map entry of the block : its stored length, with RawBlock
+  //! set when it is stored as is. out then stays empty
+  //------------------------------------------------------------------------------
+  static uint32_t compress(Codec codec, int level, const char *in, size_t len,
+                           std::string &out);
+
+  //------------------------------------------------------------------------------
+  //! decompresses a block stored with the given codec into out, of capacity outLen.
+  //! Returns the length of the block, which may be shorter than the capacity,
+  //! or -1 if the stored data is corrupted
+  //------------------------------------------------------------------------------
+  static long decompress(Codec codec, const char *in, size_t len, char *out, size_t outLen);
+
+  static size_t storedLength(uint32_t entry) { return entry & ~RawBlock; }
+  static bool isRaw(uint32_t entry) { return (entry & RawBlock) != 0; }
+
+};
+
+//------------------------------------------------------------------------------
+//! Map of the blocks of a compressed file. Its header holds the codec, block
+//! size and size of the file, its entries are split in chunks of fixed size
+//! so that each chunk fits in one xattr
+//------------------------------------------------------------------------------
+
+class XrdCephBlockMap {
+
+public:
+
+  XrdCephBlockMap() : codec(XrdCephCompress::NONE), level(0), blockSize(0), size(0) {}
+
+  /// number of entries per chunk
+  static const size_t ChunkEntries = 4096;
+
+  std::string encodeHeader() const;
+
+  /// decodes a header, giving the number of entries still to be decoded from chunks.
+  /// Returns false if the header is invalid
+  bool decodeHeader(const std::string &header, size_t &nbEntries);
+
+  size_t nbChunks() const { return (entries.size() + ChunkEntries - 1) / ChunkEntries; }
+
+  std::string encodeChunk(size_t chunkNo) const;
+
+  /// decodes a chunk into the entries, which must already have their final
+  /// number. Returns false if the chunk does not match them
+  bool decodeChunk(size_t chunkNo, const std::string &chunk);
+
+  /// logical length of a block, given the size of the file
+  unsigned long long blockLength(unsigned long long blockNo) const;
+
+  /// sets the entry of a block, extending the map if needed
+  void setEntry(unsigned long long blockNo, uint32_t entry);
+
+  /// entry of a block, 0 for blocks never written
+  uint32_t entry(unsigned long long blockNo) const {
+    return blockNo < entries.size() ? entries[blockNo] : 0;
+  }
+
+  /// drops the blocks beyond a new size of the file. The last block kept must
+  /// be rewritten by the caller when the new size cuts it
+  void truncate(unsigned long long newSize);
+
+  XrdCephCompress::Codec codec;
+  int level;
+  unsigned long long blockSize;
+  /// logical size of the file
+  unsigned long long size;
+  std::vector<uint32_t> entries;
+
+};
+
+#endif /* __XRD_CEPH_COMPRESS_HH__ */
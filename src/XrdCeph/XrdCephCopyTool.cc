@@ -0,0 +1,110 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+/*
+ * Small tool copying a file within a ceph cluster, the OSDs copying its objects.
+ * Usage : xrdcephcp [-n <nbShards> [-s <dirShards>]] [-m <metaPool>]
+ *                   [-t <pool>:<coldPool>]... <source> <destination>
+ * Paths have the same syntax as on the gateways, e.g. [[userId@]pool[,...]:]<path>,
+ * and may be in different pools of the cluster. The destination is replaced if
+ * it exists. The copy uses the ceph credentials of the caller. For pools with a
+ * name index, the numbers of shards have to match the ceph.nameindex setting of
+ * the gateways, and the metadata pool their ceph.metapool setting. Tiered pools have to be given with -t, as in their ceph.tiering
+ * setting, so that sources moved to a cold pool are moved back before the copy
+ * and replaced destinations lose their cold copy.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <exception>
+#include <string>
+
+#include "XrdCeph/XrdCephPosix.hh"
+
+static void logwrapper(char *format, va_list argp) {
+  vfprintf(stderr, format, argp);
+  fprintf(stderr, "\n");
+}
+
+/// registers the cold pool of a tiered pool, given as <pool>:<coldPool>.
+/// The thresholds of the moves do not matter here, no move being started
+static int addTiering(const char *arg) {
+  const char *sep = strchr(arg, ':');
+  if (0 == sep || sep == arg || 0 == sep[1]) return -EINVAL;
+  return ceph_posix_set_tiering(std::string(arg, sep - arg).c_str(), sep + 1, 1, 1);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage : %s [-n <nbShards> [-s <dirShards>]] [-m <metaPool>] "
+                  "[-t <pool>:<coldPool>]... <source> <destination>\n", prog);
+}
+
+int main(int argc, char **argv) {
+  int c;
+  unsigned int nbShards = 0, dirShards = 1;
+  while ((c = getopt(argc, argv, "n:s:m:t:h")) != -1) {
+    switch (c) {
+    case 'n':
+      nbShards = strtoul(optarg, 0, 10);
+      break;
+    case 's':
+      dirShards = strtoul(optarg, 0, 10);
+      break;
+    case 'm':
+      if (ceph_posix_set_metapool(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 't':
+      if (addTiering(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (argc - optind != 2 || ceph_posix_set_nameindex(nbShards, dirShards)) {
+    usage(argv[0]);
+    return 1;
+  }
+  ceph_posix_set_logfunc(logwrapper);
+  int rc;
+  try {
+    rc = ceph_posix_copy(0, argv[optind], 0, argv[optind + 1]);
+  } catch (std::exception &e) {
+    rc = -EINVAL;
+  }
+  if (rc) {
+    fprintf(stderr, "Unable to copy %s to %s : %s\n", argv[optind], argv[optind + 1], strerror(-rc));
+  }
+  ceph_posix_disconnect_all();
+  return rc ? 1 : 0;
+}
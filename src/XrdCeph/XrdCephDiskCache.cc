@@ -0,0 +1,243 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <vector>
+
+#include "XrdCeph/XrdCephDiskCache.hh"
+
+/// magic string at the beginning of cache files, including a format version
+static const char g_diskCacheMagic[8] = {'X','R','D','C','D','C','0','2'};
+/// size of the fixed part of the header : magic, version, segment index,
+/// segment size, data size and key length
+static const size_t g_diskCacheFixedHeaderSize = sizeof(g_diskCacheMagic) + 4*8 + 4;
+
+/// 64 bits FNV-1a hash, used for checksumming headers and naming files
+static uint64_t fnv64(const char *data, size_t len, uint64_t h = 14695981039346656037ULL) {
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)data[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+XrdCephDiskCache::XrdCephDiskCache(const std::string &dir, unsigned long long maxSize,
+                                   unsigned long long segmentSize) :
+  m_dir(dir), m_maxSize(maxSize), m_segmentSize(segmentSize), m_usedSize(0),
+  m_tmpCounter(0) {}
+
+std::string XrdCephDiskCache::path(const SegmentKey &key) const {
+  char name[40];
+  snprintf(name, sizeof(name), "/%016llx.%016llx",
+           (unsigned long long)fnv64(key.first.c_str(), key.first.size()), key.second);
+  return m_dir + name;
+}
+
+long long XrdCephDiskCache::readHeader(int fd, SegmentKey &key, unsigned long long &version,
+                                       unsigned long long &size) const {
+  char fixed[g_diskCacheFixedHeaderSize];
+  if (pread(fd, fixed, sizeof(fixed), 0) != (ssize_t)sizeof(fixed)) return -1;
+  if (memcmp(fixed, g_diskCacheMagic, sizeof(g_diskCacheMagic))) return -1;
+  uint64_t v, segment, segSize, s;
+  uint32_t keyLen;
+  const char *p = fixed + sizeof(g_diskCacheMagic);
+  memcpy(&v, p, 8);
+  memcpy(&segment, p + 8, 8);
+  memcpy(&segSize, p + 16, 8);
+  memcpy(&s, p + 24, 8);
+  memcpy(&keyLen, p + 32, 4);
+  if (keyLen > 65536 || segSize != m_segmentSize || s > segSize) return -1;
+  std::vector<char> rest(keyLen + 8);
+  if (pread(fd, &rest[0], rest.size(), sizeof(fixed)) != (ssize_t)rest.size()) return -1;
+  uint64_t checksum;
+  memcpy(&checksum, &rest[keyLen], 8);
+  if (checksum != fnv64(&rest[0], keyLen, fnv64(fixed, sizeof(fixed)))) return -1;
+  key.first.assign(&rest[0], keyLen);
+  key.second = segment;
+  version = v;
+  size = s;
+  return sizeof(fixed) + rest.size();
+}
+
+long long XrdCephDiskCache::load() {
+  DIR *dir = opendir(m_dir.c_str());
+  if (0 == dir) return -errno;
+  // collect valid entries with their modification time, dropping the others
+  typedef std::pair<time_t, std::string> FoundFile;
+  std::vector<FoundFile> found;
+  struct dirent *ent;
+  while ((ent = readdir(dir))) {
+    if ('.' == ent->d_name[0] && strncmp(ent->d_name, ".tmp.", 5)) continue;
+    std::string p = m_dir + '/' + ent->d_name;
+    struct stat st;
+    if (stat(p.c_str(), &st) || !S_ISREG(st.st_mode)) continue;
+    found.push_back(FoundFile(st.st_mtime, p));
+  }
+  closedir(dir);
+  std::sort(found.begin(), found.end());
+  XrdSysMutexHelper lock(m_mutex);
+  for (std::vector<FoundFile>::const_iterator it = found.begin(); it != found.end(); it++) {
+    SegmentKey key;
+    unsigned long long version, size;
+    long long hdrSize = -1;
+    int fd = open(it->second.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      hdrSize = readHeader(fd, key, version, size);
+      struct stat st;
+      if (hdrSize >= 0 && (fstat(fd, &st) || (unsigned long long)st.st_size != hdrSize + size)) {
+        hdrSize = -1;
+      }
+      close(fd);
+    }
+    // temporary files, corrupted files, files of another segment size and files
+    // not where they should be are dropped
+    if (hdrSize < 0 || path(key) != it->second) {
+      unlink(it->second.c_str());
+      continue;
+    }
+    insert(key, version, size);
+  }
+  return m_entries.size();
+}
+
+void XrdCephDiskCache::insert(const SegmentKey &key, unsigned long long version,
+                              unsigned long long size) {
+  Entry &e = m_entries[key];
+  e.version = version;
+  e.size = size;
+  m_lru.push_front(key);
+  e.pos = m_lru.begin();
+  m_usedSize += size;
+  while (m_usedSize > m_maxSize && !m_lru.empty()) {
+    drop(m_entries.find(m_lru.back()));
+  }
+}
+
+void XrdCephDiskCache::drop(EntryMap::iterator it) {
+  unlink(path(it->first).c_str());
+  m_usedSize -= it->second.size;
+  m_lru.erase(it->second.pos);
+  m_entries.erase(it);
+}
+
+long long XrdCephDiskCache::read(const std::string &file, unsigned long long version,
+                                 unsigned long long segment, size_t offset, size_t len,
+                                 char *buf) {
+  SegmentKey key(file, segment);
+  unsigned long long size;
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    EntryMap::iterator it = m_entries.find(key);
+    if (it == m_entries.end()) return -1;
+    if (it->second.version != version) {
+      // the file was modified since this segment was cached
+      drop(it);
+      return -1;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second.pos);
+    size = it->second.size;
+  }
+  if (offset >= size) return 0;
+  if (size - offset < len) len = size - offset;
+  // the entry may be replaced or evicted concurrently, hence the header check
+  int fd = open(path(key).c_str(), O_RDONLY);
+  if (fd < 0) return -1;
+  SegmentKey foundKey;
+  unsigned long long foundVersion, foundSize;
+  long long hdrSize = readHeader(fd, foundKey, foundVersion, foundSize);
+  long long rc = -1;
+  if (hdrSize >= 0 && foundKey == key && foundVersion == version && foundSize == size) {
+    rc = pread(fd, buf, len, hdrSize + offset);
+    if (rc != (long long)len) rc = -1;
+  }
+  close(fd);
+  return rc;
+}
+
+void XrdCephDiskCache::write(const std::string &file, unsigned long long version,
+                             unsigned long long segment, const char *data, size_t len) {
+  if (len > m_maxSize || len > m_segmentSize) return;
+  SegmentKey key(file, segment);
+  std::string header(g_diskCacheMagic, sizeof(g_diskCacheMagic));
+  uint64_t v = version, s = segment, segSize = m_segmentSize, l = len;
+  uint32_t keyLen = file.size();
+  header.append((const char*)&v, 8);
+  header.append((const char*)&s, 8);
+  header.append((const char*)&segSize, 8);
+  header.append((const char*)&l, 8);
+  header.append((const char*)&keyLen, 4);
+  header.append(file);
+  uint64_t checksum = fnv64(header.c_str(), header.size());
+  header.append((const char*)&checksum, 8);
+  // write to a temporary file first, so that entries are never seen partially written
+  char tmpName[32];
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    snprintf(tmpName, sizeof(tmpName), "/.tmp.%llu", m_tmpCounter++);
+  }
+  std::string tmpPath = m_dir + tmpName;
+  int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) return;
+  bool ok = ::write(fd, header.c_str(), header.size()) == (ssize_t)header.size() &&
+            ::write(fd, data, len) == (ssize_t)len;
+  close(fd);
+  if (!ok) {
+    unlink(tmpPath.c_str());
+    return;
+  }
+  XrdSysMutexHelper lock(m_mutex);
+  std::string finalPath = path(key);
+  // note that hash collisions of file names are caught by the header check in read
+  EntryMap::iterator it = m_entries.find(key);
+  if (it != m_entries.end()) drop(it);
+  if (rename(tmpPath.c_str(), finalPath.c_str())) {
+    unlink(tmpPath.c_str());
+    return;
+  }
+  insert(key, version, len);
+}
+
+void XrdCephDiskCache::invalidate(const std::string &file) {
+  XrdSysMutexHelper lock(m_mutex);
+  EntryMap::iterator it = m_entries.lower_bound(SegmentKey(file, 0));
+  while (it != m_entries.end() && it->first.first == file) {
+    EntryMap::iterator next = it;
+    next++;
+    drop(it);
+    it = next;
+  }
+}
+
+void XrdCephDiskCache::stats(unsigned long long &usedSize, unsigned long long &nbEntries) {
+  XrdSysMutexHelper lock(m_mutex);
+  usedSize = m_usedSize;
+  nbEntries = m_entries.size();
+}
@@ -0,0 +1,146 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#ifndef __XRD_CEPH_DISK_CACHE_HH__
+#define __XRD_CEPH_DISK_CACHE_HH__
+
+#include <list>
+#include <map>
+#include <string>
+#include <stdint.h>
+#include "XrdSys/XrdSysPthread.hh"
+
+//------------------------------------------------------------------------------
+//! Cache of file segments on a local disk, typically an SSD or NVMe drive.
+//!
+//! Files are cut in segments of a fixed size, whatever their layout in ceph.
+//! Segments are stored one per local file, with a small header holding the
+//! file key, the segment index and size, and the version of the file the
+//! data belong to. The header is checksummed, and reading a segment with a different
+//! version than the stored one is a miss that drops the stale entry.
+//!
+//! The cache survives restarts : existing entries are indexed at load time,
+//! the most recently written being considered the most recently used, and
+//! entries written with another segment size being dropped.
+//! Eviction is LRU, keeping the data stored below the configured size.
+//------------------------------------------------------------------------------
+
+class XrdCephDiskCache {
+
+public:
+
+  //------------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param  dir          local directory holding the cache entries
+  //! @param  maxSize      maximum amount of data stored, in bytes
+  //! @param  segmentSize  size of the cached segments, in bytes
+  //------------------------------------------------------------------------------
+  XrdCephDiskCache(const std::string &dir, unsigned long long maxSize,
+                   unsigned long long segmentSize);
+
+  //------------------------------------------------------------------------------
+  //! Indexes the entries already present in the cache directory,
+  //! dropping invalid ones
+  //!
+  //! @return the number of entries found or -errno
+  //------------------------------------------------------------------------------
+  long long load();
+
+  //------------------------------------------------------------------------------
+  //! Reads part of a segment from the cache
+  //!
+  //! @param  offset  offset of the data to read within the segment
+  //! @return -1 on cache miss, otherwise the number of bytes read, which is
+  //!         smaller than len when the segment is the last one of the file
+  //------------------------------------------------------------------------------
+  long long read(const std::string &file, unsigned long long version,
+                 unsigned long long segment, size_t offset, size_t len, char *buf);
+
+  //------------------------------------------------------------------------------
+  //! Stores a segment in the cache. len is smaller than the segment size only
+  //! for the last segment of a file. Failures are silently ignored
+  //------------------------------------------------------------------------------
+  void write(const std::string &file, unsigned long long version,
+             unsigned long long segment, const char *data, size_t len);
+
+  //------------------------------------------------------------------------------
+  //! Drops all cached segments of a file
+  //------------------------------------------------------------------------------
+  void invalidate(const std::string &file);
+
+  //------------------------------------------------------------------------------
+  //! Size of the cached segments
+  //------------------------------------------------------------------------------
+  unsigned long long segmentSize() const { return m_segmentSize; }
+
+  //------------------------------------------------------------------------------
+  //! Fills the usage of the cache
+  //------------------------------------------------------------------------------
+  void stats(unsigned long long &usedSize, unsigned long long &nbEntries);
+
+private:
+
+  /// identifier of a segment
+  typedef std::pair<std::string, unsigned long long> SegmentKey;
+
+  /// a cached segment
+  struct Entry {
+    unsigned long long version;
+    unsigned long long size;
+    std::list<SegmentKey>::iterator pos;
+  };
+
+  typedef std::map<SegmentKey, Entry> EntryMap;
+
+  /// local path of the file holding a segment
+  std::string path(const SegmentKey &key) const;
+
+  /// reads and checks the header of a cache file. On success, fills key,
+  /// version and data size, and returns the size of the header. Returns -1
+  /// otherwise, including for segments of another size than the cache's ones
+  long long readHeader(int fd, SegmentKey &key, unsigned long long &version,
+                       unsigned long long &size) const;
+
+  /// adds an entry to the index, evicting older ones if needed
+  /// Must be called with the mutex held
+  void insert(const SegmentKey &key, unsigned long long version, unsigned long long size);
+
+  /// drops an entry and its file. Must be called with the mutex held
+  void drop(EntryMap::iterator it);
+
+  std::string m_dir;
+  unsigned long long m_maxSize;
+  unsigned long long m_segmentSize;
+  unsigned long long m_usedSize;
+  /// counter making names of temporary files unique
+  unsigned long long m_tmpCounter;
+  EntryMap m_entries;
+  /// LRU list, most recently used first
+  std::list<SegmentKey> m_lru;
+  XrdSysMutex m_mutex;
+
+};
+
+#endif /* __XRD_CEPH_DISK_CACHE_HH__ */
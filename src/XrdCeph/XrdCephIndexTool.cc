@@ -0,0 +1,110 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+/*
+ * Small tool rebuilding the name index of a pool from a full scan of it.
+ * Usage : xrdcephindex -n <nbShards> [-s <dirShards>] [-m <metaPool>] [-t <nbThreads>]
+ *                      [-r <nbRanges>] [[userId@]pool]
+ * The numbers of shards have to match the ceph.nameindex setting of the gateways,
+ * and the metadata pool their ceph.metapool setting. Changing any of them needs
+ * a rebuild.
+ * The new index is built next to the current one, which stays in use until
+ * the new one is complete.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <exception>
+
+#include "XrdCeph/XrdCephPosix.hh"
+
+// declared and used in XrdCephPosix.cc
+extern unsigned int g_cephListNbThreads;
+extern unsigned int g_cephListNbRanges;
+
+static void logwrapper(char *format, va_list argp) {
+  vfprintf(stderr, format, argp);
+  fprintf(stderr, "\n");
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage : %s -n <nbShards> [-s <dirShards>] [-m <metaPool>] [-t <nbThreads>] "
+                  "[-r <nbRanges>] [[userId@]pool]\n", prog);
+}
+
+int main(int argc, char **argv) {
+  int c;
+  unsigned int nbShards = 0, dirShards = 1;
+  while ((c = getopt(argc, argv, "n:s:m:t:r:h")) != -1) {
+    switch (c) {
+    case 'n':
+      nbShards = strtoul(optarg, 0, 10);
+      break;
+    case 's':
+      dirShards = strtoul(optarg, 0, 10);
+      break;
+    case 'm':
+      if (ceph_posix_set_metapool(optarg)) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 't':
+      g_cephListNbThreads = strtoul(optarg, 0, 10);
+      break;
+    case 'r':
+      g_cephListNbRanges = strtoul(optarg, 0, 10);
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (0 == nbShards || ceph_posix_set_nameindex(nbShards, dirShards) ||
+      0 == g_cephListNbThreads || 0 == g_cephListNbRanges || argc - optind > 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  ceph_posix_set_logfunc(logwrapper);
+  std::string path = "/";
+  if (optind < argc) {
+    path = std::string(argv[optind]) + ":/";
+  }
+  int rc;
+  try {
+    rc = ceph_posix_rebuild_index(0, path.c_str());
+  } catch (std::exception &e) {
+    fprintf(stderr, "Invalid syntax for pool : %s\n", argv[optind]);
+    return 1;
+  }
+  ceph_posix_disconnect_all();
+  if (rc < 0) {
+    fprintf(stderr, "Rebuilding of the name index failed : %s\n", strerror(-rc));
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,422 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "XrdCeph/XrdCephMetaCache.hh"
+
+/// magic string at the beginning of log files, including a format version
+static const char g_metaCacheMagic[8] = {'X','R','D','C','M','C','0','1'};
+
+/// 32 bits FNV-1a checksum protecting records of the log
+static uint32_t recordChecksum(const char *data, size_t len) {
+  uint32_t h = 2166136261U;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)data[i];
+    h *= 16777619U;
+  }
+  return h;
+}
+
+/// helpers serializing integers and strings in native byte order
+/// the log is a local file, never shared between machines
+template<typename T> static void putInt(std::string &s, T v) {
+  s.append((const char*)&v, sizeof(T));
+}
+
+static void putString(std::string &s, const std::string &v) {
+  putInt<uint32_t>(s, v.size());
+  s.append(v);
+}
+
+/// helpers deserializing integers and strings, checking bounds
+template<typename T> static bool getInt(const char *&p, const char *end, T &v) {
+  if ((size_t)(end - p) < sizeof(T)) return false;
+  memcpy(&v, p, sizeof(T));
+  p += sizeof(T);
+  return true;
+}
+
+/// builds a log record : its length and checksum, followed by its body
+static std::string makeRecord(uint8_t type, const std::string &key,
+                              const std::string &payload) {
+  std::string body;
+  putInt<uint8_t>(body, type);
+  putString(body, key);
+  body.append(payload);
+  std::string record;
+  putInt<uint32_t>(record, body.size());
+  putInt<uint32_t>(record, recordChecksum(body.c_str(), body.size()));
+  record.append(body);
+  return record;
+}
+
+/// writes a whole buffer to a file, returning false on failure
+static bool writeAll(int fd, const std::string &data) {
+  size_t done = 0;
+  while (done < data.size()) {
+    ssize_t rc = write(fd, data.c_str() + done, data.size() - done);
+    if (rc < 0 && EINTR == errno) continue;
+    if (rc <= 0) return false;
+    done += rc;
+  }
+  return true;
+}
+
+static bool getString(const char *&p, const char *end, std::string &v) {
+  uint32_t len;
+  if (!getInt(p, end, len) || (size_t)(end - p) < len) return false;
+  v.assign(p, len);
+  p += len;
+  return true;
+}
+
+XrdCephMetaCache::XrdCephMetaCache(unsigned long long maxEntries) :
+  m_maxEntries(maxEntries), m_fd(-1), m_logSize(0), m_nbRecords(0),
+  m_compacting(false), m_nbPending(0) {}
+
+XrdCephMetaCache::~XrdCephMetaCache() {
+  if (m_fd >= 0) close(m_fd);
+}
+
+long long XrdCephMetaCache::load(const std::string &path) {
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    m_path = path;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      struct stat st;
+      if (fstat(fd, &st)) {
+        int rc = -errno;
+        close(fd);
+        return rc;
+      }
+      if ((size_t)st.st_size >= sizeof(g_metaCacheMagic)) {
+        void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == map) {
+          int rc = -errno;
+          close(fd);
+          return rc;
+        }
+        const char *p = (const char*)map;
+        const char *end = p + st.st_size;
+        // a file with an unknown format is ignored and will be overwritten
+        if (0 == memcmp(p, g_metaCacheMagic, sizeof(g_metaCacheMagic))) {
+          p += sizeof(g_metaCacheMagic);
+          while (p < end) {
+            // stop at the first truncated or corrupted record
+            uint32_t len, checksum;
+            if (!getInt(p, end, len) || !getInt(p, end, checksum)) break;
+            if ((size_t)(end - p) < len) break;
+            if (recordChecksum(p, len) != checksum) break;
+            if (!replay(p, len)) break;
+            p += len;
+          }
+        }
+        munmap(map, st.st_size);
+      }
+      close(fd);
+    } else if (errno != ENOENT) {
+      return -errno;
+    }
+  }
+  // rewrite a compact log, also dropping any corrupted tail
+  int rc = compact();
+  if (rc) return rc;
+  return nbEntries();
+}
+
+bool XrdCephMetaCache::replay(const char *data, uint32_t len) {
+  const char *p = data;
+  const char *end = data + len;
+  uint8_t type;
+  std::string key;
+  if (!getInt(p, end, type) || !getString(p, end, key)) return false;
+  switch (type) {
+  case STAT: {
+    uint64_t size;
+    int64_t mtime;
+    if (!getInt(p, end, size) || !getInt(p, end, mtime)) return false;
+    Entry *e = getOrCreate(key);
+    if (e) {
+      e->hasStat = true;
+      e->size = size;
+      e->mtime = mtime;
+    }
+    return true;
+  }
+  case XATTR: {
+    std::string name, value;
+    if (!getString(p, end, name) || !getString(p, end, value)) return false;
+    Entry *e = getOrCreate(key);
+    if (e) e->xattrs[name].value = value;
+    return true;
+  }
+  case RMXATTR: {
+    std::string name;
+    if (!getString(p, end, name)) return false;
+    EntryMap::iterator it = m_entries.find(key);
+    if (it != m_entries.end()) it->second.xattrs.erase(name);
+    return true;
+  }
+  case REMOVE: {
+    EntryMap::iterator it = m_entries.find(key);
+    if (it != m_entries.end()) drop(it);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+XrdCephMetaCache::EntryMap::iterator XrdCephMetaCache::find(const std::string &key) {
+  EntryMap::iterator it = m_entries.find(key);
+  if (it != m_entries.end()) m_lru.splice(m_lru.begin(), m_lru, it->second.pos);
+  return it;
+}
+
+void XrdCephMetaCache::drop(EntryMap::iterator it) {
+  m_lru.erase(it->second.pos);
+  m_entries.erase(it);
+}
+
+XrdCephMetaCache::Entry* XrdCephMetaCache::getOrCreate(const std::string &key) {
+  EntryMap::iterator it = find(key);
+  if (it != m_entries.end()) return &(it->second);
+  if (0 == m_maxEntries) return 0;
+  if (m_entries.size() >= m_maxEntries) {
+    // the dropped file is also removed from the log, so that a reload does
+    // not bring it back in place of more recent ones
+    std::string victim = m_lru.back();
+    drop(m_entries.find(victim));
+    append(REMOVE, victim, "");
+  }
+  m_lru.push_front(key);
+  Entry &e = m_entries[key];
+  e.pos = m_lru.begin();
+  return &e;
+}
+
+void XrdCephMetaCache::append(RecordType type, const std::string &key,
+                              const std::string &payload) {
+  if (m_fd < 0) return;
+  std::string record = makeRecord(type, key, payload);
+  // the log is only a cache : in case of failure, stop updating it rather
+  // than leaving it inconsistent with memory
+  if (!writeAll(m_fd, record)) {
+    dropLog();
+    return;
+  }
+  m_logSize += record.size();
+  m_nbRecords++;
+  if (m_compacting) {
+    m_pending.append(record);
+    m_nbPending++;
+  }
+}
+
+void XrdCephMetaCache::dropLog() {
+  if (m_fd >= 0) close(m_fd);
+  m_fd = -1;
+  if (!m_path.empty()) unlink(m_path.c_str());
+  m_path.clear();
+}
+
+int XrdCephMetaCache::compact() {
+  std::string path;
+  std::string buffer(g_metaCacheMagic, sizeof(g_metaCacheMagic));
+  unsigned long long nbRecords = 0;
+  {
+    // only the snapshot of the cache is taken with the mutex held
+    XrdSysMutexHelper lock(m_mutex);
+    if (m_compacting || m_path.empty()) return 0;
+    m_compacting = true;
+    path = m_path;
+    for (EntryMap::const_iterator it = m_entries.begin(); it != m_entries.end(); it++) {
+      if (it->second.hasStat) {
+        std::string payload;
+        putInt<uint64_t>(payload, it->second.size);
+        putInt<int64_t>(payload, it->second.mtime);
+        buffer.append(makeRecord(STAT, it->first, payload));
+        nbRecords++;
+      }
+      for (std::map<std::string, Xattr>::const_iterator xit = it->second.xattrs.begin();
+           xit != it->second.xattrs.end();
+           xit++) {
+        std::string payload;
+        putString(payload, xit->first);
+        putString(payload, xit->second.value);
+        buffer.append(makeRecord(XATTR, it->first, payload));
+        nbRecords++;
+      }
+    }
+  }
+  std::string tmpPath = path + ".tmp";
+  int rc = 0;
+  int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    rc = -errno;
+  } else if (!writeAll(fd, buffer)) {
+    rc = -EIO;
+  }
+  XrdSysMutexHelper lock(m_mutex);
+  m_compacting = false;
+  // the current log may have been dropped meanwhile, after a failed write
+  if (0 == rc && m_path.empty()) rc = -EIO;
+  if (0 == rc && !writeAll(fd, m_pending)) rc = -EIO;
+  if (0 == rc && rename(tmpPath.c_str(), path.c_str())) rc = -errno;
+  if (rc) {
+    // do not leave behind a log that is not maintained anymore
+    if (fd >= 0) close(fd);
+    unlink(tmpPath.c_str());
+    dropLog();
+  } else {
+    if (m_fd >= 0) close(m_fd);
+    m_fd = fd;
+    m_logSize = buffer.size() + m_pending.size();
+    m_nbRecords = nbRecords + m_nbPending;
+  }
+  m_pending.clear();
+  m_nbPending = 0;
+  return rc;
+}
+
+void XrdCephMetaCache::compactIfDue() {
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    if (m_compacting || m_fd < 0 || m_nbRecords <= 4 * m_entries.size() + 100000) return;
+  }
+  compact();
+}
+
+bool XrdCephMetaCache::getStat(const std::string &key, unsigned long long &size,
+                               time_t &mtime, time_t &validated) {
+  XrdSysMutexHelper lock(m_mutex);
+  EntryMap::const_iterator it = find(key);
+  if (it == m_entries.end() || !it->second.hasStat) return false;
+  size = it->second.size;
+  mtime = it->second.mtime;
+  validated = it->second.validated;
+  return true;
+}
+
+void XrdCephMetaCache::putStat(const std::string &key, unsigned long long size, time_t mtime) {
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    Entry *e = getOrCreate(key);
+    if (0 == e) return;
+    e->validated = time(NULL);
+    if (e->hasStat && e->size == size && e->mtime == mtime) return;
+    // the file changed, forget about its extended attributes
+    if (e->hasStat && !e->xattrs.empty()) {
+      e->xattrs.clear();
+      append(REMOVE, key, "");
+    }
+    e->hasStat = true;
+    e->size = size;
+    e->mtime = mtime;
+    std::string payload;
+    putInt<uint64_t>(payload, size);
+    putInt<int64_t>(payload, mtime);
+    append(STAT, key, payload);
+  }
+  compactIfDue();
+}
+
+void XrdCephMetaCache::setValidated(const std::string &key, time_t validated) {
+  XrdSysMutexHelper lock(m_mutex);
+  EntryMap::iterator it = m_entries.find(key);
+  if (it != m_entries.end()) it->second.validated = validated;
+}
+
+bool XrdCephMetaCache::getXattr(const std::string &key, const std::string &name,
+                                std::string &value, time_t &validated) {
+  XrdSysMutexHelper lock(m_mutex);
+  EntryMap::const_iterator it = find(key);
+  if (it == m_entries.end()) return false;
+  std::map<std::string, Xattr>::const_iterator xit = it->second.xattrs.find(name);
+  if (xit == it->second.xattrs.end()) return false;
+  value = xit->second.value;
+  validated = xit->second.validated;
+  return true;
+}
+
+void XrdCephMetaCache::putXattr(const std::string &key, const std::string &name,
+                                const std::string &value) {
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    Entry *e = getOrCreate(key);
+    if (0 == e) return;
+    std::map<std::string, Xattr>::iterator xit = e->xattrs.find(name);
+    bool unchanged = xit != e->xattrs.end() && xit->second.value == value;
+    Xattr &x = e->xattrs[name];
+    x.validated = time(NULL);
+    if (unchanged) return;
+    x.value = value;
+    std::string payload;
+    putString(payload, name);
+    putString(payload, value);
+    append(XATTR, key, payload);
+  }
+  compactIfDue();
+}
+
+void XrdCephMetaCache::removeXattr(const std::string &key, const std::string &name) {
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    EntryMap::iterator it = m_entries.find(key);
+    if (it == m_entries.end() || 0 == it->second.xattrs.erase(name)) return;
+    std::string payload;
+    putString(payload, name);
+    append(RMXATTR, key, payload);
+  }
+  compactIfDue();
+}
+
+void XrdCephMetaCache::remove(const std::string &key) {
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    EntryMap::iterator it = m_entries.find(key);
+    if (it == m_entries.end()) return;
+    drop(it);
+    append(REMOVE, key, "");
+  }
+  compactIfDue();
+}
+
+unsigned long long XrdCephMetaCache::nbEntries() {
+  XrdSysMutexHelper lock(m_mutex);
+  return m_entries.size();
+}
+
+unsigned long long XrdCephMetaCache::logSize() {
+  XrdSysMutexHelper lock(m_mutex);
+  return m_logSize;
+}
@@ -0,0 +1,209 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#ifndef __XRD_CEPH_META_CACHE_HH__
+#define __XRD_CEPH_META_CACHE_HH__
+
+#include <list>
+#include <map>
+#include <string>
+#include <time.h>
+#include <stdint.h>
+#include "XrdSys/XrdSysPthread.hh"
+
+//------------------------------------------------------------------------------
+//! Persistent cache of file metadata (size, mtime and extended attributes),
+//! allowing a restarted gateway to answer metadata queries on hot files
+//! without contacting ceph.
+//!
+//! Metadata are kept in memory and every change is appended to a local log
+//! file. At startup, the log is memory mapped and replayed, then compacted.
+//! Records are checksummed so that a truncated or corrupted tail, e.g. after
+//! a crash, is simply ignored. Compactions are also done when the log is
+//! dominated by obsolete records : the new log is written without holding the
+//! cache lock, and the records appended meanwhile are added to it at the end.
+//!
+//! When full, the cache drops its least recently used files.
+//!
+//! The cache does not talk to ceph itself : each stat and each extended
+//! attribute carries the time it was last validated against ceph, 0 for
+//! entries reloaded from disk, and the caller decides whether and how to
+//! revalidate them.
+//------------------------------------------------------------------------------
+
+class XrdCephMetaCache {
+
+public:
+
+  //------------------------------------------------------------------------------
+  //! Constructor
+  //!
+  //! @param  maxEntries  maximum number of files in the cache. When reached,
+  //!                     the least recently used ones are dropped
+  //------------------------------------------------------------------------------
+  XrdCephMetaCache(unsigned long long maxEntries);
+
+  //------------------------------------------------------------------------------
+  //! Destructor
+  //------------------------------------------------------------------------------
+  ~XrdCephMetaCache();
+
+  //------------------------------------------------------------------------------
+  //! Loads the content of a log file and attaches to it for further updates.
+  //! The file is created if it does not exist.
+  //!
+  //! @return the number of entries loaded or -errno
+  //------------------------------------------------------------------------------
+  long long load(const std::string &path);
+
+  //------------------------------------------------------------------------------
+  //! Gets the size and mtime of a file
+  //!
+  //! @param  validated  filled with the time of the last validation, 0 if none
+  //! @return true if found
+  //------------------------------------------------------------------------------
+  bool getStat(const std::string &key, unsigned long long &size,
+               time_t &mtime, time_t &validated);
+
+  //------------------------------------------------------------------------------
+  //! Records the size and mtime of a file, as just validated against ceph.
+  //! Cached extended attributes are dropped if size or mtime changed.
+  //------------------------------------------------------------------------------
+  void putStat(const std::string &key, unsigned long long size, time_t mtime);
+
+  //------------------------------------------------------------------------------
+  //! Marks an entry as validated, without changing its content
+  //------------------------------------------------------------------------------
+  void setValidated(const std::string &key, time_t validated);
+
+  //------------------------------------------------------------------------------
+  //! Gets an extended attribute of a file
+  //!
+  //! @param  validated  filled with the time of the last validation, 0 if none
+  //! @return true if found
+  //------------------------------------------------------------------------------
+  bool getXattr(const std::string &key, const std::string &name,
+                std::string &value, time_t &validated);
+
+  //------------------------------------------------------------------------------
+  //! Records an extended attribute of a file, as just validated against ceph
+  //------------------------------------------------------------------------------
+  void putXattr(const std::string &key, const std::string &name,
+                const std::string &value);
+
+  //------------------------------------------------------------------------------
+  //! Drops an extended attribute of a file
+  //------------------------------------------------------------------------------
+  void removeXattr(const std::string &key, const std::string &name);
+
+  //------------------------------------------------------------------------------
+  //! Drops all metadata of a file
+  //------------------------------------------------------------------------------
+  void remove(const std::string &key);
+
+  //------------------------------------------------------------------------------
+  //! Number of files in the cache
+  //------------------------------------------------------------------------------
+  unsigned long long nbEntries();
+
+  //------------------------------------------------------------------------------
+  //! Size of the log file, in bytes
+  //------------------------------------------------------------------------------
+  unsigned long long logSize();
+
+private:
+
+  /// extended attribute of a file, validated independently of the stat
+  struct Xattr {
+    Xattr() : validated(0) {}
+    std::string value;
+    time_t validated;
+  };
+
+  /// metadata of a file
+  struct Entry {
+    Entry() : hasStat(false), size(0), mtime(0), validated(0) {}
+    bool hasStat;
+    unsigned long long size;
+    time_t mtime;
+    time_t validated;
+    std::map<std::string, Xattr> xattrs;
+    /// position in the LRU list
+    std::list<std::string>::iterator pos;
+  };
+
+  typedef std::map<std::string, Entry> EntryMap;
+
+  /// types of records in the log
+  enum RecordType { STAT = 1, XATTR = 2, RMXATTR = 3, REMOVE = 4 };
+
+  /// gets the entry of a file, creating it if needed and dropping the least
+  /// recently used one if the cache is full. Must be called with the mutex held
+  /// returns 0 if the cache cannot hold any file
+  Entry* getOrCreate(const std::string &key);
+
+  /// finds the entry of a file and marks it as recently used
+  /// Must be called with the mutex held
+  EntryMap::iterator find(const std::string &key);
+
+  /// drops the entry of a file. Must be called with the mutex held
+  void drop(EntryMap::iterator it);
+
+  /// replays a record read from the log. Returns false if it is malformed
+  bool replay(const char *data, uint32_t len);
+
+  /// appends a record to the log. Must be called with the mutex held
+  void append(RecordType type, const std::string &key,
+              const std::string &payload);
+
+  /// stops maintaining the log and removes it. Must be called with the mutex held
+  void dropLog();
+
+  /// writes the whole cache content to a new log, replacing the current one
+  /// Must be called without the mutex held
+  int compact();
+
+  /// compacts the log if it is dominated by obsolete records
+  /// Must be called without the mutex held
+  void compactIfDue();
+
+  EntryMap m_entries;
+  /// LRU list, most recently used first
+  std::list<std::string> m_lru;
+  unsigned long long m_maxEntries;
+  /// path of the log, empty when it is not maintained
+  std::string m_path;
+  int m_fd;
+  unsigned long long m_logSize;
+  unsigned long long m_nbRecords;
+  /// whether a compaction is writing a new log, and the records appended
+  /// since it took its snapshot of the cache, to be added to the new log
+  bool m_compacting;
+  std::string m_pending;
+  unsigned long long m_nbPending;
+  XrdSysMutex m_mutex;
+
+};
+
+#endif /* __XRD_CEPH_META_CACHE_HH__ */
@@ -94,6 +94,12 @@ XrdCephOss::~XrdCephOss() {
 
 // declared and used in XrdCephPosix.cc
 extern unsigned int g_maxCephPoolIdx;
+extern unsigned int g_cephListNbThreads;
+extern unsigned int g_cephListNbRanges;
+extern unsigned int g_cephStatAheadWindow;
+extern bool g_cephCoalesceReads;
+extern bool g_cephOsdChecksums;
+extern bool g_cephStorePageChecksums;
 int XrdCephOss::Configure(const char *configfn, XrdSysError &Eroute) {
    int NoGo = 0;
    XrdOucEnv myEnv;
@@ -125,6 +131,464 @@ int XrdCephOss::Configure(const char *configfn, XrdSysError &Eroute) {
            return 1;
          }
        }
+       if (!strncmp(var, "ceph.listthreads", 16)) {
+         var = Config.GetWord();
+         if (var) {
+           unsigned long value = strtoul(var, 0, 10);
+           if (value > 0 and value <= 256) {
+             g_cephListNbThreads = value;
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.listthreads in config file (must be between 1 and 256)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.listthreads in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.listranges", 15)) {
+         var = Config.GetWord();
+         if (var) {
+           unsigned long value = strtoul(var, 0, 10);
+           if (value > 0 and value <= 65536) {
+             g_cephListNbRanges = value;
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.listranges in config file (must be between 1 and 65536)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.listranges in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.statahead", 14)) {
+         var = Config.GetWord();
+         if (var) {
+           unsigned long value = strtoul(var, 0, 10);
+           if (value > 0 and value <= 10000) {
+             g_cephStatAheadWindow = value;
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.statahead in config file (must be between 1 and 10000)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.statahead in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.neglookup", 14)) {
+         var = Config.GetWord();
+         if (var) {
+           unsigned long long nbFiles = strtoull(var, 0, 10);
+           double fpRate = 0.01;
+           unsigned long rebuildInterval = 3600;
+           bool trusted = false;
+           bool valid = true;
+           char *arg = Config.GetWord();
+           if (arg) {
+             fpRate = strtod(arg, 0);
+             arg = Config.GetWord();
+             if (arg) {
+               rebuildInterval = strtoul(arg, 0, 10);
+               arg = Config.GetWord();
+               if (arg) {
+                 trusted = !strcmp(arg, "trusted");
+                 valid = trusted;
+               }
+             }
+           }
+           if (!valid || ceph_posix_set_neglookup(nbFiles, fpRate, rebuildInterval, trusted)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.neglookup in config file (must be <nbFiles> [<fpRate> [<rebuildInterval> [trusted]]])", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.neglookup in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.metacache", 14)) {
+         var = Config.GetWord();
+         if (var) {
+           std::string path = var;
+           unsigned long long maxEntries = 1000000;
+           unsigned long ttl = 60;
+           char *arg = Config.GetWord();
+           if (arg) {
+             maxEntries = strtoull(arg, 0, 10);
+             arg = Config.GetWord();
+             if (arg) ttl = strtoul(arg, 0, 10);
+           }
+           if (ceph_posix_set_metacache(path.c_str(), maxEntries, ttl)) {
+             Eroute.Emsg("Config", "Unable to setup ceph.metacache (syntax is <file> [<maxEntries> [<ttl>]])", configfn, path.c_str());
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.metacache in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.blockcache", 15)) {
+         var = Config.GetWord();
+         if (var) {
+           unsigned long long sizeMB = strtoull(var, 0, 10);
+           unsigned long long blockSizeKB = 1024;
+           char *arg = Config.GetWord();
+           if (arg) blockSizeKB = strtoull(arg, 0, 10);
+           if (ceph_posix_set_blockcache(sizeMB << 20, blockSizeKB << 10)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.blockcache in config file (must be <sizeMB> [<blockSizeKB>] with size larger than block size)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.blockcache in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.diskcache", 14)) {
+         var = Config.GetWord();
+         char *arg = var ? Config.GetWord() : 0;
+         if (arg) {
+           unsigned long long sizeGB = strtoull(arg, 0, 10);
+           unsigned long long segmentSizeMB = 4;
+           arg = Config.GetWord();
+           if (arg) segmentSizeMB = strtoull(arg, 0, 10);
+           if (ceph_posix_set_diskcache(var, sizeGB << 30, segmentSizeMB << 20)) {
+             Eroute.Emsg("Config", "Unable to setup ceph.diskcache (syntax is <directory> <sizeGB> [<segmentSizeMB>])", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.diskcache in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.coalescereads", 18)) {
+         var = Config.GetWord();
+         if (var && !strcmp(var, "on")) {
+           g_cephCoalesceReads = true;
+         } else if (var && !strcmp(var, "off")) {
+           g_cephCoalesceReads = false;
+         } else {
+           Eroute.Emsg("Config", "Invalid or missing value for ceph.coalescereads in config file (must be on or off)", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.hedgereads", 15)) {
+         var = Config.GetWord();
+         if (var) {
+           unsigned long percentile = strtoul(var, 0, 10);
+           double budgetPercent = 5;
+           unsigned long minDelayMs = 10;
+           char *arg = Config.GetWord();
+           if (arg) {
+             budgetPercent = strtod(arg, 0);
+             arg = Config.GetWord();
+             if (arg) minDelayMs = strtoul(arg, 0, 10);
+           }
+           if (ceph_posix_set_hedging(percentile, budgetPercent / 100, minDelayMs)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.hedgereads in config file (must be <percentile> [<budgetPercent> [<minDelayMs>]])", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.hedgereads in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.deadline", 13)) {
+         var = Config.GetWord();
+         char *arg = var ? Config.GetWord() : 0;
+         if (arg) {
+           if (ceph_posix_set_deadline(var, strtoul(arg, 0, 10))) {
+             Eroute.Emsg("Config", "Invalid value for ceph.deadline in config file (must be open|stat|read|write|list <deadlineMs>)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.deadline in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.admission", 14)) {
+         var = Config.GetWord();
+         char *arg = var ? Config.GetWord() : 0;
+         if (arg) {
+           unsigned long maxOps = strtoul(var, 0, 10);
+           unsigned long long maxMB = strtoull(arg, 0, 10);
+           unsigned long perFileOps = 0;
+           unsigned long long perFileMB = 0;
+           unsigned long targetLatencyMs = 100;
+           unsigned long maxQueue = 1024;
+           arg = Config.GetWord();
+           if (arg) {
+             perFileOps = strtoul(arg, 0, 10);
+             arg = Config.GetWord();
+             if (arg) {
+               perFileMB = strtoull(arg, 0, 10);
+               arg = Config.GetWord();
+               if (arg) {
+                 targetLatencyMs = strtoul(arg, 0, 10);
+                 arg = Config.GetWord();
+                 if (arg) maxQueue = strtoul(arg, 0, 10);
+               }
+             }
+           }
+           if (ceph_posix_set_admission(maxOps, maxMB << 20, perFileOps, perFileMB << 20,
+                                        targetLatencyMs, maxQueue)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.admission in config file (must be <maxOps> <maxMB> [<perFileOps> [<perFileMB> [<targetLatencyMs> [<maxQueue>]]]])", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.admission in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.ioshare", 12)) {
+         var = Config.GetWord();
+         char *op = var ? Config.GetWord() : 0;
+         char *arg = op ? Config.GetWord() : 0;
+         if (arg) {
+           std::string userId = var;
+           std::string opType = op;
+           double weight = strtod(arg, 0);
+           unsigned long long clientCapMBps = 0;
+           arg = Config.GetWord();
+           if (arg) clientCapMBps = strtoull(arg, 0, 10);
+           int rc = ceph_posix_set_ioshare(userId.c_str(), opType.c_str(), weight, clientCapMBps << 20);
+           if (-ENOENT == rc) {
+             Eroute.Emsg("Config", "ceph.ioshare requires ceph.admission to be given first in config file", configfn, userId.c_str());
+             return 1;
+           }
+           if (rc) {
+             Eroute.Emsg("Config", "Invalid value for ceph.ioshare in config file (must be <userId|*> <read|write|*> <weight> [<clientCapMBps>])", configfn, userId.c_str());
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.ioshare in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.ecalign", 12)) {
+         var = Config.GetWord();
+         if (var) {
+           if (ceph_posix_set_ecalign(var)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.ecalign in config file (must be off|warn|round)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.ecalign in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.metapool", 13)) {
+         var = Config.GetWord();
+         if (var) {
+           if (ceph_posix_set_metapool(var)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.metapool in config file", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.metapool in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.sizeclass", 14)) {
+         char *words[4];
+         unsigned int nbWords = 0;
+         while (nbWords < 4 && (words[nbWords] = Config.GetWord())) {
+           words[nbWords] = strdup(words[nbWords]);
+           nbWords++;
+         }
+         int rc = -EINVAL;
+         if (4 == nbWords) {
+           rc = ceph_posix_add_sizeclass(strtoull(words[0], 0, 10) << 20,
+                                         strtoul(words[1], 0, 10),
+                                         strtoull(words[2], 0, 10),
+                                         strtoull(words[3], 0, 10));
+         }
+         for (unsigned int i = 0; i < nbWords; i++) free(words[i]);
+         if (rc) {
+           Eroute.Emsg("Config", "Invalid value for ceph.sizeclass in config file (must be <minSizeMB> <nbStripes> <stripeUnit> <objectSize>)", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.writecks", 13)) {
+         var = Config.GetWord();
+         if (var) {
+           if (ceph_posix_set_writecks(var)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.writecks in config file (must be a comma separated list of adler32 and crc32c)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.writecks in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.osdcks", 11)) {
+         var = Config.GetWord();
+         if (var && !strcmp(var, "on")) {
+           g_cephOsdChecksums = true;
+         } else if (var && !strcmp(var, "off")) {
+           g_cephOsdChecksums = false;
+         } else {
+           Eroute.Emsg("Config", "Invalid or missing value for ceph.osdcks in config file (must be on or off)", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.pagecks", 12)) {
+         var = Config.GetWord();
+         if (var && !strcmp(var, "on")) {
+           g_cephStorePageChecksums = true;
+         } else if (var && !strcmp(var, "off")) {
+           g_cephStorePageChecksums = false;
+         } else {
+           Eroute.Emsg("Config", "Invalid or missing value for ceph.pagecks in config file (must be on or off)", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.reclaim", 12)) {
+         var = Config.GetWord();
+         if (var) {
+           unsigned long long minSize = strtoull(var, 0, 10) << 20;
+           unsigned long objectsPerSecond = 100;
+           char *arg = Config.GetWord();
+           if (arg) objectsPerSecond = strtoul(arg, 0, 10);
+           if (ceph_posix_set_reclaim(minSize, objectsPerSecond)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.reclaim in config file (must be <minSizeMB> [objectsPerSecond], with a non zero rate)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.reclaim in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.cluster", 12)) {
+         var = Config.GetWord();
+         char *confFile = var ? Config.GetWord() : 0;
+         if (confFile) {
+           std::string name = var;
+           if (ceph_posix_add_cluster(name.c_str(), confFile)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.cluster in config file (must be <name> <confFile>, with a new name)", configfn, name.c_str());
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.cluster in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.federate", 13)) {
+         var = Config.GetWord();
+         char *clusters = var ? Config.GetWord() : 0;
+         if (clusters) {
+           std::string pool = var;
+           std::string clusterList = clusters;
+           unsigned long failoverMs = 0;
+           char *arg = Config.GetWord();
+           if (arg) failoverMs = strtoul(arg, 0, 10);
+           if (ceph_posix_set_federation(pool.c_str(), clusterList.c_str(), failoverMs)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.federate in config file (must be <pool> <cluster>[,<cluster>...] [failoverMs], with clusters declared by ceph.cluster or default)", configfn, pool.c_str());
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.federate in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.readpolicy", 15)) {
+         var = Config.GetWord();
+         char *policy = var ? Config.GetWord() : 0;
+         if (policy) {
+           std::string pool = var;
+           if (ceph_posix_set_readpolicy(pool.c_str(), policy)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.readpolicy in config file (must be <pool|*> <primary|balance|localize>)", configfn, pool.c_str());
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.readpolicy in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.crushlocation", 18)) {
+         // the location is made of space separated <type>=<name> pairs
+         std::string location;
+         char *word;
+         while ((word = Config.GetWord())) {
+           if (!location.empty()) location += " ";
+           location += word;
+         }
+         if (location.empty() || ceph_posix_set_crushlocation(location.c_str())) {
+           Eroute.Emsg("Config", "Invalid or missing value for ceph.crushlocation in config file (must be <type>=<name> [<type>=<name>...])", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.tiering", 12)) {
+         var = Config.GetWord();
+         char *coldPool = var ? Config.GetWord() : 0;
+         char *promoteOpens = coldPool ? Config.GetWord() : 0;
+         char *demoteDays = promoteOpens ? Config.GetWord() : 0;
+         if (demoteDays) {
+           std::string pool = var;
+           std::string cold = coldPool;
+           unsigned long opens = strtoul(promoteOpens, 0, 10);
+           if (ceph_posix_set_tiering(pool.c_str(), cold.c_str(), opens, strtoul(demoteDays, 0, 10))) {
+             Eroute.Emsg("Config", "Invalid value for ceph.tiering in config file (must be <pool> <coldPool> <promoteOpens> <demoteDays>, with distinct pools and non zero values)", configfn, pool.c_str());
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.tiering in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.compress", 13)) {
+         var = Config.GetWord();
+         char *codec = var ? Config.GetWord() : 0;
+         if (codec) {
+           std::string target = var;
+           std::string codecName = codec;
+           char *level = Config.GetWord();
+           int levelValue = level ? (int)strtoul(level, 0, 10) : 0;
+           if (ceph_posix_add_compression(target.c_str(), codecName.c_str(), levelValue)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.compress in config file (must be <pool|*|/path> <lz4|zstd|none> [level], with a codec available in this build)", configfn, codecName.c_str());
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.compress in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.listfilter", 15)) {
+         var = Config.GetWord();
+         if (var) {
+           std::string type = var;
+           std::string arg1, arg2;
+           char *arg = Config.GetWord();
+           if (arg) {
+             arg1 = arg;
+             arg = Config.GetWord();
+             if (arg) arg2 = arg;
+           }
+           if (ceph_posix_set_listfilter(type.c_str(),
+                                         arg1.empty() ? 0 : arg1.c_str(),
+                                         arg2.empty() ? 0 : arg2.c_str())) {
+             Eroute.Emsg("Config", "Invalid value for ceph.listfilter in config file (must be 'plain <xattr> <value>' or '<class>.<filter> [<arg>]')", configfn, type.c_str());
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.listfilter in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.nameindex", 14)) {
+         var = Config.GetWord();
+         if (var) {
+           std::string nbShards = var;
+           char *dirShards = Config.GetWord();
+           if (ceph_posix_set_nameindex(strtoul(nbShards.c_str(), 0, 10),
+                                        dirShards ? strtoul(dirShards, 0, 10) : 1)) {
+             Eroute.Emsg("Config", "Invalid value for ceph.nameindex in config file (must be <nbShards> [<dirShards>], with nbShards between 0 and 65536 and dirShards between 1 and nbShards)", configfn, nbShards.c_str());
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.nameindex in config file", configfn);
+           return 1;
+         }
+       }
        if (!strncmp(var, "ceph.namelib", 12)) {
          var = Config.GetWord();
          if (var) {
@@ -163,7 +627,13 @@ int XrdCephOss::Chmod(const char *path, mode_t mode, XrdOucEnv *envP) {
 
 int XrdCephOss::Create(const char *tident, const char *path, mode_t access_mode,
                     XrdOucEnv &env, int Opts) {
-  return -ENOTSUP;
+  try {
+    // the open flags are given in the upper bits of Opts
+    return ceph_posix_create(&env, path, access_mode, Opts >> 8, Opts & XRDOSS_new);
+  } catch (std::exception &e) {
+    XrdCephEroute.Say("create : invalid syntax in file parameters");
+    return -EINVAL;
+  }
 }
 
 int XrdCephOss::Init(XrdSysLogger *logger, const char* configFn) { return 0; }
@@ -180,7 +650,12 @@ int XrdCephOss::Rename(const char *from,
                     const char *to,
                     XrdOucEnv *eP1,
                     XrdOucEnv *eP2) {
-  return -ENOTSUP;
+  try {
+    return ceph_posix_rename(eP1, from, eP2, to);
+  } catch (std::exception &e) {
+    XrdCephEroute.Say("rename : invalid syntax in file parameters");
+    return -EINVAL;
+  }
 }
 
 int XrdCephOss::Stat(const char* path,
@@ -203,6 +678,16 @@ int XrdCephOss::Stat(const char* path,
   }
 }
 
+int XrdCephOss::Stats(char *bp, int bl) {
+  return ceph_posix_stats(bp, bl);
+}
+
+#ifdef XRDOSS_HASPGRW
+uint64_t XrdCephOss::Features() {
+  return XRDOSS_HASPGRW;
+}
+#endif
+
 int XrdCephOss::StatFS(const char *path, char *buff, int &blen, XrdOucEnv *eP) {
   XrdOssVSInfo sP;
   int rc = StatVS(&sP, 0, 0);
@@ -48,6 +48,129 @@
 //! clash with one used in a ofs.xattrlib directive. In case both directives
 //! have a default and they are different, the behavior is not defined.
 //! In case one of the two only has a default, it will be applied for both plugins.
+//!
+//! Optionally, an in memory Bloom filter of the existing files of each pool can
+//! be maintained (see ceph.neglookup) to answer Stat of non existing files
+//! without contacting ceph. It is built from a background scan of the pool,
+//! periodically redone, and updated with the files created by this gateway.
+//! Files created by other gateways are thus only seen after the next rebuild.
+//! The two modes trade correctness against load on ceph :
+//!   - by default, negative answers are still checked against ceph, and only
+//!     counted as stale when wrong. This saves no request to ceph : it only
+//!     measures how often the filter would be right (see the neglookup
+//!     statistics) before trusting it.
+//!   - with 'trusted', negative answers are returned as they are, saving the
+//!     stat of every missing file. A file created by another gateway may then
+//!     be reported missing by this one for up to the rebuild interval plus the
+//!     duration of a scan of the pool. This only suits pools written through a
+//!     single gateway, or whose readers can cope with that delay, and the
+//!     rebuild interval should be chosen with that bound in mind.
+//!
+//! Metadata (size, mtime and extended attributes) can also be cached in a
+//! local file (see ceph.metacache) that survives restarts. Cached metadata
+//! are trusted for a configurable time, except right after a restart where
+//! sizes and mtimes are served immediately and revalidated in the background,
+//! while extended attributes are fetched again from ceph. When the cache holds
+//! its maximum number of files, the least recently used ones are dropped.
+//!
+//! Finally, data of files opened read only can be cached in memory, in blocks
+//! shared by all open files (see ceph.blockcache). A file is revalidated at
+//! each open by checking the modification time of its first object.
+//! The same files may also be cached on a local disk (see ceph.diskcache),
+//! in segments of a fixed size, in a cache surviving restarts and sitting
+//! below the memory one.
+//!
+//! Reads and stats of a file that are identical to, or contained in, one
+//! already being fetched from ceph join it rather than being sent again
+//! (see ceph.coalescereads, on by default).
+//!
+//! Reads still pending after a given percentile of the recent read latencies
+//! can be hedged (see ceph.hedgereads) : the objects concerned are read again
+//! directly, letting ceph balance the reads over replicas, and the first
+//! answer wins. The number of hedges is capped by a budget.
+//!
+//! Deadlines can be given per class of operations (see ceph.deadline) : an
+//! operation not over in time fails with ETIMEDOUT and is abandoned, its
+//! buffers being released once ceph answers or times out in turn.
+//!
+//! Reads and writes sent to ceph can go through an admission control (see
+//! ceph.admission) limiting the operations and bytes in flight, globally and
+//! per open file. The global limits adapt to the observed latency, and
+//! operations over them are queued, or refused with EBUSY when the queue is full.
+//! Queued operations are served by weighted fair queueing between clients, with
+//! weights and optional bandwidth caps per client given by ceph user and
+//! operation type (see ceph.ioshare, which requires ceph.admission).
+//!
+//! For erasure coded pools, the default layout of new files is aligned on the
+//! stripe width of the pool. Layouts requested by clients are either left as
+//! they are, with a warning, or rounded up (see ceph.ecalign). As these pools
+//! have no omap, the metadata objects kept for them, like the queue of deferred
+//! removals or the name index, need a replicated pool given with ceph.metapool,
+//! which then holds those of all pools. Without it, the features using them are
+//! disabled there.
+//!
+//! New files whose expected size is given (oss.asize) get the layout of the
+//! matching size class (see ceph.sizeclass), unless a layout is explicitly
+//! requested. Create writes their first object and layout up front.
+//!
+//! Checksums can be computed while files are written (see ceph.writecks) and
+//! are stored at close as XrdCks xattrs. Files not written sequentially are
+//! read back at close instead, unless the OSDs can compute the crc32c of each
+//! object, which are then combined (see ceph.osdcks). Missing XrdCks.crc32c
+//! xattrs are computed the same way when requested.
+//!
+//! Page checksummed reads and writes (pgRead/pgWrite) are supported natively.
+//! The page checksums can be stored with files (see ceph.pagecks), so that
+//! reads return them without recomputing them. They are packed in xattrs of the
+//! objects holding the pages, and files which never had any are marked as such
+//! when opened, so that their plain writes do not look for checksums to drop.
+//!
+//! Lists of files can be deleted in one go with the xrdcephrm tool, using the
+//! ceph credentials of the administrator. Removals run in parallel over the
+//! connections to the cluster.
+//!
+//! Unlinks and truncations of large files can return before all objects are
+//! removed (see ceph.reclaim). The file is updated at once and the objects left
+//! are removed in the background, at a limited rate, from a queue kept in the
+//! pool, or in the metadata pool, so that this resumes after a restart. Opening
+//! such a file for writing, recreating or truncating it completes the pending
+//! removal first.
+//!
+//! Renames, and copies within the cluster done with the xrdcephcp tool, including
+//! between pools, are done by the OSDs, copying all objects of the file in
+//! parallel with their xattrs. The source of a rename is only removed once its
+//! copy is complete, and an existing destination is only replaced once the file
+//! was copied next to it.
+//!
+//! Pools may be held by several clusters (see ceph.cluster and ceph.federate),
+//! the first one getting writes and the others being mirrors. Reads go to the
+//! cluster with the lowest latency and fail over to the next ones on error or
+//! timeout. Short reads from mirrors are checked against the size of the file
+//! in the first cluster, which is given the failover time to answer. The
+//! latency and traffic of each cluster are part of the statistics.
+//!
+//! Reads go to the primary OSDs unless a pool has another read policy (see
+//! ceph.readpolicy) : any replica, or the closest one to the gateway given its
+//! crush location (see ceph.crushlocation). Such reads go directly to objects,
+//! following the layout stored with each file.
+//!
+//! Files of a pool not opened for some days may move to a cold pool, typically
+//! erasure coded, and come back once opened often enough (see ceph.tiering).
+//! Moves run in the background. The first object stays with the xattrs and
+//! points reads to the cold pool, so names and metadata do not change.
+//! Modifying, renaming or copying a cold file moves it back first. The
+//! xrdcephrm and xrdcephcp tools have to be given the tiered pools with their
+//! -t option, in the same way, not to leave cold copies behind.
+//!
+//! The state of tiering, compression and page checksums is kept in xattrs
+//! named xrdceph.*, which are not listed to clients and cannot be set or
+//! removed by them.
+//!
+//! New files of some pools or paths may be compressed with lz4 or zstd (see
+//! ceph.compress). Each stripe unit is compressed on its own, so reads only
+//! decompress the blocks they touch. Compressed files are detected by all
+//! gateways, whatever their rules, from the xattrs of their first object : reads
+//! get them in place of the stat done at open, writes read them once per open.
 //------------------------------------------------------------------------------
 
 class XrdCephOss : public XrdOss {
@@ -64,6 +187,10 @@ public:
   virtual int     Remdir(const char *, int Opts=0, XrdOucEnv *eP=0);
   virtual int     Rename(const char *, const char *, XrdOucEnv *eP1=0, XrdOucEnv *eP2=0);
   virtual int     Stat(const char *, struct stat *, int opts=0, XrdOucEnv *eP=0);
+  virtual int     Stats(char *bp, int bl);
+#ifdef XRDOSS_HASPGRW
+  virtual uint64_t Features();
+#endif
   virtual int     StatFS(const char *path, char *buff, int &blen, XrdOucEnv *eP=0);
   virtual int     StatVS(XrdOssVSInfo *sP, const char *sname=0, int updt=0);
   virtual int     Truncate(const char *, unsigned long long, XrdOucEnv *eP=0);
@@ -29,7 +29,8 @@
 
 extern XrdSysError XrdCephEroute;
 
-XrdCephOssDir::XrdCephOssDir(XrdCephOss *cephOss) : m_dirp(0), m_cephOss(cephOss) {}
+XrdCephOssDir::XrdCephOssDir(XrdCephOss *cephOss) :
+  m_dirp(0), m_statRet(0), m_cephOss(cephOss) {}
 
 int XrdCephOssDir::Opendir(const char *path, XrdOucEnv &env) {
   try {
@@ -50,5 +51,10 @@ int XrdCephOssDir::Close(long long *retsz) {
 }
 
 int XrdCephOssDir::Readdir(char *buff, int blen) {
-  return ceph_posix_readdir(m_dirp, buff, blen);
+  return ceph_posix_readdir_stat(m_dirp, buff, blen, m_statRet);
+}
+
+int XrdCephOssDir::StatRet(struct stat *buff) {
+  m_statRet = buff;
+  return XrdOssOK;
 }
@@ -30,9 +30,38 @@
 
 //------------------------------------------------------------------------------
 //! This class implements XrdOssDF interface for usage with a CEPH storage.
-//! It has a very restricted usage as the only valid path for opendir is '/'.
-//! The reason is that ceph is an object store where you can only list all
-//! objects, and that has no notion of hierarchy
+//! By default, it has a very restricted usage as the only valid path for
+//! opendir is '/'. The reason is that ceph is an object store where you can
+//! only list all objects, and that has no notion of hierarchy
+//!
+//! When the name index is enabled (see ceph.nameindex), any directory can be
+//! listed. The index is kept in the omap of a set of objects of the pool, or
+//! of the metadata pool if any (see ceph.metapool), which erasure coded pools
+//! need. It is sharded by directory, and the entries of each directory can be
+//! spread over several shards by hash of their name, so that large directories
+//! do not grow a single object. Listings then read all these shards in turn.
+//! The index is maintained on file creation and deletion. Directories are
+//! pseudo directories implied by the names of the files.
+//! The index can be rebuilt from a scan of the pool using xrdcephindex, which
+//! is needed after changing the number of shards or the metadata pool.
+//!
+//! The listing of the pool is split into ranges of the object hash space
+//! that are scanned concurrently (see ceph.listthreads and ceph.listranges).
+//! An external crawler can restrict a listing to a part of the pool by giving
+//! a 'cephListShard' entry with format <i>/<n> in the XrdOucEnv parameter.
+//! Only shard i (starting at 0) out of n shards will then be listed.
+//!
+//! The OSDs can be asked to only return the first objects of the striped
+//! files via a server side filter (see ceph.listfilter). It can either be a
+//! 'plain' filter matching the value of a given xattr, e.g.
+//!   ceph.listfilter plain striper.layout.stripe_count 1
+//! when all files share the same layout, or a filter provided by an object
+//! class deployed on the OSDs. If the OSDs refuse the filter, the listing
+//! falls back to filtering the objects on the gateway.
+//!
+//! Stat information can be returned together with each entry (see StatRet).
+//! The stats of the next entries are then issued ahead of time, as a window
+//! of asynchronous operations (see ceph.statahead).
 //!
 //! This plugin is able to use any pool of ceph with any userId.
 //! There are several ways to provide the pool and userId to be used for a given
@@ -60,11 +89,14 @@ public:
   virtual ~XrdCephOssDir() {};
   virtual int Opendir(const char *, XrdOucEnv &);
   virtual int Readdir(char *buff, int blen);
+  virtual int StatRet(struct stat *buff);
   virtual int Close(long long *retsz=0);
 
 private:
 
   DIR *m_dirp;
+  /// where to put the stat information of each entry, 0 if not requested
+  struct stat *m_statRet;
   XrdCephOss *m_cephOss;
 
 };
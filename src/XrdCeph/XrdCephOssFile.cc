@@ -99,3 +99,16 @@ int XrdCephOssFile::Fsync() {
 int XrdCephOssFile::Ftruncate(unsigned long long len) {
   return ceph_posix_ftruncate(m_fd, len);
 }
+
+#ifdef XRDOSS_HASPGRW
+ssize_t XrdCephOssFile::pgRead(void *buffer, off_t offset, size_t rdlen,
+                               uint32_t *csvec, uint64_t opts) {
+  return ceph_posix_pgread(m_fd, buffer, rdlen, offset, csvec, opts & XrdOssDF::Verify);
+}
+
+ssize_t XrdCephOssFile::pgWrite(void *buffer, off_t offset, size_t wrlen,
+                                uint32_t *csvec, uint64_t opts) {
+  return ceph_posix_pgwrite(m_fd, buffer, wrlen, offset, csvec,
+                            opts & XrdOssDF::Verify, opts & XrdOssDF::doCalc);
+}
+#endif
@@ -66,6 +66,10 @@ public:
   virtual int Write(XrdSfsAio *aiop);
   virtual int Fsync(void);
   virtual int Ftruncate(unsigned long long);
+#ifdef XRDOSS_HASPGRW
+  virtual ssize_t pgRead(void *buffer, off_t offset, size_t rdlen, uint32_t *csvec, uint64_t opts);
+  virtual ssize_t pgWrite(void *buffer, off_t offset, size_t wrlen, uint32_t *csvec, uint64_t opts);
+#endif
 
 private:
 
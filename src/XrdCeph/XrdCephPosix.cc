@@ -36,19 +36,35 @@
 #include <memory>
 #include <radosstriper/libradosstriper.hpp>
 #include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include <sstream>
 #include <sys/xattr.h>
 #include <time.h>
 #include <limits>
+#include <cmath>
 #include <pthread.h>
+#include <arpa/inet.h>
 #include "XrdSfs/XrdSfsAio.hh"
 #include "XrdSys/XrdSysPthread.hh"
 #include "XrdOuc/XrdOucName2Name.hh"
 #include "XrdSys/XrdSysPlatform.hh"
+#include "XrdSec/XrdSecEntity.hh"
+#include "XrdCks/XrdCksData.hh"
 
 #include "XrdCeph/XrdCephPosix.hh"
+#include "XrdCeph/XrdCephBloomFilter.hh"
+#include "XrdCeph/XrdCephMetaCache.hh"
+#include "XrdCeph/XrdCephBlockCache.hh"
+#include "XrdCeph/XrdCephDiskCache.hh"
+#include "XrdCeph/XrdCephTimer.hh"
+#include "XrdCeph/XrdCephAdmission.hh"
+#include "XrdCeph/XrdCephChecksum.hh"
+#include "XrdCeph/XrdCephCompress.hh"
 
 /// small structs to store file metadata
 struct CephFile {
@@ -60,18 +76,72 @@ struct CephFile {
   unsigned long long objectSize;
 };
 
+struct WriteChecksum;
+struct CompressedFile;
+
 struct CephFileRef : CephFile {
   int flags;
   mode_t mode;
   unsigned long long offset;
   unsigned rdcount;
   unsigned wrcount;
+  /// version of the file used for the block cache, 0 if not cached
+  unsigned long long cacheVersion;
+  /// xrootd identifier of the client that opened the file, if known
+  std::string client;
+  /// checksums computed while the file is written, if configured
+  WriteChecksum *writeCks;
+  /// state of the file when it is compressed
+  CompressedFile *compress;
+  /// whether page checksums were stored for the file, -1 until known
+  int pageCks;
+  /// layout the file is stored with, locating its page checksums once pageCks is known
+  CephFile storedLayout;
+};
+
+/// small struct for an entry of a listing whose stat was requested ahead of time
+struct DirEntryStat {
+  DirEntryStat(const std::string &n) : name(n), completion(0), size(0), mtime(0) {}
+  std::string name;
+  /// completion of the asynchronous stat, 0 for directories
+  librados::AioCompletion *completion;
+  uint64_t size;
+  time_t mtime;
 };
 
 /// small struct for directory listing
+/// The pool is split into several ranges of the object hash space, which are
+/// scanned concurrently by a bounded set of threads. These feed a queue of
+/// names that is then consumed by ceph_posix_readdir
+/// When the name index is enabled, names are rather fetched from the index,
+/// batch by batch
 struct DirIterator {
-  librados::NObjectIterator m_iterator;
-  librados::IoCtx *m_ioctx;
+  DirIterator() : m_nextRange(0), m_nbActiveWorkers(0), m_rc(0), m_stop(false),
+                  m_indexNextObject(0), m_indexMore(false) {}
+  CephFile m_file;
+  std::vector<std::pair<librados::ObjectCursor, librados::ObjectCursor> > m_ranges;
+  unsigned int m_nextRange;
+  std::deque<std::string> m_names;
+  std::vector<pthread_t> m_workers;
+  unsigned int m_nbActiveWorkers;
+  int m_rc;
+  bool m_stop;
+  /// name index objects holding the entries of the directory listed, and
+  /// the one being fetched
+  std::vector<std::string> m_indexObjects;
+  unsigned int m_indexNextObject;
+  /// prefix of the name index keys of the directory listed
+  std::string m_indexPrefix;
+  /// last name index key fetched
+  std::string m_indexLastKey;
+  /// whether more entries remain to be fetched from the name index
+  bool m_indexMore;
+  /// name of the directory listed when using the name index, with trailing '/'
+  std::string m_indexDir;
+  /// entries for which a stat was already issued, in listing order
+  std::deque<DirEntryStat*> m_statAhead;
+  /// protects all members above and signals changes of m_names
+  XrdSysCondVar m_cond;
 };
 
 /// small struct for aio API callbacks
@@ -91,7 +161,8 @@ typedef std::map<std::string, libradosstriper::RadosStriper*> StriperDict;
 std::vector<StriperDict> g_radosStripers;
 typedef std::map<std::string, librados::IoCtx*> IOCtxDict;
 std::vector<IOCtxDict> g_ioCtx;
-std::vector<librados::Rados*> g_cluster;
+/// connections to the clusters, indexed by pool index and then cluster index
+std::vector<std::vector<librados::Rados*> > g_cluster;
 /// mutex protecting the striper and ioctx maps
 XrdSysMutex g_striper_mutex;
 /// index of current Striper/IoCtx to be used
@@ -100,6 +171,77 @@ unsigned int g_cephPoolIdx = 0;
 /// may be overwritten in the configuration file
 /// (See XrdCephOss::configure)
 unsigned int g_maxCephPoolIdx = 1;
+/// number of threads scanning the pool concurrently for a directory listing
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+unsigned int g_cephListNbThreads = 4;
+/// number of ranges of the object hash space a listing is split into
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+unsigned int g_cephListNbRanges = 32;
+/// maximum number of names prefetched by the listing threads
+static const unsigned int g_cephListQueueSize = 10000;
+/// maximum number of objects returned by a single listing call to ceph
+static const unsigned int g_cephListBatchSize = 1000;
+/// number of stats issued ahead of time when listing with stat information
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+unsigned int g_cephStatAheadWindow = 64;
+/// server side filter applied by the OSDs to the listing of pools
+/// empty when no filter is configured (See ceph_posix_set_listfilter)
+ceph::bufferlist g_cephListFilter;
+/// whether the OSDs accepted the listing filter. Set to false on the first
+/// failure, in which case we fall back to filtering the listing locally
+bool g_cephListFilterSupported = true;
+/// number of shards of the name index, 0 meaning that the index is disabled
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+unsigned int g_cephNameIndexNbShards = 0;
+/// number of shards the entries of each directory are spread over, by hash of
+/// their name, so that large directories do not end up in a single object
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+unsigned int g_cephNameIndexDirShards = 1;
+/// a ceph cluster the gateway is connected to, with statistics of the reads it served
+struct CephCluster {
+  CephCluster(const std::string &n = "default", const std::string &c = "") :
+    name(n), confFile(c), latencyMs(0), lastErrorMs(0), nbReads(0), nbBytes(0),
+    nbErrors(0), nbTimeouts(0), nbFailovers(0) {}
+  std::string name;
+  /// configuration file of the cluster, empty for the default ceph configuration
+  std::string confFile;
+  /// moving average of the latency of successful reads, in milliseconds
+  double latencyMs;
+  /// time of the last failed read, on the clock of XrdCephTimer
+  unsigned long long lastErrorMs;
+  unsigned long long nbReads;
+  unsigned long long nbBytes;
+  unsigned long long nbErrors;
+  unsigned long long nbTimeouts;
+  /// number of reads served after another cluster failed them
+  unsigned long long nbFailovers;
+};
+/// clusters known to the gateway. The first one is described by the default
+/// ceph configuration, others may be declared in the configuration file
+/// (See XrdCephOss::configure)
+std::vector<CephCluster> g_cephClusters(1);
+/// clusters holding a pool. The first cluster gets all writes and metadata
+/// operations, the others being mirrors that can serve reads
+struct FederatedPool {
+  std::vector<unsigned int> clusters;
+  /// time after which a read fails over to another cluster, in milliseconds,
+  /// 0 meaning that only errors trigger a failover
+  unsigned int failoverMs;
+};
+/// pools not only held by the default cluster
+/// (See XrdCephOss::configure)
+std::map<std::string, FederatedPool> g_federatedPools;
+/// protects the statistics of the clusters
+XrdSysMutex g_cephClustersMutex;
+/// crush location of the gateway, used to read from the closest replicas,
+/// empty to keep the one of the ceph configuration
+/// (See XrdCephOss::configure)
+std::string g_crushLocation;
 /// pointer to library providing Name2Name interface. 0 be default
 /// populated in case of ceph.namelib entry in the config file in XrdCephOss
 XrdOucName2Name *g_namelib = 0;
@@ -114,6 +256,23 @@ unsigned int g_nextCephFd = 0;
 XrdSysMutex g_fd_mutex;
 /// mutex protecting initialization of ceph clusters
 XrdSysMutex g_init_mutex;
+/// set when disconnecting from ceph, so that background threads stop
+bool g_cephShutdown = false;
+/// timer used for delayed actions on operations, created on first use
+XrdCephTimer *g_cephTimer = 0;
+/// classes of operations that can be given a deadline
+enum DeadlineClass { DL_OPEN = 0, DL_STAT, DL_READ, DL_WRITE, DL_LIST, DL_NBCLASSES };
+static const char* g_deadlineClassNames[DL_NBCLASSES] = {"open", "stat", "read", "write", "list"};
+/// deadlines of operations per class, in milliseconds, 0 meaning no deadline
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+unsigned int g_deadlineMs[DL_NBCLASSES] = {0, 0, 0, 0, 0};
+/// number of operations that missed their deadline, per class
+unsigned long long g_deadlineNbExpired[DL_NBCLASSES] = {0, 0, 0, 0, 0};
+
+/// suffix of the first object of a striped file
+static const char g_firstObjectSuffix[] = ".0000000000000000";
+static const size_t g_firstObjectSuffixLen = sizeof(g_firstObjectSuffix)-1;
 
 /// Accessor to next ceph pool index
 /// Note that this is not thread safe, but we do not care
@@ -128,7 +287,7 @@ unsigned int getCephPoolIdxAndIncrease() {
       for (unsigned int i = 0; i < g_maxCephPoolIdx; i++) {
         g_radosStripers.push_back(StriperDict());
         g_ioCtx.push_back(IOCtxDict());
-        g_cluster.push_back(0);
+        g_cluster.push_back(std::vector<librados::Rados*>(g_cephClusters.size(), 0));
       }
     }
   }
@@ -426,12 +585,20 @@ static CephFileRef getCephFileRef(const char *path, XrdOucEnv *env, int flags,
   fr.offset = 0;
   fr.rdcount = 0;
   fr.wrcount = 0;
+  fr.cacheVersion = 0;
+  fr.writeCks = 0;
+  fr.compress = 0;
+  fr.pageCks = -1;
+  if (env && env->secEnv() && env->secEnv()->tident) {
+    fr.client = env->secEnv()->tident;
+  }
   return fr;
 }
 
 inline librados::Rados* checkAndCreateCluster(unsigned int cephPoolIdx,
-                                              std::string userId = g_defaultParams.userId) {
-  if (0 == g_cluster[cephPoolIdx]) {
+                                              std::string userId = g_defaultParams.userId,
+                                              unsigned int clusterIdx = 0) {
+  if (0 == g_cluster[cephPoolIdx][clusterIdx]) {
     // create connection to cluster
     librados::Rados *cluster = new librados::Rados;
     if (0 == cluster) {
@@ -443,7 +610,8 @@ inline librados::Rados* checkAndCreateCluster(unsigned int cephPoolIdx,
       delete cluster;
       return 0;
     }
-    rc = cluster->conf_read_file(NULL);
+    const std::string &confFile = g_cephClusters[clusterIdx].confFile;
+    rc = cluster->conf_read_file(confFile.empty() ? NULL : confFile.c_str());
     if (rc) {
       logwrapper((char*)"checkAndCreateCluster : cluster read config failed, rc = %d", rc);
       cluster->shutdown();
@@ -451,6 +619,17 @@ inline librados::Rados* checkAndCreateCluster(unsigned int cephPoolIdx,
       return 0;
     }
     cluster->conf_parse_env(NULL);
+    if (!g_crushLocation.empty()) {
+      cluster->conf_set("crush_location", g_crushLocation.c_str());
+    }
+    // operations abandoned after their deadline are eventually cancelled by librados
+    unsigned int maxDeadlineMs = *std::max_element(g_deadlineMs, g_deadlineMs + DL_NBCLASSES);
+    if (maxDeadlineMs > 0) {
+      std::ostringstream timeout;
+      timeout << 2 * maxDeadlineMs / 1000 + 1;
+      cluster->conf_set("rados_osd_op_timeout", timeout.str().c_str());
+      cluster->conf_set("rados_mon_op_timeout", timeout.str().c_str());
+    }
     rc = cluster->connect();
     if (rc) {
       logwrapper((char*)"checkAndCreateCluster : cluster connect failed, rc = %d", rc);
@@ -458,18 +637,59 @@ inline librados::Rados* checkAndCreateCluster(unsigned int cephPoolIdx,
       delete cluster;
       return 0;
     }
-    g_cluster[cephPoolIdx] = cluster;
+    g_cluster[cephPoolIdx][clusterIdx] = cluster;
+  }
+  return g_cluster[cephPoolIdx][clusterIdx];
+}
+
+/// policies for layouts not aligned on the stripe width of erasure coded pools
+enum EcAlignPolicy { EC_ALIGN_OFF, EC_ALIGN_WARN, EC_ALIGN_ROUND };
+/// policy for layouts requested by clients, default layouts are always aligned
+/// unless the policy is EC_ALIGN_OFF
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+EcAlignPolicy g_ecAlignPolicy = EC_ALIGN_WARN;
+/// alignment required by each pool, i.e. the stripe width (k x chunk size)
+/// of erasure coded pools, 0 for replicated ones
+std::map<std::string, unsigned long long> g_poolAlignments;
+XrdSysMutex g_poolAlignmentsMutex;
+/// number of writes to erasure coded pools, and of those not covering full stripes
+unsigned long long g_ecNbWrites = 0;
+unsigned long long g_ecNbPartialWrites = 0;
+
+/// records the alignment required by the pool of a new IoCtx
+static void recordPoolAlignment(const std::string &pool, librados::IoCtx &ioctx) {
+  bool alignmentRequired = false;
+  uint64_t alignment = 0;
+  if (ioctx.pool_requires_alignment2(&alignmentRequired) || !alignmentRequired ||
+      ioctx.pool_required_alignment2(&alignment)) {
+    alignment = 0;
   }
-  return g_cluster[cephPoolIdx];
+  XrdSysMutexHelper lock(g_poolAlignmentsMutex);
+  if (alignment && g_poolAlignments.find(pool) == g_poolAlignments.end()) {
+    logwrapper((char*)"recordPoolAlignment : pool %s is erasure coded, stripe width %llu",
+               pool.c_str(), (unsigned long long)alignment);
+  }
+  g_poolAlignments[pool] = alignment;
+}
+
+static void reclaimWatchPool(const CephFile &file);
+static void tierWatchPool(const CephFile &file);
+
+/// index of the cluster getting the writes and metadata operations of a pool
+static unsigned int homeCluster(const CephFile &file) {
+  std::map<std::string, FederatedPool>::const_iterator it = g_federatedPools.find(file.pool);
+  return it == g_federatedPools.end() ? 0 : it->second.clusters.front();
 }
 
-int checkAndCreateStriper(unsigned int cephPoolIdx, std::string &userAtPool, const CephFile& file) {
+int checkAndCreateStriper(unsigned int cephPoolIdx, std::string &userAtPool, const CephFile& file,
+                          unsigned int clusterIdx) {
   StriperDict &sDict = g_radosStripers[cephPoolIdx];
   StriperDict::iterator it = sDict.find(userAtPool);
   if (it == sDict.end()) {
     // we need to create a new radosStriper
     // Get a cluster
-    librados::Rados* cluster = checkAndCreateCluster(cephPoolIdx, file.userId);
+    librados::Rados* cluster = checkAndCreateCluster(cephPoolIdx, file.userId, clusterIdx);
     if (0 == cluster) {
       logwrapper((char*)"checkAndCreateStriper : checkAndCreateCluster failed");
       return 0;
@@ -480,18 +700,23 @@ int checkAndCreateStriper(unsigned int cephPoolIdx, std::string &userAtPool, con
       logwrapper((char*)"checkAndCreateStriper : IoCtx instantiation failed");
       cluster->shutdown();
       delete cluster;
-      g_cluster[cephPoolIdx] = 0;
+      g_cluster[cephPoolIdx][clusterIdx] = 0;
       return 0;
     }
-    int rc = g_cluster[cephPoolIdx]->ioctx_create(file.pool.c_str(), *ioctx);
+    int rc = cluster->ioctx_create(file.pool.c_str(), *ioctx);
     if (rc != 0) {
       logwrapper((char*)"checkAndCreateStriper : ioctx_create failed, rc = %d", rc);
       cluster->shutdown();
       delete cluster;
-      g_cluster[cephPoolIdx] = 0;
+      g_cluster[cephPoolIdx][clusterIdx] = 0;
       delete ioctx;
       return 0;
     }
+    recordPoolAlignment(file.pool, *ioctx);
+    if (clusterIdx == homeCluster(file)) {
+      reclaimWatchPool(file);
+      tierWatchPool(file);
+    }
     // create RadosStriper connection
     libradosstriper::RadosStriper *striper = new libradosstriper::RadosStriper;
     if (0 == striper) {
@@ -499,7 +724,7 @@ int checkAndCreateStriper(unsigned int cephPoolIdx, std::string &userAtPool, con
       delete ioctx;
       cluster->shutdown();
       delete cluster;
-      g_cluster[cephPoolIdx] = 0;
+      g_cluster[cephPoolIdx][clusterIdx] = 0;
       return 0;
     }
     rc = libradosstriper::RadosStriper::striper_create(*ioctx, striper);
@@ -509,7 +734,7 @@ int checkAndCreateStriper(unsigned int cephPoolIdx, std::string &userAtPool, con
       delete ioctx;
       cluster->shutdown();
       delete cluster;
-      g_cluster[cephPoolIdx] = 0;
+      g_cluster[cephPoolIdx][clusterIdx] = 0;
       return 0;
     }
     // setup layout
@@ -520,7 +745,7 @@ int checkAndCreateStriper(unsigned int cephPoolIdx, std::string &userAtPool, con
       delete ioctx;
       cluster->shutdown();
       delete cluster;
-      g_cluster[cephPoolIdx] = 0;
+      g_cluster[cephPoolIdx][clusterIdx] = 0;
       return 0;
     }
     rc = striper->set_object_layout_stripe_unit(file.stripeUnit);
@@ -530,7 +755,7 @@ int checkAndCreateStriper(unsigned int cephPoolIdx, std::string &userAtPool, con
       delete ioctx;
       cluster->shutdown();
       delete cluster;
-      g_cluster[cephPoolIdx] = 0;
+      g_cluster[cephPoolIdx][clusterIdx] = 0;
       return 0;
     }
     rc = striper->set_object_layout_object_size(file.objectSize);
@@ -540,7 +765,7 @@ int checkAndCreateStriper(unsigned int cephPoolIdx, std::string &userAtPool, con
       delete ioctx;
       cluster->shutdown();
       delete cluster;
-      g_cluster[cephPoolIdx] = 0;
+      g_cluster[cephPoolIdx][clusterIdx] = 0;
       return 0;
     }
     IOCtxDict & ioDict = g_ioCtx[cephPoolIdx];
@@ -551,34 +776,311 @@ int checkAndCreateStriper(unsigned int cephPoolIdx, std::string &userAtPool, con
   return 1;
 } 
 
-static libradosstriper::RadosStriper* getRadosStriper(const CephFile& file) {
-  XrdSysMutexHelper lock(g_striper_mutex);
+/// key of the striper and IoCtx of a file in a given cluster
+static std::string striperKey(const CephFile& file, unsigned int clusterIdx) {
   std::stringstream ss;
+  if (clusterIdx) ss << g_cephClusters[clusterIdx].name << ':';
   ss << file.userId << '@' << file.pool << ',' << file.nbStripes << ','
      << file.stripeUnit << ',' << file.objectSize;
-  std::string userAtPool = ss.str();
+  return ss.str();
+}
+
+/// gets the striper of a file in a given cluster
+static libradosstriper::RadosStriper* getClusterStriper(const CephFile& file,
+                                                        unsigned int clusterIdx) {
+  XrdSysMutexHelper lock(g_striper_mutex);
+  std::string userAtPool = striperKey(file, clusterIdx);
   unsigned int cephPoolIdx = getCephPoolIdxAndIncrease();
-  if (checkAndCreateStriper(cephPoolIdx, userAtPool, file) == 0) {
+  if (checkAndCreateStriper(cephPoolIdx, userAtPool, file, clusterIdx) == 0) {
     logwrapper((char*)"getRadosStriper : checkAndCreateStriper failed");
     return 0;
   }
   return g_radosStripers[cephPoolIdx][userAtPool];
 }
 
-static librados::IoCtx* getIoCtx(const CephFile& file) {
+static libradosstriper::RadosStriper* getRadosStriper(const CephFile& file) {
+  return getClusterStriper(file, homeCluster(file));
+}
+
+/// gets the IoCtx of the pool of a file in a given cluster
+static librados::IoCtx* getClusterIoCtx(const CephFile& file, unsigned int clusterIdx) {
   XrdSysMutexHelper lock(g_striper_mutex);
-  std::stringstream ss;
-  ss << file.userId << '@' << file.pool << ',' << file.nbStripes << ','
-     << file.stripeUnit << ',' << file.objectSize;
-  std::string userAtPool = ss.str();
+  std::string userAtPool = striperKey(file, clusterIdx);
   unsigned int cephPoolIdx = getCephPoolIdxAndIncrease();
-  if (checkAndCreateStriper(cephPoolIdx, userAtPool, file) == 0) {
+  if (checkAndCreateStriper(cephPoolIdx, userAtPool, file, clusterIdx) == 0) {
     return 0;
   }
   return g_ioCtx[cephPoolIdx][userAtPool];
 }
 
+static librados::IoCtx* getIoCtx(const CephFile& file) {
+  return getClusterIoCtx(file, homeCluster(file));
+}
+
+/// gets the connection to a given cluster, creating the completions of the
+/// operations sent to that cluster
+static librados::Rados* getClusterRados(const CephFile& file, unsigned int clusterIdx) {
+  return checkAndCreateCluster(getCephPoolIdxAndIncrease(), file.userId, clusterIdx);
+}
+
+/// a contiguous piece of a range of a file, stored in a single object
+struct ObjectExtent {
+  unsigned long long objectNo;
+  unsigned long long objectOffset;
+  size_t length;
+  /// offset of the piece within the range of the file
+  size_t bufferOffset;
+};
+
+/// name of an object of a striped file
+static std::string getObjectName(const std::string &name, unsigned long long objectNo) {
+  char suffix[18];
+  snprintf(suffix, sizeof(suffix), ".%016llx", objectNo);
+  return name + suffix;
+}
+
+/// maps a range of a file to pieces of its objects, following the striping
+/// layout of libradosstriper : stripe units are distributed round robin over
+/// stripe_count objects, until these are full, then a new set of objects is used
+static void getObjectExtents(const CephFile &file, unsigned long long offset, size_t count,
+                             std::vector<ObjectExtent> &extents) {
+  unsigned long long su = file.stripeUnit;
+  unsigned long long sc = file.nbStripes;
+  unsigned long long stripesPerObject = file.objectSize / su;
+  size_t done = 0;
+  while (done < count) {
+    unsigned long long pos = offset + done;
+    unsigned long long blockNo = pos / su;
+    unsigned long long stripeNo = blockNo / sc;
+    unsigned long long stripePos = blockNo % sc;
+    ObjectExtent e;
+    e.objectNo = (stripeNo / stripesPerObject) * sc + stripePos;
+    e.objectOffset = (stripeNo % stripesPerObject) * su + pos % su;
+    e.length = su - pos % su < count - done ? su - pos % su : count - done;
+    e.bufferOffset = done;
+    // merge with the previous piece when contiguous in both the object and the range
+    if (!extents.empty()) {
+      ObjectExtent &last = extents.back();
+      if (last.objectNo == e.objectNo &&
+          last.objectOffset + last.length == e.objectOffset &&
+          last.bufferOffset + last.length == e.bufferOffset) {
+        last.length += e.length;
+        done += e.length;
+        continue;
+      }
+    }
+    extents.push_back(e);
+    done += e.length;
+  }
+}
+
+/// sets the policy for layouts not aligned on the stripe width of erasure coded pools
+/// returns 0 or -EINVAL for an unknown policy
+int ceph_posix_set_ecalign(const char *policy) {
+  if (!strcmp(policy, "off")) g_ecAlignPolicy = EC_ALIGN_OFF;
+  else if (!strcmp(policy, "warn")) g_ecAlignPolicy = EC_ALIGN_WARN;
+  else if (!strcmp(policy, "round")) g_ecAlignPolicy = EC_ALIGN_ROUND;
+  else return -EINVAL;
+  return 0;
+}
+
+/// alignment required by the pool of a file, if already known
+static bool lookupPoolAlignment(const CephFile &file, unsigned long long &alignment) {
+  XrdSysMutexHelper lock(g_poolAlignmentsMutex);
+  std::map<std::string, unsigned long long>::const_iterator it = g_poolAlignments.find(file.pool);
+  if (it == g_poolAlignments.end()) return false;
+  alignment = it->second;
+  return true;
+}
+
+/// alignment required by the pool of a file, 0 if none or unknown
+/// it is recorded when the first IoCtx of the pool is created
+static unsigned long long getPoolAlignment(const CephFile &file) {
+  unsigned long long alignment = 0;
+  if (lookupPoolAlignment(file, alignment)) return alignment;
+  // create an IoCtx with the default layout, which is valid
+  CephFile defaultFile = file;
+  defaultFile.nbStripes = g_defaultParams.nbStripes;
+  defaultFile.stripeUnit = g_defaultParams.stripeUnit;
+  defaultFile.objectSize = g_defaultParams.objectSize;
+  if (0 == getIoCtx(defaultFile)) return 0;
+  lookupPoolAlignment(file, alignment);
+  return alignment;
+}
+
+/// replicated pool holding the metadata objects kept for the data pools, as
+/// erasure coded pools have no omap. Empty to keep them in each data pool
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+std::string g_cephMetaPool;
+
+/// sets the pool holding the metadata objects of all data pools
+/// returns 0 or -EINVAL for an empty name
+int ceph_posix_set_metapool(const char *pool) {
+  if (0 == *pool) return -EINVAL;
+  g_cephMetaPool = pool;
+  return 0;
+}
+
+/// whether metadata objects using omap can be kept for the pool of a file
+static bool hasMetaPool(const CephFile &file) {
+  return !g_cephMetaPool.empty() || 0 == getPoolAlignment(file);
+}
+
+/// name of a metadata object of the pool of a file, in the pool holding it.
+/// The objects of all data pools share the metadata pool, so their names then
+/// get the name of their data pool
+static std::string metaObjectName(const CephFile &file, const std::string &name) {
+  return g_cephMetaPool.empty() ? name : name + '@' + file.pool;
+}
+
+/// gets the IoCtx of the pool holding a metadata object of the pool of a file,
+/// and the name of that object there (See metaObjectName)
+static librados::IoCtx* getMetaIoCtx(const CephFile &file, const std::string &name,
+                                     std::string &oid) {
+  oid = metaObjectName(file, name);
+  if (g_cephMetaPool.empty()) {
+    return getIoCtx(file);
+  }
+  CephFile meta = file;
+  meta.pool = g_cephMetaPool;
+  meta.nbStripes = g_defaultParams.nbStripes;
+  meta.stripeUnit = g_defaultParams.stripeUnit;
+  meta.objectSize = g_defaultParams.objectSize;
+  return getIoCtx(meta);
+}
+
+/// aligns the layout of a file on the stripe width of its pool when erasure coded,
+/// so that writes of whole stripe units do not need read-modify-writes on the OSDs
+static void alignLayout(CephFile &file) {
+  if (EC_ALIGN_OFF == g_ecAlignPolicy) return;
+  unsigned long long alignment = getPoolAlignment(file);
+  if (0 == alignment) return;
+  // stripe units must also be multiples of 64K for the striper
+  unsigned long long a = alignment, b = 65536;
+  while (b) {
+    unsigned long long t = a % b;
+    a = b;
+    b = t;
+  }
+  unsigned long long unit = alignment / a * 65536;
+  if (file.stripeUnit % unit == 0) return;
+  bool isDefault = file.stripeUnit == g_defaultParams.stripeUnit &&
+    file.objectSize == g_defaultParams.objectSize;
+  if (!isDefault && EC_ALIGN_WARN == g_ecAlignPolicy) {
+    logwrapper((char*)"alignLayout : stripeUnit %llu of %s is not a multiple of %llu, "
+               "writes will need read-modify-writes", file.stripeUnit, file.name.c_str(), unit);
+    return;
+  }
+  unsigned long long stripeUnit = (file.stripeUnit + unit - 1) / unit * unit;
+  unsigned long long objectSize = (file.objectSize + stripeUnit - 1) / stripeUnit * stripeUnit;
+  logwrapper((char*)"alignLayout : layout of %s rounded to stripeUnit %llu, objectSize %llu",
+             file.name.c_str(), stripeUnit, objectSize);
+  file.stripeUnit = stripeUnit;
+  file.objectSize = objectSize;
+}
+
+/// counts writes to erasure coded pools that do not cover full stripes
+static void countEcWrite(const CephFile &file, size_t count, unsigned long long offset) {
+  unsigned long long alignment = 0;
+  if (!lookupPoolAlignment(file, alignment) || 0 == alignment) return;
+  __sync_fetch_and_add(&g_ecNbWrites, 1);
+  std::vector<ObjectExtent> extents;
+  getObjectExtents(file, offset, count, extents);
+  for (std::vector<ObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+    if (it->objectOffset % alignment || it->length % alignment) {
+      __sync_fetch_and_add(&g_ecNbPartialWrites, 1);
+      return;
+    }
+  }
+}
+
+/// a class of file sizes, and the layout given to new files of this class
+struct SizeClass {
+  unsigned long long minSize;
+  unsigned int nbStripes;
+  unsigned long long stripeUnit;
+  unsigned long long objectSize;
+};
+/// size classes, sorted by minimum size
+/// (See XrdCephOss::configure)
+std::vector<SizeClass> g_sizeClasses;
+
+/// adds a size class : new files expected to have at least minSize bytes get the
+/// given layout, unless a larger class applies or their layout is explicitly given
+/// returns 0 or -EINVAL in case of an invalid layout
+int ceph_posix_add_sizeclass(unsigned long long minSize, unsigned int nbStripes,
+                             unsigned long long stripeUnit, unsigned long long objectSize) {
+  if (0 == nbStripes || 0 == stripeUnit || stripeUnit % 65536 ||
+      0 == objectSize || objectSize % stripeUnit) {
+    return -EINVAL;
+  }
+  SizeClass sc;
+  sc.minSize = minSize;
+  sc.nbStripes = nbStripes;
+  sc.stripeUnit = stripeUnit;
+  sc.objectSize = objectSize;
+  std::vector<SizeClass>::iterator it = g_sizeClasses.begin();
+  while (it != g_sizeClasses.end() && it->minSize <= minSize) it++;
+  g_sizeClasses.insert(it, sc);
+  return 0;
+}
+
+/// whether the layout of a file is explicitly given, in its path or its environment
+static bool hasExplicitLayout(const char *path, XrdOucEnv *env) {
+  std::string spath = path;
+  size_t colonPos = spath.find(':');
+  if (std::string::npos != colonPos && std::string::npos != spath.find(',')
+      && spath.find(',') < colonPos) {
+    return true;
+  }
+  return env && (env->Get("cephNbStripes") || env->Get("cephStripeUnit") ||
+                 env->Get("cephObjectSize"));
+}
+
+/// picks the layout of a new file from its expected size, given by the
+/// oss.asize entry of the environment, using the configured size classes
+static void applySizeClass(const char *path, XrdOucEnv *env, CephFile &file) {
+  if (g_sizeClasses.empty() || 0 == env) return;
+  char *asize = env->Get("oss.asize");
+  if (0 == asize || hasExplicitLayout(path, env)) return;
+  unsigned long long size = strtoull(asize, 0, 10);
+  const SizeClass *sc = 0;
+  for (std::vector<SizeClass>::const_iterator it = g_sizeClasses.begin();
+       it != g_sizeClasses.end() && it->minSize <= size;
+       it++) {
+    sc = &(*it);
+  }
+  if (0 == sc) return;
+  file.nbStripes = sc->nbStripes;
+  file.stripeUnit = sc->stripeUnit;
+  file.objectSize = sc->objectSize;
+}
+
+/// appends the statistics of writes to erasure coded pools to a stream
+static void ecAlignStats(std::ostringstream &ss) {
+  ss << "<ecalign>"
+     << "<writes>" << g_ecNbWrites << "</writes>"
+     << "<partial>" << g_ecNbPartialWrites << "</partial>"
+     << "</ecalign>";
+}
+
+/// gets the timer, creating it if needed
+static XrdCephTimer* getTimer() {
+  XrdSysMutexHelper lock(g_init_mutex);
+  if (0 == g_cephTimer && !g_cephShutdown) g_cephTimer = new XrdCephTimer();
+  return g_cephTimer;
+}
+
 void ceph_posix_disconnect_all() {
+  g_cephShutdown = true;
+  XrdCephTimer *timer;
+  {
+    XrdSysMutexHelper lock(g_init_mutex);
+    timer = g_cephTimer;
+    g_cephTimer = 0;
+  }
+  delete timer;
   XrdSysMutexHelper lock(g_striper_mutex);
   for (unsigned int i= 0; i < g_maxCephPoolIdx; i++) {
     for (StriperDict::iterator it2 = g_radosStripers[i].begin();
@@ -591,7 +1093,9 @@ void ceph_posix_disconnect_all() {
          it2++) {
       delete it2->second;
     }
-    delete g_cluster[i];
+    for (unsigned int j = 0; j < g_cluster[i].size(); j++) {
+      delete g_cluster[i][j];
+    }
   }
   g_radosStripers.clear();
   g_ioCtx.clear();
@@ -602,178 +1106,5599 @@ void ceph_posix_set_logfunc(void (*logfunc) (char *, va_list argp)) {
   g_logfunc = logfunc;
 };
 
-static int ceph_posix_internal_truncate(const CephFile &file, unsigned long long size);
+/// prefix of the objects holding the name index
+static const char g_nameIndexObjectPrefix[] = "xrdceph.nameindex.";
+/// object holding the generation of the name index in use, and the one being
+/// rebuilt if any, as xattrs. Each generation has its own shards, so that
+/// rebuilds fill fresh shards and swap them in once complete
+static const char g_nameIndexRootObject[] = "xrdceph.nameindex";
+/// number of seconds the generations of the name index of a pool are cached.
+/// Rebuilds wait for that long before scanning the pool and after swapping the
+/// shards, so that all gateways write to the shards being rebuilt meanwhile
+static const unsigned int g_nameIndexStateTtl = 10;
+/// maximum number of name index entries fetched or written in one go
+static const unsigned int g_nameIndexBatchSize = 1000;
+/// maximum number of directories remembered as already indexed
+static const unsigned int g_nameIndexMaxKnownDirs = 100000;
 
-int ceph_posix_open(XrdOucEnv* env, const char *pathname, int flags, mode_t mode) {
-  CephFileRef fr = getCephFileRef(pathname, env, flags, mode, 0);
-  int fd = insertFileRef(fr);
-  logwrapper((char*)"ceph_open: fd %d associated to %s", fd, pathname);
-  // in case of O_CREAT and O_EXCL, we should complain if the file exists
-  // in case of O_READ, the file has to exist
-  if (((flags & O_CREAT) && (flags & O_EXCL)) || ((flags&O_ACCMODE) == O_RDONLY)) {
-    libradosstriper::RadosStriper *striper = getRadosStriper(fr);
-    if (0 == striper) {
-      deleteFileRef(fd, fr);
-      return -EINVAL;
-    }
-    struct stat buf;
-    int rc = striper->stat(fr.name, (uint64_t*)&(buf.st_size), &(buf.st_atime));
-    if ((flags&O_ACCMODE) == O_RDONLY) {
-      if (rc) {
-        deleteFileRef(fd, fr);
-        return rc;
-      }
-    } else if (rc != -ENOENT) {
-      deleteFileRef(fd, fr);
-      if (0 == rc) return -EEXIST;
-      return rc;
-    }
-  }
-  // in case of O_TRUNC, we should truncate the file
-  if (flags & O_TRUNC) {
-    int rc = ceph_posix_internal_truncate(fr, 0);
-    // fail only if file exists and cannot be truncated
-    if (rc < 0 && rc != -ENOENT) {
-      deleteFileRef(fd, fr);
-      return rc;
-    }
+/// state of the name index of a pool, as last read from its root object
+struct NameIndexState {
+  NameIndexState() : generation(0), building(0), fetched(0) {}
+  /// generation of the shards in use, and of the ones being rebuilt, 0 if none
+  unsigned long long generation;
+  unsigned long long building;
+  time_t fetched;
+  /// directories known to be present in the shards in use, used to avoid
+  /// rewriting the parent chain on every file creation. They are forgotten
+  /// when the shards in use change
+  std::set<std::string> knownDirs;
+};
+/// states of the name indexes, per pool
+std::map<std::string, NameIndexState> g_nameIndexStates;
+/// mutex protecting g_nameIndexStates
+XrdSysMutex g_nameIndexMutex;
+
+/// FNV-1a hash, used to shard the name index by directory
+/// Note that it has to be stable across gateways and versions
+static unsigned int nameIndexHash(const std::string &s) {
+  unsigned int h = 2166136261U;
+  for (std::string::const_iterator it = s.begin(); it != s.end(); it++) {
+    h ^= (unsigned char)*it;
+    h *= 16777619U;
   }
-  return fd;
+  return h;
 }
 
-int ceph_posix_close(int fd) {
-  CephFileRef* fr = getFileRef(fd);
-  if (fr) {
-    logwrapper((char*)"ceph_close: closed fd %d for file %s, read ops count %d, write ops count %d",
-               fd, fr->name.c_str(), fr->rdcount, fr->wrcount);
-    deleteFileRef(fd, *fr);
-    return 0;
-  } else {
-    return -EBADF;
-  }
+/// normalizes a directory name so that it starts and ends with a '/'
+static std::string nameIndexDirName(const std::string &path) {
+  std::string dir = path;
+  if (dir.empty() || dir[0] != '/') dir = "/" + dir;
+  if (dir[dir.size()-1] != '/') dir += '/';
+  return dir;
 }
 
-static off64_t lseek_compute_offset(CephFileRef &fr, off64_t offset, int whence) {
-  switch (whence) {
-  case SEEK_SET:
-    fr.offset = offset;
-    break;
-  case SEEK_CUR:
-    fr.offset += offset;
-    break;
-  default:
+/// splits a file or directory name into its parent directory (with trailing '/')
+/// and its entry name. Directories entries keep a trailing '/'
+static void nameIndexSplit(const std::string &path, std::string &dir, std::string &entry) {
+  std::string p = path;
+  if (p.empty() || p[0] != '/') p = "/" + p;
+  bool isDir = p.size() > 1 && p[p.size()-1] == '/';
+  if (isDir) p.erase(p.size()-1);
+  size_t slashPos = p.rfind('/');
+  dir = p.substr(0, slashPos+1);
+  entry = p.substr(slashPos+1);
+  if (isDir) entry += '/';
+}
+
+int ceph_posix_set_nameindex(unsigned int nbShards, unsigned int dirShards) {
+  if (nbShards > 65536 || 0 == dirShards || (nbShards > 0 && dirShards > nbShards)) {
     return -EINVAL;
   }
-  return fr.offset;
+  g_cephNameIndexNbShards = nbShards;
+  g_cephNameIndexDirShards = dirShards;
+  return 0;
 }
 
-off_t ceph_posix_lseek(int fd, off_t offset, int whence) {
-  CephFileRef* fr = getFileRef(fd);
-  if (fr) {
-    logwrapper((char*)"ceph_lseek: for fd %d, offset=%lld, whence=%d", fd, offset, whence);
-    return (off_t)lseek_compute_offset(*fr, offset, whence);
-  } else {
-    return -EBADF;
+/// gets the IoCtx of the pool holding the name index of the pool of a file,
+/// which is the metadata pool if any (See getMetaIoCtx)
+/// returns 0 for erasure coded pools without metadata pool, having no omap
+static librados::IoCtx* nameIndexIoCtx(const CephFile &file) {
+  if (!hasMetaPool(file)) return 0;
+  std::string oid;
+  return getMetaIoCtx(file, g_nameIndexRootObject, oid);
+}
+
+/// name of a shard of a name index generation of the pool of a file
+/// generation 0 keeps the names of the indexes never rebuilt
+static std::string nameIndexShard(const CephFile &file, unsigned long long generation,
+                                  unsigned int shard) {
+  std::stringstream ss;
+  ss << g_nameIndexObjectPrefix;
+  if (generation) ss << generation << '.';
+  ss << shard;
+  return metaObjectName(file, ss.str());
+}
+
+/// name of the index object holding a given entry of a given directory
+/// The entries of a directory are spread over g_cephNameIndexDirShards
+/// consecutive shards, starting at the one given by the directory name
+static std::string nameIndexObject(const CephFile &file, const std::string &dir,
+                                   const std::string &entry, unsigned long long generation) {
+  unsigned int shard = nameIndexHash(dir) % g_cephNameIndexNbShards;
+  shard += nameIndexHash(entry) % g_cephNameIndexDirShards;
+  return nameIndexShard(file, generation, shard % g_cephNameIndexNbShards);
+}
+
+/// names of the index objects holding the entries of a given directory
+static void nameIndexDirObjects(const CephFile &file, const std::string &dir,
+                                unsigned long long generation, std::vector<std::string> &objects) {
+  unsigned int first = nameIndexHash(dir) % g_cephNameIndexNbShards;
+  for (unsigned int i = 0; i < g_cephNameIndexDirShards; i++) {
+    objects.push_back(nameIndexShard(file, generation, (first + i) % g_cephNameIndexNbShards));
   }
 }
 
-off64_t ceph_posix_lseek64(int fd, off64_t offset, int whence) {
-  CephFileRef* fr = getFileRef(fd);
-  if (fr) {
-    logwrapper((char*)"ceph_lseek64: for fd %d, offset=%lld, whence=%d", fd, offset, whence);
-    return lseek_compute_offset(*fr, offset, whence);
-  } else {
-    return -EBADF;
+/// reads the generations of the name index of a pool from its root object
+static int nameIndexReadState(const CephFile &file, librados::IoCtx *ioctx,
+                              unsigned long long &generation, unsigned long long &building) {
+  generation = 0;
+  building = 0;
+  std::map<std::string, ceph::bufferlist> attrs;
+  int rc = ioctx->getxattrs(metaObjectName(file, g_nameIndexRootObject), attrs);
+  if (-ENOENT == rc) return 0;
+  if (rc < 0) return rc;
+  std::map<std::string, ceph::bufferlist>::iterator it = attrs.find("generation");
+  if (it != attrs.end()) {
+    generation = strtoull(std::string(it->second.c_str(), it->second.length()).c_str(), 0, 10);
   }
+  it = attrs.find("building");
+  if (it != attrs.end()) {
+    building = strtoull(std::string(it->second.c_str(), it->second.length()).c_str(), 0, 10);
+  }
+  return 0;
 }
 
-ssize_t ceph_posix_write(int fd, const void *buf, size_t count) {
-  CephFileRef* fr = getFileRef(fd);
-  if (fr) {
-    logwrapper((char*)"ceph_write: for fd %d, count=%d", fd, count);
-    if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
-      return -EBADF;
-    }
-    libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
-    if (0 == striper) {
-      return -EINVAL;
-    }
-    ceph::bufferlist bl;
-    bl.append((const char*)buf, count);
-    int rc = striper->write(fr->name, bl, count, fr->offset);
-    if (rc) return rc;
-    fr->offset += count;
-    fr->wrcount++;
-    return count;
-  } else {
-    return -EBADF;
+/// generations of the name index of a pool in use and being rebuilt, cached
+/// for g_nameIndexStateTtl seconds. The previous ones are kept on errors
+static void nameIndexGenerations(const CephFile &file, librados::IoCtx *ioctx,
+                                 unsigned long long &generation, unsigned long long &building) {
+  time_t now = time(NULL);
+  {
+    XrdSysMutexHelper lock(g_nameIndexMutex);
+    NameIndexState &state = g_nameIndexStates[file.pool];
+    generation = state.generation;
+    building = state.building;
+    if (state.fetched + (time_t)g_nameIndexStateTtl > now) return;
+  }
+  unsigned long long newGeneration, newBuilding;
+  int rc = nameIndexReadState(file, ioctx, newGeneration, newBuilding);
+  XrdSysMutexHelper lock(g_nameIndexMutex);
+  NameIndexState &state = g_nameIndexStates[file.pool];
+  state.fetched = now;
+  if (rc < 0) {
+    logwrapper((char*)"nameIndexGenerations : unable to read the name index state of pool %s, rc = %d",
+               file.pool.c_str(), rc);
+    return;
   }
+  if (newGeneration != state.generation) state.knownDirs.clear();
+  state.generation = generation = newGeneration;
+  state.building = building = newBuilding;
 }
 
-ssize_t ceph_posix_pwrite(int fd, const void *buf, size_t count, off64_t offset) {
-  CephFileRef* fr = getFileRef(fd);
-  if (fr) {
-    // TODO implement proper logging level for this plugin - this should be only debug
-    //logwrapper((char*)"ceph_write: for fd %d, count=%d", fd, count);
-    if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
-      return -EBADF;
-    }
-    libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
-    if (0 == striper) {
-      return -EINVAL;
-    }
-    ceph::bufferlist bl;
-    bl.append((const char*)buf, count);
-    int rc = striper->write(fr->name, bl, count, offset);
-    if (rc) return rc;
-    fr->wrcount++;
-    return count;
-  } else {
-    return -EBADF;
+/// prefix of the keys of the entries of a given directory
+/// the length of the directory name is included so that the entries of a
+/// directory are never mixed with the ones of its subdirectories
+static std::string nameIndexKeyPrefix(const std::string &dir) {
+  std::stringstream ss;
+  ss << dir.size() << ':' << dir;
+  return ss.str();
+}
+
+/// adds to the given map the index entries of a file and of its parent
+/// directories in a given generation, stopping at the first directory present
+/// in knownDirs. The map is indexed by index object name
+typedef std::map<std::string, std::map<std::string, ceph::bufferlist> > NameIndexUpdates;
+static void nameIndexCollectEntries(const CephFile &file, const std::string &name,
+                                    unsigned long long generation,
+                                    std::set<std::string> &knownDirs,
+                                    NameIndexUpdates &updates) {
+  std::string path = name;
+  while (true) {
+    std::string dir, entry;
+    nameIndexSplit(path, dir, entry);
+    if (entry.empty()) break;
+    updates[nameIndexObject(file, dir, entry, generation)][nameIndexKeyPrefix(dir) + entry] =
+      ceph::bufferlist();
+    if (dir == "/") break;
+    if (knownDirs.find(dir) != knownDirs.end()) break;
+    knownDirs.insert(dir);
+    path = dir;
   }
 }
 
-static void ceph_aio_write_complete(rados_completion_t c, void *arg) {
-  AioArgs *awa = reinterpret_cast<AioArgs*>(arg);
-  size_t rc = rados_aio_get_return_value(c);
-  awa->callback(awa->aiop, rc == 0 ? awa->nbBytes : rc);
-  delete(awa);
+/// writes a set of updates to the name index
+/// returns 0 or the first negative error code encountered
+static int nameIndexWrite(librados::IoCtx *ioctx, const NameIndexUpdates &updates) {
+  int res = 0;
+  for (NameIndexUpdates::const_iterator it = updates.begin(); it != updates.end(); it++) {
+    librados::ObjectWriteOperation op;
+    op.omap_set(it->second);
+    int rc = ioctx->operate(it->first, &op);
+    if (rc < 0 && 0 == res) res = rc;
+  }
+  return res;
 }
 
-ssize_t ceph_aio_write(int fd, XrdSfsAio *aiop, AioCB *cb) {
-  CephFileRef* fr = getFileRef(fd);
-  if (fr) {
-    // get the parameters from the Xroot aio object
-    size_t count = aiop->sfsAio.aio_nbytes;
-    const char *buf = (const char*)aiop->sfsAio.aio_buf;
-    size_t offset = aiop->sfsAio.aio_offset;
-    // TODO implement proper logging level for this plugin - this should be only debug
-    //logwrapper((char*)"ceph_aio_write: for fd %d, count=%d", fd, count);
-    if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
-      return -EBADF;
+/// adds a file and its parent directories to the name index
+static int nameIndexAdd(const CephFile &file) {
+  librados::IoCtx *ioctx = nameIndexIoCtx(file);
+  if (0 == ioctx) return -EINVAL;
+  unsigned long long generation, building;
+  nameIndexGenerations(file, ioctx, generation, building);
+  NameIndexUpdates updates;
+  {
+    XrdSysMutexHelper lock(g_nameIndexMutex);
+    std::set<std::string> &knownDirs = g_nameIndexStates[file.pool].knownDirs;
+    if (knownDirs.size() > g_nameIndexMaxKnownDirs) {
+      knownDirs.clear();
+    }
+    nameIndexCollectEntries(file, file.name, generation, knownDirs, updates);
+  }
+  if (building) {
+    // shards being rebuilt get the whole parent chain, as they may not have it yet
+    std::set<std::string> noKnownDirs;
+    nameIndexCollectEntries(file, file.name, building, noKnownDirs, updates);
+  }
+  int rc = nameIndexWrite(ioctx, updates);
+  if (rc < 0) {
+    // forget about the directories we could not write
+    XrdSysMutexHelper lock(g_nameIndexMutex);
+    g_nameIndexStates[file.pool].knownDirs.clear();
+    logwrapper((char*)"nameIndexAdd : failed to index %s, rc = %d", file.name.c_str(), rc);
+  }
+  return rc;
+}
+
+/// removes a file from the name index, and from the shards being rebuilt if
+/// any. Parent directories are kept
+static int nameIndexRemove(const CephFile &file) {
+  librados::IoCtx *ioctx = nameIndexIoCtx(file);
+  if (0 == ioctx) return -EINVAL;
+  unsigned long long generations[2];
+  nameIndexGenerations(file, ioctx, generations[0], generations[1]);
+  std::string dir, entry;
+  nameIndexSplit(file.name, dir, entry);
+  std::set<std::string> keys;
+  keys.insert(nameIndexKeyPrefix(dir) + entry);
+  for (unsigned int i = 0; i < 2; i++) {
+    if (i > 0 && 0 == generations[i]) break;
+    librados::ObjectWriteOperation op;
+    op.omap_rm_keys(keys);
+    int rc = ioctx->operate(nameIndexObject(file, dir, entry, generations[i]), &op);
+    if (rc < 0 && rc != -ENOENT) {
+      logwrapper((char*)"nameIndexRemove : failed to remove %s from index, rc = %d",
+                 file.name.c_str(), rc);
+      return rc;
+    }
+  }
+  return 0;
+}
+
+/// checks whether a directory exists in the name index
+/// returns 1 if it does, 0 if not and a negative error code in case of failure
+static int nameIndexDirExists(const CephFile &file) {
+  std::string dirName = nameIndexDirName(file.name);
+  if (dirName == "/") return 1;
+  librados::IoCtx *ioctx = nameIndexIoCtx(file);
+  if (0 == ioctx) return -EINVAL;
+  unsigned long long generation, building;
+  nameIndexGenerations(file, ioctx, generation, building);
+  std::string parent, entry;
+  nameIndexSplit(dirName, parent, entry);
+  std::set<std::string> keys;
+  keys.insert(nameIndexKeyPrefix(parent) + entry);
+  std::map<std::string, ceph::bufferlist> values;
+  int rval = 0;
+  librados::ObjectReadOperation op;
+  op.omap_get_vals_by_keys(keys, &values, &rval);
+  int rc = ioctx->operate(nameIndexObject(file, parent, entry, generation), &op, 0);
+  if (-ENOENT == rc) return 0;
+  if (rc < 0) return rc;
+  if (rval < 0) return rval;
+  return values.empty() ? 0 : 1;
+}
+
+static DirIterator* openPoolListing(const CephFile &file, unsigned int shardIdx,
+                                    unsigned int nbShards);
+
+/// small struct holding the negative lookup filter of a pool, together with
+/// the statistics of its usage
+struct NegLookupFilter {
+  NegLookupFilter() : current(0), building(0), lastBuild(0), buildDuration(0),
+                      nbUnlinks(0), nbLookups(0), nbNegatives(0), nbFalsePositives(0),
+                      nbStaleNegatives(0) {}
+  /// user and pool to be scanned
+  CephFile file;
+  /// filter in use, 0 until the first build is over
+  XrdCephBloomFilter *current;
+  /// filter being built, 0 outside of builds
+  XrdCephBloomFilter *building;
+  /// time of the end of the last build
+  time_t lastBuild;
+  /// duration of the last build, in seconds
+  double buildDuration;
+  /// number of files unlinked since the last build
+  unsigned long long nbUnlinks;
+  /// number of lookups, negative answers given and false positives seen
+  unsigned long long nbLookups;
+  unsigned long long nbNegatives;
+  unsigned long long nbFalsePositives;
+  /// number of negative answers found wrong when checked against ceph, that is
+  /// files created by other gateways since the last build
+  unsigned long long nbStaleNegatives;
+  /// protects all members above and signals rebuild requests
+  XrdSysCondVar cond;
+};
+
+/// expected number of files per pool for the negative lookup filters
+/// 0 means that negative lookup filters are disabled
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+unsigned long long g_negLookupExpectedNbFiles = 0;
+/// targeted false positive rate of the negative lookup filters
+double g_negLookupFpRate = 0.01;
+/// whether the negative answers of the filters are trusted. They miss the files
+/// created by other gateways until the next rebuild, so by default they are
+/// checked against ceph, and only counted. Trusted answers save the stats of
+/// missing files but may be stale for up to g_negLookupRebuildInterval plus
+/// the duration of a scan
+bool g_negLookupTrusted = false;
+/// interval between two rebuilds of the negative lookup filters, in seconds
+unsigned int g_negLookupRebuildInterval = 3600;
+/// global variable holding the negative lookup filters, per pool
+std::map<std::string, NegLookupFilter*> g_negLookupFilters;
+/// mutex protecting g_negLookupFilters
+XrdSysMutex g_negLookupMutex;
+
+/// rebuilds the negative lookup filter of a pool from a full scan of it
+static void buildNegLookupFilter(NegLookupFilter *nlf) {
+  time_t start = time(NULL);
+  unsigned long long nbExpected = g_negLookupExpectedNbFiles;
+  {
+    XrdSysCondVarHelper lock(nlf->cond);
+    // leave some room for growth in case the pool outgrew the configuration
+    if (nlf->current && nlf->current->nbEntries() * 5 / 4 > nbExpected) {
+      nbExpected = nlf->current->nbEntries() * 5 / 4;
+    }
+    nlf->building = new XrdCephBloomFilter(nbExpected, g_negLookupFpRate);
+  }
+  DirIterator *dir = openPoolListing(nlf->file, 0, 1);
+  int rc = (0 == dir) ? -errno : 0;
+  if (dir) {
+    char name[MAXPATHLEN+1];
+    while (!g_cephShutdown) {
+      rc = ceph_posix_readdir((DIR*)dir, name, sizeof(name));
+      if (rc < 0 || 0 == name[0]) break;
+      nlf->building->add(name);
+    }
+    ceph_posix_closedir((DIR*)dir);
+  }
+  XrdSysCondVarHelper lock(nlf->cond);
+  if (rc < 0 || g_cephShutdown) {
+    logwrapper((char*)"buildNegLookupFilter : scan of pool %s failed, rc = %d, keeping previous filter",
+               nlf->file.pool.c_str(), rc);
+    delete nlf->building;
+    nlf->building = 0;
+    return;
+  }
+  delete nlf->current;
+  nlf->current = nlf->building;
+  nlf->building = 0;
+  nlf->lastBuild = time(NULL);
+  nlf->buildDuration = difftime(nlf->lastBuild, start);
+  nlf->nbUnlinks = 0;
+  logwrapper((char*)"buildNegLookupFilter : filter of pool %s rebuilt in %.0fs, %llu files, "
+             "%llu bits, expected false positive rate %f",
+             nlf->file.pool.c_str(), nlf->buildDuration, nlf->current->nbEntries(),
+             nlf->current->nbBits(), nlf->current->expectedFpRate());
+}
+
+/// entry point of the threads (re)building the negative lookup filters
+static void* negLookupWorker(void *arg) {
+  NegLookupFilter *nlf = (NegLookupFilter*)arg;
+  while (!g_cephShutdown) {
+    buildNegLookupFilter(nlf);
+    // wait for the next rebuild, anticipated when too many files were removed
+    // since removed files cannot be dropped from the filter
+    XrdSysCondVarHelper lock(nlf->cond);
+    while (!g_cephShutdown &&
+           difftime(time(NULL), nlf->lastBuild) < g_negLookupRebuildInterval &&
+           (0 == nlf->current || nlf->nbUnlinks * 10 < nlf->current->nbEntries())) {
+      nlf->cond.Wait(60);
+    }
+  }
+  return 0;
+}
+
+/// gets the negative lookup filter of the pool of a file, creating it if needed
+/// returns 0 if negative lookup filters are disabled
+static NegLookupFilter* getNegLookupFilter(const CephFile &file) {
+  if (0 == g_negLookupExpectedNbFiles) return 0;
+  XrdSysMutexHelper lock(g_negLookupMutex);
+  std::map<std::string, NegLookupFilter*>::iterator it = g_negLookupFilters.find(file.pool);
+  if (it != g_negLookupFilters.end()) return it->second;
+  NegLookupFilter *nlf = new NegLookupFilter();
+  nlf->file = file;
+  nlf->file.name = "/";
+  pthread_t tid;
+  // the thread is created detached
+  int rc = XrdSysThread::Run(&tid, negLookupWorker, nlf, 0, "ceph negative lookup filter");
+  if (rc) {
+    logwrapper((char*)"getNegLookupFilter : unable to create thread for pool %s, rc = %d",
+               file.pool.c_str(), rc);
+    delete nlf;
+    return 0;
+  }
+  g_negLookupFilters[file.pool] = nlf;
+  return nlf;
+}
+
+/// checks whether a file is known not to exist thanks to the negative lookup filter
+static bool negLookupIsAbsent(const CephFile &file) {
+  NegLookupFilter *nlf = getNegLookupFilter(file);
+  if (0 == nlf) return false;
+  XrdSysCondVarHelper lock(nlf->cond);
+  if (0 == nlf->current) return false;
+  nlf->nbLookups++;
+  if (nlf->current->mayContain(file.name)) return false;
+  nlf->nbNegatives++;
+  return true;
+}
+
+/// records that a negative answer of the negative lookup filter was wrong
+static void negLookupStale(const CephFile &file) {
+  NegLookupFilter *nlf = getNegLookupFilter(file);
+  if (0 == nlf) return;
+  XrdSysCondVarHelper lock(nlf->cond);
+  nlf->nbStaleNegatives++;
+}
+
+/// records that a lookup let through by the negative lookup filter found no file
+static void negLookupFalsePositive(const CephFile &file) {
+  NegLookupFilter *nlf = getNegLookupFilter(file);
+  if (0 == nlf) return;
+  XrdSysCondVarHelper lock(nlf->cond);
+  if (nlf->current) nlf->nbFalsePositives++;
+}
+
+/// adds a newly created file to the negative lookup filter of its pool
+static void negLookupAdd(const CephFile &file) {
+  NegLookupFilter *nlf = getNegLookupFilter(file);
+  if (0 == nlf) return;
+  XrdSysCondVarHelper lock(nlf->cond);
+  if (nlf->current) nlf->current->add(file.name);
+  if (nlf->building) nlf->building->add(file.name);
+}
+
+/// records the removal of a file, possibly triggering an early rebuild of the
+/// negative lookup filter of its pool
+static void negLookupRemoved(const CephFile &file) {
+  NegLookupFilter *nlf = getNegLookupFilter(file);
+  if (0 == nlf) return;
+  XrdSysCondVarHelper lock(nlf->cond);
+  nlf->nbUnlinks++;
+  if (nlf->current && nlf->nbUnlinks * 10 >= nlf->current->nbEntries()) {
+    nlf->cond.Signal();
+  }
+}
+
+/// sets the parameters of the negative lookup filters
+/// expectedNbFiles is the expected number of files per pool, 0 disabling the filters
+/// fpRate is the targeted false positive rate and rebuildInterval the interval
+/// between 2 rebuilds of the filters, in seconds. trusted tells whether stats
+/// may fail with ENOENT on the sole answer of the filters
+/// returns 0 or -EINVAL in case of invalid arguments
+int ceph_posix_set_neglookup(unsigned long long expectedNbFiles, double fpRate,
+                             unsigned int rebuildInterval, bool trusted) {
+  if (fpRate <= 0 || fpRate >= 1 || 0 == rebuildInterval) return -EINVAL;
+  g_negLookupExpectedNbFiles = expectedNbFiles;
+  g_negLookupFpRate = fpRate;
+  g_negLookupRebuildInterval = rebuildInterval;
+  g_negLookupTrusted = trusted;
+  return 0;
+}
+
+/// appends the statistics of the negative lookup filters to a stream
+static void negLookupStats(std::ostringstream &ss) {
+  XrdSysMutexHelper lock(g_negLookupMutex);
+  for (std::map<std::string, NegLookupFilter*>::const_iterator it = g_negLookupFilters.begin();
+       it != g_negLookupFilters.end();
+       it++) {
+    NegLookupFilter *nlf = it->second;
+    XrdSysCondVarHelper flock(nlf->cond);
+    ss << "<neglookup pool=\"" << it->first << "\">"
+       << "<ready>" << (nlf->current ? 1 : 0) << "</ready>";
+    if (nlf->current) {
+      unsigned long long nbPositives = nlf->nbLookups - nlf->nbNegatives;
+      ss << "<files>" << nlf->current->nbEntries() << "</files>"
+         << "<bits>" << nlf->current->nbBits() << "</bits>"
+         << "<lookups>" << nlf->nbLookups << "</lookups>"
+         << "<negatives>" << nlf->nbNegatives << "</negatives>"
+         << "<falsepos>" << nlf->nbFalsePositives << "</falsepos>"
+         << "<stale>" << nlf->nbStaleNegatives << "</stale>"
+         << "<fprate>" << (nbPositives > 0 ? (double)nlf->nbFalsePositives / nbPositives : 0.0) << "</fprate>"
+         << "<expfprate>" << nlf->current->expectedFpRate() << "</expfprate>"
+         << "<buildtime>" << nlf->buildDuration << "</buildtime>"
+         << "<lastbuild>" << nlf->lastBuild << "</lastbuild>";
+    }
+    ss << "</neglookup>";
+  }
+}
+
+/// persistent cache of file metadata, 0 when disabled
+/// created in case of ceph.metacache entry in the config file
+XrdCephMetaCache *g_metaCache = 0;
+/// time during which cached metadata are trusted without revalidation, in seconds
+unsigned int g_metaCacheTtl = 60;
+/// statistics of the metadata cache
+unsigned long long g_metaCacheNbHits = 0;
+unsigned long long g_metaCacheNbMisses = 0;
+unsigned long long g_metaCacheNbRevalidations = 0;
+unsigned long long g_metaCacheNbStale = 0;
+
+/// key of a file in the metadata and block caches
+static std::string fileCacheKey(const CephFile &file) {
+  return file.pool + ':' + file.name;
+}
+
+/// small struct for asynchronous revalidations of the metadata cache
+struct MetaCacheRevalidation {
+  MetaCacheRevalidation(const std::string &k, unsigned long long s, time_t m) :
+    key(k), cachedSize(s), cachedMtime(m), size(0), mtime(0) {}
+  std::string key;
+  unsigned long long cachedSize;
+  time_t cachedMtime;
+  uint64_t size;
+  time_t mtime;
+};
+
+static void metaCacheRevalidateComplete(rados_completion_t c, void *arg) {
+  MetaCacheRevalidation *mcr = reinterpret_cast<MetaCacheRevalidation*>(arg);
+  int rc = rados_aio_get_return_value(c);
+  if (0 == rc) {
+    if (mcr->size != mcr->cachedSize || mcr->mtime != mcr->cachedMtime) {
+      __sync_fetch_and_add(&g_metaCacheNbStale, 1);
+    }
+    g_metaCache->putStat(mcr->key, mcr->size, mcr->mtime);
+  } else if (-ENOENT == rc) {
+    __sync_fetch_and_add(&g_metaCacheNbStale, 1);
+    g_metaCache->remove(mcr->key);
+  } else {
+    // unable to check, retry at next access
+    g_metaCache->setValidated(mcr->key, 0);
+  }
+  delete mcr;
+}
+
+/// revalidates asynchronously the cached stat information of a file
+static void metaCacheRevalidate(const CephFile &file, unsigned long long size, time_t mtime) {
+  std::string key = fileCacheKey(file);
+  // avoid concurrent revalidations of the same entry
+  g_metaCache->setValidated(key, time(NULL));
+  libradosstriper::RadosStriper *striper = getRadosStriper(file);
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  if (0 == striper || 0 == cluster) {
+    g_metaCache->setValidated(key, 0);
+    return;
+  }
+  __sync_fetch_and_add(&g_metaCacheNbRevalidations, 1);
+  MetaCacheRevalidation *mcr = new MetaCacheRevalidation(key, size, mtime);
+  librados::AioCompletion *completion =
+    cluster->aio_create_completion(mcr, metaCacheRevalidateComplete, NULL);
+  int rc = striper->aio_stat(file.name, completion, &mcr->size, &mcr->mtime);
+  completion->release();
+  if (rc) {
+    g_metaCache->setValidated(key, 0);
+    delete mcr;
+  }
+}
+
+/// answers a stat from the metadata cache, if possible
+/// entries reloaded from disk are used immediately and revalidated in the background
+/// returns true if buf could be filled
+static bool metaCacheStat(const CephFile &file, struct stat *buf) {
+  unsigned long long size;
+  time_t mtime, validated;
+  if (!g_metaCache->getStat(fileCacheKey(file), size, mtime, validated) ||
+      (validated > 0 && difftime(time(NULL), validated) >= g_metaCacheTtl)) {
+    __sync_fetch_and_add(&g_metaCacheNbMisses, 1);
+    return false;
+  }
+  __sync_fetch_and_add(&g_metaCacheNbHits, 1);
+  if (0 == validated) metaCacheRevalidate(file, size, mtime);
+  buf->st_size = size;
+  buf->st_atime = mtime;
+  buf->st_mtime = mtime;
+  buf->st_ctime = mtime;
+  buf->st_mode = 0666 | S_IFREG;
+  return true;
+}
+
+/// enables the persistent metadata cache
+/// path is the local file where metadata are persisted, maxEntries the maximum
+/// number of files cached and ttl the time during which cached metadata are
+/// trusted without revalidation, in seconds
+/// returns 0 or -errno
+int ceph_posix_set_metacache(const char *path, unsigned long long maxEntries,
+                             unsigned int ttl) {
+  if (0 == maxEntries) return -EINVAL;
+  XrdCephMetaCache *cache = new XrdCephMetaCache(maxEntries);
+  long long rc = cache->load(path);
+  if (rc < 0) {
+    logwrapper((char*)"ceph_posix_set_metacache : unable to load %s, rc = %lld", path, rc);
+    delete cache;
+    return rc;
+  }
+  logwrapper((char*)"ceph_posix_set_metacache : %lld entries loaded from %s", rc, path);
+  delete g_metaCache;
+  g_metaCache = cache;
+  g_metaCacheTtl = ttl;
+  return 0;
+}
+
+/// appends the statistics of the metadata cache to a stream
+static void metaCacheStats(std::ostringstream &ss) {
+  if (0 == g_metaCache) return;
+  ss << "<metacache>"
+     << "<entries>" << g_metaCache->nbEntries() << "</entries>"
+     << "<logsize>" << g_metaCache->logSize() << "</logsize>"
+     << "<hits>" << g_metaCacheNbHits << "</hits>"
+     << "<misses>" << g_metaCacheNbMisses << "</misses>"
+     << "<revalidations>" << g_metaCacheNbRevalidations << "</revalidations>"
+     << "<stale>" << g_metaCacheNbStale << "</stale>"
+     << "</metacache>";
+}
+
+/// sets the deadline of a class of operations
+/// opClass is one of open, stat, read, write and list, and deadlineMs the
+/// deadline in milliseconds, 0 meaning no deadline
+/// returns 0 or -EINVAL in case of invalid arguments
+int ceph_posix_set_deadline(const char *opClass, unsigned int deadlineMs) {
+  for (unsigned int i = 0; i < DL_NBCLASSES; i++) {
+    if (!strcmp(opClass, g_deadlineClassNames[i])) {
+      g_deadlineMs[i] = deadlineMs;
+      return 0;
+    }
+  }
+  return -EINVAL;
+}
+
+/// absolute deadline of an operation of the given class starting now,
+/// on the clock of XrdCephTimer, 0 if there is no deadline
+static unsigned long long getDeadline(DeadlineClass dc) {
+  return g_deadlineMs[dc] ? XrdCephTimer::nowMs() + g_deadlineMs[dc] : 0;
+}
+
+/// records that an operation missed its deadline
+static void deadlineExpired(DeadlineClass dc) {
+  __sync_fetch_and_add(&g_deadlineNbExpired[dc], 1);
+}
+
+/// waits on a condition variable, at most until the given deadline (0 for none)
+/// returns false if the deadline is over
+static bool waitUntil(XrdSysCondVar &cond, unsigned long long deadline) {
+  if (0 == deadline) {
+    cond.Wait();
+    return true;
+  }
+  unsigned long long now = XrdCephTimer::nowMs();
+  if (now >= deadline) return false;
+  cond.WaitMS(deadline - now);
+  return true;
+}
+
+/// small struct allowing to wait for an asynchronous operation until a deadline
+/// it is deleted by the last of the waiter and the completion, so that an
+/// abandoned operation can still complete safely
+struct DeadlineOp {
+  DeadlineOp() : rc(0), done(false), nbRefs(2), size(0), mtime(0) {}
+  int rc;
+  bool done;
+  unsigned int nbRefs;
+  uint64_t size;
+  time_t mtime;
+  /// data of reads, kept until the completion even if the read is abandoned
+  ceph::bufferlist bl;
+  std::map<std::string, ceph::bufferlist> attrs;
+  XrdSysCondVar cond;
+};
+
+static void releaseDeadlineOp(DeadlineOp *op) {
+  bool last;
+  {
+    XrdSysCondVarHelper lock(op->cond);
+    last = (0 == --op->nbRefs);
+  }
+  if (last) delete op;
+}
+
+static void deadlineOpComplete(rados_completion_t c, void *arg) {
+  DeadlineOp *op = reinterpret_cast<DeadlineOp*>(arg);
+  {
+    XrdSysCondVarHelper lock(op->cond);
+    op->rc = rados_aio_get_return_value(c);
+    op->done = true;
+    op->cond.Signal();
+  }
+  releaseDeadlineOp(op);
+}
+
+/// waits for an operation at most until the given deadline (0 for none)
+/// returns whether the operation completed
+static bool waitOpUntil(DeadlineOp *op, unsigned long long deadline) {
+  XrdSysCondVarHelper lock(op->cond);
+  while (!op->done && waitUntil(op->cond, deadline)) {}
+  return op->done;
+}
+
+/// waits for an operation until the deadline of its class
+/// returns its return code or -ETIMEDOUT, in which case the operation is abandoned
+static int waitDeadlineOp(DeadlineOp *op, DeadlineClass dc) {
+  if (waitOpUntil(op, getDeadline(dc))) return op->rc;
+  deadlineExpired(dc);
+  return -ETIMEDOUT;
+}
+
+/// stats a file, giving up after the deadline of the given class
+static int statWithDeadline(const CephFile &file, libradosstriper::RadosStriper *striper,
+                            uint64_t *size, time_t *mtime, DeadlineClass dc) {
+  if (0 == g_deadlineMs[dc]) return striper->stat(file.name, size, mtime);
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  if (0 == cluster) {
+    return -EINVAL;
+  }
+  DeadlineOp *op = new DeadlineOp();
+  librados::AioCompletion *completion =
+    cluster->aio_create_completion(op, deadlineOpComplete, NULL);
+  int rc = striper->aio_stat(file.name, completion, &op->size, &op->mtime);
+  completion->release();
+  if (rc) {
+    delete op;
+    return rc;
+  }
+  rc = waitDeadlineOp(op, dc);
+  if (0 == rc) {
+    *size = op->size;
+    *mtime = op->mtime;
+  }
+  releaseDeadlineOp(op);
+  return rc;
+}
+
+/// reads the xattrs of the first object of a file, giving up after the deadline
+/// of the given class. Like a stat, this tells whether the file exists, and
+/// also gives what is stored in xattrs, e.g. whether the file is compressed
+static int xattrsWithDeadline(const CephFile &file, std::map<std::string, ceph::bufferlist> &attrs,
+                              DeadlineClass dc) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  int rc;
+  if (0 == g_deadlineMs[dc]) {
+    rc = ioctx->getxattrs(getObjectName(file.name, 0), attrs);
+  } else {
+    librados::Rados* cluster = getClusterRados(file, homeCluster(file));
+    if (0 == cluster) {
+      return -EINVAL;
+    }
+    DeadlineOp *op = new DeadlineOp();
+    librados::ObjectReadOperation readOp;
+    readOp.getxattrs(&op->attrs, 0);
+    librados::AioCompletion *completion =
+      cluster->aio_create_completion(op, deadlineOpComplete, NULL);
+    rc = ioctx->aio_operate(getObjectName(file.name, 0), completion, &readOp, 0, NULL);
+    completion->release();
+    if (rc) {
+      delete op;
+      return rc;
+    }
+    rc = waitDeadlineOp(op, dc);
+    if (0 == rc) attrs.swap(op->attrs);
+    releaseDeadlineOp(op);
+  }
+  if (rc < 0) return rc;
+  // the first object of a striped file always has its size
+  if (0 == attrs.count("striper.size")) return -EINVAL;
+  return 0;
+}
+
+/// writes to a file, giving up after the write deadline
+/// the data are held by bl, which librados keeps referenced if the write is abandoned
+static int writeWithDeadline(const CephFile &file, libradosstriper::RadosStriper *striper,
+                             ceph::bufferlist &bl, size_t count, unsigned long long offset) {
+  if (0 == g_deadlineMs[DL_WRITE]) return striper->write(file.name, bl, count, offset);
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  if (0 == cluster) {
+    return -EINVAL;
+  }
+  DeadlineOp *op = new DeadlineOp();
+  librados::AioCompletion *completion =
+    cluster->aio_create_completion(op, deadlineOpComplete, NULL);
+  int rc = striper->aio_write(file.name, completion, bl, count, offset);
+  completion->release();
+  if (rc) {
+    delete op;
+    return rc;
+  }
+  rc = waitDeadlineOp(op, DL_WRITE);
+  releaseDeadlineOp(op);
+  return rc;
+}
+
+/// admission control of the reads and writes sent to ceph, if configured
+/// (See XrdCephOss::configure)
+XrdCephAdmission *g_admission = 0;
+
+/// small struct remembering the admission of an aio, keyed by its XrdSfsAio
+struct AdmittedAio {
+  AioCB *callback;
+  int fd;
+  size_t nbBytes;
+  unsigned long long startMs;
+};
+std::map<XrdSfsAio*, AdmittedAio> g_admittedAios;
+XrdSysMutex g_admittedAiosMutex;
+
+/// takes over the admission of an aio, if any, so that it can be released
+/// independently of the callback of the aio
+/// returns whether the aio was admitted
+static bool takeAdmittedAio(XrdSfsAio *aiop, AdmittedAio &aa) {
+  XrdSysMutexHelper lock(g_admittedAiosMutex);
+  std::map<XrdSfsAio*, AdmittedAio>::iterator it = g_admittedAios.find(aiop);
+  if (it == g_admittedAios.end()) return false;
+  aa = it->second;
+  g_admittedAios.erase(it);
+  return true;
+}
+
+/// small struct for asynchronous writes with a deadline
+/// whichever of the completion and the timer comes first calls the callback
+/// the admission of the write, if any, is only released by the completion, as
+/// an abandoned write still loads ceph until then
+struct DeadlineAioArgs {
+  DeadlineAioArgs(XrdSfsAio* a, AioCB *b, size_t n) :
+    aiop(a), callback(b), nbBytes(n), admitted(false), done(false), nbRefs(2), timerId(0) {}
+  XrdSfsAio* aiop;
+  AioCB *callback;
+  size_t nbBytes;
+  bool admitted;
+  AdmittedAio admission;
+  bool done;
+  unsigned int nbRefs;
+  unsigned long long timerId;
+  XrdSysMutex mutex;
+};
+
+static void releaseDeadlineAio(DeadlineAioArgs *daa) {
+  bool last;
+  {
+    XrdSysMutexHelper lock(daa->mutex);
+    last = (0 == --daa->nbRefs);
+  }
+  if (last) delete daa;
+}
+
+static void deadlineAioWriteComplete(rados_completion_t c, void *arg) {
+  DeadlineAioArgs *daa = reinterpret_cast<DeadlineAioArgs*>(arg);
+  int rc = rados_aio_get_return_value(c);
+  bool first = false;
+  {
+    XrdSysMutexHelper lock(daa->mutex);
+    if (!daa->done) {
+      first = true;
+      daa->done = true;
+      XrdCephTimer *timer = getTimer();
+      if (daa->timerId && timer && timer->cancel(daa->timerId)) daa->nbRefs--;
+    }
+  }
+  if (daa->admitted) {
+    g_admission->release(daa->admission.fd, daa->admission.nbBytes,
+                         XrdCephTimer::nowMs() - daa->admission.startMs);
+  }
+  if (first) daa->callback(daa->aiop, rc == 0 ? daa->nbBytes : rc);
+  releaseDeadlineAio(daa);
+}
+
+static void deadlineAioExpired(void *arg) {
+  DeadlineAioArgs *daa = reinterpret_cast<DeadlineAioArgs*>(arg);
+  bool first = false;
+  {
+    XrdSysMutexHelper lock(daa->mutex);
+    daa->timerId = 0;
+    if (!daa->done) {
+      first = true;
+      daa->done = true;
+    }
+  }
+  if (first) {
+    deadlineExpired(DL_WRITE);
+    daa->callback(daa->aiop, -ETIMEDOUT);
+  }
+  releaseDeadlineAio(daa);
+}
+
+/// asynchronous write with a deadline. The data are copied, so that the
+/// XrdSfsAio object can be released as soon as the deadline is over
+static ssize_t deadlineAioWrite(const CephFile &file, libradosstriper::RadosStriper *striper,
+                                XrdSfsAio *aiop, AioCB *cb) {
+  size_t count = aiop->sfsAio.aio_nbytes;
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  XrdCephTimer *timer = getTimer();
+  if (0 == cluster || 0 == timer) {
+    return -EINVAL;
+  }
+  ceph::bufferlist bl;
+  bl.append((const char*)aiop->sfsAio.aio_buf, count);
+  DeadlineAioArgs *args = new DeadlineAioArgs(aiop, cb, count);
+  // the admission is released at completion, so the original callback is called directly
+  args->admitted = takeAdmittedAio(aiop, args->admission);
+  if (args->admitted) args->callback = args->admission.callback;
+  librados::AioCompletion *completion =
+    cluster->aio_create_completion(args, deadlineAioWriteComplete, NULL);
+  int rc = striper->aio_write(file.name, completion, bl, count, aiop->sfsAio.aio_offset);
+  completion->release();
+  if (rc) {
+    delete args;
+    return rc;
+  }
+  XrdSysMutexHelper lock(args->mutex);
+  if (!args->done) args->timerId = timer->schedule(g_deadlineMs[DL_WRITE], deadlineAioExpired, args);
+  if (0 == args->timerId) {
+    // no timer, drop its reference. The completion one is still there if not done
+    if (0 == --args->nbRefs) {
+      lock.UnLock();
+      delete args;
+    }
+  }
+  return 0;
+}
+
+/// appends the statistics of deadlines to a stream
+static void deadlineStats(std::ostringstream &ss) {
+  ss << "<deadlines>";
+  for (unsigned int i = 0; i < DL_NBCLASSES; i++) {
+    if (0 == g_deadlineMs[i]) continue;
+    ss << "<" << g_deadlineClassNames[i] << ">"
+       << "<ms>" << g_deadlineMs[i] << "</ms>"
+       << "<expired>" << g_deadlineNbExpired[i] << "</expired>"
+       << "</" << g_deadlineClassNames[i] << ">";
+  }
+  ss << "</deadlines>";
+}
+
+/// replica read policies : reads go to the primary OSD, to any replica,
+/// or to the replica closest to the gateway according to its crush location
+enum ReadPolicy { RP_PRIMARY = 0, RP_BALANCE, RP_LOCALIZE, RP_NBPOLICIES };
+static const char* g_readPolicyNames[RP_NBPOLICIES] = {"primary", "balance", "localize"};
+static const int g_readPolicyFlags[RP_NBPOLICIES] = {librados::OPERATION_NOFLAG,
+                                                     librados::OPERATION_BALANCE_READS,
+                                                     librados::OPERATION_LOCALIZE_READS};
+/// read policy of each pool, "*" giving the one of pools not listed,
+/// which otherwise read from the primary OSDs
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+std::map<std::string, ReadPolicy> g_readPolicies;
+/// number of reads and of bytes read directly from the objects of files, per policy
+unsigned long long g_directNbReads[RP_NBPOLICIES] = {0, 0, 0};
+unsigned long long g_directNbBytes[RP_NBPOLICIES] = {0, 0, 0};
+/// number of direct reads redone with the layout stored with the file, which
+/// differed from the one given by its path
+unsigned long long g_directNbRereads = 0;
+
+/// sets the replica read policy of a pool, or of all pools without their own
+/// policy if pool is "*". policy is one of primary, balance and localize
+/// returns 0 or -EINVAL in case of invalid arguments
+int ceph_posix_set_readpolicy(const char *pool, const char *policy) {
+  for (unsigned int i = 0; i < RP_NBPOLICIES; i++) {
+    if (!strcmp(policy, g_readPolicyNames[i])) {
+      g_readPolicies[pool] = (ReadPolicy)i;
+      return 0;
+    }
+  }
+  return -EINVAL;
+}
+
+/// sets the crush location of the gateway, e.g. "host=gw1 rack=r2", used by
+/// the localize read policy
+/// returns 0 or -EINVAL in case of invalid arguments
+int ceph_posix_set_crushlocation(const char *location) {
+  if (0 == strchr(location, '=')) return -EINVAL;
+  g_crushLocation = location;
+  return 0;
+}
+
+/// replica read policy of a file
+static ReadPolicy readPolicy(const CephFile &file) {
+  std::map<std::string, ReadPolicy>::const_iterator it = g_readPolicies.find(file.pool);
+  if (it == g_readPolicies.end()) it = g_readPolicies.find("*");
+  return it == g_readPolicies.end() ? RP_PRIMARY : it->second;
+}
+
+/// function called when an asynchronous read completes
+typedef void (ReadDoneCB)(void *arg, int rc);
+
+/// small struct for reads going through the striper
+struct PlainReadArgs {
+  PlainReadArgs(ReadDoneCB *b, void *a) : cb(b), arg(a) {}
+  ReadDoneCB *cb;
+  void *arg;
+};
+
+static void plainReadComplete(rados_completion_t c, void *arg) {
+  PlainReadArgs *pra = reinterpret_cast<PlainReadArgs*>(arg);
+  pra->cb(pra->arg, rados_aio_get_return_value(c));
+  delete pra;
+}
+
+/// piece of a direct read, read from one object
+struct ReadExtent {
+  ObjectExtent extent;
+  ceph::bufferlist bl;
+  int rc;
+};
+
+/// small struct describing a read done directly on the objects of a file rather
+/// than through the striper, so that the object reads can be given flags
+/// The pieces are read with the layout last seen for the file while the layout
+/// stored with it is checked, and read again in the rare case it differs
+/// it is deleted once all pieces are over and the callback was called
+struct DirectRead {
+  DirectRead(const CephFile &f, librados::IoCtx *i, librados::Rados *r, ceph::bufferlist *t,
+             size_t c, unsigned long long o, ReadPolicy p, ReadDoneCB *b, void *a) :
+    file(f), ioctx(i), cluster(r), target(t), count(c), offset(o), policy(p), cb(b), arg(a),
+    nbPending(0), reread(false) {
+    for (unsigned int i = 0; i < 4; i++) attrRcs[i] = 0;
+  }
+  /// the file, with the layout its pieces are read with
+  CephFile file;
+  librados::IoCtx *ioctx;
+  librados::Rados *cluster;
+  ceph::bufferlist *target;
+  size_t count;
+  unsigned long long offset;
+  ReadPolicy policy;
+  ReadDoneCB *cb;
+  void *arg;
+  /// pieces of the read, and number of them still pending, including the
+  /// layout check on the first object and the issuer
+  std::vector<ReadExtent> extents;
+  unsigned int nbPending;
+  /// whether the pieces were read again with the layout stored with the file
+  bool reread;
+  /// attributes of the first object used to check the layout and the size of the file
+  ceph::bufferlist attrs[4];
+  int attrRcs[4];
+  XrdSysMutex mutex;
+};
+
+/// layouts of files found to differ from the one given by their path, by pool and
+/// name, so that the next direct reads of these files use them from the start
+/// They are only hints, as the stored layout is checked by every read
+std::map<std::string, CephFile> g_directLayouts;
+XrdSysMutex g_directLayoutsMutex;
+/// number of hints kept, beyond which they are all dropped
+static const size_t g_directLayoutsMax = 10000;
+
+static std::string directLayoutKey(const CephFile &file) {
+  return file.pool + '/' + file.name;
+}
+
+/// the layout last seen for a file, or the one given by its path
+static void lookupDirectLayout(CephFile &file) {
+  XrdSysMutexHelper lock(g_directLayoutsMutex);
+  std::map<std::string, CephFile>::const_iterator it = g_directLayouts.find(directLayoutKey(file));
+  if (it == g_directLayouts.end()) return;
+  file.stripeUnit = it->second.stripeUnit;
+  file.nbStripes = it->second.nbStripes;
+  file.objectSize = it->second.objectSize;
+}
+
+/// records the layout stored with a file, when it differs from the one given by its path
+static void recordDirectLayout(const CephFile &file, const CephFile &stored) {
+  bool same = file.stripeUnit == stored.stripeUnit && file.nbStripes == stored.nbStripes &&
+    file.objectSize == stored.objectSize;
+  XrdSysMutexHelper lock(g_directLayoutsMutex);
+  if (same) {
+    g_directLayouts.erase(directLayoutKey(file));
+    return;
+  }
+  if (g_directLayouts.size() >= g_directLayoutsMax) g_directLayouts.clear();
+  g_directLayouts[directLayoutKey(file)] = stored;
+}
+
+static void directPieceComplete(rados_completion_t c, void *arg);
+
+/// sends the reads of the pieces of a direct read, following the layout of dr->file
+/// extra is the number of references held on top of the pieces
+static void sendDirectPieces(DirectRead *dr, unsigned int extra) {
+  std::vector<ObjectExtent> extents;
+  getObjectExtents(dr->file, dr->offset, dr->count, extents);
+  dr->extents.clear();
+  dr->extents.resize(extents.size());
+  for (size_t i = 0; i < extents.size(); i++) {
+    dr->extents[i].extent = extents[i];
+    dr->extents[i].rc = 0;
+  }
+  dr->nbPending = extents.size() + extra;
+  int flags = g_readPolicyFlags[dr->policy];
+  for (size_t i = 0; i < dr->extents.size(); i++) {
+    ReadExtent &re = dr->extents[i];
+    librados::ObjectReadOperation op;
+    op.read(re.extent.objectOffset, re.extent.length, &re.bl, &re.rc);
+    librados::AioCompletion *completion =
+      dr->cluster->aio_create_completion(dr, directPieceComplete, NULL);
+    if (dr->ioctx->aio_operate(getObjectName(dr->file.name, re.extent.objectNo), completion, &op,
+                               flags, NULL)) {
+      re.rc = -EIO;
+      directPieceComplete(0, dr);
+    }
+    completion->release();
+  }
+}
+
+/// completes a direct read once all its pieces are over
+static void finishDirectRead(DirectRead *dr) {
+  int rc = 0;
+  for (unsigned int i = 0; 0 == rc && i < 4; i++) {
+    if (dr->attrRcs[i] < 0) rc = dr->attrRcs[i];
+  }
+  // check that the pieces were read with the layout of the file
+  unsigned long long values[3] = {0, 0, 0};
+  for (unsigned int i = 0; 0 == rc && i < 3; i++) {
+    std::string value(dr->attrs[i].c_str(), dr->attrs[i].length());
+    values[i] = strtoull(value.c_str(), 0, 10);
+  }
+  CephFile stored = dr->file;
+  stored.stripeUnit = values[0];
+  stored.nbStripes = values[1];
+  stored.objectSize = values[2];
+  if (0 == rc && (0 == stored.stripeUnit || 0 == stored.nbStripes ||
+                  stored.objectSize < stored.stripeUnit)) {
+    rc = -EIO;
+  }
+  if (0 == rc && (stored.stripeUnit != dr->file.stripeUnit ||
+                  stored.nbStripes != dr->file.nbStripes ||
+                  stored.objectSize != dr->file.objectSize)) {
+    if (dr->reread) {
+      rc = -EIO;
+    } else {
+      // the pieces are read again, without blocking, once the layout is known
+      __sync_fetch_and_add(&g_directNbRereads, 1);
+      recordDirectLayout(dr->file, stored);
+      dr->file = stored;
+      dr->reread = true;
+      sendDirectPieces(dr, 1);
+      directPieceComplete(0, dr);
+      return;
+    }
+  }
+  for (std::vector<ReadExtent>::const_iterator it = dr->extents.begin();
+       0 == rc && it != dr->extents.end();
+       it++) {
+    // missing objects are holes of the file
+    if (it->rc < 0 && it->rc != -ENOENT) rc = it->rc;
+  }
+  if (rc < 0) {
+    dr->cb(dr->arg, rc);
+    delete dr;
+    return;
+  }
+  std::string sizeStr(dr->attrs[3].c_str(), dr->attrs[3].length());
+  unsigned long long size = strtoull(sizeStr.c_str(), 0, 10);
+  size_t len = 0;
+  if (size > dr->offset) len = size - dr->offset < dr->count ? size - dr->offset : dr->count;
+  ceph::bufferptr bp(len);
+  memset(bp.c_str(), 0, len);
+  for (std::vector<ReadExtent>::iterator it = dr->extents.begin(); it != dr->extents.end(); it++) {
+    if (it->rc < 0 || it->extent.bufferOffset >= len) continue;
+    size_t n = std::min<size_t>(it->bl.length(), len - it->extent.bufferOffset);
+    it->bl.copy(0, n, bp.c_str() + it->extent.bufferOffset);
+  }
+  dr->target->clear();
+  dr->target->append(bp.c_str(), len);
+  __sync_fetch_and_add(&g_directNbReads[dr->policy], 1);
+  __sync_fetch_and_add(&g_directNbBytes[dr->policy], len);
+  dr->cb(dr->arg, len);
+  delete dr;
+}
+
+static void directPieceComplete(rados_completion_t c, void *arg) {
+  DirectRead *dr = reinterpret_cast<DirectRead*>(arg);
+  bool last;
+  {
+    XrdSysMutexHelper lock(dr->mutex);
+    last = (0 == --dr->nbPending);
+  }
+  if (last) finishDirectRead(dr);
+}
+
+/// starts an asynchronous read of a file into bl, reading its objects directly
+/// from the given cluster, with the flags of the given replica read policy
+/// cb is called exactly once when data are available, unless an error is returned
+static int startDirectRead(const CephFile &file, unsigned int clusterIdx, ceph::bufferlist *bl,
+                           size_t count, unsigned long long offset, ReadPolicy policy,
+                           ReadDoneCB *cb, void *arg) {
+  librados::IoCtx *ioctx = getClusterIoCtx(file, clusterIdx);
+  librados::Rados* cluster = getClusterRados(file, clusterIdx);
+  if (0 == ioctx || 0 == cluster) {
+    return -EINVAL;
+  }
+  DirectRead *dr = new DirectRead(file, ioctx, cluster, bl, count, offset, policy, cb, arg);
+  lookupDirectLayout(dr->file);
+  sendDirectPieces(dr, 2);
+  librados::ObjectReadOperation attrOp;
+  attrOp.getxattr("striper.layout.stripe_unit", &dr->attrs[0], &dr->attrRcs[0]);
+  attrOp.getxattr("striper.layout.stripe_count", &dr->attrs[1], &dr->attrRcs[1]);
+  attrOp.getxattr("striper.layout.object_size", &dr->attrs[2], &dr->attrRcs[2]);
+  attrOp.getxattr("striper.size", &dr->attrs[3], &dr->attrRcs[3]);
+  librados::AioCompletion *completion =
+    cluster->aio_create_completion(dr, directPieceComplete, NULL);
+  if (ioctx->aio_operate(getObjectName(file.name, 0), completion, &attrOp,
+                         g_readPolicyFlags[policy], NULL)) {
+    dr->attrRcs[0] = -EIO;
+    directPieceComplete(0, dr);
+  }
+  completion->release();
+  // drop the reference of the issuer, which kept early completions from finishing the read
+  directPieceComplete(0, dr);
+  return 0;
+}
+
+static void directReadOpDone(void *arg, int rc) {
+  DeadlineOp *op = reinterpret_cast<DeadlineOp*>(arg);
+  {
+    XrdSysCondVarHelper lock(op->cond);
+    op->rc = rc;
+    op->done = true;
+    op->cond.Signal();
+  }
+  releaseDeadlineOp(op);
+}
+
+/// reads a file directly from its objects in the given cluster, giving up after timeoutMs if not 0
+static int directRead(const CephFile &file, unsigned int clusterIdx, ceph::bufferlist *bl,
+                      size_t count, unsigned long long offset, ReadPolicy policy,
+                      unsigned int timeoutMs) {
+  DeadlineOp *op = new DeadlineOp();
+  int rc = startDirectRead(file, clusterIdx, &op->bl, count, offset, policy,
+                           directReadOpDone, op);
+  if (rc) {
+    delete op;
+    return rc;
+  }
+  rc = -ETIMEDOUT;
+  if (waitOpUntil(op, timeoutMs ? XrdCephTimer::nowMs() + timeoutMs : 0)) {
+    rc = op->rc;
+    if (rc >= 0) bl->claim_append(op->bl);
+  }
+  releaseDeadlineOp(op);
+  return rc;
+}
+
+/// appends the statistics of the replica read policies to a stream
+static void readPolicyStats(std::ostringstream &ss) {
+  if (g_readPolicies.empty()) return;
+  ss << "<readpolicy>";
+  for (unsigned int i = RP_BALANCE; i < RP_NBPOLICIES; i++) {
+    ss << "<" << g_readPolicyNames[i] << ">"
+       << "<reads>" << g_directNbReads[i] << "</reads>"
+       << "<bytes>" << g_directNbBytes[i] << "</bytes>"
+       << "</" << g_readPolicyNames[i] << ">";
+  }
+  ss << "<rereads>" << g_directNbRereads << "</rereads>"
+     << "</readpolicy>";
+}
+
+/// time during which a cluster that failed a read is only tried as a last resort, in milliseconds
+static const unsigned int g_clusterPenaltyMs = 30000;
+
+/// declares a cluster that pools can be federated with
+/// confFile is the ceph configuration file describing the cluster
+/// returns 0 or -EINVAL in case of invalid arguments
+int ceph_posix_add_cluster(const char *name, const char *confFile) {
+  if (0 == *name || 0 == *confFile) return -EINVAL;
+  for (std::vector<CephCluster>::const_iterator it = g_cephClusters.begin();
+       it != g_cephClusters.end();
+       it++) {
+    if (it->name == name) return -EINVAL;
+  }
+  g_cephClusters.push_back(CephCluster(name, confFile));
+  return 0;
+}
+
+/// sets the clusters holding a pool, as a comma separated list of names of
+/// declared clusters, "default" being the one of the default ceph configuration
+/// The first cluster gets all writes and metadata operations. Reads go to the
+/// cluster with the lowest latency and fail over to the others on error or,
+/// if failoverMs is not 0, when they take longer than failoverMs milliseconds
+/// returns 0 or -EINVAL in case of invalid arguments
+int ceph_posix_set_federation(const char *pool, const char *clusters, unsigned int failoverMs) {
+  FederatedPool fp;
+  fp.failoverMs = failoverMs;
+  std::istringstream ss(clusters);
+  std::string name;
+  while (std::getline(ss, name, ',')) {
+    unsigned int idx = 0;
+    while (idx < g_cephClusters.size() && g_cephClusters[idx].name != name) idx++;
+    if (idx == g_cephClusters.size() ||
+        std::find(fp.clusters.begin(), fp.clusters.end(), idx) != fp.clusters.end()) {
+      return -EINVAL;
+    }
+    fp.clusters.push_back(idx);
+  }
+  if (fp.clusters.empty()) return -EINVAL;
+  g_federatedPools[pool] = fp;
+  return 0;
+}
+
+/// whether reads of a file may be served by several clusters
+static bool isFederated(const CephFile &file) {
+  std::map<std::string, FederatedPool>::const_iterator it = g_federatedPools.find(file.pool);
+  return it != g_federatedPools.end() && it->second.clusters.size() > 1;
+}
+
+/// orders the clusters of a federated pool for a read : clusters by increasing
+/// latency, the ones that failed recently coming last
+static std::vector<unsigned int> readClusters(const FederatedPool &fp) {
+  std::vector<std::pair<double, unsigned int> > costs;
+  unsigned long long now = XrdCephTimer::nowMs();
+  {
+    XrdSysMutexHelper lock(g_cephClustersMutex);
+    for (std::vector<unsigned int>::const_iterator it = fp.clusters.begin();
+         it != fp.clusters.end();
+         it++) {
+      const CephCluster &cluster = g_cephClusters[*it];
+      double cost = cluster.latencyMs;
+      if (cluster.lastErrorMs && now < cluster.lastErrorMs + g_clusterPenaltyMs) {
+        cost += g_clusterPenaltyMs;
+      }
+      costs.push_back(std::make_pair(cost, *it));
+    }
+  }
+  std::stable_sort(costs.begin(), costs.end());
+  std::vector<unsigned int> order;
+  for (unsigned int i = 0; i < costs.size(); i++) order.push_back(costs[i].second);
+  return order;
+}
+
+/// reads a file from a given cluster, giving up after timeoutMs if not 0
+static int clusterRead(const CephFile &file, unsigned int clusterIdx, ceph::bufferlist *bl,
+                       size_t count, unsigned long long offset, unsigned int timeoutMs) {
+  libradosstriper::RadosStriper *striper = getClusterStriper(file, clusterIdx);
+  if (0 == striper) {
+    return -EINVAL;
+  }
+  ReadPolicy policy = readPolicy(file);
+  if (RP_PRIMARY != policy) {
+    return directRead(file, clusterIdx, bl, count, offset, policy, timeoutMs);
+  }
+  if (0 == timeoutMs) return striper->read(file.name, bl, count, offset);
+  librados::Rados* cluster = getClusterRados(file, clusterIdx);
+  if (0 == cluster) {
+    return -EINVAL;
+  }
+  DeadlineOp *op = new DeadlineOp();
+  librados::AioCompletion *completion =
+    cluster->aio_create_completion(op, deadlineOpComplete, NULL);
+  int rc = striper->aio_read(file.name, completion, &op->bl, count, offset);
+  completion->release();
+  if (rc) {
+    delete op;
+    return rc;
+  }
+  rc = -ETIMEDOUT;
+  if (waitOpUntil(op, XrdCephTimer::nowMs() + timeoutMs)) {
+    rc = op->rc;
+    if (rc >= 0) bl->claim_append(op->bl);
+  }
+  releaseDeadlineOp(op);
+  return rc;
+}
+
+/// time given to the home cluster to tell the size of a file read short from a
+/// mirror, for pools without failover time, in milliseconds
+static const unsigned int g_mirrorCheckMs = 5000;
+
+/// checks a short read from a mirror against the size of the file in the home
+/// cluster, as a mirror lagging behind would silently return truncated data
+/// The home cluster is given the failover time of the pool to answer, and is
+/// not asked when it failed recently, so that it cannot hold reads served by mirrors
+/// returns 0 when the read is complete, -EIO when it is short
+static int checkMirrorRead(const CephFile &file, const FederatedPool &fp, size_t count,
+                           unsigned long long offset, int rc, long long &homeSize) {
+  if (homeSize < 0) {
+    unsigned int home = homeCluster(file);
+    unsigned long long now = XrdCephTimer::nowMs();
+    {
+      XrdSysMutexHelper lock(g_cephClustersMutex);
+      const CephCluster &cluster = g_cephClusters[home];
+      if (cluster.lastErrorMs && now < cluster.lastErrorMs + g_clusterPenaltyMs) {
+        return -ETIMEDOUT;
+      }
+    }
+    libradosstriper::RadosStriper *striper = getClusterStriper(file, home);
+    librados::Rados* cluster = getClusterRados(file, home);
+    if (0 == striper || 0 == cluster) {
+      return -EINVAL;
+    }
+    DeadlineOp *op = new DeadlineOp();
+    librados::AioCompletion *completion =
+      cluster->aio_create_completion(op, deadlineOpComplete, NULL);
+    int statRc = striper->aio_stat(file.name, completion, &op->size, &op->mtime);
+    completion->release();
+    if (statRc) {
+      delete op;
+      return statRc;
+    }
+    statRc = -ETIMEDOUT;
+    uint64_t size = 0;
+    if (waitOpUntil(op, now + (fp.failoverMs ? fp.failoverMs : g_mirrorCheckMs))) {
+      statRc = op->rc;
+      size = op->size;
+    }
+    releaseDeadlineOp(op);
+    if (-ETIMEDOUT == statRc) {
+      XrdSysMutexHelper lock(g_cephClustersMutex);
+      g_cephClusters[home].nbTimeouts++;
+      g_cephClusters[home].lastErrorMs = XrdCephTimer::nowMs();
+      return statRc;
+    }
+    if (-ENOENT == statRc) size = 0;
+    else if (statRc) return statRc;
+    homeSize = size;
+  }
+  unsigned long long expected = 0;
+  if (offset < (unsigned long long)homeSize) {
+    expected = std::min((unsigned long long)count, homeSize - offset);
+  }
+  return (unsigned long long)rc == expected ? 0 : -EIO;
+}
+
+/// reads a file of a federated pool from the nearest cluster, failing over to
+/// the other ones on error, timeout or short read. The last cluster tried is
+/// given no timeout
+/// returns the number of bytes read, or the error of the first cluster tried
+static int federatedRead(const CephFile &file, ceph::bufferlist *bl, size_t count,
+                         unsigned long long offset) {
+  const FederatedPool &fp = g_federatedPools.find(file.pool)->second;
+  std::vector<unsigned int> order = readClusters(fp);
+  int firstRc = 0;
+  // size of the file in the home cluster, only read on short reads of mirrors
+  long long homeSize = -1;
+  for (unsigned int i = 0; i < order.size(); i++) {
+    unsigned long long start = XrdCephTimer::nowMs();
+    bl->clear();
+    int rc = clusterRead(file, order[i], bl, count, offset,
+                         i + 1 < order.size() ? fp.failoverMs : 0);
+    bool stale = false;
+    if (rc >= 0 && (size_t)rc < count && order[i] != homeCluster(file)) {
+      int checkRc = checkMirrorRead(file, fp, count, offset, rc, homeSize);
+      // when the home cluster cannot tell, the mirror is the best answer left
+      if (-EIO == checkRc) {
+        rc = checkRc;
+        stale = true;
+      }
+    }
+    unsigned long long now = XrdCephTimer::nowMs();
+    XrdSysMutexHelper lock(g_cephClustersMutex);
+    CephCluster &cluster = g_cephClusters[order[i]];
+    if (rc >= 0) {
+      double latencyMs = now - start;
+      cluster.latencyMs = cluster.nbReads ? 0.9 * cluster.latencyMs + 0.1 * latencyMs : latencyMs;
+      cluster.nbReads++;
+      cluster.nbBytes += rc;
+      if (i > 0) cluster.nbFailovers++;
+      return rc;
+    }
+    if (-ETIMEDOUT == rc) {
+      cluster.nbTimeouts++;
+    } else {
+      cluster.nbErrors++;
+    }
+    // a missing or stale file may not be mirrored yet, which says nothing of the cluster
+    if (-ENOENT != rc && !stale) cluster.lastErrorMs = now;
+    if (0 == i) firstRc = rc;
+  }
+  return firstRc;
+}
+
+/// reads a file synchronously, following the replica read policy of its pool
+/// and failing over between clusters for federated pools
+static int readWithPolicy(const CephFile &file, libradosstriper::RadosStriper *striper,
+                          ceph::bufferlist *bl, size_t count, unsigned long long offset) {
+  if (isFederated(file)) return federatedRead(file, bl, count, offset);
+  ReadPolicy policy = readPolicy(file);
+  if (RP_PRIMARY == policy) return striper->read(file.name, bl, count, offset);
+  return directRead(file, homeCluster(file), bl, count, offset, policy, 0);
+}
+
+/// appends the statistics of the clusters to a stream
+static void clusterStats(std::ostringstream &ss) {
+  if (g_federatedPools.empty()) return;
+  XrdSysMutexHelper lock(g_cephClustersMutex);
+  ss << "<clusters>";
+  for (std::vector<CephCluster>::const_iterator it = g_cephClusters.begin();
+       it != g_cephClusters.end();
+       it++) {
+    ss << "<cluster name=\"" << it->name << "\">"
+       << "<latencyms>" << it->latencyMs << "</latencyms>"
+       << "<reads>" << it->nbReads << "</reads>"
+       << "<bytes>" << it->nbBytes << "</bytes>"
+       << "<errors>" << it->nbErrors << "</errors>"
+       << "<timeouts>" << it->nbTimeouts << "</timeouts>"
+       << "<failovers>" << it->nbFailovers << "</failovers>"
+       << "</cluster>";
+  }
+  ss << "</clusters>";
+}
+
+/// percentile of the read latency after which reads are hedged, 0 to disable hedging
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+unsigned int g_hedgePercentile = 0;
+/// maximum fraction of reads that may be hedged
+double g_hedgeBudget = 0.05;
+/// bounds of the delay after which reads are hedged, in milliseconds
+unsigned int g_hedgeMinDelayMs = 10;
+static const unsigned int g_hedgeMaxDelayMs = 10000;
+/// number of recent read latencies the hedging delay is computed from
+static const unsigned int g_hedgeNbSamples = 1024;
+/// recent read latencies, in milliseconds, as a circular buffer
+std::vector<unsigned int> g_hedgeSamples;
+unsigned long long g_hedgeNbSamplesSeen = 0;
+/// current delay after which reads are hedged, in milliseconds
+unsigned int g_hedgeDelayMs = 0;
+/// number of hedges that may still be issued. Grows by g_hedgeBudget per read
+double g_hedgeTokens = 0;
+/// statistics of hedging
+unsigned long long g_hedgeNbReads = 0;
+unsigned long long g_hedgeNbHedges = 0;
+unsigned long long g_hedgeNbWins = 0;
+unsigned long long g_hedgeNbDenied = 0;
+unsigned long long g_hedgeNbFailed = 0;
+/// protects all hedging variables above
+XrdSysMutex g_hedgeMutex;
+
+/// enables hedged reads
+/// percentile is the percentile of the recent read latencies after which a read
+/// is hedged, budget the maximum fraction of reads hedged and minDelayMs the
+/// minimum delay before hedging a read
+/// returns 0 or -EINVAL in case of invalid arguments
+int ceph_posix_set_hedging(unsigned int percentile, double budget, unsigned int minDelayMs) {
+  if (percentile >= 100 || budget <= 0 || budget > 1) return -EINVAL;
+  XrdSysMutexHelper lock(g_hedgeMutex);
+  g_hedgePercentile = percentile;
+  g_hedgeBudget = budget;
+  g_hedgeMinDelayMs = minDelayMs;
+  g_hedgeDelayMs = minDelayMs > g_hedgeMaxDelayMs / 10 ? minDelayMs : g_hedgeMaxDelayMs / 10;
+  g_hedgeSamples.assign(g_hedgeNbSamples, 0);
+  return 0;
+}
+
+/// records the latency of a read and updates the hedging delay regularly
+static void recordReadLatency(unsigned long long latencyMs) {
+  XrdSysMutexHelper lock(g_hedgeMutex);
+  g_hedgeSamples[g_hedgeNbSamplesSeen % g_hedgeNbSamples] = latencyMs;
+  g_hedgeNbSamplesSeen++;
+  if (g_hedgeNbSamplesSeen % 64 != 0) return;
+  std::vector<unsigned int> samples(g_hedgeSamples.begin(),
+                                    g_hedgeSamples.begin() +
+                                    std::min<unsigned long long>(g_hedgeNbSamplesSeen, g_hedgeNbSamples));
+  std::vector<unsigned int>::iterator nth = samples.begin() + samples.size() * g_hedgePercentile / 100;
+  std::nth_element(samples.begin(), nth, samples.end());
+  g_hedgeDelayMs = std::max(g_hedgeMinDelayMs, std::min(*nth, g_hedgeMaxDelayMs));
+}
+
+/// small struct describing a read that may be hedged
+/// it is only deleted when the primary read, the timer and the hedge are all over,
+/// so that late completions always find valid buffers
+struct HedgedRead {
+  HedgedRead(const CephFile &f, size_t c, unsigned long long o, ceph::bufferlist *t,
+             ReadDoneCB *b, void *a) :
+    file(f), count(c), offset(o), target(t), cb(b), arg(a),
+    startMs(XrdCephTimer::nowMs()), done(false), nbRefs(2), timerId(0) {}
+  CephFile file;
+  size_t count;
+  unsigned long long offset;
+  /// where the data of the winning read go
+  ceph::bufferlist *target;
+  ReadDoneCB *cb;
+  void *arg;
+  unsigned long long startMs;
+  ceph::bufferlist primaryBl;
+  ceph::bufferlist hedgeBl;
+  bool done;
+  unsigned int nbRefs;
+  unsigned long long timerId;
+  XrdSysMutex mutex;
+};
+
+/// drops a reference to a hedged read, deleting it when unused
+static void releaseHedgedRead(HedgedRead *hr) {
+  bool last;
+  {
+    XrdSysMutexHelper lock(hr->mutex);
+    last = (0 == --hr->nbRefs);
+  }
+  if (last) delete hr;
+}
+
+static void hedgePrimaryDone(void *arg, int rc) {
+  HedgedRead *hr = reinterpret_cast<HedgedRead*>(arg);
+  if (rc >= 0) recordReadLatency(XrdCephTimer::nowMs() - hr->startMs);
+  bool won = false;
+  {
+    XrdSysMutexHelper lock(hr->mutex);
+    if (!hr->done) {
+      won = true;
+      hr->done = true;
+      hr->target->swap(hr->primaryBl);
+      // the timer keeps a reference until it is cancelled or called
+      XrdCephTimer *timer = getTimer();
+      if (hr->timerId && timer && timer->cancel(hr->timerId)) hr->nbRefs--;
+    }
+  }
+  if (won) hr->cb(hr->arg, rc);
+  releaseHedgedRead(hr);
+}
+
+static void hedgePrimaryComplete(rados_completion_t c, void *arg) {
+  hedgePrimaryDone(arg, rados_aio_get_return_value(c));
+}
+
+/// gives back the token of a hedge that could not help the read
+static void refundHedge() {
+  XrdSysMutexHelper lock(g_hedgeMutex);
+  g_hedgeTokens = std::min(g_hedgeTokens + 1, 100.0);
+  g_hedgeNbFailed++;
+}
+
+/// called when a hedge is over. Failed hedges are dropped, leaving the read
+/// to the primary one, and do not count against the budget
+static void hedgeDone(void *arg, int rc) {
+  HedgedRead *hr = reinterpret_cast<HedgedRead*>(arg);
+  bool won = false;
+  if (rc < 0) {
+    refundHedge();
+  } else {
+    XrdSysMutexHelper lock(hr->mutex);
+    if (!hr->done) {
+      won = true;
+      hr->done = true;
+      hr->target->swap(hr->hedgeBl);
+    }
+  }
+  if (won) {
+    {
+      XrdSysMutexHelper lock(g_hedgeMutex);
+      g_hedgeNbWins++;
+    }
+    hr->cb(hr->arg, rc);
+  }
+  releaseHedgedRead(hr);
+}
+
+/// issues the hedge of a read that did not complete in time
+/// the hedge reads the objects of the file directly, letting ceph balance
+/// the reads over all replicas, so that a slow primary OSD is avoided. Like all
+/// direct reads, it follows the layout stored with the file
+static void hedgeTimerExpired(void *arg) {
+  HedgedRead *hr = reinterpret_cast<HedgedRead*>(arg);
+  bool hedge;
+  {
+    XrdSysMutexHelper lock(hr->mutex);
+    hr->timerId = 0;
+    hedge = !hr->done;
+  }
+  if (hedge) {
+    XrdSysMutexHelper lock(g_hedgeMutex);
+    if (g_hedgeTokens >= 1) {
+      g_hedgeTokens -= 1;
+      g_hedgeNbHedges++;
+    } else {
+      g_hedgeNbDenied++;
+      hedge = false;
+    }
+  }
+  // the timer reference is transferred to the hedge
+  if (hedge && startDirectRead(hr->file, homeCluster(hr->file), &hr->hedgeBl, hr->count,
+                               hr->offset, RP_BALANCE, hedgeDone, hr)) {
+    refundHedge();
+    hedge = false;
+  }
+  if (!hedge) releaseHedgedRead(hr);
+}
+
+/// starts an asynchronous read of a file into bl, hedged if enabled and
+/// following the replica read policy of its pool
+/// cb is called exactly once when data are available, unless an error is returned
+static int startRead(const CephFile &file, libradosstriper::RadosStriper *striper,
+                     ceph::bufferlist *bl, size_t count, unsigned long long offset,
+                     ReadDoneCB *cb, void *arg) {
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  if (0 == cluster) {
+    return -EINVAL;
+  }
+  ReadPolicy policy = readPolicy(file);
+  if (0 == g_hedgePercentile) {
+    if (RP_PRIMARY != policy) {
+      return startDirectRead(file, homeCluster(file), bl, count, offset, policy, cb, arg);
+    }
+    PlainReadArgs *args = new PlainReadArgs(cb, arg);
+    librados::AioCompletion *completion =
+      cluster->aio_create_completion(args, plainReadComplete, NULL);
+    int rc = striper->aio_read(file.name, completion, bl, count, offset);
+    completion->release();
+    if (rc) delete args;
+    return rc;
+  }
+  unsigned int delayMs;
+  {
+    XrdSysMutexHelper lock(g_hedgeMutex);
+    g_hedgeNbReads++;
+    g_hedgeTokens = std::min(g_hedgeTokens + g_hedgeBudget, 100.0);
+    delayMs = g_hedgeDelayMs;
+  }
+  HedgedRead *hr = new HedgedRead(file, count, offset, bl, cb, arg);
+  int rc;
+  if (RP_PRIMARY != policy) {
+    rc = startDirectRead(file, homeCluster(file), &hr->primaryBl, count, offset,
+                         policy, hedgePrimaryDone, hr);
+  } else {
+    librados::AioCompletion *completion =
+      cluster->aio_create_completion(hr, hedgePrimaryComplete, NULL);
+    rc = striper->aio_read(file.name, completion, &hr->primaryBl, count, offset);
+    completion->release();
+  }
+  if (rc) {
+    delete hr;
+    return rc;
+  }
+  XrdCephTimer *timer = getTimer();
+  XrdSysMutexHelper lock(hr->mutex);
+  if (!hr->done && timer) hr->timerId = timer->schedule(delayMs, hedgeTimerExpired, hr);
+  if (0 == hr->timerId) {
+    // no hedge will be issued. Drop the timer reference, knowing that the
+    // primary one is still there if the read is not over
+    if (hr->done) {
+      if (0 == --hr->nbRefs) {
+        lock.UnLock();
+        delete hr;
+      }
+    } else {
+      hr->nbRefs--;
+    }
+  }
+  return 0;
+}
+
+/// appends the statistics of hedging to a stream
+static void hedgingStats(std::ostringstream &ss) {
+  if (0 == g_hedgePercentile) return;
+  XrdSysMutexHelper lock(g_hedgeMutex);
+  ss << "<hedging>"
+     << "<reads>" << g_hedgeNbReads << "</reads>"
+     << "<hedges>" << g_hedgeNbHedges << "</hedges>"
+     << "<wins>" << g_hedgeNbWins << "</wins>"
+     << "<denied>" << g_hedgeNbDenied << "</denied>"
+     << "<failed>" << g_hedgeNbFailed << "</failed>"
+     << "<delayms>" << g_hedgeDelayMs << "</delayms>"
+     << "</hedging>";
+}
+
+/// whether concurrent identical reads and stats are coalesced
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+bool g_cephCoalesceReads = true;
+
+struct InflightRead;
+
+/// small struct for the deadline of an asynchronous read
+struct AioReadDeadline {
+  AioReadDeadline(InflightRead *r, XrdSfsAio *a) : ir(r), aiop(a) {}
+  InflightRead *ir;
+  XrdSfsAio *aiop;
+};
+
+/// an asynchronous reader waiting for a read in flight
+struct AioWaiter {
+  AioWaiter(XrdSfsAio *a, AioCB *b) : aiop(a), cb(b), timerId(0), deadline(0) {}
+  XrdSfsAio *aiop;
+  AioCB *cb;
+  /// timer of the deadline of the read, if any, and its argument
+  unsigned long long timerId;
+  AioReadDeadline *deadline;
+};
+
+/// small struct describing a read being fetched from ceph, that other
+/// reads of the same file within the same range can join
+struct InflightRead {
+  InflightRead(unsigned long long o, size_t c) :
+    offset(o), count(c), rc(0), done(false), nbRefs(1) {}
+  unsigned long long offset;
+  size_t count;
+  ceph::bufferlist bl;
+  int rc;
+  bool done;
+  /// number of users of this struct : the issuer, synchronous readers and
+  /// deadline timers of asynchronous readers
+  unsigned int nbRefs;
+  /// asynchronous readers waiting for the data
+  std::vector<AioWaiter> aioWaiters;
+};
+typedef std::list<InflightRead*> InflightReadList;
+/// reads in flight, per file
+std::map<std::string, InflightReadList> g_inflightReads;
+
+/// small struct describing a stat being done, that other stats of the
+/// same file can join
+struct InflightStat {
+  InflightStat() : rc(0), size(0), mtime(0), done(false), nbRefs(1) {}
+  int rc;
+  uint64_t size;
+  time_t mtime;
+  bool done;
+  unsigned int nbRefs;
+};
+/// stats in flight, per file
+std::map<std::string, InflightStat*> g_inflightStats;
+/// protects g_inflightReads and g_inflightStats and signals completions
+XrdSysCondVar g_inflightCond;
+/// statistics of coalescing
+unsigned long long g_coalescedReads = 0;
+unsigned long long g_coalescedBytes = 0;
+unsigned long long g_coalescedStats = 0;
+
+/// finds a read in flight covering the given range, 0 if none
+/// Must be called with g_inflightCond held
+static InflightRead* findInflightRead(const std::string &key, unsigned long long offset,
+                                      size_t count) {
+  std::map<std::string, InflightReadList>::iterator it = g_inflightReads.find(key);
+  if (it == g_inflightReads.end()) return 0;
+  for (InflightReadList::iterator rit = it->second.begin(); rit != it->second.end(); rit++) {
+    if ((*rit)->offset <= offset && offset + count <= (*rit)->offset + (*rit)->count) {
+      return *rit;
+    }
+  }
+  return 0;
+}
+
+/// registers a new read in flight
+/// Must be called with g_inflightCond held
+static InflightRead* addInflightRead(const std::string &key, unsigned long long offset,
+                                     size_t count) {
+  InflightRead *ir = new InflightRead(offset, count);
+  g_inflightReads[key].push_back(ir);
+  return ir;
+}
+
+/// unregisters a read in flight, if still registered, so that new reads do not join it
+/// Must be called with g_inflightCond held
+static void detachInflightRead(const std::string &key, InflightRead *ir) {
+  std::map<std::string, InflightReadList>::iterator it = g_inflightReads.find(key);
+  if (it == g_inflightReads.end()) return;
+  it->second.remove(ir);
+  if (it->second.empty()) g_inflightReads.erase(it);
+}
+
+/// copies the part of a completed read needed by a reader
+/// returns the number of bytes copied or the error of the read
+static ssize_t copyInflightRead(InflightRead *ir, char *buf, unsigned long long offset,
+                                size_t count) {
+  if (ir->rc < 0) return ir->rc;
+  unsigned long long start = offset - ir->offset;
+  if (start >= ir->bl.length()) return 0;
+  size_t n = ir->bl.length() - start < count ? ir->bl.length() - start : count;
+  ir->bl.copy(start, n, buf);
+  return n;
+}
+
+/// drops a reference to a read in flight, deleting it when unused
+/// Must be called with g_inflightCond held
+static void releaseInflightRead(InflightRead *ir) {
+  if (0 == --ir->nbRefs) delete ir;
+}
+
+static void aioReadDeadlineExpired(void *arg) {
+  AioReadDeadline *ard = reinterpret_cast<AioReadDeadline*>(arg);
+  AioCB *cb = 0;
+  {
+    XrdSysCondVarHelper lock(g_inflightCond);
+    std::vector<AioWaiter> &waiters = ard->ir->aioWaiters;
+    for (std::vector<AioWaiter>::iterator it = waiters.begin(); it != waiters.end(); it++) {
+      if (it->aiop == ard->aiop) {
+        cb = it->cb;
+        waiters.erase(it);
+        break;
+      }
+    }
+    releaseInflightRead(ard->ir);
+  }
+  // the reader is abandoned. The read itself goes on for the other readers
+  if (cb) {
+    deadlineExpired(DL_READ);
+    cb(ard->aiop, -ETIMEDOUT);
+  }
+  delete ard;
+}
+
+/// adds an asynchronous reader to a read in flight, with the read deadline if any
+/// Must be called with g_inflightCond held
+static void addAioWaiter(InflightRead *ir, XrdSfsAio *aiop, AioCB *cb) {
+  AioWaiter waiter(aiop, cb);
+  XrdCephTimer *timer = g_deadlineMs[DL_READ] ? getTimer() : 0;
+  if (timer) {
+    waiter.deadline = new AioReadDeadline(ir, aiop);
+    waiter.timerId = timer->schedule(g_deadlineMs[DL_READ], aioReadDeadlineExpired,
+                                     waiter.deadline);
+    if (waiter.timerId) {
+      ir->nbRefs++;
+    } else {
+      delete waiter.deadline;
+      waiter.deadline = 0;
+    }
+  }
+  ir->aioWaiters.push_back(waiter);
+}
+
+/// cancels the deadline of an asynchronous reader, if any
+/// Must be called with g_inflightCond held
+static void cancelAioWaiterDeadline(InflightRead *ir, AioWaiter &waiter) {
+  if (0 == waiter.timerId) return;
+  // when the timer is already running, it will release its reference itself
+  if (getTimer() && getTimer()->cancel(waiter.timerId)) {
+    delete waiter.deadline;
+    releaseInflightRead(ir);
+  }
+  waiter.timerId = 0;
+  waiter.deadline = 0;
+}
+
+/// publishes the result of a read in flight to all readers that joined it
+/// and drops the reference of the issuer
+static void completeInflightRead(const std::string &key, InflightRead *ir, int rc) {
+  std::vector<AioWaiter> aioWaiters;
+  {
+    XrdSysCondVarHelper lock(g_inflightCond);
+    detachInflightRead(key, ir);
+    ir->rc = rc;
+    ir->done = true;
+    aioWaiters.swap(ir->aioWaiters);
+    for (std::vector<AioWaiter>::iterator it = aioWaiters.begin(); it != aioWaiters.end(); it++) {
+      cancelAioWaiterDeadline(ir, *it);
+    }
+    g_inflightCond.Broadcast();
+  }
+  // no new reader can join anymore, and the data are not modified anymore,
+  // so the asynchronous readers can be served without the lock
+  for (std::vector<AioWaiter>::const_iterator it = aioWaiters.begin();
+       it != aioWaiters.end();
+       it++) {
+    XrdSfsAio *aiop = it->aiop;
+    it->cb(aiop, copyInflightRead(ir, (char*)aiop->sfsAio.aio_buf,
+                                  aiop->sfsAio.aio_offset, aiop->sfsAio.aio_nbytes));
+  }
+  XrdSysCondVarHelper lock(g_inflightCond);
+  releaseInflightRead(ir);
+}
+
+/// small struct for reads that may be joined by others
+struct CoalescedReadArgs {
+  CoalescedReadArgs(const std::string &k, InflightRead *r) : key(k), ir(r) {}
+  std::string key;
+  InflightRead *ir;
+};
+
+static void coalescedReadDone(void *arg, int rc) {
+  CoalescedReadArgs *cra = reinterpret_cast<CoalescedReadArgs*>(arg);
+  completeInflightRead(cra->key, cra->ir, rc);
+  delete cra;
+}
+
+/// starts a read registered as in flight
+static int startInflightRead(const CephFile &file, libradosstriper::RadosStriper *striper,
+                             const std::string &key, InflightRead *ir) {
+  CoalescedReadArgs *args = new CoalescedReadArgs(key, ir);
+  int rc = startRead(file, striper, &ir->bl, ir->count, ir->offset, coalescedReadDone, args);
+  if (rc) delete args;
+  return rc;
+}
+
+/// synchronous read joining any identical read in flight
+/// the read is done asynchronously so that it can be hedged and joined
+static ssize_t coalescedRead(const CephFile &file, libradosstriper::RadosStriper *striper,
+                             char *buf, size_t count, unsigned long long offset) {
+  std::string key = fileCacheKey(file);
+  InflightRead *ir;
+  bool issuer = false;
+  {
+    XrdSysCondVarHelper lock(g_inflightCond);
+    ir = g_cephCoalesceReads ? findInflightRead(key, offset, count) : 0;
+    if (ir) {
+      g_coalescedReads++;
+      g_coalescedBytes += count;
+    } else {
+      ir = addInflightRead(key, offset, count);
+      issuer = true;
+    }
+    // reference held while waiting for the completion
+    ir->nbRefs++;
+  }
+  if (issuer) {
+    int rc = startInflightRead(file, striper, key, ir);
+    // fail the readers that joined meanwhile, and ourselves
+    if (rc) completeInflightRead(key, ir, rc);
+  }
+  unsigned long long deadline = getDeadline(DL_READ);
+  XrdSysCondVarHelper lock(g_inflightCond);
+  while (!ir->done && waitUntil(g_inflightCond, deadline)) {}
+  ssize_t rc;
+  if (ir->done) {
+    rc = copyInflightRead(ir, buf, offset, count);
+  } else {
+    // abandon the read, it goes on for the other readers
+    deadlineExpired(DL_READ);
+    rc = -ETIMEDOUT;
+  }
+  releaseInflightRead(ir);
+  return rc;
+}
+
+/// asynchronous read joining any identical read in flight
+static ssize_t coalescedAioRead(const CephFile &file, libradosstriper::RadosStriper *striper,
+                                XrdSfsAio *aiop, AioCB *cb) {
+  std::string key = fileCacheKey(file);
+  size_t count = aiop->sfsAio.aio_nbytes;
+  unsigned long long offset = aiop->sfsAio.aio_offset;
+  InflightRead *ir;
+  {
+    XrdSysCondVarHelper lock(g_inflightCond);
+    ir = g_cephCoalesceReads ? findInflightRead(key, offset, count) : 0;
+    if (ir) {
+      addAioWaiter(ir, aiop, cb);
+      g_coalescedReads++;
+      g_coalescedBytes += count;
+      return 0;
+    }
+    ir = addInflightRead(key, offset, count);
+    // the issuer is served like any other waiter
+    addAioWaiter(ir, aiop, cb);
+  }
+  int rc = startInflightRead(file, striper, key, ir);
+  if (rc) {
+    // fail the readers that joined meanwhile, but not the issuer, who gets rc
+    {
+      XrdSysCondVarHelper lock(g_inflightCond);
+      cancelAioWaiterDeadline(ir, ir->aioWaiters.front());
+      ir->aioWaiters.erase(ir->aioWaiters.begin());
+    }
+    completeInflightRead(key, ir, rc);
+  }
+  return rc;
+}
+
+/// stat joining any stat of the same file in flight
+static int coalescedStat(const CephFile &file, libradosstriper::RadosStriper *striper,
+                         uint64_t *size, time_t *mtime) {
+  std::string key = fileCacheKey(file);
+  InflightStat *is;
+  {
+    XrdSysCondVarHelper lock(g_inflightCond);
+    std::map<std::string, InflightStat*>::iterator it = g_inflightStats.find(key);
+    if (it != g_inflightStats.end()) {
+      is = it->second;
+      is->nbRefs++;
+      g_coalescedStats++;
+      unsigned long long deadline = getDeadline(DL_STAT);
+      while (!is->done && waitUntil(g_inflightCond, deadline)) {}
+      int rc = -ETIMEDOUT;
+      if (is->done) {
+        rc = is->rc;
+        *size = is->size;
+        *mtime = is->mtime;
+      } else {
+        deadlineExpired(DL_STAT);
+      }
+      if (0 == --is->nbRefs) delete is;
+      return rc;
+    }
+    is = new InflightStat();
+    g_inflightStats[key] = is;
+  }
+  int rc = statWithDeadline(file, striper, size, mtime, DL_STAT);
+  XrdSysCondVarHelper lock(g_inflightCond);
+  std::map<std::string, InflightStat*>::iterator it = g_inflightStats.find(key);
+  if (it != g_inflightStats.end() && it->second == is) g_inflightStats.erase(it);
+  is->rc = rc;
+  is->size = *size;
+  is->mtime = *mtime;
+  is->done = true;
+  g_inflightCond.Broadcast();
+  if (0 == --is->nbRefs) delete is;
+  return rc;
+}
+
+/// whether uncached reads go through the reads in flight, in order to be
+/// coalesced, hedged or given a deadline
+static bool asyncReads() {
+  return g_cephCoalesceReads || g_hedgePercentile > 0 || g_deadlineMs[DL_READ] > 0;
+}
+
+/// makes sure that reads and stats issued after a modification of a file
+/// do not join operations that started before it
+static void detachInflightOperations(const CephFile &file) {
+  std::string key = fileCacheKey(file);
+  XrdSysCondVarHelper lock(g_inflightCond);
+  g_inflightReads.erase(key);
+  g_inflightStats.erase(key);
+}
+
+/// appends the statistics of coalescing to a stream
+static void coalescingStats(std::ostringstream &ss) {
+  XrdSysCondVarHelper lock(g_inflightCond);
+  ss << "<coalescing>"
+     << "<reads>" << g_coalescedReads << "</reads>"
+     << "<bytes>" << g_coalescedBytes << "</bytes>"
+     << "<stats>" << g_coalescedStats << "</stats>"
+     << "</coalescing>";
+}
+
+/// cache of file segments on local disk, 0 when disabled
+/// created in case of ceph.diskcache entry in the config file
+XrdCephDiskCache *g_diskCache = 0;
+
+/// statistics of the disk cache for a given pool
+struct DiskCachePoolStats {
+  DiskCachePoolStats() : nbHits(0), nbMisses(0), bytesFromCache(0), bytesFromCeph(0) {}
+  unsigned long long nbHits;
+  unsigned long long nbMisses;
+  unsigned long long bytesFromCache;
+  unsigned long long bytesFromCeph;
+};
+/// statistics of the disk cache, per pool
+std::map<std::string, DiskCachePoolStats> g_diskCacheStats;
+/// mutex protecting g_diskCacheStats
+XrdSysMutex g_diskCacheStatsMutex;
+
+/// enables the disk cache
+/// dir is the local directory holding cached segments, size the maximum
+/// amount of data it may hold and segmentSize the size of cached segments,
+/// in bytes
+/// returns 0 or -errno
+int ceph_posix_set_diskcache(const char *dir, unsigned long long size,
+                             unsigned long long segmentSize) {
+  if (0 == size || 0 == segmentSize || segmentSize > size) return -EINVAL;
+  XrdCephDiskCache *cache = new XrdCephDiskCache(dir, size, segmentSize);
+  long long rc = cache->load();
+  if (rc < 0) {
+    logwrapper((char*)"ceph_posix_set_diskcache : unable to load %s, rc = %lld", dir, rc);
+    delete cache;
+    return rc;
+  }
+  logwrapper((char*)"ceph_posix_set_diskcache : %lld segments found in %s", rc, dir);
+  delete g_diskCache;
+  g_diskCache = cache;
+  return 0;
+}
+
+/// reads data of a file through the disk cache
+/// segments have the fixed size of the cache, independently of the layout of
+/// the file, so that a given segment always holds the same range of the file
+/// missing segments are read as a whole from ceph and stored in the cache
+/// returns the number of bytes read, smaller than count at the end of the file,
+/// or a negative error
+static ssize_t diskCacheRead(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                             char *buf, size_t count, off64_t offset) {
+  std::string key = fileCacheKey(fr);
+  unsigned long long segSize = g_diskCache->segmentSize();
+  DiskCachePoolStats stats;
+  size_t done = 0;
+  int rc = 0;
+  while (done < count) {
+    unsigned long long pos = offset + done;
+    unsigned long long segment = pos / segSize;
+    size_t len = segSize - pos % segSize < count - done ? segSize - pos % segSize : count - done;
+    long long n = g_diskCache->read(key, fr.cacheVersion, segment, pos % segSize, len, buf + done);
+    if (n >= 0) {
+      stats.nbHits++;
+      stats.bytesFromCache += n;
+    } else {
+      ceph::bufferlist bl;
+      rc = readWithPolicy(fr, striper, &bl, segSize, segment * segSize);
+      if (rc < 0) break;
+      stats.nbMisses++;
+      stats.bytesFromCeph += rc;
+      if (rc > 0) g_diskCache->write(key, fr.cacheVersion, segment, bl.c_str(), rc);
+      n = 0;
+      if (pos % segSize < (unsigned long long)rc) {
+        n = rc - pos % segSize < len ? rc - pos % segSize : len;
+        bl.copy(pos % segSize, n, buf + done);
+      }
+    }
+    done += n;
+    if ((size_t)n < len) break;
+  }
+  {
+    XrdSysMutexHelper lock(g_diskCacheStatsMutex);
+    DiskCachePoolStats &ps = g_diskCacheStats[fr.pool];
+    ps.nbHits += stats.nbHits;
+    ps.nbMisses += stats.nbMisses;
+    ps.bytesFromCache += stats.bytesFromCache;
+    ps.bytesFromCeph += stats.bytesFromCeph;
+  }
+  if (rc < 0 && 0 == done) return rc;
+  return done;
+}
+
+/// appends the statistics of the disk cache to a stream
+static void diskCacheStats(std::ostringstream &ss) {
+  if (0 == g_diskCache) return;
+  unsigned long long usedSize, nbEntries;
+  g_diskCache->stats(usedSize, nbEntries);
+  ss << "<diskcache>"
+     << "<used>" << usedSize << "</used>"
+     << "<segments>" << nbEntries << "</segments>";
+  XrdSysMutexHelper lock(g_diskCacheStatsMutex);
+  for (std::map<std::string, DiskCachePoolStats>::const_iterator it = g_diskCacheStats.begin();
+       it != g_diskCacheStats.end();
+       it++) {
+    ss << "<pool name=\"" << it->first << "\">"
+       << "<hits>" << it->second.nbHits << "</hits>"
+       << "<misses>" << it->second.nbMisses << "</misses>"
+       << "<cachebytes>" << it->second.bytesFromCache << "</cachebytes>"
+       << "<cephbytes>" << it->second.bytesFromCeph << "</cephbytes>"
+       << "</pool>";
+  }
+  ss << "</diskcache>";
+}
+
+/// cache of file blocks shared by all open files, 0 when disabled
+/// created in case of ceph.blockcache entry in the config file
+XrdCephBlockCache *g_blockCache = 0;
+
+/// drops the cached metadata and blocks of a file, e.g. when it is modified
+static void invalidateCaches(const CephFile &file) {
+  if (g_metaCache) g_metaCache->remove(fileCacheKey(file));
+  if (g_blockCache) g_blockCache->invalidate(fileCacheKey(file));
+  if (g_diskCache) g_diskCache->invalidate(fileCacheKey(file));
+  if (g_cephCoalesceReads) detachInflightOperations(file);
+}
+
+/// enables the block cache
+/// size is the maximum memory used by cached data and blockSize the size
+/// of cached blocks, both in bytes
+/// returns 0 or -EINVAL in case of invalid arguments
+int ceph_posix_set_blockcache(unsigned long long size, unsigned long long blockSize) {
+  if (0 == blockSize || size < blockSize) return -EINVAL;
+  delete g_blockCache;
+  g_blockCache = new XrdCephBlockCache(size, blockSize);
+  return 0;
+}
+
+/// gets the version of a file for the block cache, i.e. the modification time
+/// of its first object, which is touched by every write through the striper
+/// returns 0 if it cannot be determined, meaning that the cache must not be used
+static unsigned long long blockCacheVersion(const CephFile &file) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) return 0;
+  uint64_t size;
+  struct timespec ts;
+  if (ioctx->stat2(file.name + g_firstObjectSuffix, &size, &ts)) return 0;
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/// inserts the blocks contained in a bufferlist into the block cache
+static void blockCacheInsert(const std::string &key, unsigned long long version,
+                             unsigned long long firstBlock, ceph::bufferlist &bl) {
+  unsigned long long bs = g_blockCache->blockSize();
+  const char *data = bl.c_str();
+  for (unsigned long long pos = 0; pos < bl.length(); pos += bs) {
+    size_t len = bl.length() - pos < bs ? bl.length() - pos : bs;
+    g_blockCache->put(key, version, firstBlock + pos / bs, data + pos, len);
+  }
+}
+
+/// copies to buf the data found in the block cache, starting at offset
+/// and stopping at the first missing block
+/// eof is set when the end of the file was reached
+/// returns the number of bytes copied
+static size_t blockCacheCopy(const std::string &key, unsigned long long version,
+                             char *buf, size_t count, off64_t offset, bool &eof) {
+  unsigned long long bs = g_blockCache->blockSize();
+  size_t done = 0;
+  eof = false;
+  while (done < count) {
+    unsigned long long pos = offset + done;
+    size_t len = bs - pos % bs < count - done ? bs - pos % bs : count - done;
+    long long n = g_blockCache->get(key, version, pos / bs, pos % bs, len, buf + done);
+    if (n < 0) break;
+    done += n;
+    if ((size_t)n < len) {
+      eof = true;
+      break;
+    }
+  }
+  return done;
+}
+
+/// reads through the block cache
+/// missing blocks are read from ceph as a single aligned read and cached
+static ssize_t blockCacheRead(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                              char *buf, size_t count, off64_t offset) {
+  std::string key = fileCacheKey(fr);
+  bool eof;
+  size_t done = blockCacheCopy(key, fr.cacheVersion, buf, count, offset, eof);
+  if (done == count || eof) return done;
+  unsigned long long bs = g_blockCache->blockSize();
+  unsigned long long firstBlock = (offset + done) / bs;
+  unsigned long long lastBlock = (offset + count - 1) / bs;
+  ceph::bufferlist bl;
+  int rc;
+  if (g_diskCache) {
+    size_t len = (lastBlock - firstBlock + 1) * bs;
+    ceph::bufferptr bp(len);
+    rc = diskCacheRead(fr, striper, bp.c_str(), len, firstBlock * bs);
+    if (rc > 0) bl.append(bp.c_str(), rc);
+  } else {
+    rc = readWithPolicy(fr, striper, &bl, (lastBlock - firstBlock + 1) * bs, firstBlock * bs);
+  }
+  if (rc < 0) return rc;
+  blockCacheInsert(key, fr.cacheVersion, firstBlock, bl);
+  unsigned long long start = offset + done - firstBlock * bs;
+  if (start < bl.length()) {
+    size_t n = bl.length() - start < count - done ? bl.length() - start : count - done;
+    bl.copy(start, n, buf + done);
+    done += n;
+  }
+  return done;
+}
+
+/// reads through the block and/or disk caches
+static ssize_t cachedPread(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                           char *buf, size_t count, off64_t offset) {
+  if (g_blockCache) return blockCacheRead(fr, striper, buf, count, offset);
+  return diskCacheRead(fr, striper, buf, count, offset);
+}
+
+/// small struct for aio reads going through the block cache
+struct BlockCacheAioArgs {
+  BlockCacheAioArgs(XrdSfsAio* a, AioCB *b, const std::string &k, unsigned long long v,
+                    unsigned long long fb, size_t d) :
+    aiop(a), callback(b), key(k), version(v), firstBlock(fb), done(d) {}
+  XrdSfsAio* aiop;
+  AioCB *callback;
+  std::string key;
+  unsigned long long version;
+  /// first block read from ceph
+  unsigned long long firstBlock;
+  /// number of bytes already served from the cache
+  size_t done;
+  ceph::bufferlist bl;
+};
+
+static void blockCacheAioReadDone(void *arg, int rc) {
+  BlockCacheAioArgs *bca = reinterpret_cast<BlockCacheAioArgs*>(arg);
+  if (rc < 0) {
+    bca->callback(bca->aiop, rc);
+    delete bca;
+    return;
+  }
+  blockCacheInsert(bca->key, bca->version, bca->firstBlock, bca->bl);
+  size_t count = bca->aiop->sfsAio.aio_nbytes;
+  unsigned long long offset = bca->aiop->sfsAio.aio_offset;
+  unsigned long long start = offset + bca->done - bca->firstBlock * g_blockCache->blockSize();
+  size_t done = bca->done;
+  if (start < bca->bl.length()) {
+    size_t n = bca->bl.length() - start < count - done ? bca->bl.length() - start : count - done;
+    bca->bl.copy(start, n, (char*)bca->aiop->sfsAio.aio_buf + done);
+    done += n;
+  }
+  bca->callback(bca->aiop, done);
+  delete bca;
+}
+
+static void blockCacheAioReadComplete(rados_completion_t c, void *arg) {
+  blockCacheAioReadDone(arg, rados_aio_get_return_value(c));
+}
+
+/// asynchronous read through the block cache
+/// reads fully served from the cache complete immediately
+static ssize_t blockCacheAioRead(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                                 XrdSfsAio *aiop, AioCB *cb) {
+  size_t count = aiop->sfsAio.aio_nbytes;
+  off64_t offset = aiop->sfsAio.aio_offset;
+  std::string key = fileCacheKey(fr);
+  bool eof;
+  size_t done = blockCacheCopy(key, fr.cacheVersion, (char*)aiop->sfsAio.aio_buf,
+                               count, offset, eof);
+  if (done == count || eof) {
+    cb(aiop, done);
+    return 0;
+  }
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  if (0 == cluster) {
+    return -EINVAL;
+  }
+  unsigned long long bs = g_blockCache->blockSize();
+  unsigned long long firstBlock = (offset + done) / bs;
+  unsigned long long lastBlock = (offset + count - 1) / bs;
+  BlockCacheAioArgs *args = new BlockCacheAioArgs(aiop, cb, key, fr.cacheVersion, firstBlock, done);
+  ReadPolicy policy = readPolicy(fr);
+  int rc;
+  if (RP_PRIMARY != policy) {
+    rc = startDirectRead(fr, homeCluster(fr), &args->bl, (lastBlock - firstBlock + 1) * bs,
+                         firstBlock * bs, policy, blockCacheAioReadDone, args);
+  } else {
+    librados::AioCompletion *completion =
+      cluster->aio_create_completion(args, blockCacheAioReadComplete, NULL);
+    rc = striper->aio_read(fr.name, completion, &args->bl,
+                           (lastBlock - firstBlock + 1) * bs, firstBlock * bs);
+    completion->release();
+  }
+  if (rc) delete args;
+  return rc;
+}
+
+/// appends the statistics of the block cache to a stream
+static void blockCacheStats(std::ostringstream &ss) {
+  if (0 == g_blockCache) return;
+  unsigned long long usedSize, nbBlocks, nbHits, nbMisses, nbEvictions;
+  g_blockCache->stats(usedSize, nbBlocks, nbHits, nbMisses, nbEvictions);
+  ss << "<blockcache>"
+     << "<used>" << usedSize << "</used>"
+     << "<blocks>" << nbBlocks << "</blocks>"
+     << "<hits>" << nbHits << "</hits>"
+     << "<misses>" << nbMisses << "</misses>"
+     << "<evictions>" << nbEvictions << "</evictions>"
+     << "</blockcache>";
+}
+
+/// types of checksums computed while files are written
+enum WriteChecksumType { WCKS_ADLER32 = 1, WCKS_CRC32C = 2 };
+/// checksums computed while files are written and stored as XrdCks xattrs
+/// at close, as a mask of WriteChecksumType. 0 means none
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+unsigned int g_writeCksTypes = 0;
+/// number of reads in flight when files have to be read back to get their checksums
+static const unsigned int g_writeCksRereadDepth = 8;
+/// number of files whose checksums were computed while written, read back,
+/// or could not be stored
+unsigned long long g_writeCksNbStreamed = 0;
+unsigned long long g_writeCksNbReread = 0;
+unsigned long long g_writeCksNbFailed = 0;
+
+/// checksums of the data written sequentially to a file from its beginning
+struct WriteChecksum {
+  WriteChecksum() : inOrder(true), offset(0), adler32(1), crc32c(0) {}
+  /// whether all writes so far were sequential
+  bool inOrder;
+  /// end of the data checksummed so far
+  unsigned long long offset;
+  uint32_t adler32;
+  uint32_t crc32c;
+  XrdSysMutex mutex;
+};
+
+/// sets the checksums computed while files are written, as a comma separated
+/// list of adler32 and crc32c
+/// returns 0 or -EINVAL for an unknown checksum
+int ceph_posix_set_writecks(const char *types) {
+  unsigned int mask = 0;
+  std::istringstream ss(types);
+  std::string type;
+  while (std::getline(ss, type, ',')) {
+    if (type == "adler32") mask |= WCKS_ADLER32;
+    else if (type == "crc32c") mask |= WCKS_CRC32C;
+    else return -EINVAL;
+  }
+  g_writeCksTypes = mask;
+  return 0;
+}
+
+/// adds data written to a file to its checksums, if they are computed
+/// writes that are not sequential stop the computation, the checksums
+/// will then be computed at close by reading the file back
+static void updateWriteChecksum(CephFileRef &fr, const char *buf, size_t count,
+                                unsigned long long offset) {
+  WriteChecksum *wc = fr.writeCks;
+  if (0 == wc) return;
+  XrdSysMutexHelper lock(wc->mutex);
+  if (!wc->inOrder) return;
+  if (offset != wc->offset) {
+    wc->inOrder = false;
+    return;
+  }
+  if (g_writeCksTypes & WCKS_ADLER32) {
+    wc->adler32 = XrdCephChecksum::adler32(wc->adler32, (const unsigned char*)buf, count);
+  }
+  if (g_writeCksTypes & WCKS_CRC32C) {
+    wc->crc32c = XrdCephChecksum::crc32c(wc->crc32c, (const unsigned char*)buf, count);
+  }
+  wc->offset += count;
+}
+
+/// marks the checksums computed while writing a file as unusable
+static void dropWriteChecksum(CephFileRef &fr) {
+  WriteChecksum *wc = fr.writeCks;
+  if (0 == wc) return;
+  XrdSysMutexHelper lock(wc->mutex);
+  wc->inOrder = false;
+}
+
+/// computes the checksums of a file by reading it back, with several reads in flight
+static int rereadChecksums(const CephFile &file, libradosstriper::RadosStriper *striper,
+                           unsigned long long size, uint32_t &adler32, uint32_t &crc32c) {
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  if (0 == cluster) {
+    return -EINVAL;
+  }
+  unsigned long long chunkSize = std::max(file.stripeUnit, 4ULL << 20);
+  typedef std::pair<librados::AioCompletion*, ceph::bufferlist*> ChunkRead;
+  std::deque<ChunkRead> inflight;
+  std::deque<size_t> lengths;
+  unsigned long long next = 0;
+  int rc = 0;
+  adler32 = 1;
+  crc32c = 0;
+  while (!inflight.empty() || (0 == rc && next < size)) {
+    while (0 == rc && next < size && inflight.size() < g_writeCksRereadDepth) {
+      size_t len = std::min(chunkSize, size - next);
+      ceph::bufferlist *bl = new ceph::bufferlist();
+      librados::AioCompletion *completion = cluster->aio_create_completion();
+      rc = striper->aio_read(file.name, completion, bl, len, next);
+      if (rc) {
+        completion->release();
+        delete bl;
+        break;
+      }
+      inflight.push_back(ChunkRead(completion, bl));
+      lengths.push_back(len);
+      next += len;
+    }
+    if (inflight.empty()) break;
+    // chunks are consumed in order, as checksums are sequential
+    ChunkRead &chunk = inflight.front();
+    chunk.first->wait_for_complete();
+    int nbRead = chunk.first->get_return_value();
+    if (0 == rc) {
+      if (nbRead != (int)lengths.front()) {
+        rc = nbRead < 0 ? nbRead : -EIO;
+      } else {
+        const unsigned char *data = (const unsigned char*)chunk.second->c_str();
+        if (g_writeCksTypes & WCKS_ADLER32) adler32 = XrdCephChecksum::adler32(adler32, data, nbRead);
+        if (g_writeCksTypes & WCKS_CRC32C) crc32c = XrdCephChecksum::crc32c(crc32c, data, nbRead);
+      }
+    }
+    chunk.first->release();
+    delete chunk.second;
+    inflight.pop_front();
+    lengths.pop_front();
+  }
+  return rc;
+}
+
+/// whether the crc32c of files is computed by the OSDs holding their objects
+/// when it is not stored yet or when files were not written sequentially
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+bool g_cephOsdChecksums = false;
+/// number of objects whose checksums are requested in parallel
+static const unsigned int g_osdCksDepth = 32;
+/// number of files whose crc32c was computed by the OSDs, and of failures
+unsigned long long g_osdCksNbComputed = 0;
+unsigned long long g_osdCksNbFailed = 0;
+
+/// checksum op on an object, and its results
+struct OsdChecksumRead {
+  OsdChecksumRead(unsigned long long no) :
+    objectNo(no), completion(0), hasUnits(false), hasTail(false), unitsRc(0), tailRc(0) {}
+  unsigned long long objectNo;
+  librados::AioCompletion *completion;
+  librados::ObjectReadOperation op;
+  /// crc32c of the full stripe units of the object, and of the partial last one
+  bool hasUnits;
+  bool hasTail;
+  ceph::bufferlist units;
+  ceph::bufferlist tail;
+  int unitsRc;
+  int tailRc;
+};
+
+/// decodes the result of the checksum op of rados : a little endian count
+/// followed by as many little endian crc32c values
+static bool decodeOsdChecksums(ceph::bufferlist &bl, std::vector<uint32_t> &crcs) {
+  if (bl.length() < 4) return false;
+  const unsigned char *p = (const unsigned char*)bl.c_str();
+  uint32_t count = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+  if (bl.length() != 4 + 4ULL * count) return false;
+  for (uint32_t i = 0; i < count; i++) {
+    const unsigned char *v = p + 4 + 4 * i;
+    // the OSDs start from the given seed but do not invert the result
+    crcs.push_back(~(v[0] | v[1] << 8 | v[2] << 16 | (uint32_t)v[3] << 24));
+  }
+  return true;
+}
+
+static int readStriperLayout(librados::IoCtx *ioctx, const std::string &name,
+                             CephFile &layout, unsigned long long &size);
+
+/// computes the crc32c of a file from the crc32c of its stripe units, computed
+/// by the OSDs holding its objects. Only the checksums go through the network
+static int osdCrc32c(const CephFile &file, unsigned long long size, uint32_t &crc32c) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  if (0 == ioctx || 0 == cluster) {
+    return -EINVAL;
+  }
+  // the layout the file was written with, which may differ from the one
+  // given in the path or the default one
+  CephFile layout = file;
+  unsigned long long storedSize;
+  int rc = readStriperLayout(ioctx, file.name, layout, storedSize);
+  if (rc) return rc;
+  // lengths of the objects, deduced from the size and the layout of the file
+  std::vector<ObjectExtent> extents;
+  getObjectExtents(layout, 0, size, extents);
+  std::vector<unsigned long long> lengths;
+  for (std::vector<ObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+    if (it->objectNo >= lengths.size()) lengths.resize(it->objectNo + 1, 0);
+    lengths[it->objectNo] = std::max(lengths[it->objectNo], it->objectOffset + it->length);
+  }
+  ceph::bufferlist seed;
+  uint32_t init = 0xffffffff;
+  seed.append((const char*)&init, sizeof(init));
+  std::vector<std::vector<uint32_t> > crcs(lengths.size());
+  std::deque<OsdChecksumRead*> inflight;
+  unsigned long long next = 0;
+  while (!inflight.empty() || (0 == rc && next < lengths.size())) {
+    while (0 == rc && next < lengths.size() && inflight.size() < g_osdCksDepth) {
+      unsigned long long unitsLen = lengths[next] - lengths[next] % layout.stripeUnit;
+      OsdChecksumRead *r = new OsdChecksumRead(next);
+      if (unitsLen) {
+        r->hasUnits = true;
+        r->op.checksum(LIBRADOS_CHECKSUM_TYPE_CRC32C, seed, 0, unitsLen,
+                       layout.stripeUnit, &r->units, &r->unitsRc);
+      }
+      if (lengths[next] > unitsLen) {
+        r->hasTail = true;
+        r->op.checksum(LIBRADOS_CHECKSUM_TYPE_CRC32C, seed, unitsLen,
+                       lengths[next] - unitsLen, 0, &r->tail, &r->tailRc);
+      }
+      r->completion = cluster->aio_create_completion();
+      rc = ioctx->aio_operate(getObjectName(file.name, next), r->completion, &r->op,
+                              g_readPolicyFlags[readPolicy(file)], NULL);
+      if (rc) {
+        r->completion->release();
+        delete r;
+        break;
+      }
+      inflight.push_back(r);
+      next++;
+    }
+    if (inflight.empty()) break;
+    OsdChecksumRead *r = inflight.front();
+    inflight.pop_front();
+    r->completion->wait_for_complete();
+    int opRc = r->completion->get_return_value();
+    if (0 == rc) {
+      if (opRc < 0) rc = opRc;
+      else if (r->unitsRc < 0) rc = r->unitsRc;
+      else if (r->tailRc < 0) rc = r->tailRc;
+      else if ((r->hasUnits && !decodeOsdChecksums(r->units, crcs[r->objectNo])) ||
+               (r->hasTail && !decodeOsdChecksums(r->tail, crcs[r->objectNo]))) rc = -EIO;
+    }
+    r->completion->release();
+    delete r;
+  }
+  if (rc) return rc;
+  if (!XrdCephChecksum::stripedCrc32c(crcs, size, layout.stripeUnit, layout.nbStripes,
+                                      layout.objectSize, crc32c)) {
+    return -EIO;
+  }
+  return 0;
+}
+
+/// computes the crc32c of a file on the OSDs, if enabled, and counts the outcome
+static void tierDataFile(CephFile &file);
+static bool isCompressed(const CephFile &file);
+
+static bool tryOsdCrc32c(const CephFile &file, unsigned long long size, uint32_t &crc32c) {
+  if (!g_cephOsdChecksums) return false;
+  // the objects of compressed files do not hold the data of the file
+  if (isCompressed(file)) return false;
+  // files moved to a cold pool only have their data there
+  CephFile dataFile = file;
+  tierDataFile(dataFile);
+  int rc = osdCrc32c(dataFile, size, crc32c);
+  if (rc) {
+    logwrapper((char*)"tryOsdCrc32c : OSDs could not checksum %s, rc = %d",
+               file.name.c_str(), rc);
+    __sync_fetch_and_add(&g_osdCksNbFailed, 1);
+    return false;
+  }
+  __sync_fetch_and_add(&g_osdCksNbComputed, 1);
+  return true;
+}
+
+/// appends the statistics of the checksums computed by the OSDs to a stream
+static void osdCksStats(std::ostringstream &ss) {
+  if (!g_cephOsdChecksums) return;
+  ss << "<osdcks>"
+     << "<computed>" << g_osdCksNbComputed << "</computed>"
+     << "<failed>" << g_osdCksNbFailed << "</failed>"
+     << "</osdcks>";
+}
+
+static ssize_t ceph_posix_internal_setxattr(const CephFile &file, const char* name,
+                                            const void* value, size_t size, int flags);
+
+/// fills a checksum in the format of XrdCks
+static void makeCksData(XrdCksData &cks, const char *name, uint32_t value, time_t mtime) {
+  cks.Set(name);
+  unsigned char bytes[4] = {(unsigned char)(value >> 24), (unsigned char)(value >> 16),
+                            (unsigned char)(value >> 8), (unsigned char)value};
+  cks.Set(bytes, 4);
+  cks.fmTime = htonll((long long)mtime);
+  cks.csTime = htonl((int)(time(0) - mtime));
+}
+
+/// stores a checksum as an xattr, in the format of XrdCks
+static int storeChecksum(const CephFile &file, const char *name, uint32_t value, time_t mtime) {
+  XrdCksData cks;
+  makeCksData(cks, name, value, mtime);
+  std::string attr = std::string("XrdCks.") + name;
+  return ceph_posix_internal_setxattr(file, attr.c_str(), &cks, sizeof(cks), 0);
+}
+
+/// answers a request for the missing XrdCks.crc32c xattr of a file by having
+/// the OSDs compute it, and stores it for the next requests
+/// returns -ENODATA when it could not be computed, so that XrdCks reads the file
+static ssize_t osdChecksumXattr(const CephFile &file, libradosstriper::RadosStriper *striper,
+                                void *value, size_t size) {
+  uint64_t fileSize;
+  time_t mtime;
+  int rc = striper->stat(file.name, &fileSize, &mtime);
+  if (rc) return rc;
+  uint32_t crc32c;
+  if (!tryOsdCrc32c(file, fileSize, crc32c)) return -ENODATA;
+  XrdCksData cks;
+  makeCksData(cks, "crc32c", crc32c, mtime);
+  if (ceph_posix_internal_setxattr(file, "XrdCks.crc32c", &cks, sizeof(cks), 0)) {
+    logwrapper((char*)"osdChecksumXattr : unable to store the crc32c of %s", file.name.c_str());
+  }
+  size_t returned_size = sizeof(cks)<size?sizeof(cks):size;
+  memcpy(value, &cks, returned_size);
+  return returned_size;
+}
+
+/// whether the page checksums of pgWrite are stored with files, in xattrs of the
+/// objects holding the pages, so that pgRead returns them instead of recomputing them.
+/// Plain writes and truncations then drop the checksums of the pages they touch
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+bool g_cephStorePageChecksums = false;
+/// xattr of the first object of files for which page checksums were stored, so
+/// that the writes of other files do not have to look for checksums to drop
+static const char *g_pageCksXattr = "xrdceph.pgcks";
+/// prefix of the xattrs holding the checksums of a span of pages of an object,
+/// followed by the number of the span within the object
+static const char *g_pageCksPrefix = "xrdceph.pgcks.";
+/// number of pages of a span, whose checksums are packed in a single xattr
+static const unsigned long long g_pageCksSpan = 1024;
+/// number of attempts to update the checksums of an object updated concurrently
+static const unsigned int g_pageCksMaxAttempts = 8;
+/// number of page checksums stored, reused by reads, computed,
+/// and of reads or writes whose checksums did not match their data
+unsigned long long g_pageCksNbStored = 0;
+unsigned long long g_pageCksNbReused = 0;
+unsigned long long g_pageCksNbComputed = 0;
+unsigned long long g_pageCksNbMismatches = 0;
+
+static unsigned long long objectCount(const CephFile &layout, unsigned long long size);
+
+/// xattr holding the checksums of a span of pages of an object
+static std::string pageCksKey(unsigned long long spanNo) {
+  char key[40];
+  snprintf(key, sizeof(key), "%s%llx", g_pageCksPrefix, spanNo);
+  return key;
+}
+
+/// changes to the page checksums held by an object, pages being numbered within the object
+struct ObjectPageCks {
+  ObjectPageCks() : cut(~0ULL) {}
+  /// new checksum and length of pages, a null length dropping the checksum
+  std::map<unsigned long long, std::pair<uint32_t, uint32_t> > pages;
+  /// first page whose checksum is dropped, together with the ones of all following pages
+  unsigned long long cut;
+};
+
+/// changes to the page checksums of a file, by object number
+typedef std::map<unsigned long long, ObjectPageCks> PageCksUpdate;
+
+/// reads the layout and size of a file and whether page checksums were stored
+/// for it, from the xattrs of its first object
+static int readPageCksState(librados::IoCtx *ioctx, const std::string &name,
+                            CephFile &layout, unsigned long long &size, bool &stored) {
+  static const char* attrNames[4] = {"striper.layout.stripe_unit",
+                                     "striper.layout.stripe_count",
+                                     "striper.layout.object_size",
+                                     "striper.size"};
+  std::map<std::string, ceph::bufferlist> attrs;
+  int rc = ioctx->getxattrs(getObjectName(name, 0), attrs);
+  if (rc < 0) return rc;
+  unsigned long long values[4];
+  for (unsigned int i = 0; i < 4; i++) {
+    std::map<std::string, ceph::bufferlist>::iterator it = attrs.find(attrNames[i]);
+    if (it == attrs.end()) return -EINVAL;
+    values[i] = strtoull(std::string(it->second.c_str(), it->second.length()).c_str(), 0, 10);
+  }
+  layout.name = name;
+  layout.stripeUnit = values[0];
+  layout.nbStripes = values[1];
+  layout.objectSize = values[2];
+  size = values[3];
+  if (0 == layout.stripeUnit || 0 == layout.nbStripes || layout.objectSize < layout.stripeUnit) {
+    return -EINVAL;
+  }
+  stored = attrs.count(g_pageCksXattr) > 0;
+  return 0;
+}
+
+/// whether page checksums can be located in the objects of a layout, as
+/// pages must not be split across objects
+static bool pageCksLayout(const CephFile &layout) {
+  return 0 == layout.stripeUnit % XrdCephChecksum::PageSize;
+}
+
+/// loads whether page checksums were stored for an open file, together with the
+/// layout locating them. Files not created yet have none and will get the layout of the open
+static int loadPageCksState(CephFileRef &fr) {
+  if (fr.pageCks >= 0) return 0;
+  librados::IoCtx *ioctx = getIoCtx(fr);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  fr.storedLayout = fr;
+  unsigned long long size;
+  bool stored = false;
+  int rc = readPageCksState(ioctx, fr.name, fr.storedLayout, size, stored);
+  if (rc && -ENOENT != rc) return rc;
+  fr.pageCks = stored ? 1 : 0;
+  return 0;
+}
+
+/// whether page checksums are stored for an open file. Compressed files are not
+/// concerned, as their objects do not hold the data at their offset
+static bool storesPageChecksums(CephFileRef &fr) {
+  if (!g_cephStorePageChecksums || fr.compress) return false;
+  if (loadPageCksState(fr)) return false;
+  return pageCksLayout(fr.storedLayout);
+}
+
+/// adds the pages of a range of a file to an update, with their checksums when
+/// given, otherwise dropping them. The checksum of a partial first page is always dropped
+static void addPageCks(const CephFile &layout, unsigned long long offset, size_t count,
+                       const uint32_t *csvec, PageCksUpdate &update) {
+  const unsigned long long ps = XrdCephChecksum::PageSize;
+  std::vector<ObjectExtent> extents;
+  getObjectExtents(layout, offset, count, extents);
+  for (std::vector<ObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+    ObjectPageCks &object = update[it->objectNo];
+    size_t done = 0;
+    while (done < it->length) {
+      unsigned long long pos = it->objectOffset + done;
+      size_t len = std::min((size_t)(ps - pos % ps), it->length - done);
+      std::pair<uint32_t, uint32_t> &value = object.pages[pos / ps];
+      if (csvec && 0 == pos % ps) {
+        unsigned long long pageNo = (offset + it->bufferOffset + done) / ps - offset / ps;
+        value = std::make_pair(csvec[pageNo], (uint32_t)len);
+      } else {
+        value = std::make_pair(0U, 0U);
+      }
+      done += len;
+    }
+  }
+}
+
+/// adds the cut of a truncation to an update. Only the objects of the object set
+/// holding the new end are cut, the ones beyond are removed with their xattrs
+static void addPageCksCut(const CephFile &layout, unsigned long long size,
+                          unsigned long long oldSize, PageCksUpdate &update) {
+  const unsigned long long ps = XrdCephChecksum::PageSize;
+  unsigned long long sc = layout.nbStripes;
+  unsigned long long setSize = sc * layout.objectSize;
+  unsigned long long setOffset = size / setSize * setSize;
+  unsigned long long setStart = size / setSize * sc;
+  unsigned long long oldCount = objectCount(layout, oldSize);
+  std::vector<unsigned long long> lengths(sc, 0);
+  std::vector<ObjectExtent> extents;
+  getObjectExtents(layout, setOffset, size - setOffset, extents);
+  for (std::vector<ObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+    unsigned long long &length = lengths[it->objectNo - setStart];
+    length = std::max(length, it->objectOffset + it->length);
+  }
+  for (unsigned long long objectNo = setStart; objectNo < setStart + sc && objectNo < oldCount; objectNo++) {
+    // a partial last page does not match its checksum anymore
+    update[objectNo].cut = lengths[objectNo - setStart] / ps;
+  }
+}
+
+/// applies the changes to the page checksums held by an object. Each xattr is
+/// rewritten only if it did not change since it was read, otherwise the object
+/// is read again. Objects which do not exist have nothing to change
+static int updateObjectPageCks(librados::IoCtx *ioctx, const std::string &oid,
+                               bool first, const ObjectPageCks &changes) {
+  typedef std::map<unsigned long long, std::pair<uint32_t, uint32_t> > Pages;
+  for (unsigned int attempt = 0; attempt < g_pageCksMaxAttempts; attempt++) {
+    std::map<std::string, ceph::bufferlist> attrs;
+    int rc = ioctx->getxattrs(oid, attrs);
+    if (rc < 0) return -ENOENT == rc ? 0 : rc;
+    // spans concerned, with their current value
+    std::map<unsigned long long, std::string> spans;
+    for (Pages::const_iterator it = changes.pages.begin(); it != changes.pages.end(); it++) {
+      spans[it->first / g_pageCksSpan];
+    }
+    size_t prefixLen = strlen(g_pageCksPrefix);
+    for (std::map<std::string, ceph::bufferlist>::iterator it = attrs.begin(); it != attrs.end(); it++) {
+      if (it->first.compare(0, prefixLen, g_pageCksPrefix)) continue;
+      unsigned long long spanNo = strtoull(it->first.c_str() + prefixLen, 0, 16);
+      if (spans.count(spanNo) || (spanNo + 1) * g_pageCksSpan > changes.cut) {
+        spans[spanNo].assign(it->second.c_str(), it->second.length());
+      }
+    }
+    librados::ObjectWriteOperation op;
+    bool changed = false;
+    for (std::map<unsigned long long, std::string>::const_iterator it = spans.begin(); it != spans.end(); it++) {
+      std::string value = it->second;
+      unsigned long long firstPage = it->first * g_pageCksSpan;
+      for (Pages::const_iterator pit = changes.pages.lower_bound(firstPage);
+           pit != changes.pages.end() && pit->first < firstPage + g_pageCksSpan;
+           pit++) {
+        size_t pos = 8 * (pit->first - firstPage);
+        if (value.size() < pos + 8) value.resize(pos + 8, '\0');
+        uint32_t packed[2] = {htonl(pit->second.first), htonl(pit->second.second)};
+        value.replace(pos, 8, (const char*)packed, 8);
+      }
+      if (changes.cut < firstPage + g_pageCksSpan) {
+        size_t keep = changes.cut > firstPage ? 8 * (changes.cut - firstPage) : 0;
+        if (value.size() > keep) value.resize(keep);
+      }
+      // dropped checksums at the end are not kept, so that spans only shrink
+      while (value.size() >= 8 && 0 == value.compare(value.size() - 4, 4, std::string(4, '\0'))) {
+        value.resize(value.size() - 8);
+      }
+      if (value == it->second) continue;
+      std::string key = pageCksKey(it->first);
+      ceph::bufferlist old;
+      old.append(it->second);
+      op.cmpxattr(key.c_str(), LIBRADOS_CMPXATTR_OP_EQ, old);
+      if (value.empty()) {
+        op.rmxattr(key.c_str());
+      } else {
+        ceph::bufferlist bl;
+        bl.append(value);
+        op.setxattr(key.c_str(), bl);
+      }
+      changed = true;
+    }
+    // a file truncated to nothing has no page checksums anymore
+    if (first && 0 == changes.cut && attrs.count(g_pageCksXattr)) {
+      op.rmxattr(g_pageCksXattr);
+      changed = true;
+    }
+    if (!changed) return 0;
+    op.assert_exists();
+    rc = ioctx->operate(oid, &op);
+    if (-ECANCELED != rc) return -ENOENT == rc ? 0 : rc;
+  }
+  return -EBUSY;
+}
+
+/// applies the changes to the page checksums of a file, object by object
+static int updatePageCks(const CephFile &file, const PageCksUpdate &update) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  for (PageCksUpdate::const_iterator it = update.begin(); it != update.end(); it++) {
+    int rc = updateObjectPageCks(ioctx, getObjectName(file.name, it->first), 0 == it->first,
+                                 it->second);
+    if (rc) return rc;
+  }
+  return 0;
+}
+
+/// stores the checksums of the pages written by a pgWrite. Each checksum is kept
+/// with the length it covers, as the last page of a file may be partial, and is
+/// used only for reads of that same length. A partial first page is not stored.
+/// The file is first marked as having page checksums, once it was written
+static int storePageChecksums(CephFileRef &fr, unsigned long long offset, size_t count,
+                              const uint32_t *csvec) {
+  if (1 != fr.pageCks) {
+    librados::IoCtx *ioctx = getIoCtx(fr);
+    if (0 == ioctx) {
+      return -EINVAL;
+    }
+    ceph::bufferlist bl;
+    bl.append("1", 1);
+    int rc = ioctx->setxattr(getObjectName(fr.name, 0), g_pageCksXattr, bl);
+    if (rc) return rc;
+    fr.pageCks = 1;
+  }
+  PageCksUpdate update;
+  addPageCks(fr.storedLayout, offset, count, csvec, update);
+  int rc = updatePageCks(fr, update);
+  if (0 == rc) {
+    const unsigned long long ps = XrdCephChecksum::PageSize;
+    __sync_fetch_and_add(&g_pageCksNbStored, (offset + count - 1) / ps - (offset + ps - 1) / ps + 1);
+  }
+  return rc;
+}
+
+/// drops the stored checksums of the pages touched by a write. Files for which
+/// no page checksums were stored have nothing to drop and cost no operation
+static int dropPageChecksums(CephFileRef &fr, unsigned long long offset, size_t count) {
+  if (0 == count || !g_cephStorePageChecksums || fr.compress) return 0;
+  int rc = loadPageCksState(fr);
+  if (rc) return rc;
+  if (1 != fr.pageCks || !pageCksLayout(fr.storedLayout)) return 0;
+  PageCksUpdate update;
+  addPageCks(fr.storedLayout, offset, count, 0, update);
+  return updatePageCks(fr, update);
+}
+
+/// drops the stored checksums of the pages cut by a truncation. As pages beyond
+/// the new end may come back later as zeros, none of their checksums may survive
+static int truncatePageChecksums(const CephFile &file, unsigned long long size) {
+  if (!g_cephStorePageChecksums) return 0;
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  CephFile layout = file;
+  unsigned long long oldSize;
+  bool stored = false;
+  int rc = readPageCksState(ioctx, file.name, layout, oldSize, stored);
+  if (rc) return -ENOENT == rc ? 0 : rc;
+  if (!stored || size >= oldSize || !pageCksLayout(layout)) return 0;
+  PageCksUpdate update;
+  addPageCksCut(layout, size, oldSize, update);
+  return updatePageCks(file, update);
+}
+
+/// asynchronous lookup of the stored checksums of the pages of a read,
+/// in the xattrs of the objects holding them
+struct PageCksFetch {
+  struct ObjectFetch {
+    ObjectFetch() : completion(0), rc(0) {}
+    librados::AioCompletion *completion;
+    librados::ObjectReadOperation op;
+    std::map<std::string, ceph::bufferlist> attrs;
+    int rc;
+  };
+  ~PageCksFetch() {
+    for (std::map<unsigned long long, ObjectFetch*>::iterator it = objects.begin();
+         it != objects.end();
+         it++) {
+      if (it->second->completion) it->second->completion->release();
+      delete it->second;
+    }
+  }
+  CephFile layout;
+  std::map<unsigned long long, ObjectFetch*> objects;
+};
+
+/// starts the lookup of the stored checksums of the pages of a read, so that
+/// it runs in parallel with the read itself. Returns 0 if it could not be started
+static PageCksFetch* startPageCksFetch(CephFileRef &fr, unsigned long long offset,
+                                       size_t count) {
+  if (0 == count || 1 != fr.pageCks) return 0;
+  librados::IoCtx *ioctx = getIoCtx(fr);
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  if (0 == ioctx || 0 == cluster) return 0;
+  PageCksFetch *fetch = new PageCksFetch();
+  fetch->layout = fr.storedLayout;
+  std::vector<ObjectExtent> extents;
+  getObjectExtents(fr.storedLayout, offset, count, extents);
+  for (std::vector<ObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+    if (fetch->objects.count(it->objectNo)) continue;
+    PageCksFetch::ObjectFetch *object = new PageCksFetch::ObjectFetch();
+    fetch->objects[it->objectNo] = object;
+    object->op.getxattrs(&object->attrs, &object->rc);
+    object->completion = cluster->aio_create_completion();
+    if (ioctx->aio_operate(getObjectName(fr.name, it->objectNo), object->completion, &object->op,
+                           g_readPolicyFlags[readPolicy(fr)], NULL)) {
+      delete fetch;
+      return 0;
+    }
+  }
+  return fetch;
+}
+
+/// waits for the lookup of stored page checksums and fills the ones matching
+/// the pages actually read. Returns the number of pages found and deletes the lookup
+static size_t finishPageCksFetch(PageCksFetch *fetch, unsigned long long offset, size_t count,
+                                 std::vector<uint32_t> &stored, std::vector<bool> &known) {
+  for (std::map<unsigned long long, PageCksFetch::ObjectFetch*>::iterator it = fetch->objects.begin();
+       it != fetch->objects.end();
+       it++) {
+    it->second->completion->wait_for_complete();
+    if (0 == it->second->rc) it->second->rc = it->second->completion->get_return_value();
+  }
+  const unsigned long long ps = XrdCephChecksum::PageSize;
+  size_t nbKnown = 0;
+  std::vector<ObjectExtent> extents;
+  if (count) getObjectExtents(fetch->layout, offset, count, extents);
+  for (std::vector<ObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+    std::map<unsigned long long, PageCksFetch::ObjectFetch*>::iterator oit =
+      fetch->objects.find(it->objectNo);
+    if (oit == fetch->objects.end() || oit->second->rc) continue;
+    std::map<std::string, ceph::bufferlist> &attrs = oit->second->attrs;
+    size_t done = 0;
+    while (done < it->length) {
+      unsigned long long pos = it->objectOffset + done;
+      size_t len = std::min((size_t)(ps - pos % ps), it->length - done);
+      unsigned long long pageNo = pos / ps;
+      std::map<std::string, ceph::bufferlist>::iterator ait = attrs.find(pageCksKey(pageNo / g_pageCksSpan));
+      size_t valuePos = 8 * (pageNo % g_pageCksSpan);
+      if (0 == pos % ps && ait != attrs.end() && ait->second.length() >= valuePos + 8) {
+        uint32_t value[2];
+        ait->second.copy(valuePos, sizeof(value), (char*)value);
+        if (ntohl(value[1]) == len) {
+          size_t i = (offset + it->bufferOffset + done) / ps - offset / ps;
+          stored[i] = ntohl(value[0]);
+          known[i] = true;
+          nbKnown++;
+        }
+      }
+      done += len;
+    }
+  }
+  delete fetch;
+  return nbKnown;
+}
+
+/// appends the statistics of page checksums to a stream
+static void pageCksStats(std::ostringstream &ss) {
+  if (!g_cephStorePageChecksums && 0 == g_pageCksNbComputed) return;
+  ss << "<pagecks>"
+     << "<stored>" << g_pageCksNbStored << "</stored>"
+     << "<reused>" << g_pageCksNbReused << "</reused>"
+     << "<computed>" << g_pageCksNbComputed << "</computed>"
+     << "<mismatches>" << g_pageCksNbMismatches << "</mismatches>"
+     << "</pagecks>";
+}
+
+static int rereadCompressedChecksums(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                                     unsigned long long size, uint32_t &adler32, uint32_t &crc32c);
+
+/// stores the checksums of a file that was written, when it is closed
+/// the ones computed while writing are used when the file was written
+/// sequentially from its beginning, otherwise the file is read back
+static void storeWriteChecksums(CephFileRef &fr) {
+  libradosstriper::RadosStriper *striper = getRadosStriper(fr);
+  if (0 == striper) {
+    __sync_fetch_and_add(&g_writeCksNbFailed, 1);
+    return;
+  }
+  uint64_t size;
+  time_t mtime;
+  int rc = striper->stat(fr.name, &size, &mtime);
+  uint32_t adler32 = fr.writeCks->adler32;
+  uint32_t crc32c = fr.writeCks->crc32c;
+  if (0 == rc) {
+    if (fr.writeCks->inOrder && fr.writeCks->offset == size) {
+      __sync_fetch_and_add(&g_writeCksNbStreamed, 1);
+    } else if (fr.compress) {
+      rc = rereadCompressedChecksums(fr, striper, size, adler32, crc32c);
+      if (0 == rc) __sync_fetch_and_add(&g_writeCksNbReread, 1);
+    } else if (g_writeCksTypes != WCKS_CRC32C || !tryOsdCrc32c(fr, size, crc32c)) {
+      // adler32 cannot be computed by the OSDs
+      rc = rereadChecksums(fr, striper, size, adler32, crc32c);
+      if (0 == rc) __sync_fetch_and_add(&g_writeCksNbReread, 1);
+    }
+  }
+  if (0 == rc && (g_writeCksTypes & WCKS_ADLER32)) rc = storeChecksum(fr, "adler32", adler32, mtime);
+  if (0 == rc && (g_writeCksTypes & WCKS_CRC32C)) rc = storeChecksum(fr, "crc32c", crc32c, mtime);
+  if (rc) {
+    logwrapper((char*)"storeWriteChecksums : unable to store checksums of %s, rc = %d",
+               fr.name.c_str(), rc);
+    __sync_fetch_and_add(&g_writeCksNbFailed, 1);
+  }
+}
+
+/// appends the statistics of the checksums computed on writes to a stream
+static void writeCksStats(std::ostringstream &ss) {
+  if (0 == g_writeCksTypes) return;
+  ss << "<writecks>"
+     << "<streamed>" << g_writeCksNbStreamed << "</streamed>"
+     << "<reread>" << g_writeCksNbReread << "</reread>"
+     << "<failed>" << g_writeCksNbFailed << "</failed>"
+     << "</writecks>";
+}
+
+/// minimal size of the files whose unlink, or whose truncation by at least as
+/// much, is deferred : the file is updated at once, and its objects that are
+/// not needed anymore are removed later by a background reclaimer. 0 means never
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+unsigned long long g_reclaimMinSize = 0;
+/// number of objects removed per second by the background reclaimer
+unsigned int g_reclaimObjectsPerSecond = 100;
+/// object holding the queue of the reclamations of a pool, as omap entries
+/// keyed by file name. Queues survive restarts and are shared by gateways
+/// They are kept in the metadata pool, if any (See getMetaIoCtx)
+static const char *g_reclaimQueueObject = "xrdceph.reclaim";
+/// period of the background reclaimer, in milliseconds
+static const unsigned int g_reclaimPeriodMs = 100;
+/// number of removals in flight when reclamations are completed synchronously
+static const unsigned int g_reclaimSyncDepth = 64;
+
+/// objects of a file left to remove after a deferred unlink or truncation
+struct ReclaimItem {
+  ReclaimItem() : unlink(false), next(0), end(0), inflight(0) {}
+  /// the file, with the default layout as only its pool and user matter
+  CephFile file;
+  /// whether the file was unlinked, or truncated
+  bool unlink;
+  /// range of objects still to remove
+  unsigned long long next;
+  unsigned long long end;
+  /// number of removals in flight
+  unsigned int inflight;
+  /// value of the queue entry, as last written or read by this gateway
+  std::string queued;
+};
+
+/// reclamations known to this gateway, by user, pool and file name
+std::map<std::string, ReclaimItem> g_reclaimItems;
+/// pools whose queue was not loaded yet, by user and pool
+std::map<std::string, CephFile> g_reclaimPools;
+/// pools whose queue was loaded
+std::set<std::string> g_reclaimLoadedPools;
+/// whether the background reclaimer is scheduled on the timer, whether its
+/// next batch is due, and whether its thread was started
+bool g_reclaimScheduled = false;
+bool g_reclaimDue = false;
+bool g_reclaimWorkerStarted = false;
+/// protects the reclamations, and is signaled when removals in flight complete
+XrdSysCondVar g_reclaimCond(0);
+/// number of deferred unlinks and truncations, of reclamations completed
+/// in the background or synchronously, and of objects removed
+unsigned long long g_reclaimNbDeferred = 0;
+unsigned long long g_reclaimNbDone = 0;
+unsigned long long g_reclaimNbSync = 0;
+unsigned long long g_reclaimNbObjects = 0;
+
+/// sets the minimal size of deferred unlinks and truncations, and the
+/// rate of the background reclaimer. A size of 0 disables deferral
+/// returns 0 or -EINVAL if the rate is 0
+int ceph_posix_set_reclaim(unsigned long long minSize, unsigned int objectsPerSecond) {
+  if (0 == objectsPerSecond) return -EINVAL;
+  g_reclaimMinSize = minSize;
+  g_reclaimObjectsPerSecond = objectsPerSecond;
+  return 0;
+}
+
+/// pool and user part of the key of a reclamation
+static std::string reclaimPoolKey(const CephFile &file) {
+  return file.userId + '@' + file.pool;
+}
+
+/// copy of a file with the default layout, used to reach its pool
+static CephFile reclaimFile(const CephFile &file) {
+  CephFile f = file;
+  f.nbStripes = g_defaultParams.nbStripes;
+  f.stripeUnit = g_defaultParams.stripeUnit;
+  f.objectSize = g_defaultParams.objectSize;
+  return f;
+}
+
+/// entry of a reclamation in the queue of its pool : its type and object range
+static std::string encodeReclaim(const ReclaimItem &item) {
+  std::ostringstream ss;
+  ss << (item.unlink ? 'u' : 't') << ' ' << item.next << ' ' << item.end;
+  return ss.str();
+}
+
+static bool decodeReclaim(ceph::bufferlist &bl, ReclaimItem &item) {
+  std::string value(bl.c_str(), bl.length());
+  char type;
+  if (sscanf(value.c_str(), "%c %llu %llu", &type, &item.next, &item.end) != 3) return false;
+  if (type != 'u' && type != 't') return false;
+  item.unlink = 'u' == type;
+  return true;
+}
+
+/// reads the layout and size of a file from the xattrs of its first object
+static int readStriperLayout(librados::IoCtx *ioctx, const std::string &name,
+                             CephFile &layout, unsigned long long &size) {
+  static const char* attrNames[4] = {"striper.layout.stripe_unit",
+                                     "striper.layout.stripe_count",
+                                     "striper.layout.object_size",
+                                     "striper.size"};
+  ceph::bufferlist attrs[4];
+  int attrRcs[4];
+  librados::ObjectReadOperation op;
+  for (unsigned int i = 0; i < 4; i++) op.getxattr(attrNames[i], &attrs[i], &attrRcs[i]);
+  int rc = ioctx->operate(getObjectName(name, 0), &op, NULL);
+  if (rc) return rc;
+  unsigned long long values[4];
+  for (unsigned int i = 0; i < 4; i++) {
+    if (attrRcs[i] < 0) return attrRcs[i];
+    std::string value(attrs[i].c_str(), attrs[i].length());
+    values[i] = strtoull(value.c_str(), 0, 10);
+  }
+  layout.name = name;
+  layout.stripeUnit = values[0];
+  layout.nbStripes = values[1];
+  layout.objectSize = values[2];
+  size = values[3];
+  if (0 == layout.stripeUnit || 0 == layout.nbStripes || layout.objectSize < layout.stripeUnit) {
+    return -EINVAL;
+  }
+  return 0;
+}
+
+/// number of objects of a file of the given layout and size. Objects are
+/// filled in order within each object set, so they are numbered without gaps
+static unsigned long long objectCount(const CephFile &layout, unsigned long long size) {
+  if (0 == size) return 0;
+  unsigned long long su = layout.stripeUnit;
+  unsigned long long sc = layout.nbStripes;
+  unsigned long long stripesPerObject = layout.objectSize / su;
+  unsigned long long nbBlocks = (size + su - 1) / su;
+  unsigned long long count = 0;
+  for (unsigned long long blockNo = nbBlocks > sc ? nbBlocks - sc : 0; blockNo < nbBlocks; blockNo++) {
+    unsigned long long objectNo = (blockNo / sc / stripesPerObject) * sc + blockNo % sc;
+    count = std::max(count, objectNo + 1);
+  }
+  return count;
+}
+
+/// schedules the next batch of the background reclaimer, if needed, starting
+/// its thread on first use. g_reclaimCond must be held
+static void scheduleReclaim();
+
+/// whether unlinks and truncations of a file may be deferred, which needs a
+/// queue for its pool. Erasure coded pools need a metadata pool for that
+static bool reclaimEnabled(const CephFile &file) {
+  return g_reclaimMinSize > 0 && hasMetaPool(file);
+}
+
+/// registers a pool whose queue should be loaded, so that reclamations
+/// interrupted by a restart are resumed when the pool is used again
+static void reclaimWatchPool(const CephFile &file) {
+  if (!reclaimEnabled(file)) return;
+  XrdSysCondVarHelper lock(g_reclaimCond);
+  std::string key = reclaimPoolKey(file);
+  if (g_reclaimLoadedPools.count(key)) return;
+  g_reclaimPools[key] = reclaimFile(file);
+  scheduleReclaim();
+}
+
+/// adds a reclamation to the queue of its pool, before the file is modified
+static int reclaimEnqueue(const ReclaimItem &item) {
+  std::string oid;
+  librados::IoCtx *ioctx = getMetaIoCtx(item.file, g_reclaimQueueObject, oid);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  std::map<std::string, ceph::bufferlist> entry;
+  entry[item.file.name].append(encodeReclaim(item));
+  librados::ObjectWriteOperation op;
+  op.omap_set(entry);
+  return ioctx->operate(oid, &op);
+}
+
+/// asserts that the queue entry of a file still has the given value, so that
+/// a reclamation taken over or replaced by another gateway is left alone.
+/// The operation then fails with -ECANCELED
+static void reclaimAssert(librados::ObjectWriteOperation &op, const std::string &name,
+                          const std::string &expected) {
+  std::map<std::string, std::pair<ceph::bufferlist, int> > assertions;
+  assertions[name].first.append(expected);
+  assertions[name].second = LIBRADOS_CMPXATTR_OP_EQ;
+  op.omap_cmp(assertions, NULL);
+}
+
+/// removes the reclamation of a file from the queue of its pool, if its entry
+/// still has the expected value when one is given
+static int reclaimDequeue(const CephFile &file, const std::string *expected = 0) {
+  std::string oid;
+  librados::IoCtx *ioctx = getMetaIoCtx(file, g_reclaimQueueObject, oid);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  std::set<std::string> keys;
+  keys.insert(file.name);
+  librados::ObjectWriteOperation op;
+  if (expected) reclaimAssert(op, file.name, *expected);
+  op.omap_rm_keys(keys);
+  return ioctx->operate(oid, &op);
+}
+
+/// records the progress of a reclamation in the queue of its pool, provided
+/// its entry still has the expected value
+static int reclaimUpdate(const ReclaimItem &item, const std::string &expected) {
+  std::string oid;
+  librados::IoCtx *ioctx = getMetaIoCtx(item.file, g_reclaimQueueObject, oid);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  std::map<std::string, ceph::bufferlist> entry;
+  entry[item.file.name].append(encodeReclaim(item));
+  librados::ObjectWriteOperation op;
+  reclaimAssert(op, item.file.name, expected);
+  op.omap_set(entry);
+  return ioctx->operate(oid, &op);
+}
+
+/// starts the background removal of the objects of a reclamation
+static void reclaimStart(const ReclaimItem &item) {
+  __sync_fetch_and_add(&g_reclaimNbDeferred, 1);
+  XrdSysCondVarHelper lock(g_reclaimCond);
+  ReclaimItem &started = g_reclaimItems[reclaimPoolKey(item.file) + ':' + item.file.name];
+  started = item;
+  started.queued = encodeReclaim(item);
+  scheduleReclaim();
+}
+
+/// removes a range of objects of a file, with several removals in flight
+static int removeObjects(librados::IoCtx *ioctx, const std::string &name,
+                         unsigned long long first, unsigned long long end) {
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  if (0 == cluster) {
+    return -EINVAL;
+  }
+  std::deque<librados::AioCompletion*> inflight;
+  unsigned long long next = first;
+  int rc = 0;
+  while (!inflight.empty() || (0 == rc && next < end)) {
+    while (0 == rc && next < end && inflight.size() < g_reclaimSyncDepth) {
+      librados::AioCompletion *completion = cluster->aio_create_completion();
+      rc = ioctx->aio_remove(getObjectName(name, next), completion);
+      if (rc) {
+        completion->release();
+        break;
+      }
+      inflight.push_back(completion);
+      next++;
+    }
+    if (inflight.empty()) break;
+    librados::AioCompletion *completion = inflight.front();
+    inflight.pop_front();
+    completion->wait_for_complete();
+    int removeRc = completion->get_return_value();
+    completion->release();
+    // objects may have been removed already, or be holes
+    if (0 == rc && removeRc < 0 && removeRc != -ENOENT) rc = removeRc;
+  }
+  if (0 == rc) __sync_fetch_and_add(&g_reclaimNbObjects, end - first);
+  return rc;
+}
+
+/// checks that a queued reclamation was applied to its file, as a gateway may
+/// have stopped between queueing it and modifying the file, or the entry may
+/// be stale. The first object of an unlinked file must be gone, and a
+/// truncated file must not use the objects to remove
+static bool reclaimApplied(librados::IoCtx *ioctx, const ReclaimItem &item) {
+  CephFile layout;
+  unsigned long long size;
+  int rc = readStriperLayout(ioctx, item.file.name, layout, size);
+  if (-ENOENT == rc) return true;
+  if (rc) return false;
+  if (item.unlink) return false;
+  return objectCount(layout, size) <= item.next;
+}
+
+/// completes the pending reclamation of a file, if any, before the file may
+/// be recreated or extended, as the objects left would otherwise reappear
+static int reclaimSync(const CephFile &file) {
+  if (!reclaimEnabled(file)) return 0;
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  {
+    // take the reclamation over from the background reclaimer, once its
+    // removals in flight are over. It then stops updating the queue entry
+    XrdSysCondVarHelper lock(g_reclaimCond);
+    std::string key = reclaimPoolKey(file) + ':' + file.name;
+    std::map<std::string, ReclaimItem>::iterator it = g_reclaimItems.find(key);
+    while (it != g_reclaimItems.end() && it->second.inflight > 0) {
+      g_reclaimCond.Wait();
+      it = g_reclaimItems.find(key);
+    }
+    if (it != g_reclaimItems.end()) g_reclaimItems.erase(it);
+  }
+  // the queue is shared by all gateways using the pool
+  std::string oid;
+  librados::IoCtx *queueIoctx = getMetaIoCtx(file, g_reclaimQueueObject, oid);
+  if (0 == queueIoctx) {
+    return -EINVAL;
+  }
+  std::set<std::string> keys;
+  keys.insert(file.name);
+  std::map<std::string, ceph::bufferlist> values;
+  int lookupRc = 0;
+  librados::ObjectReadOperation op;
+  op.omap_get_vals_by_keys(keys, &values, &lookupRc);
+  int rc = queueIoctx->operate(oid, &op, NULL);
+  if (-ENOENT == rc) return 0;
+  if (0 == rc) rc = lookupRc;
+  if (rc) return rc;
+  if (values.empty()) return 0;
+  ReclaimItem item;
+  item.file = file;
+  if (decodeReclaim(values.begin()->second, item) && reclaimApplied(ioctx, item)) {
+    rc = removeObjects(ioctx, file.name, item.next, item.end);
+    if (rc) return rc;
+    __sync_fetch_and_add(&g_reclaimNbSync, 1);
+  }
+  return reclaimDequeue(file);
+}
+
+/// loads the queue of a pool, resuming the reclamations it holds
+static void reclaimLoad(const CephFile &pool) {
+  librados::IoCtx *ioctx = getIoCtx(pool);
+  std::string oid;
+  librados::IoCtx *queueIoctx = getMetaIoCtx(pool, g_reclaimQueueObject, oid);
+  if (0 == ioctx || 0 == queueIoctx) return;
+  std::string after;
+  bool more = true;
+  while (more) {
+    std::map<std::string, ceph::bufferlist> values;
+    int rc = queueIoctx->omap_get_vals2(oid, after, 1024, &values, &more);
+    if (rc) {
+      if (rc != -ENOENT) {
+        logwrapper((char*)"reclaimLoad : unable to read the queue of pool %s, rc = %d",
+                   pool.pool.c_str(), rc);
+      }
+      return;
+    }
+    for (std::map<std::string, ceph::bufferlist>::iterator it = values.begin();
+         it != values.end();
+         it++) {
+      after = it->first;
+      ReclaimItem item;
+      item.file = pool;
+      item.file.name = it->first;
+      std::string key = reclaimPoolKey(pool) + ':' + it->first;
+      {
+        XrdSysCondVarHelper lock(g_reclaimCond);
+        if (g_reclaimItems.count(key)) continue;
+      }
+      if (!decodeReclaim(it->second, item) || !reclaimApplied(ioctx, item)) {
+        logwrapper((char*)"reclaimLoad : dropping stale reclamation of %s", it->first.c_str());
+        reclaimDequeue(item.file);
+        continue;
+      }
+      item.queued = it->second.to_str();
+      XrdSysCondVarHelper lock(g_reclaimCond);
+      if (0 == g_reclaimItems.count(key)) g_reclaimItems[key] = item;
+    }
+  }
+}
+
+/// removal of an object by the background reclaimer
+struct ReclaimRemoval {
+  ReclaimRemoval(const std::string &k) : key(k) {}
+  std::string key;
+};
+
+static void reclaimRemovalComplete(rados_completion_t c, void *arg) {
+  ReclaimRemoval *removal = reinterpret_cast<ReclaimRemoval*>(arg);
+  __sync_fetch_and_add(&g_reclaimNbObjects, 1);
+  {
+    XrdSysCondVarHelper lock(g_reclaimCond);
+    std::map<std::string, ReclaimItem>::iterator it = g_reclaimItems.find(removal->key);
+    if (it != g_reclaimItems.end() && it->second.inflight > 0) {
+      it->second.inflight--;
+      if (0 == it->second.inflight) g_reclaimCond.Broadcast();
+    }
+  }
+  delete removal;
+}
+
+/// batch of the background reclaimer, run periodically by its thread. It loads
+/// the queues of new pools, then removes objects at the configured rate, one
+/// batch per reclamation at a time, recording the progress of each batch in the queue
+static void reclaimTick() {
+  std::vector<CephFile> pools;
+  {
+    XrdSysCondVarHelper lock(g_reclaimCond);
+    for (std::map<std::string, CephFile>::const_iterator it = g_reclaimPools.begin();
+         it != g_reclaimPools.end();
+         it++) {
+      pools.push_back(it->second);
+      g_reclaimLoadedPools.insert(it->first);
+    }
+    g_reclaimPools.clear();
+  }
+  for (std::vector<CephFile>::const_iterator it = pools.begin(); it != pools.end(); it++) {
+    reclaimLoad(*it);
+  }
+  unsigned long long budget = std::max(1ULL, (unsigned long long)g_reclaimObjectsPerSecond *
+                                       g_reclaimPeriodMs / 1000);
+  std::vector<std::pair<std::string, ReclaimItem> > batches;
+  std::vector<ReclaimItem> done;
+  {
+    XrdSysCondVarHelper lock(g_reclaimCond);
+    std::map<std::string, ReclaimItem>::iterator it = g_reclaimItems.begin();
+    while (it != g_reclaimItems.end() && budget > 0) {
+      ReclaimItem &item = it->second;
+      if (item.inflight > 0) {
+        it++;
+        continue;
+      }
+      if (item.next >= item.end) {
+        done.push_back(item);
+        g_reclaimItems.erase(it++);
+        continue;
+      }
+      unsigned long long n = std::min(budget, item.end - item.next);
+      // the batch starts where the previous, completed, one ended
+      batches.push_back(std::pair<std::string, ReclaimItem>(it->first, item));
+      batches.back().second.end = item.next + n;
+      item.next += n;
+      item.inflight = n;
+      budget -= n;
+      it++;
+    }
+  }
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  for (std::vector<ReclaimItem>::const_iterator it = done.begin(); it != done.end(); it++) {
+    reclaimDequeue(it->file, &it->queued);
+    __sync_fetch_and_add(&g_reclaimNbDone, 1);
+  }
+  for (size_t i = 0; i < batches.size(); i++) {
+    const std::string &key = batches[i].first;
+    ReclaimItem &batch = batches[i].second;
+    librados::IoCtx *ioctx = getIoCtx(batch.file);
+    unsigned long long end = 0;
+    std::string queued;
+    {
+      XrdSysCondVarHelper lock(g_reclaimCond);
+      std::map<std::string, ReclaimItem>::iterator it = g_reclaimItems.find(key);
+      if (it == g_reclaimItems.end()) continue;
+      end = it->second.end;
+      queued = it->second.queued;
+    }
+    // the entry may have been taken over by another gateway since the last
+    // batch, e.g. to recreate the file, so both the file and the entry are
+    // checked again before removing anything. The item is not modified by
+    // reclaimSync while its batch is in flight, so the lock is not needed
+    ReclaimItem progress = batch;
+    progress.end = end;
+    int rc = -EINVAL;
+    if (ioctx && cluster) {
+      rc = reclaimApplied(ioctx, progress) ? reclaimUpdate(progress, queued) : -ECANCELED;
+    }
+    if (rc) {
+      XrdSysCondVarHelper lock(g_reclaimCond);
+      std::map<std::string, ReclaimItem>::iterator it = g_reclaimItems.find(key);
+      if (it != g_reclaimItems.end()) {
+        if (-ECANCELED == rc) {
+          logwrapper((char*)"reclaimTick : reclamation of %s taken over, dropping it",
+                     batch.file.name.c_str());
+          g_reclaimItems.erase(it);
+        } else {
+          // retried at the next tick
+          it->second.next = batch.next;
+          it->second.inflight = 0;
+        }
+        g_reclaimCond.Broadcast();
+      }
+      continue;
+    }
+    {
+      XrdSysCondVarHelper lock(g_reclaimCond);
+      std::map<std::string, ReclaimItem>::iterator it = g_reclaimItems.find(key);
+      if (it != g_reclaimItems.end()) it->second.queued = encodeReclaim(progress);
+    }
+    for (unsigned long long objectNo = batch.next; objectNo < batch.end; objectNo++) {
+      ReclaimRemoval *removal = new ReclaimRemoval(key);
+      librados::AioCompletion *completion =
+        cluster->aio_create_completion(removal, reclaimRemovalComplete, NULL);
+      if (ioctx->aio_remove(getObjectName(batch.file.name, objectNo), completion)) {
+        // counts as done, the object will be removed by a later reclamation if any
+        reclaimRemovalComplete(0, removal);
+      }
+      completion->release();
+    }
+  }
+}
+
+/// entry point of the thread of the background reclaimer. Its batches do
+/// synchronous RADOS operations, so they do not run on the timer thread, which
+/// only wakes this one up
+static void* reclaimWorker(void*) {
+  XrdSysCondVarHelper lock(g_reclaimCond);
+  while (!g_cephShutdown) {
+    if (!g_reclaimDue) {
+      g_reclaimCond.WaitMS(1000);
+      continue;
+    }
+    g_reclaimDue = false;
+    lock.UnLock();
+    reclaimTick();
+    lock.Lock(&g_reclaimCond);
+    scheduleReclaim();
+  }
+  return 0;
+}
+
+/// called by the timer when the next batch of the reclaimer is due
+static void reclaimWake(void*) {
+  XrdSysCondVarHelper lock(g_reclaimCond);
+  g_reclaimScheduled = false;
+  g_reclaimDue = true;
+  g_reclaimCond.Broadcast();
+}
+
+static void scheduleReclaim() {
+  if (g_reclaimScheduled || g_reclaimDue ||
+      (g_reclaimItems.empty() && g_reclaimPools.empty())) return;
+  if (!g_reclaimWorkerStarted) {
+    pthread_t tid;
+    int rc = XrdSysThread::Run(&tid, reclaimWorker, 0, 0, "ceph reclaimer");
+    if (rc) {
+      logwrapper((char*)"scheduleReclaim : unable to create thread, rc = %d", rc);
+      return;
+    }
+    g_reclaimWorkerStarted = true;
+  }
+  XrdCephTimer *timer = getTimer();
+  if (timer && timer->schedule(g_reclaimPeriodMs, reclaimWake, 0)) g_reclaimScheduled = true;
+}
+
+/// defers the unlink of a large file : its first object, holding its layout
+/// and size, is removed at once, and the others are queued for the reclaimer
+/// returns false when the unlink is not deferred, otherwise rc is its result
+static bool deferUnlink(const CephFile &file, int &rc) {
+  if (!reclaimEnabled(file)) return false;
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) return false;
+  CephFile layout;
+  unsigned long long size;
+  if (readStriperLayout(ioctx, file.name, layout, size) || size < g_reclaimMinSize) return false;
+  ReclaimItem item;
+  item.file = reclaimFile(file);
+  item.unlink = true;
+  item.next = 1;
+  item.end = objectCount(layout, size);
+  rc = reclaimEnqueue(item);
+  if (rc) return true;
+  rc = ioctx->remove(getObjectName(file.name, 0));
+  if (rc) {
+    reclaimDequeue(item.file);
+    return true;
+  }
+  reclaimStart(item);
+  return true;
+}
+
+/// defers the part of a large truncation removing whole objects : the objects
+/// of the last object set kept are truncated and the size is updated at once,
+/// the objects beyond are queued for the reclaimer
+/// returns false when the truncation is not deferred, otherwise rc is its result
+static bool deferTruncate(const CephFile &file, unsigned long long size, int &rc) {
+  if (!reclaimEnabled(file)) return false;
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) return false;
+  CephFile layout;
+  unsigned long long oldSize;
+  if (readStriperLayout(ioctx, file.name, layout, oldSize) ||
+      size >= oldSize || oldSize - size < g_reclaimMinSize) return false;
+  unsigned long long newCount = std::max(1ULL, objectCount(layout, size));
+  unsigned long long oldCount = objectCount(layout, oldSize);
+  if (oldCount <= newCount) return false;
+  ReclaimItem item;
+  item.file = reclaimFile(file);
+  item.next = newCount;
+  item.end = oldCount;
+  rc = reclaimEnqueue(item);
+  if (rc) return true;
+  invalidateCaches(file);
+  rc = truncatePageChecksums(file, size);
+  if (rc) return true;
+  // lengths of the objects of the last object set kept
+  unsigned long long sc = layout.nbStripes;
+  unsigned long long setStart = (newCount - 1) / sc * sc;
+  unsigned long long setOffset = setStart * layout.objectSize;
+  std::vector<ObjectExtent> extents;
+  getObjectExtents(layout, setOffset, size - setOffset, extents);
+  std::vector<unsigned long long> lengths(newCount - setStart, 0);
+  for (std::vector<ObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+    unsigned long long &length = lengths[it->objectNo - setStart];
+    length = std::max(length, it->objectOffset + it->length);
+  }
+  for (unsigned long long objectNo = std::max(setStart, 1ULL); objectNo < newCount; objectNo++) {
+    librados::ObjectWriteOperation op;
+    op.assert_exists();
+    op.truncate(lengths[objectNo - setStart]);
+    rc = ioctx->operate(getObjectName(file.name, objectNo), &op);
+    if (rc && rc != -ENOENT) return true;
+  }
+  // the first object is updated last, as it holds the size
+  librados::ObjectWriteOperation op;
+  if (0 == setStart) op.truncate(lengths[0]);
+  ceph::bufferlist sizeBl;
+  std::ostringstream sizeStr;
+  sizeStr << size;
+  sizeBl.append(sizeStr.str());
+  op.setxattr("striper.size", sizeBl);
+  rc = ioctx->operate(getObjectName(file.name, 0), &op);
+  if (rc) return true;
+  reclaimStart(item);
+  return true;
+}
+
+/// appends the statistics of reclamations to a stream
+static void reclaimStats(std::ostringstream &ss) {
+  if (0 == g_reclaimMinSize) return;
+  size_t pending;
+  {
+    XrdSysCondVarHelper lock(g_reclaimCond);
+    pending = g_reclaimItems.size();
+  }
+  ss << "<reclaim>"
+     << "<deferred>" << g_reclaimNbDeferred << "</deferred>"
+     << "<pending>" << pending << "</pending>"
+     << "<done>" << g_reclaimNbDone << "</done>"
+     << "<sync>" << g_reclaimNbSync << "</sync>"
+     << "<objects>" << g_reclaimNbObjects << "</objects>"
+     << "</reclaim>";
+}
+
+/// tiering of pools : files of a pool which are not opened any more move to a
+/// cold pool, typically erasure coded, and come back when opened again often
+/// enough. A file moved to the cold pool leaves its first object behind, with
+/// its xattrs and omap but without data, and an xattr naming the cold pool.
+/// Names, sizes and xattrs thus stay where they were, only reads are redirected
+struct Tier {
+  Tier() : promoteOpens(0), demoteDays(0), active(false), scanning(false), nextScanMs(0),
+           nbRedirects(0), nbPromotions(0), nbDemotions(0), nbCleanups(0), nbFailures(0) {}
+  std::string coldPool;
+  /// number of recent opens after which a file is moved back from the cold pool
+  unsigned int promoteOpens;
+  /// number of days without opens after which a file is moved to the cold pool
+  unsigned int demoteDays;
+  /// file of the pool used by the migrations, known once the pool is used
+  CephFile poolFile;
+  bool active;
+  /// scan of the pool, looking for files to move or to clean up
+  librados::ObjectCursor cursor;
+  bool scanning;
+  unsigned long long nextScanMs;
+  unsigned long long nbRedirects;
+  unsigned long long nbPromotions;
+  unsigned long long nbDemotions;
+  unsigned long long nbCleanups;
+  unsigned long long nbFailures;
+};
+/// tiers, by pool
+/// may be overwritten in the configuration file
+/// (See XrdCephOss::configure)
+std::map<std::string, Tier> g_tiers;
+/// recent opens of files of the cold pools, halved every day
+struct TierHeat {
+  double heat;
+  unsigned long long lastMs;
+};
+std::map<std::string, TierHeat> g_tierHeat;
+static const size_t g_tierMaxHeatEntries = 100000;
+/// files waiting to be moved back, and files being moved by this gateway
+std::deque<CephFile> g_tierPromotions;
+std::set<std::string> g_tierQueued;
+std::set<std::string> g_tierMoving;
+bool g_tierWorkerStarted = false;
+/// protects all tiering variables above, except the scans
+XrdSysCondVar g_tierCond;
+/// xattr naming the pool holding the data of a file
+static const char g_tierXattr[] = "xrdceph.tier";
+/// xattr holding the time of the last move of a file, until the copy it was
+/// moved from is removed
+static const char g_tierSinceXattr[] = "xrdceph.tier.since";
+/// xattr holding the time of the last open of a file, refreshed at most daily
+static const char g_tierAtimeXattr[] = "xrdceph.tier.atime";
+/// xattr holding the write generation of a file, changed when the file is
+/// opened for writing and when it is closed after being written. It is removed
+/// when the file is moved to the cold pool, so that writes from any gateway
+/// during or after the move are detected. It holds g_tierCleanupMark while
+/// the data left in the pool after a move are being removed
+static const char g_tierWgenXattr[] = "xrdceph.tier.wgen";
+static const char g_tierCleanupMark[] = "cleanup";
+/// number of write generations created by this gateway
+unsigned long long g_tierNbWgens = 0;
+/// time during which files opened before a move may still read the copy they
+/// were moved from, or write it and have the move undone, in seconds. This is also the time between two scans of a pool
+static const unsigned int g_tierGraceSeconds = 3600;
+/// number of objects listed by each step of a scan
+static const unsigned int g_tierScanBatch = 100;
+
+int ceph_posix_set_tiering(const char *pool, const char *coldPool,
+                           unsigned int promoteOpens, unsigned int demoteDays) {
+  if (0 == promoteOpens || 0 == demoteDays || !strcmp(pool, coldPool) ||
+      g_tiers.count(coldPool)) {
+    return -EINVAL;
+  }
+  for (std::map<std::string, Tier>::const_iterator it = g_tiers.begin(); it != g_tiers.end(); it++) {
+    if (it->second.coldPool == pool) return -EINVAL;
+  }
+  Tier &tier = g_tiers[pool];
+  tier.coldPool = coldPool;
+  tier.promoteOpens = promoteOpens;
+  tier.demoteDays = demoteDays;
+  return 0;
+}
+
+/// tiering xattrs of a file, read from its first object
+struct TierState {
+  TierState() : atime(0), since(0) {}
+  /// pool holding the data, empty when they are in the pool of the file
+  std::string coldPool;
+  time_t atime;
+  time_t since;
+  /// raw size and write generation of the file, used to detect
+  /// modifications during and after a move
+  ceph::bufferlist size;
+  ceph::bufferlist wgen;
+};
+
+static int readTierState(librados::IoCtx *ioctx, const std::string &name, TierState &state) {
+  // missing xattrs would fail a compound operation, so all of them are fetched
+  std::map<std::string, ceph::bufferlist> attrs;
+  int rc = ioctx->getxattrs(getObjectName(name, 0), attrs);
+  if (rc < 0) return rc;
+  std::map<std::string, ceph::bufferlist>::iterator it = attrs.find(g_tierXattr);
+  if (it != attrs.end()) state.coldPool.assign(it->second.c_str(), it->second.length());
+  it = attrs.find(g_tierAtimeXattr);
+  if (it != attrs.end()) {
+    state.atime = strtoull(std::string(it->second.c_str(), it->second.length()).c_str(), 0, 10);
+  }
+  it = attrs.find(g_tierSinceXattr);
+  if (it != attrs.end()) {
+    state.since = strtoull(std::string(it->second.c_str(), it->second.length()).c_str(), 0, 10);
+  }
+  it = attrs.find("striper.size");
+  if (it != attrs.end()) state.size = it->second;
+  it = attrs.find(g_tierWgenXattr);
+  if (it != attrs.end()) state.wgen = it->second;
+  return 0;
+}
+
+/// whether the data left in the pool after a move are being removed
+static bool tierCleaningUp(const TierState &state) {
+  return state.wgen.to_str() == g_tierCleanupMark;
+}
+
+/// a new write generation, unique across gateways
+static ceph::bufferlist tierNewWgen() {
+  std::ostringstream ss;
+  ss << XrdCephTimer::nowMs() << '.' << getpid() << '.'
+     << __sync_fetch_and_add(&g_tierNbWgens, 1);
+  ceph::bufferlist bl;
+  bl.append(ss.str());
+  return bl;
+}
+
+static ceph::bufferlist tierTimeValue(time_t t) {
+  std::ostringstream ss;
+  ss << t;
+  ceph::bufferlist bl;
+  bl.append(ss.str());
+  return bl;
+}
+
+/// the copy of a file in a cold pool
+static CephFile tierColdFile(const CephFile &file, const std::string &coldPool) {
+  CephFile cold = file;
+  cold.pool = coldPool;
+  return cold;
+}
+
+/// removes the copy of a file in a cold pool, deferring it when large unless
+/// deferred is false, e.g. when the copy is about to be made again
+static int tierRemoveCopy(const CephFile &cold, bool deferred = true) {
+  libradosstriper::RadosStriper *striper = getRadosStriper(cold);
+  if (0 == striper) {
+    return -EINVAL;
+  }
+  invalidateCaches(cold);
+  int rc;
+  if (!deferred) {
+    // a pending reclamation would otherwise remove the objects of the new copy
+    rc = reclaimSync(cold);
+    if (rc) return rc;
+  }
+  if (!deferred || !deferUnlink(cold, rc)) rc = striper->remove(cold.name);
+  return -ENOENT == rc ? 0 : rc;
+}
+
+/// marks a file as being moved by this gateway, waiting for any move in
+/// progress unless wait is false. Returns whether the file was marked
+static bool tierLockFile(const std::string &key, bool wait) {
+  XrdSysCondVarHelper lock(g_tierCond);
+  while (g_tierMoving.count(key)) {
+    if (!wait) return false;
+    g_tierCond.Wait();
+  }
+  g_tierMoving.insert(key);
+  return true;
+}
+
+static void tierUnlockFile(const std::string &key, Tier &tier, int rc) {
+  XrdSysCondVarHelper lock(g_tierCond);
+  g_tierMoving.erase(key);
+  // a file modified or removed during the move is not a failure
+  if (rc && rc != -ENOENT && rc != -ECANCELED) tier.nbFailures++;
+  g_tierCond.Broadcast();
+}
+
+static int copyObjects(const CephFile &src, const CephFile &dst, unsigned long long count,
+                       bool firstObject = true);
+
+/// moves a file to the cold pool. The copy made, the first object is switched
+/// to a pointer at once, provided neither the size nor the write generation of
+/// the file changed meanwhile. The write generation is then removed, so that
+/// handles opened before the switch and written since are detected by the
+/// cleanup. The data left in the pool are only removed after the grace period
+static int tierDemote(const CephFile &file, Tier &tier, const TierState &state) {
+  std::string name = file.name;
+  if (isOpenForWrite(name)) return 0;
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  CephFile layout;
+  unsigned long long size;
+  int rc = readStriperLayout(ioctx, file.name, layout, size);
+  if (rc) return rc;
+  // a copy left behind by an interrupted move is replaced, at once as the
+  // objects of the new copy have the same names
+  CephFile cold = tierColdFile(file, tier.coldPool);
+  rc = tierRemoveCopy(cold, false);
+  if (rc) return rc;
+  rc = copyObjects(file, cold, std::max(1ULL, objectCount(layout, size)));
+  if (rc) return rc;
+  ceph::bufferlist pointer;
+  pointer.append(tier.coldPool);
+  librados::ObjectWriteOperation op;
+  op.cmpxattr("striper.size", LIBRADOS_CMPXATTR_OP_EQ, state.size);
+  op.cmpxattr(g_tierWgenXattr, LIBRADOS_CMPXATTR_OP_EQ, state.wgen);
+  op.setxattr(g_tierXattr, pointer);
+  op.setxattr(g_tierSinceXattr, tierTimeValue(time(NULL)));
+  if (state.wgen.length()) op.rmxattr(g_tierWgenXattr);
+  rc = ioctx->operate(getObjectName(file.name, 0), &op);
+  if (rc) {
+    tierRemoveCopy(cold);
+    return rc;
+  }
+  invalidateCaches(file);
+  XrdSysCondVarHelper lock(g_tierCond);
+  tier.nbDemotions++;
+  return 0;
+}
+
+/// moves a file back from the cold pool, if it is there. The data of the
+/// first object are written together with the removal of the pointer, so that
+/// readers switch back at once, provided no cleanup started or ended meanwhile
+/// as it would have removed some of the objects copied. The cold copy is
+/// removed after the grace period
+static int tierPromoteFile(const CephFile &file, Tier &tier) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  TierState state;
+  int rc = readTierState(ioctx, file.name, state);
+  if (-ENOENT == rc) return 0;
+  if (rc) return rc;
+  if (state.coldPool.empty()) return 0;
+  CephFile cold = tierColdFile(file, state.coldPool);
+  librados::IoCtx *coldIoctx = getIoCtx(cold);
+  if (0 == coldIoctx) {
+    return -EINVAL;
+  }
+  CephFile layout;
+  unsigned long long size;
+  rc = readStriperLayout(coldIoctx, file.name, layout, size);
+  if (rc) return rc;
+  rc = copyObjects(cold, file, std::max(1ULL, objectCount(layout, size)), false);
+  if (rc) return rc;
+  ceph::bufferlist data;
+  rc = coldIoctx->read(getObjectName(file.name, 0), data, layout.objectSize, 0);
+  if (rc < 0) return rc;
+  ceph::bufferlist pointer;
+  pointer.append(state.coldPool);
+  time_t now = time(NULL);
+  librados::ObjectWriteOperation op;
+  op.cmpxattr(g_tierXattr, LIBRADOS_CMPXATTR_OP_EQ, pointer);
+  op.cmpxattr(g_tierWgenXattr, LIBRADOS_CMPXATTR_OP_EQ, state.wgen);
+  op.write_full(data);
+  op.rmxattr(g_tierXattr);
+  op.setxattr(g_tierSinceXattr, tierTimeValue(now));
+  op.setxattr(g_tierAtimeXattr, tierTimeValue(now));
+  op.setxattr(g_tierWgenXattr, tierNewWgen());
+  rc = ioctx->operate(getObjectName(file.name, 0), &op);
+  if (rc) return rc;
+  invalidateCaches(file);
+  invalidateCaches(cold);
+  XrdSysCondVarHelper lock(g_tierCond);
+  tier.nbPromotions++;
+  return 0;
+}
+
+/// removes the copy a file was moved from, once the grace period is over.
+/// For a file moved to the cold pool, the cleanup is first recorded in its
+/// write generation, so that moves back from other gateways fail rather than
+/// copy objects being removed. A file written since its move is moved back
+/// instead, as its data in the pool are the most recent ones
+static int tierCleanup(const CephFile &file, Tier &tier, const TierState &state) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  librados::ObjectWriteOperation op;
+  op.cmpxattr(g_tierSinceXattr, LIBRADOS_CMPXATTR_OP_EQ, tierTimeValue(state.since));
+  if (state.coldPool.empty()) {
+    // moved back : the cold copy goes
+    int rc = tierRemoveCopy(tierColdFile(file, tier.coldPool));
+    if (rc) return rc;
+  } else {
+    ceph::bufferlist pointer;
+    pointer.append(state.coldPool);
+    ceph::bufferlist mark;
+    mark.append(g_tierCleanupMark);
+    op.cmpxattr(g_tierXattr, LIBRADOS_CMPXATTR_OP_EQ, pointer);
+    if (state.wgen.length() && !tierCleaningUp(state)) {
+      // written since the move : the pointer goes, and the cold copy later
+      op.cmpxattr(g_tierWgenXattr, LIBRADOS_CMPXATTR_OP_EQ, state.wgen);
+      op.rmxattr(g_tierXattr);
+      op.setxattr(g_tierSinceXattr, tierTimeValue(time(NULL)));
+      int rc = ioctx->operate(getObjectName(file.name, 0), &op);
+      if (rc) return rc;
+      logwrapper((char*)"tierCleanup : %s was written after its move, moving it back",
+                 file.name.c_str());
+      invalidateCaches(file);
+      XrdSysCondVarHelper lock(g_tierCond);
+      tier.nbPromotions++;
+      return 0;
+    }
+    if (!tierCleaningUp(state)) {
+      librados::ObjectWriteOperation markOp;
+      markOp.cmpxattr(g_tierXattr, LIBRADOS_CMPXATTR_OP_EQ, pointer);
+      markOp.cmpxattr(g_tierWgenXattr, LIBRADOS_CMPXATTR_OP_EQ, state.wgen);
+      markOp.setxattr(g_tierWgenXattr, mark);
+      int rc = ioctx->operate(getObjectName(file.name, 0), &markOp);
+      if (rc) return rc;
+    }
+    // moved to the cold pool : only the xattrs of the first object stay
+    CephFile layout;
+    unsigned long long size;
+    int rc = readStriperLayout(ioctx, file.name, layout, size);
+    if (rc) return rc;
+    rc = removeObjects(ioctx, file.name, 1, objectCount(layout, size));
+    if (rc) return rc;
+    op.cmpxattr(g_tierWgenXattr, LIBRADOS_CMPXATTR_OP_EQ, mark);
+    op.truncate(0);
+    op.rmxattr(g_tierWgenXattr);
+  }
+  op.rmxattr(g_tierSinceXattr);
+  int rc = ioctx->operate(getObjectName(file.name, 0), &op);
+  if (rc) return rc;
+  XrdSysCondVarHelper lock(g_tierCond);
+  tier.nbCleanups++;
+  return 0;
+}
+
+/// checks a file found by the scan of its pool, cleaning up after its last
+/// move or moving it to the cold pool when not opened for long enough
+static void tierCheck(const CephFile &file, Tier &tier) {
+  std::string key = fileCacheKey(file);
+  if (!tierLockFile(key, false)) return;
+  librados::IoCtx *ioctx = getIoCtx(file);
+  TierState state;
+  int rc = ioctx ? readTierState(ioctx, file.name, state) : -EINVAL;
+  time_t now = time(NULL);
+  if (0 == rc) {
+    if (state.since) {
+      if (now - state.since >= (time_t)g_tierGraceSeconds) rc = tierCleanup(file, tier, state);
+    } else if (state.coldPool.empty()) {
+      if (0 == state.atime) {
+        // files never opened since tiering was enabled start from now
+        ceph::bufferlist bl = tierTimeValue(now);
+        rc = ioctx->setxattr(getObjectName(file.name, 0), g_tierAtimeXattr, bl);
+      } else if (now - state.atime >= (time_t)tier.demoteDays * 86400) {
+        rc = tierDemote(file, tier, state);
+      }
+    }
+  }
+  tierUnlockFile(key, tier, rc);
+}
+
+/// number of attempts to move a file back, when cleanups get in the way
+static const unsigned int g_tierPromoteAttempts = 3;
+
+/// moves a file back from the cold pool, waiting for any move in progress
+static int tierPromote(const CephFile &file) {
+  std::map<std::string, Tier>::iterator it = g_tiers.find(file.pool);
+  if (it == g_tiers.end()) return 0;
+  std::string key = fileCacheKey(file);
+  tierLockFile(key, true);
+  int rc = -ECANCELED;
+  for (unsigned int i = 0; i < g_tierPromoteAttempts && -ECANCELED == rc; i++) {
+    rc = tierPromoteFile(file, it->second);
+  }
+  tierUnlockFile(key, it->second, rc);
+  return rc;
+}
+
+/// changes the write generation of a file of a tiered pool, if it exists
+static void tierMarkWrite(const CephFile &file) {
+  if (0 == g_tiers.count(file.pool)) return;
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) return;
+  librados::ObjectWriteOperation op;
+  op.assert_exists();
+  op.setxattr(g_tierWgenXattr, tierNewWgen());
+  int rc = ioctx->operate(getObjectName(file.name, 0), &op);
+  if (rc && rc != -ENOENT) {
+    logwrapper((char*)"tierMarkWrite : unable to mark %s, rc = %d", file.name.c_str(), rc);
+  }
+}
+
+/// goes on with the scan of the tiered pools, checking a batch of files
+/// returns false when no scan is due
+static bool tierScanStep() {
+  for (std::map<std::string, Tier>::iterator it = g_tiers.begin(); it != g_tiers.end(); it++) {
+    Tier &tier = it->second;
+    CephFile poolFile;
+    {
+      XrdSysCondVarHelper lock(g_tierCond);
+      if (!tier.active || XrdCephTimer::nowMs() < tier.nextScanMs) continue;
+      poolFile = tier.poolFile;
+    }
+    librados::IoCtx *ioctx = getIoCtx(poolFile);
+    if (0 == ioctx) continue;
+    if (!tier.scanning) {
+      tier.cursor = ioctx->object_list_begin();
+      tier.scanning = true;
+    }
+    std::vector<librados::ObjectItem> items;
+    librados::ObjectCursor next;
+    int rc = ioctx->object_list(tier.cursor, ioctx->object_list_end(), g_tierScanBatch,
+                                ceph::bufferlist(), &items, &next);
+    if (rc < 0) {
+      logwrapper((char*)"tierScanStep : listing of pool %s failed, rc = %d",
+                 poolFile.pool.c_str(), rc);
+    }
+    for (std::vector<librados::ObjectItem>::const_iterator oit = items.begin();
+         oit != items.end() && !g_cephShutdown; oit++) {
+      const std::string &oid = oit->oid;
+      if (oid.size() > g_firstObjectSuffixLen &&
+          0 == oid.compare(oid.size() - g_firstObjectSuffixLen,
+                           g_firstObjectSuffixLen, g_firstObjectSuffix)) {
+        CephFile file = poolFile;
+        file.name = oid.substr(0, oid.size() - g_firstObjectSuffixLen);
+        tierCheck(file, tier);
+      }
+    }
+    tier.cursor = next;
+    if (rc < 0 || ioctx->object_list_is_end(next)) {
+      tier.scanning = false;
+      XrdSysCondVarHelper lock(g_tierCond);
+      tier.nextScanMs = XrdCephTimer::nowMs() + g_tierGraceSeconds * 1000ULL;
+    }
+    return true;
+  }
+  return false;
+}
+
+/// entry point of the thread moving files between tiers. Promotions go first,
+/// as clients are waiting for them
+static void* tierWorker(void*) {
+  while (!g_cephShutdown) {
+    CephFile file;
+    bool promote = false;
+    {
+      XrdSysCondVarHelper lock(g_tierCond);
+      if (!g_tierPromotions.empty()) {
+        file = g_tierPromotions.front();
+        g_tierPromotions.pop_front();
+        g_tierQueued.erase(fileCacheKey(file));
+        promote = true;
+      }
+    }
+    if (promote) {
+      tierPromote(file);
+    } else if (!tierScanStep()) {
+      XrdSysCondVarHelper lock(g_tierCond);
+      if (g_tierPromotions.empty() && !g_cephShutdown) g_tierCond.WaitMS(1000);
+    }
+  }
+  return 0;
+}
+
+/// registers a tiered pool for the scans, starting the migration thread on first use
+static void tierWatchPool(const CephFile &file) {
+  std::map<std::string, Tier>::iterator it = g_tiers.find(file.pool);
+  if (it == g_tiers.end()) return;
+  XrdSysCondVarHelper lock(g_tierCond);
+  if (it->second.active) return;
+  if (!g_tierWorkerStarted) {
+    pthread_t tid;
+    int rc = XrdSysThread::Run(&tid, tierWorker, 0, 0, "ceph tiering");
+    if (rc) {
+      logwrapper((char*)"tierWatchPool : unable to create thread, rc = %d", rc);
+      return;
+    }
+    g_tierWorkerStarted = true;
+  }
+  it->second.poolFile = reclaimFile(file);
+  it->second.poolFile.name = "/";
+  it->second.active = true;
+}
+
+/// counts an open of a file of a cold pool, queueing its move back when
+/// opened often enough. g_tierCond must be held
+static void tierRecordOpen(const CephFile &file, const Tier &tier) {
+  std::string key = fileCacheKey(file);
+  unsigned long long now = XrdCephTimer::nowMs();
+  if (g_tierHeat.size() >= g_tierMaxHeatEntries && 0 == g_tierHeat.count(key)) {
+    // forget the files which cooled down, or all of them if none did
+    std::map<std::string, TierHeat>::iterator it = g_tierHeat.begin();
+    while (it != g_tierHeat.end()) {
+      if (now - it->second.lastMs > 86400000ULL) g_tierHeat.erase(it++);
+      else it++;
+    }
+    if (g_tierHeat.size() >= g_tierMaxHeatEntries) g_tierHeat.clear();
+  }
+  TierHeat &th = g_tierHeat[key];
+  th.heat = th.heat * pow(0.5, (now - th.lastMs) / 86400000.0) + 1;
+  th.lastMs = now;
+  if (th.heat >= tier.promoteOpens && 0 == g_tierQueued.count(key)) {
+    g_tierHeat.erase(key);
+    g_tierQueued.insert(key);
+    g_tierPromotions.push_back(file);
+    g_tierCond.Signal();
+  }
+}
+
+/// points a file of a tiered pool to the pool holding its data
+static void tierDataFile(CephFile &file) {
+  if (0 == g_tiers.count(file.pool)) return;
+  librados::IoCtx *ioctx = getIoCtx(file);
+  TierState state;
+  if (0 == ioctx || readTierState(ioctx, file.name, state)) return;
+  if (!state.coldPool.empty()) file.pool = state.coldPool;
+}
+
+/// points a file opened for reading to the pool holding its data, recording
+/// the open for the moves between tiers
+static void tierRedirect(CephFile &file) {
+  std::map<std::string, Tier>::iterator it = g_tiers.find(file.pool);
+  if (it == g_tiers.end()) return;
+  librados::IoCtx *ioctx = getIoCtx(file);
+  TierState state;
+  if (0 == ioctx || readTierState(ioctx, file.name, state)) return;
+  time_t now = time(NULL);
+  if (state.coldPool.empty()) {
+    if (now - state.atime >= 86400) {
+      ceph::bufferlist bl = tierTimeValue(now);
+      ioctx->setxattr(getObjectName(file.name, 0), g_tierAtimeXattr, bl);
+    }
+    return;
+  }
+  {
+    XrdSysCondVarHelper lock(g_tierCond);
+    it->second.nbRedirects++;
+    tierRecordOpen(file, it->second);
+  }
+  file.pool = state.coldPool;
+}
+
+/// moves a file back from the cold pool before it is modified, renamed or
+/// copied, changing its write generation so that no move overlaps
+static int tierRecall(const CephFile &file) {
+  if (0 == g_tiers.count(file.pool)) return 0;
+  int rc = tierPromote(file);
+  if (rc) return rc;
+  tierMarkWrite(file);
+  return 0;
+}
+
+/// removes the cold copy of a file about to be removed, if any
+static int tierUnlink(const CephFile &file) {
+  std::map<std::string, Tier>::iterator it = g_tiers.find(file.pool);
+  if (it == g_tiers.end()) return 0;
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  std::string key = fileCacheKey(file);
+  tierLockFile(key, true);
+  TierState state;
+  int rc = readTierState(ioctx, file.name, state);
+  if (0 == rc && (!state.coldPool.empty() || state.since)) {
+    rc = tierRemoveCopy(tierColdFile(file, state.coldPool.empty() ? it->second.coldPool
+                                                                  : state.coldPool));
+  }
+  if (-ENOENT == rc) rc = 0;
+  tierUnlockFile(key, it->second, rc);
+  return rc;
+}
+
+/// appends the statistics of tiering to a stream
+static void tierStats(std::ostringstream &ss) {
+  if (g_tiers.empty()) return;
+  XrdSysCondVarHelper lock(g_tierCond);
+  ss << "<tiering>";
+  for (std::map<std::string, Tier>::const_iterator it = g_tiers.begin(); it != g_tiers.end(); it++) {
+    ss << "<tier pool=\"" << it->first << "\" cold=\"" << it->second.coldPool << "\">"
+       << "<redirects>" << it->second.nbRedirects << "</redirects>"
+       << "<promotions>" << it->second.nbPromotions << "</promotions>"
+       << "<demotions>" << it->second.nbDemotions << "</demotions>"
+       << "<cleanups>" << it->second.nbCleanups << "</cleanups>"
+       << "<failures>" << it->second.nbFailures << "</failures>"
+       << "</tier>";
+  }
+  ss << "<queued>" << g_tierPromotions.size() << "</queued>"
+     << "</tiering>";
+}
+
+/// compression of files, per pool or path prefix : new files matching a rule
+/// are cut in blocks of one stripe unit, each compressed on its own with the
+/// codec of the rule (See XrdCephCompress). Files already compressed are
+/// always read and written as such, or refused when their codec is not available
+/// Rules are given in the configuration file (See XrdCephOss::configure)
+struct CompressRule {
+  /// pool, or "*" for all, empty for path prefixes
+  std::string pool;
+  std::string prefix;
+  XrdCephCompress::Codec codec;
+  int level;
+};
+std::vector<CompressRule> g_compressRules;
+/// number of blocks of a file kept in memory, waiting to be completed by out
+/// of order writes before being compressed
+static const size_t g_compressMaxPending = 8;
+/// xattr holding the header of the block map of compressed files, its chunks
+/// being in the xattrs suffixed by their number
+static const char g_compressXattr[] = "xrdceph.compress";
+/// prefix of the xattrs holding the map entries of the blocks being rewritten,
+/// followed by the block number. The new data of such a block are first written
+/// to a journal object, so that a block rewritten in place but not yet in the
+/// map is replayed when the file is next opened, rather than left corrupted
+static const char g_compressJournalXattr[] = "xrdceph.compress.journal.";
+/// number of blocks compressed, of blocks stored as is, of bytes before and
+/// after compression, of blocks read back to be updated, of blocks decompressed
+/// and of corrupted blocks
+unsigned long long g_compressNbBlocks = 0;
+unsigned long long g_compressNbRawBlocks = 0;
+unsigned long long g_compressNbBytesIn = 0;
+unsigned long long g_compressNbBytesOut = 0;
+unsigned long long g_compressNbRewrites = 0;
+unsigned long long g_compressNbDecompressed = 0;
+unsigned long long g_compressNbCorrupted = 0;
+
+/// block of a compressed file being written
+struct PendingBlock {
+  PendingBlock() : written(0) {}
+  std::string data;
+  /// number of bytes written to the block, which is compressed once full
+  unsigned long long written;
+};
+
+/// state of an open compressed file
+struct CompressedFile {
+  CompressedFile() : storedChunks(0), cachedBlockNo(0), hasCachedBlock(false), dirty(false) {}
+  XrdCephBlockMap map;
+  /// number of chunks of the map in the xattrs of the file
+  size_t storedChunks;
+  std::map<unsigned long long, PendingBlock> pending;
+  /// last block decompressed, as reads are usually smaller than blocks
+  unsigned long long cachedBlockNo;
+  std::string cachedBlock;
+  bool hasCachedBlock;
+  /// whether the map changed since it was stored
+  bool dirty;
+  /// blocks rewritten since the map was stored, whose journal is to be dropped
+  std::set<unsigned long long> journaled;
+  /// serializes the reads and writes of the file
+  XrdSysMutex mutex;
+};
+
+/// adds a compression rule. target is a pool, "*" for all pools, or a path
+/// prefix starting with '/'. level 0 is the default level of the codec
+/// returns 0 or -EINVAL for an unknown or unavailable codec
+int ceph_posix_add_compression(const char *target, const char *codecName, int level) {
+  CompressRule rule;
+  if (!XrdCephCompress::codecFromName(codecName, rule.codec) ||
+      !XrdCephCompress::available(rule.codec) || level < 0 || 0 == *target) {
+    return -EINVAL;
+  }
+  if ('/' == target[0]) rule.prefix = target;
+  else rule.pool = target;
+  rule.level = level;
+  g_compressRules.push_back(rule);
+  return 0;
+}
+
+/// first rule matching a file, if any
+static const CompressRule* compressRule(const CephFile &file) {
+  for (std::vector<CompressRule>::const_iterator it = g_compressRules.begin();
+       it != g_compressRules.end(); it++) {
+    if (it->pool.empty() ? 0 == file.name.compare(0, it->prefix.size(), it->prefix)
+                         : (it->pool == "*" || it->pool == file.pool)) {
+      return &(*it);
+    }
+  }
+  return 0;
+}
+
+static std::string compressChunkXattr(size_t chunkNo) {
+  std::ostringstream ss;
+  ss << g_compressXattr << '.' << chunkNo;
+  return ss.str();
+}
+
+static std::string compressJournalXattr(unsigned long long blockNo) {
+  std::ostringstream ss;
+  ss << g_compressJournalXattr << blockNo;
+  return ss.str();
+}
+
+/// object holding the new data of a block being rewritten
+static std::string compressJournalObject(const std::string &name, unsigned long long blockNo) {
+  std::ostringstream ss;
+  ss << name << ".compress." << blockNo;
+  return ss.str();
+}
+
+static ceph::bufferlist encodeCompressEntry(uint32_t entry) {
+  std::string value;
+  for (unsigned int b = 0; b < 4; b++) value += (char)((entry >> (8 * b)) & 0xff);
+  ceph::bufferlist bl;
+  bl.append(value);
+  return bl;
+}
+
+/// decodes the block map of a file from the xattrs of its first object. found
+/// tells whether the file is compressed, size is the size of the file anyway
+/// The entries of the blocks being rewritten are put in the map, and the
+/// blocks in journaled, as their journal is to be replayed
+static int decodeBlockMap(std::map<std::string, ceph::bufferlist> &attrs,
+                          XrdCephBlockMap &map, bool &found, unsigned long long &size,
+                          std::set<unsigned long long> &journaled) {
+  found = false;
+  size = 0;
+  std::map<std::string, ceph::bufferlist>::iterator it = attrs.find("striper.size");
+  if (it != attrs.end()) {
+    size = strtoull(std::string(it->second.c_str(), it->second.length()).c_str(), 0, 10);
+  }
+  it = attrs.find(g_compressXattr);
+  if (it == attrs.end()) return 0;
+  size_t nbEntries;
+  if (!map.decodeHeader(std::string(it->second.c_str(), it->second.length()), nbEntries)) {
+    return -EIO;
+  }
+  for (size_t i = 0; i < map.nbChunks(); i++) {
+    it = attrs.find(compressChunkXattr(i));
+    if (it == attrs.end() ||
+        !map.decodeChunk(i, std::string(it->second.c_str(), it->second.length()))) {
+      return -EIO;
+    }
+  }
+  size_t prefixLen = sizeof(g_compressJournalXattr) - 1;
+  for (it = attrs.lower_bound(g_compressJournalXattr);
+       it != attrs.end() && 0 == it->first.compare(0, prefixLen, g_compressJournalXattr);
+       it++) {
+    if (it->second.length() != 4) return -EIO;
+    const unsigned char *p = (const unsigned char*)it->second.c_str();
+    uint32_t entry = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+    unsigned long long blockNo = strtoull(it->first.c_str() + prefixLen, 0, 10);
+    if (XrdCephCompress::storedLength(entry) > map.blockSize) return -EIO;
+    map.setEntry(blockNo, entry);
+    journaled.insert(blockNo);
+  }
+  found = true;
+  return 0;
+}
+
+/// reads the block map of a file from the xattrs of its first object
+/// (See decodeBlockMap)
+static int readBlockMap(librados::IoCtx *ioctx, const std::string &name,
+                        XrdCephBlockMap &map, bool &found, unsigned long long &size,
+                        std::set<unsigned long long> &journaled) {
+  std::map<std::string, ceph::bufferlist> attrs;
+  int rc = ioctx->getxattrs(getObjectName(name, 0), attrs);
+  if (rc < 0) return rc;
+  return decodeBlockMap(attrs, map, found, size, journaled);
+}
+
+/// stores the block map of a compressed file in the xattrs of its first object
+/// With setSize, the size of the file is set too, as the striper only knows the
+/// end of the data stored, which is shorter when the last block was compressed
+static int storeBlockMap(const CephFile &file, CompressedFile &cf, bool setSize) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  librados::ObjectWriteOperation op;
+  ceph::bufferlist header;
+  header.append(cf.map.encodeHeader());
+  op.setxattr(g_compressXattr, header);
+  size_t nbChunks = cf.map.nbChunks();
+  for (size_t i = 0; i < nbChunks; i++) {
+    ceph::bufferlist chunk;
+    chunk.append(cf.map.encodeChunk(i));
+    op.setxattr(compressChunkXattr(i).c_str(), chunk);
+  }
+  for (size_t i = nbChunks; i < cf.storedChunks; i++) {
+    op.rmxattr(compressChunkXattr(i).c_str());
+  }
+  for (std::set<unsigned long long>::const_iterator it = cf.journaled.begin();
+       it != cf.journaled.end();
+       it++) {
+    op.rmxattr(compressJournalXattr(*it).c_str());
+  }
+  if (setSize) {
+    std::ostringstream sizeStr;
+    sizeStr << cf.map.size;
+    ceph::bufferlist sizeBl;
+    sizeBl.append(sizeStr.str());
+    op.setxattr("striper.size", sizeBl);
+  }
+  int rc = ioctx->operate(getObjectName(file.name, 0), &op);
+  if (rc) return rc;
+  cf.storedChunks = nbChunks;
+  cf.dirty = false;
+  // the journals are not needed any more. Leftovers are overwritten when
+  // their block is next rewritten, and ignored until then
+  for (std::set<unsigned long long>::const_iterator it = cf.journaled.begin();
+       it != cf.journaled.end();
+       it++) {
+    ioctx->remove(compressJournalObject(file.name, *it));
+  }
+  cf.journaled.clear();
+  return 0;
+}
+
+/// whether a file is compressed
+static bool isCompressed(const CephFile &file) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  ceph::bufferlist bl;
+  return ioctx && ioctx->getxattr(getObjectName(file.name, 0), g_compressXattr, bl) >= 0;
+}
+
+static ssize_t readFromCeph(const CephFile &file, libradosstriper::RadosStriper *striper,
+                            char *buf, size_t count, off64_t offset);
+
+/// reads a block of a compressed file, over its logical length. Blocks never
+/// written, and the part of blocks never written, read as zeros
+/// cf.mutex must be held
+static int readCompressedBlock(const CephFile &file, libradosstriper::RadosStriper *striper,
+                               CompressedFile &cf, unsigned long long blockNo, std::string &data) {
+  unsigned long long length = cf.map.blockLength(blockNo);
+  std::map<unsigned long long, PendingBlock>::const_iterator pit = cf.pending.find(blockNo);
+  if (pit != cf.pending.end()) {
+    data = pit->second.data;
+    data.resize(length, 0);
+    return 0;
+  }
+  uint32_t entry = cf.map.entry(blockNo);
+  size_t stored = XrdCephCompress::storedLength(entry);
+  data.assign(length, 0);
+  if (0 == stored) return 0;
+  std::string buf(stored, 0);
+  ssize_t rc = readFromCeph(file, striper, &buf[0], stored, blockNo * cf.map.blockSize);
+  if (rc < 0) return rc;
+  if (XrdCephCompress::isRaw(entry)) {
+    data.replace(0, std::min((size_t)rc, data.size()), buf, 0, std::min((size_t)rc, data.size()));
+    return 0;
+  }
+  data.assign(cf.map.blockSize, 0);
+  long len = -1;
+  if ((size_t)rc == stored) {
+    len = XrdCephCompress::decompress(cf.map.codec, buf.data(), stored, &data[0], data.size());
+  }
+  if (len < 0) {
+    logwrapper((char*)"readCompressedBlock : block %llu of %s is corrupted",
+               blockNo, file.name.c_str());
+    __sync_fetch_and_add(&g_compressNbCorrupted, 1);
+    return -EIO;
+  }
+  data.resize(length);
+  __sync_fetch_and_add(&g_compressNbDecompressed, 1);
+  return 0;
+}
+
+/// journals the rewrite of a block already stored, before it is overwritten in
+/// place : its new data go to the journal object first, then its new entry to
+/// the xattrs of the first object, where storeBlockMap drops it
+static int journalCompressedBlock(const CephFile &file, CompressedFile &cf,
+                                  unsigned long long blockNo, const std::string &stored,
+                                  uint32_t entry) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    return -EINVAL;
+  }
+  ceph::bufferlist bl;
+  bl.append(stored.data(), stored.size());
+  int rc = ioctx->write_full(compressJournalObject(file.name, blockNo), bl);
+  if (rc) return rc;
+  ceph::bufferlist entryBl = encodeCompressEntry(entry);
+  rc = ioctx->setxattr(getObjectName(file.name, 0), compressJournalXattr(blockNo).c_str(), entryBl);
+  if (rc) return rc;
+  cf.journaled.insert(blockNo);
+  return 0;
+}
+
+/// replays the rewrites of blocks journaled but possibly not done when the
+/// file was last written, then stores the map
+static int replayCompressJournal(const CephFile &file, CompressedFile &cf) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  libradosstriper::RadosStriper *striper = getRadosStriper(file);
+  if (0 == ioctx || 0 == striper) {
+    return -EINVAL;
+  }
+  for (std::set<unsigned long long>::const_iterator it = cf.journaled.begin();
+       it != cf.journaled.end();
+       it++) {
+    size_t stored = XrdCephCompress::storedLength(cf.map.entry(*it));
+    ceph::bufferlist bl;
+    int rc = ioctx->read(compressJournalObject(file.name, *it), bl, stored, 0);
+    if (rc < 0) return rc;
+    if ((size_t)rc != stored) return -EIO;
+    if (0 == stored) continue;
+    rc = writeWithDeadline(file, striper, bl, stored, *it * cf.map.blockSize);
+    if (rc) return rc;
+  }
+  logwrapper((char*)"replayCompressJournal : replayed %d block rewrites of %s",
+             (int)cf.journaled.size(), file.name.c_str());
+  return storeBlockMap(file, cf, false);
+}
+
+/// compresses and writes a pending block of a compressed file. A block already
+/// stored is journaled first, as the map is only stored later. cf.mutex must be held
+static int flushCompressedBlock(const CephFile &file, libradosstriper::RadosStriper *striper,
+                                CompressedFile &cf, unsigned long long blockNo) {
+  const std::string &data = cf.pending[blockNo].data;
+  std::string compressed;
+  uint32_t entry = XrdCephCompress::compress(cf.map.codec, cf.map.level,
+                                             data.data(), data.size(), compressed);
+  const std::string &stored = XrdCephCompress::isRaw(entry) ? data : compressed;
+  if (cf.map.entry(blockNo)) {
+    int rc = journalCompressedBlock(file, cf, blockNo, stored, stored.empty() ? 0 : entry);
+    if (rc) return rc;
+  }
+  if (!stored.empty()) {
+    ceph::bufferlist bl;
+    bl.append(stored.data(), stored.size());
+    int rc = writeWithDeadline(file, striper, bl, stored.size(), blockNo * cf.map.blockSize);
+    if (rc) return rc;
+  }
+  __sync_fetch_and_add(&g_compressNbBlocks, 1);
+  if (XrdCephCompress::isRaw(entry)) __sync_fetch_and_add(&g_compressNbRawBlocks, 1);
+  __sync_fetch_and_add(&g_compressNbBytesIn, data.size());
+  __sync_fetch_and_add(&g_compressNbBytesOut, stored.size());
+  cf.map.setEntry(blockNo, stored.empty() ? 0 : entry);
+  cf.pending.erase(blockNo);
+  if (cf.cachedBlockNo == blockNo) cf.hasCachedBlock = false;
+  cf.dirty = true;
+  return 0;
+}
+
+/// writes to a compressed file. Writes fill blocks kept in memory, which are
+/// compressed and written once full, when too many are pending, or when the
+/// file is closed. Blocks already stored are read back when partially rewritten
+static ssize_t compressedWrite(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                               const char *buf, size_t count, unsigned long long offset) {
+  CompressedFile &cf = *fr.compress;
+  XrdSysMutexHelper lock(cf.mutex);
+  unsigned long long blockSize = cf.map.blockSize;
+  size_t done = 0;
+  while (done < count) {
+    unsigned long long blockNo = (offset + done) / blockSize;
+    size_t inBlock = (offset + done) % blockSize;
+    size_t len = std::min((unsigned long long)(count - done), blockSize - inBlock);
+    std::map<unsigned long long, PendingBlock>::iterator it = cf.pending.find(blockNo);
+    if (it == cf.pending.end()) {
+      it = cf.pending.insert(std::make_pair(blockNo, PendingBlock())).first;
+      if (cf.map.entry(blockNo)) {
+        int rc = readCompressedBlock(fr, striper, cf, blockNo, it->second.data);
+        if (rc) {
+          cf.pending.erase(it);
+          return rc;
+        }
+        __sync_fetch_and_add(&g_compressNbRewrites, 1);
+      }
+    }
+    PendingBlock &pb = it->second;
+    if (pb.data.size() < inBlock + len) pb.data.resize(inBlock + len, 0);
+    memcpy(&pb.data[inBlock], buf + done, len);
+    pb.written += len;
+    done += len;
+    if (cf.cachedBlockNo == blockNo) cf.hasCachedBlock = false;
+    if (pb.written >= blockSize) {
+      int rc = flushCompressedBlock(fr, striper, cf, blockNo);
+      if (rc) return rc;
+    }
+  }
+  cf.map.size = std::max(cf.map.size, offset + count);
+  cf.dirty = true;
+  // blocks left incomplete by out of order writes go first in file order
+  while (cf.pending.size() > g_compressMaxPending) {
+    int rc = flushCompressedBlock(fr, striper, cf, cf.pending.begin()->first);
+    if (rc) return rc;
+  }
+  return count;
+}
+
+/// reads from a compressed file, block by block
+static ssize_t compressedRead(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                              char *buf, size_t count, unsigned long long offset) {
+  CompressedFile &cf = *fr.compress;
+  XrdSysMutexHelper lock(cf.mutex);
+  if (offset >= cf.map.size) return 0;
+  count = std::min((unsigned long long)count, cf.map.size - offset);
+  size_t done = 0;
+  while (done < count) {
+    unsigned long long blockNo = (offset + done) / cf.map.blockSize;
+    size_t inBlock = (offset + done) % cf.map.blockSize;
+    if (!cf.hasCachedBlock || cf.cachedBlockNo != blockNo) {
+      cf.hasCachedBlock = false;
+      int rc = readCompressedBlock(fr, striper, cf, blockNo, cf.cachedBlock);
+      if (rc) return rc;
+      cf.cachedBlockNo = blockNo;
+      cf.hasCachedBlock = true;
+    }
+    size_t len = std::min(count - done, cf.cachedBlock.size() - inBlock);
+    memcpy(buf + done, cf.cachedBlock.data() + inBlock, len);
+    done += len;
+  }
+  return done;
+}
+
+/// writes the pending blocks and the map of a compressed file, when it is
+/// closed or synced
+static int compressFlush(const CephFileRef &fr) {
+  CompressedFile &cf = *fr.compress;
+  XrdSysMutexHelper lock(cf.mutex);
+  if (!cf.dirty) return 0;
+  libradosstriper::RadosStriper *striper = getRadosStriper(fr);
+  if (0 == striper) {
+    return -EINVAL;
+  }
+  while (!cf.pending.empty()) {
+    int rc = flushCompressedBlock(fr, striper, cf, cf.pending.begin()->first);
+    if (rc) return rc;
+  }
+  return storeBlockMap(fr, cf, true);
+}
+
+/// checksums of a compressed file read back, when it was not written sequentially
+static int rereadCompressedChecksums(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                                     unsigned long long size, uint32_t &adler32, uint32_t &crc32c) {
+  adler32 = 1;
+  crc32c = 0;
+  std::vector<char> buf(fr.compress->map.blockSize);
+  unsigned long long offset = 0;
+  while (offset < size) {
+    ssize_t rc = compressedRead(fr, striper, &buf[0], buf.size(), offset);
+    if (rc < 0) return rc;
+    if (0 == rc) return -EIO;
+    const unsigned char *data = (const unsigned char*)&buf[0];
+    if (g_writeCksTypes & WCKS_ADLER32) adler32 = XrdCephChecksum::adler32(adler32, data, rc);
+    if (g_writeCksTypes & WCKS_CRC32C) crc32c = XrdCephChecksum::crc32c(crc32c, data, rc);
+    offset += rc;
+  }
+  return 0;
+}
+
+/// sets up the compression of a file being opened : files already compressed
+/// stay so, whatever the rules, new or empty ones opened for writing follow them
+/// attrs are the xattrs of the first object when already read, empty if the
+/// file does not exist, or 0 to have them read
+static int compressOpen(const CephFile &file, bool forWrite,
+                        std::map<std::string, ceph::bufferlist> *attrs, CompressedFile *&cf) {
+  cf = 0;
+  XrdCephBlockMap map;
+  bool found;
+  unsigned long long size;
+  std::set<unsigned long long> journaled;
+  int rc;
+  if (attrs) {
+    rc = decodeBlockMap(*attrs, map, found, size, journaled);
+  } else {
+    librados::IoCtx *ioctx = getIoCtx(file);
+    if (0 == ioctx) {
+      return -EINVAL;
+    }
+    rc = readBlockMap(ioctx, file.name, map, found, size, journaled);
+  }
+  if (rc && rc != -ENOENT) return rc;
+  if (found) {
+    if (!XrdCephCompress::available(map.codec)) {
+      logwrapper((char*)"compressOpen : codec %s of %s is not available",
+                 XrdCephCompress::codecName(map.codec), file.name.c_str());
+      return -ENOTSUP;
+    }
+    cf = new CompressedFile();
+    cf->map = map;
+    cf->storedChunks = map.nbChunks();
+    cf->journaled = journaled;
+    if (!journaled.empty()) {
+      rc = replayCompressJournal(file, *cf);
+      if (rc) {
+        delete cf;
+        cf = 0;
+        return rc;
+      }
+    }
+    return 0;
+  }
+  if (!forWrite || size > 0) return 0;
+  const CompressRule *rule = compressRule(file);
+  if (0 == rule || XrdCephCompress::NONE == rule->codec) return 0;
+  cf = new CompressedFile();
+  cf->map.codec = rule->codec;
+  cf->map.level = rule->level;
+  cf->map.blockSize = file.stripeUnit;
+  return 0;
+}
+
+/// updates the map of a compressed file being truncated, before its objects
+/// are. The block cut by the new size is rewritten shorter. cf is the state of
+/// the file when open through fd, otherwise the map is read from the file
+static int compressTruncate(const CephFile &file, CompressedFile *cf, unsigned long long size) {
+  CompressedFile *loaded = 0;
+  if (0 == cf) {
+    librados::IoCtx *ioctx = getIoCtx(file);
+    if (0 == ioctx) {
+      return -EINVAL;
+    }
+    XrdCephBlockMap map;
+    bool found;
+    unsigned long long fileSize;
+    std::set<unsigned long long> journaled;
+    int rc = readBlockMap(ioctx, file.name, map, found, fileSize, journaled);
+    if (-ENOENT == rc || (0 == rc && !found)) return 0;
+    if (rc) return rc;
+    if (!XrdCephCompress::available(map.codec)) return -ENOTSUP;
+    cf = loaded = new CompressedFile();
+    cf->map = map;
+    cf->storedChunks = map.nbChunks();
+    cf->journaled = journaled;
+    if (!journaled.empty()) rc = replayCompressJournal(file, *cf);
+    if (rc) {
+      delete loaded;
+      return rc;
+    }
+  }
+  libradosstriper::RadosStriper *striper = getRadosStriper(file);
+  if (0 == striper) {
+    delete loaded;
+    return -EINVAL;
+  }
+  int rc = 0;
+  {
+    XrdSysMutexHelper lock(cf->mutex);
+    unsigned long long blockSize = cf->map.blockSize;
+    unsigned long long cutBlockNo = size / blockSize;
+    size_t cutLength = size % blockSize;
+    std::map<unsigned long long, PendingBlock>::iterator it = cf->pending.begin();
+    while (it != cf->pending.end()) {
+      if (it->first * blockSize >= size) {
+        cf->pending.erase(it++);
+      } else {
+        if (it->first == cutBlockNo && it->second.data.size() > cutLength) {
+          it->second.data.resize(cutLength);
+        }
+        it++;
+      }
+    }
+    cf->hasCachedBlock = false;
+    if (cutLength && size < cf->map.size && cf->map.entry(cutBlockNo) &&
+        0 == cf->pending.count(cutBlockNo)) {
+      PendingBlock pb;
+      rc = readCompressedBlock(file, striper, *cf, cutBlockNo, pb.data);
+      if (0 == rc) {
+        pb.data.resize(cutLength, 0);
+        cf->pending[cutBlockNo] = pb;
+        __sync_fetch_and_add(&g_compressNbRewrites, 1);
+      }
+    }
+    if (0 == rc) cf->map.truncate(size);
+    // the blocks are written before the objects are cut, which also sets the size
+    while (0 == rc && !cf->pending.empty()) {
+      rc = flushCompressedBlock(file, striper, *cf, cf->pending.begin()->first);
+    }
+    if (0 == rc) rc = storeBlockMap(file, *cf, false);
+  }
+  delete loaded;
+  return rc;
+}
+
+/// appends the statistics of compression to a stream
+static void compressStats(std::ostringstream &ss) {
+  if (g_compressRules.empty()) return;
+  ss << "<compression>"
+     << "<blocks>" << g_compressNbBlocks << "</blocks>"
+     << "<raw>" << g_compressNbRawBlocks << "</raw>"
+     << "<bytesin>" << g_compressNbBytesIn << "</bytesin>"
+     << "<bytesout>" << g_compressNbBytesOut << "</bytesout>"
+     << "<rewrites>" << g_compressNbRewrites << "</rewrites>"
+     << "<decompressed>" << g_compressNbDecompressed << "</decompressed>"
+     << "<corrupted>" << g_compressNbCorrupted << "</corrupted>"
+     << "</compression>";
+}
+
+static int ceph_posix_internal_truncate(const CephFile &file, unsigned long long size);
+
+int ceph_posix_open(XrdOucEnv* env, const char *pathname, int flags, mode_t mode) {
+  CephFileRef fr = getCephFileRef(pathname, env, flags, mode, 0);
+  // the layout only matters for files being written, existing ones keep theirs
+  if (flags & (O_WRONLY|O_RDWR|O_CREAT)) {
+    applySizeClass(pathname, env, fr);
+    alignLayout(fr);
+    int rc = reclaimSync(fr);
+    if (rc) return rc;
+    rc = tierRecall(fr);
+    if (rc) return rc;
+  } else {
+    tierRedirect(fr);
+  }
+  // files opened read only may be served from the block and disk caches
+  if ((g_blockCache || g_diskCache) && 0 == (flags & (O_WRONLY|O_RDWR|O_CREAT|O_TRUNC))) {
+    fr.cacheVersion = blockCacheVersion(fr);
+  }
+  int fd = insertFileRef(fr);
+  logwrapper((char*)"ceph_open: fd %d associated to %s", fd, pathname);
+  // in case of O_CREAT and O_EXCL, we should complain if the file exists
+  // in case of O_READ, the file has to exist
+  // the xattrs of the first object tell both, as well as whether the file is compressed
+  std::map<std::string, ceph::bufferlist> attrs;
+  bool attrsKnown = false;
+  if (((flags & O_CREAT) && (flags & O_EXCL)) || ((flags&O_ACCMODE) == O_RDONLY)) {
+    int rc = xattrsWithDeadline(fr, attrs, DL_OPEN);
+    attrsKnown = (0 == rc || -ENOENT == rc) && 0 == (flags & O_TRUNC);
+    if ((flags&O_ACCMODE) == O_RDONLY) {
+      if (rc) {
+        deleteFileRef(fd, fr);
+        return rc;
+      }
+    } else if (rc != -ENOENT) {
+      deleteFileRef(fd, fr);
+      if (0 == rc) return -EEXIST;
+      return rc;
+    }
+  }
+  // in case of O_TRUNC, we should truncate the file
+  if (flags & O_TRUNC) {
+    int rc = compressTruncate(fr, 0, 0);
+    if (0 == rc) rc = ceph_posix_internal_truncate(fr, 0);
+    // fail only if file exists and cannot be truncated
+    if (rc < 0 && rc != -ENOENT) {
+      deleteFileRef(fd, fr);
+      return rc;
+    }
+  }
+  // compressed files bypass the block and disk caches, which hold raw object data
+  CompressedFile *cf;
+  int compressRc = compressOpen(fr, 0 != (flags & (O_WRONLY|O_RDWR)), attrsKnown ? &attrs : 0, cf);
+  if (compressRc) {
+    deleteFileRef(fd, fr);
+    return compressRc;
+  }
+  if (cf) {
+    CephFileRef* nfr = getFileRef(fd);
+    nfr->compress = cf;
+    nfr->cacheVersion = 0;
+  }
+  // in case of creation, add the file to the negative lookup filter. It only
+  // goes to the name index, if any, once closed
+  if (flags & O_CREAT) {
+    negLookupAdd(fr);
+  }
+  if (g_writeCksTypes && (flags & (O_WRONLY|O_RDWR))) {
+    CephFileRef* nfr = getFileRef(fd);
+    if (nfr) nfr->writeCks = new WriteChecksum();
+  }
+  return fd;
+}
+
+/// creates a file ahead of its opening, with the layout matching its expected size
+/// The first object and its layout xattrs are written, so that the first write
+/// does not have to. flags are the open flags, exclusive tells whether the
+/// file must not exist yet
+int ceph_posix_create(XrdOucEnv* env, const char *pathname, mode_t mode,
+                      int flags, bool exclusive) {
+  logwrapper((char*)"ceph_create: %s", pathname);
+  CephFile file = getCephFile(pathname, env);
+  applySizeClass(pathname, env, file);
+  alignLayout(file);
+  libradosstriper::RadosStriper *striper = getRadosStriper(file);
+  if (0 == striper) {
+    return -EINVAL;
+  }
+  int rc = reclaimSync(file);
+  if (rc) return rc;
+  rc = tierRecall(file);
+  if (rc) return rc;
+  uint64_t size;
+  time_t mtime;
+  rc = statWithDeadline(file, striper, &size, &mtime, DL_OPEN);
+  if (0 == rc) {
+    if (exclusive) return -EEXIST;
+    if (flags & O_TRUNC) {
+      rc = compressTruncate(file, 0, 0);
+      if (rc) return rc;
+      return ceph_posix_internal_truncate(file, 0);
+    }
+    return 0;
+  }
+  if (rc != -ENOENT) return rc;
+  invalidateCaches(file);
+  ceph::bufferlist bl;
+  rc = striper->write(file.name, bl, 0, 0);
+  if (rc) return rc;
+  negLookupAdd(file);
+  return 0;
+}
+
+int ceph_posix_close(int fd) {
+  CephFileRef* fr = getFileRef(fd);
+  if (fr) {
+    logwrapper((char*)"ceph_close: closed fd %d for file %s, read ops count %d, write ops count %d",
+               fd, fr->name.c_str(), fr->rdcount, fr->wrcount);
+    // blocks of compressed files still in memory are written first
+    int rc = fr->compress ? compressFlush(*fr) : 0;
+    // files written, or created even empty, are added to the name index, if any
+    if (g_cephNameIndexNbShards > 0 && (fr->wrcount > 0 || (fr->flags & O_CREAT))) {
+      bool exists = fr->wrcount > 0;
+      libradosstriper::RadosStriper *striper = exists ? 0 : getRadosStriper(*fr);
+      if (striper) {
+        uint64_t size;
+        time_t mtime;
+        exists = (0 == striper->stat(fr->name, &size, &mtime));
+      }
+      if (exists) nameIndexAdd(*fr);
+    }
+    // drop metadata possibly cached while the file was being written
+    if (fr->wrcount > 0) {
+      invalidateCaches(*fr);
+      tierMarkWrite(*fr);
+    }
+    // checksums of data that could not all be written would not match the file
+    if (fr->writeCks) {
+      if (fr->wrcount > 0 && 0 == rc) storeWriteChecksums(*fr);
+      delete fr->writeCks;
+    }
+    delete fr->compress;
+    deleteFileRef(fd, *fr);
+    return rc;
+  } else {
+    return -EBADF;
+  }
+}
+
+static off64_t lseek_compute_offset(CephFileRef &fr, off64_t offset, int whence) {
+  switch (whence) {
+  case SEEK_SET:
+    fr.offset = offset;
+    break;
+  case SEEK_CUR:
+    fr.offset += offset;
+    break;
+  default:
+    return -EINVAL;
+  }
+  return fr.offset;
+}
+
+off_t ceph_posix_lseek(int fd, off_t offset, int whence) {
+  CephFileRef* fr = getFileRef(fd);
+  if (fr) {
+    logwrapper((char*)"ceph_lseek: for fd %d, offset=%lld, whence=%d", fd, offset, whence);
+    return (off_t)lseek_compute_offset(*fr, offset, whence);
+  } else {
+    return -EBADF;
+  }
+}
+
+off64_t ceph_posix_lseek64(int fd, off64_t offset, int whence) {
+  CephFileRef* fr = getFileRef(fd);
+  if (fr) {
+    logwrapper((char*)"ceph_lseek64: for fd %d, offset=%lld, whence=%d", fd, offset, whence);
+    return lseek_compute_offset(*fr, offset, whence);
+  } else {
+    return -EBADF;
+  }
+}
+
+/// configures the admission control of reads and writes
+/// perFileOps and perFileBytes limit the operations of each open file, 0 meaning no limit
+/// returns 0 or -EINVAL in case of invalid arguments
+int ceph_posix_set_admission(unsigned int maxOps, unsigned long long maxBytes,
+                             unsigned int perFileOps, unsigned long long perFileBytes,
+                             unsigned int targetLatencyMs, unsigned int maxQueue) {
+  if (0 == maxOps || 0 == maxBytes || 0 == targetLatencyMs) return -EINVAL;
+  delete g_admission;
+  g_admission = new XrdCephAdmission(maxOps, maxBytes, perFileOps, perFileBytes,
+                                     targetLatencyMs, maxQueue);
+  return 0;
+}
+
+/// share of the I/O given to a class of operations, with an optional
+/// bandwidth cap for each client of the class
+struct IoShare {
+  std::string userId;
+  std::string op;
+  double weight;
+  unsigned long long clientCap;
+};
+/// shares of the I/O, the first matching one applies. Operations matching
+/// none have a weight of 1 and no cap
+/// (See XrdCephOss::configure)
+std::vector<IoShare> g_ioShares;
+
+/// adds a share of the I/O for the operations of a ceph user, "*" matching
+/// all users, and type (read, write or "*" for both)
+/// clientCap is the maximum bandwidth of each client in bytes per second, 0 for no cap
+/// The shares only apply when operations are queued by the admission control,
+/// which must thus be configured first
+/// returns 0, -EINVAL in case of invalid arguments or -ENOENT if the admission
+/// control is not configured
+int ceph_posix_set_ioshare(const char *userId, const char *op, double weight,
+                           unsigned long long clientCap) {
+  if (weight <= 0 || (strcmp(op, "read") && strcmp(op, "write") && strcmp(op, "*"))) {
+    return -EINVAL;
+  }
+  if (0 == g_admission) return -ENOENT;
+  IoShare share;
+  share.userId = userId;
+  share.op = op;
+  share.weight = weight;
+  share.clientCap = clientCap;
+  g_ioShares.push_back(share);
+  return 0;
+}
+
+/// classifies an operation for the weighted fair queueing of the admission control
+/// flows are made of the operations of a given type of a given client, each
+/// flow getting the weight of the share of its ceph user and operation type
+static XrdCephAdmission::Flow getIoFlow(const CephFileRef &fr, const char *op) {
+  XrdCephAdmission::Flow flow;
+  flow.name = fr.userId + "/" + op + "/" + fr.client;
+  flow.client = fr.client;
+  for (std::vector<IoShare>::const_iterator it = g_ioShares.begin();
+       it != g_ioShares.end();
+       it++) {
+    if ((it->userId == "*" || it->userId == fr.userId) && (it->op == "*" || it->op == op)) {
+      flow.weight = it->weight;
+      // clients without an identifier cannot be told apart, they are not capped
+      if (!fr.client.empty()) flow.clientCap = it->clientCap;
+      break;
+    }
+  }
+  return flow;
+}
+
+/// reads from ceph, bypassing the caches
+static ssize_t readFromCeph(const CephFile &file, libradosstriper::RadosStriper *striper,
+                            char *buf, size_t count, off64_t offset) {
+  if (asyncReads() && !isFederated(file)) {
+    return coalescedRead(file, striper, buf, count, offset);
+  }
+  ceph::bufferlist bl;
+  int rc = readWithPolicy(file, striper, &bl, count, offset);
+  if (rc < 0) return rc;
+  bl.copy(0, rc, buf);
+  return rc;
+}
+
+/// reads from ceph once admitted
+static ssize_t admittedRead(int fd, const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                            char *buf, size_t count, off64_t offset) {
+  if (0 == g_admission) return readFromCeph(fr, striper, buf, count, offset);
+  int rc = g_admission->acquire(fd, count, g_deadlineMs[DL_READ], getIoFlow(fr, "read"));
+  if (rc) return rc;
+  unsigned long long start = XrdCephTimer::nowMs();
+  ssize_t nbRead = readFromCeph(fr, striper, buf, count, offset);
+  g_admission->release(fd, count, XrdCephTimer::nowMs() - start);
+  return nbRead;
+}
+
+/// writes to ceph once admitted
+static int admittedWrite(int fd, const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                         ceph::bufferlist &bl, size_t count, unsigned long long offset) {
+  if (0 == g_admission) return writeWithDeadline(fr, striper, bl, count, offset);
+  int rc = g_admission->acquire(fd, count, g_deadlineMs[DL_WRITE], getIoFlow(fr, "write"));
+  if (rc) return rc;
+  unsigned long long start = XrdCephTimer::nowMs();
+  rc = writeWithDeadline(fr, striper, bl, count, offset);
+  g_admission->release(fd, count, XrdCephTimer::nowMs() - start);
+  return rc;
+}
+
+/// callback of admitted aios, releasing their admission before calling
+/// the original callback. Not used when the issuer takes over the admission
+/// (see takeAdmittedAio)
+static void admittedAioComplete(XrdSfsAio *aiop, size_t rc) {
+  AdmittedAio aa;
+  {
+    XrdSysMutexHelper lock(g_admittedAiosMutex);
+    std::map<XrdSfsAio*, AdmittedAio>::iterator it = g_admittedAios.find(aiop);
+    aa = it->second;
+    g_admittedAios.erase(it);
+  }
+  g_admission->release(aa.fd, aa.nbBytes, XrdCephTimer::nowMs() - aa.startMs);
+  aa.callback(aiop, rc);
+}
+
+/// function sending an aio to ceph
+typedef ssize_t (AioIssuer)(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                            XrdSfsAio *aiop, AioCB *cb);
+
+/// sends an aio to ceph once admitted
+static ssize_t admittedAio(int fd, const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                           XrdSfsAio *aiop, AioCB *cb, AioIssuer *issue, DeadlineClass dc) {
+  if (0 == g_admission) return issue(fr, striper, aiop, cb);
+  size_t count = aiop->sfsAio.aio_nbytes;
+  int rc = g_admission->acquire(fd, count, g_deadlineMs[dc],
+                                getIoFlow(fr, DL_WRITE == dc ? "write" : "read"));
+  if (rc) return rc;
+  {
+    XrdSysMutexHelper lock(g_admittedAiosMutex);
+    AdmittedAio &aa = g_admittedAios[aiop];
+    aa.callback = cb;
+    aa.fd = fd;
+    aa.nbBytes = count;
+    aa.startMs = XrdCephTimer::nowMs();
+  }
+  rc = issue(fr, striper, aiop, admittedAioComplete);
+  if (rc) {
+    {
+      XrdSysMutexHelper lock(g_admittedAiosMutex);
+      g_admittedAios.erase(aiop);
+    }
+    g_admission->release(fd, count);
+  }
+  return rc;
+}
+
+/// appends the statistics of the admission control to a stream
+static void admissionStats(std::ostringstream &ss) {
+  if (g_admission) g_admission->stats(ss);
+}
+
+ssize_t ceph_posix_write(int fd, const void *buf, size_t count) {
+  CephFileRef* fr = getFileRef(fd);
+  if (fr) {
+    logwrapper((char*)"ceph_write: for fd %d, count=%d", fd, count);
+    if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
+      return -EBADF;
     }
-    // get the striper object
     libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
     if (0 == striper) {
       return -EINVAL;
     }
-    // prepare a bufferlist around the given buffer
+    invalidateCaches(*fr);
+    int rc = dropPageChecksums(*fr, fr->offset, count);
+    if (rc) return rc;
+    if (fr->compress) {
+      ssize_t wrc = compressedWrite(*fr, striper, (const char*)buf, count, fr->offset);
+      rc = wrc < 0 ? wrc : 0;
+    } else {
+      ceph::bufferlist bl;
+      bl.append((const char*)buf, count);
+      countEcWrite(*fr, count, fr->offset);
+      rc = admittedWrite(fd, *fr, striper, bl, count, fr->offset);
+    }
+    if (rc) {
+      dropWriteChecksum(*fr);
+      return rc;
+    }
+    updateWriteChecksum(*fr, (const char*)buf, count, fr->offset);
+    fr->offset += count;
+    fr->wrcount++;
+    return count;
+  } else {
+    return -EBADF;
+  }
+}
+
+/// writes to an open file, leaving its stored page checksums to the caller
+static ssize_t pwriteFileRef(int fd, CephFileRef &fr, const void *buf, size_t count,
+                             off64_t offset) {
+  if ((fr.flags & (O_WRONLY|O_RDWR)) == 0) {
+    return -EBADF;
+  }
+  libradosstriper::RadosStriper *striper = getRadosStriper(fr);
+  if (0 == striper) {
+    return -EINVAL;
+  }
+  invalidateCaches(fr);
+  int rc;
+  if (fr.compress) {
+    ssize_t wrc = compressedWrite(fr, striper, (const char*)buf, count, offset);
+    rc = wrc < 0 ? wrc : 0;
+  } else {
     ceph::bufferlist bl;
-    bl.append(buf, count);
-    // get the poolIdx to use
-    int cephPoolIdx = getCephPoolIdxAndIncrease();
-    // Get the cluster to use
-    librados::Rados* cluster = checkAndCreateCluster(cephPoolIdx);
-    if (0 == cluster) {
+    bl.append((const char*)buf, count);
+    countEcWrite(fr, count, offset);
+    rc = admittedWrite(fd, fr, striper, bl, count, offset);
+  }
+  if (rc) {
+    dropWriteChecksum(fr);
+    return rc;
+  }
+  updateWriteChecksum(fr, (const char*)buf, count, offset);
+  fr.wrcount++;
+  return count;
+}
+
+ssize_t ceph_posix_pwrite(int fd, const void *buf, size_t count, off64_t offset) {
+  CephFileRef* fr = getFileRef(fd);
+  if (fr) {
+    // TODO implement proper logging level for this plugin - this should be only debug
+    //logwrapper((char*)"ceph_write: for fd %d, count=%d", fd, count);
+    if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
+      return -EBADF;
+    }
+    int rc = dropPageChecksums(*fr, offset, count);
+    if (rc) return rc;
+    return pwriteFileRef(fd, *fr, buf, count, offset);
+  } else {
+    return -EBADF;
+  }
+}
+
+ssize_t ceph_posix_pgwrite(int fd, const void *buf, size_t count, off64_t offset,
+                           uint32_t *csvec, bool verify, bool calc) {
+  CephFileRef* fr = getFileRef(fd);
+  if (0 == fr) {
+    return -EBADF;
+  }
+  bool store = storesPageChecksums(*fr);
+  size_t nbPages = XrdCephChecksum::pageCount(offset, count);
+  std::vector<uint32_t> computed;
+  if ((csvec && (verify || calc)) || (0 == csvec && store)) {
+    computed.resize(nbPages + 1);
+    XrdCephChecksum::pageCrc32c((const unsigned char*)buf, count, offset, &computed[0]);
+    __sync_fetch_and_add(&g_pageCksNbComputed, nbPages);
+  }
+  if (csvec && verify) {
+    for (size_t i = 0; i < nbPages; i++) {
+      if (csvec[i] != computed[i]) {
+        __sync_fetch_and_add(&g_pageCksNbMismatches, 1);
+        logwrapper((char*)"ceph_posix_pgwrite : checksum mismatch for %s at offset %lld",
+                   fr->name.c_str(), (long long)offset);
+        return -EDOM;
+      }
+    }
+  }
+  if (csvec && calc) {
+    std::copy(computed.begin(), computed.begin() + nbPages, csvec);
+  }
+  // the old checksums must not survive a write that fails or is interrupted
+  // before the new ones are stored
+  int drc = dropPageChecksums(*fr, offset, count);
+  if (drc) return drc;
+  ssize_t rc = pwriteFileRef(fd, *fr, buf, count, offset);
+  if (rc <= 0 || !store) return rc;
+  int src = storePageChecksums(*fr, offset, count, csvec ? csvec : &computed[0]);
+  if (src) {
+    logwrapper((char*)"ceph_posix_pgwrite : unable to store page checksums of %s, rc = %d",
+               fr->name.c_str(), src);
+    return src;
+  }
+  return rc;
+}
+
+static void ceph_aio_write_complete(rados_completion_t c, void *arg) {
+  AioArgs *awa = reinterpret_cast<AioArgs*>(arg);
+  size_t rc = rados_aio_get_return_value(c);
+  awa->callback(awa->aiop, rc == 0 ? awa->nbBytes : rc);
+  delete(awa);
+}
+
+/// sends an aio write to ceph
+static ssize_t aioWriteToCeph(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                              XrdSfsAio *aiop, AioCB *cb) {
+  if (g_deadlineMs[DL_WRITE]) {
+    return deadlineAioWrite(fr, striper, aiop, cb);
+  }
+  // get the parameters from the Xroot aio object
+  size_t count = aiop->sfsAio.aio_nbytes;
+  const char *buf = (const char*)aiop->sfsAio.aio_buf;
+  size_t offset = aiop->sfsAio.aio_offset;
+  // prepare a bufferlist around the given buffer
+  ceph::bufferlist bl;
+  bl.append(buf, count);
+  // get the poolIdx to use
+  int cephPoolIdx = getCephPoolIdxAndIncrease();
+  // Get the cluster to use
+  librados::Rados* cluster = checkAndCreateCluster(cephPoolIdx);
+  if (0 == cluster) {
+    return -EINVAL;
+  }
+  // prepare a ceph AioCompletion object and do async call
+  AioArgs *args = new AioArgs(aiop, cb, count);
+  librados::AioCompletion *completion =
+    cluster->aio_create_completion(args, ceph_aio_write_complete, NULL);
+  // do the write
+  int rc = striper->aio_write(fr.name, completion, bl, count, offset);
+  completion->release();
+  if (rc) delete args;
+  return rc;
+}
+
+/// small struct remembering the file of an aio write whose data are
+/// checksummed, keyed by its XrdSfsAio
+struct ChecksummedAio {
+  AioCB *callback;
+  int fd;
+};
+std::map<XrdSfsAio*, ChecksummedAio> g_checksummedAios;
+XrdSysMutex g_checksummedAiosMutex;
+
+/// callback of checksummed aio writes, dropping the checksums of the file
+/// when the write failed before calling the original callback
+static void checksummedAioComplete(XrdSfsAio *aiop, size_t rc) {
+  ChecksummedAio ca;
+  {
+    XrdSysMutexHelper lock(g_checksummedAiosMutex);
+    std::map<XrdSfsAio*, ChecksummedAio>::iterator it = g_checksummedAios.find(aiop);
+    ca = it->second;
+    g_checksummedAios.erase(it);
+  }
+  if ((ssize_t)rc < 0) {
+    CephFileRef* fr = getFileRef(ca.fd);
+    if (fr) dropWriteChecksum(*fr);
+  }
+  ca.callback(aiop, rc);
+}
+
+ssize_t ceph_aio_write(int fd, XrdSfsAio *aiop, AioCB *cb) {
+  CephFileRef* fr = getFileRef(fd);
+  if (fr) {
+    // TODO implement proper logging level for this plugin - this should be only debug
+    //logwrapper((char*)"ceph_aio_write: for fd %d, count=%d", fd, aiop->sfsAio.aio_nbytes);
+    if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
+      return -EBADF;
+    }
+    // get the striper object
+    libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
+    if (0 == striper) {
       return -EINVAL;
     }
-    // prepare a ceph AioCompletion object and do async call
-    AioArgs *args = new AioArgs(aiop, cb, count);
-    librados::AioCompletion *completion =
-      cluster->aio_create_completion(args, ceph_aio_write_complete, NULL);
-    // do the write
-    int rc = striper->aio_write(fr->name, completion, bl, count, offset);
-    completion->release();
+    invalidateCaches(*fr);
+    int dropRc = dropPageChecksums(*fr, aiop->sfsAio.aio_offset, aiop->sfsAio.aio_nbytes);
+    if (dropRc) return dropRc;
+    if (fr->compress) {
+      // writes of compressed files are served synchronously, as they only
+      // fill blocks in memory until these are complete
+      ssize_t rc = pwriteFileRef(fd, *fr, (const void*)aiop->sfsAio.aio_buf,
+                                 aiop->sfsAio.aio_nbytes, aiop->sfsAio.aio_offset);
+      if (rc < 0) return rc;
+      cb(aiop, rc);
+      return 0;
+    }
+    countEcWrite(*fr, aiop->sfsAio.aio_nbytes, aiop->sfsAio.aio_offset);
+    // aio writes are checksummed in submission order, a failure makes the
+    // upload fail, and a retry at the same offset triggers a read back at close
+    updateWriteChecksum(*fr, (const char*)aiop->sfsAio.aio_buf,
+                        aiop->sfsAio.aio_nbytes, aiop->sfsAio.aio_offset);
+    if (fr->writeCks) {
+      XrdSysMutexHelper lock(g_checksummedAiosMutex);
+      ChecksummedAio &ca = g_checksummedAios[aiop];
+      ca.callback = cb;
+      ca.fd = fd;
+      cb = checksummedAioComplete;
+    }
+    ssize_t rc = admittedAio(fd, *fr, striper, aiop, cb, aioWriteToCeph, DL_WRITE);
+    if (rc) {
+      dropWriteChecksum(*fr);
+      XrdSysMutexHelper lock(g_checksummedAiosMutex);
+      g_checksummedAios.erase(aiop);
+    }
     return rc;
   } else {
     return -EBADF;
@@ -792,10 +6717,16 @@ ssize_t ceph_posix_read(int fd, void *buf, size_t count) {
     if (0 == striper) {
       return -EINVAL;
     }
-    ceph::bufferlist bl;
-    int rc = striper->read(fr->name, &bl, count, fr->offset);
+    if (fr->cacheVersion || fr->compress) {
+      ssize_t rc = fr->compress ? compressedRead(*fr, striper, (char*)buf, count, fr->offset)
+                                : cachedPread(*fr, striper, (char*)buf, count, fr->offset);
+      if (rc < 0) return rc;
+      fr->offset += rc;
+      fr->rdcount++;
+      return rc;
+    }
+    ssize_t rc = admittedRead(fd, *fr, striper, (char*)buf, count, fr->offset);
     if (rc < 0) return rc;
-    bl.copy(0, rc, (char*)buf);
     fr->offset += rc;
     fr->rdcount++;
     return rc;
@@ -816,10 +6747,14 @@ ssize_t ceph_posix_pread(int fd, void *buf, size_t count, off64_t offset) {
     if (0 == striper) {
       return -EINVAL;
     }
-    ceph::bufferlist bl;
-    int rc = striper->read(fr->name, &bl, count, offset);
+    if (fr->cacheVersion || fr->compress) {
+      ssize_t rc = fr->compress ? compressedRead(*fr, striper, (char*)buf, count, offset)
+                                : cachedPread(*fr, striper, (char*)buf, count, offset);
+      if (rc >= 0) fr->rdcount++;
+      return rc;
+    }
+    ssize_t rc = admittedRead(fd, *fr, striper, (char*)buf, count, offset);
     if (rc < 0) return rc;
-    bl.copy(0, rc, (char*)buf);
     fr->rdcount++;
     return rc;
   } else {
@@ -841,6 +6776,38 @@ static void ceph_aio_read_complete(rados_completion_t c, void *arg) {
   delete(awa);
 }
 
+/// sends an aio read to ceph, bypassing the caches
+static ssize_t aioReadFromCeph(const CephFileRef &fr, libradosstriper::RadosStriper *striper,
+                               XrdSfsAio *aiop, AioCB *cb) {
+  if (asyncReads() || RP_PRIMARY != readPolicy(fr)) {
+    return coalescedAioRead(fr, striper, aiop, cb);
+  }
+  // get the parameters from the Xroot aio object
+  size_t count = aiop->sfsAio.aio_nbytes;
+  size_t offset = aiop->sfsAio.aio_offset;
+  // get the poolIdx to use
+  int cephPoolIdx = getCephPoolIdxAndIncrease();
+  // Get the cluster to use
+  librados::Rados* cluster = checkAndCreateCluster(cephPoolIdx);
+  if (0 == cluster) {
+    return -EINVAL;
+  }
+  // prepare a bufferlist to receive data
+  ceph::bufferlist *bl = new ceph::bufferlist();
+  // prepare a ceph AioCompletion object and do async call
+  AioArgs *args = new AioArgs(aiop, cb, count, bl);
+  librados::AioCompletion *completion =
+    cluster->aio_create_completion(args, ceph_aio_read_complete, NULL);
+  // do the read
+  int rc = striper->aio_read(fr.name, completion, bl, count, offset);
+  completion->release();
+  if (rc) {
+    delete bl;
+    delete args;
+  }
+  return rc;
+}
+
 ssize_t ceph_aio_read(int fd, XrdSfsAio *aiop, AioCB *cb) {
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
@@ -857,28 +6824,77 @@ ssize_t ceph_aio_read(int fd, XrdSfsAio *aiop, AioCB *cb) {
     if (0 == striper) {
       return -EINVAL;
     }
-    // prepare a bufferlist to receive data
-    ceph::bufferlist *bl = new ceph::bufferlist();
-    // get the poolIdx to use
-    int cephPoolIdx = getCephPoolIdxAndIncrease();
-    // Get the cluster to use
-    librados::Rados* cluster = checkAndCreateCluster(cephPoolIdx);
-    if (0 == cluster) {
-      return -EINVAL;
+    if (fr->compress) {
+      // reads of compressed files are served synchronously, block by block
+      ssize_t rc = compressedRead(*fr, striper, (char*)aiop->sfsAio.aio_buf, count, offset);
+      if (rc < 0) return rc;
+      cb(aiop, rc);
+      return 0;
     }
-    // prepare a ceph AioCompletion object and do async call
-    AioArgs *args = new AioArgs(aiop, cb, count, bl);
-    librados::AioCompletion *completion =
-      cluster->aio_create_completion(args, ceph_aio_read_complete, NULL);
-    // do the read
-    int rc = striper->aio_read(fr->name, completion, bl, count, offset);
-    completion->release();
-    return rc;
+    if (fr->cacheVersion) {
+      if (g_diskCache || isFederated(*fr)) {
+        // with a disk cache, reads are served synchronously : hits are local
+        // and misses fetch whole segments that are then stored on disk.
+        // Reads of federated pools are also synchronous, to fail over between clusters
+        ssize_t rc = cachedPread(*fr, striper, (char*)aiop->sfsAio.aio_buf, count, offset);
+        if (rc < 0) return rc;
+        cb(aiop, rc);
+        return 0;
+      }
+      return blockCacheAioRead(*fr, striper, aiop, cb);
+    }
+    if (isFederated(*fr)) {
+      // reads of federated pools are served synchronously, so that they can
+      // fail over from one cluster to the next
+      ssize_t rc = admittedRead(fd, *fr, striper, (char*)aiop->sfsAio.aio_buf, count, offset);
+      if (rc < 0) return rc;
+      cb(aiop, rc);
+      return 0;
+    }
+    return admittedAio(fd, *fr, striper, aiop, cb, aioReadFromCeph, DL_READ);
   } else {
     return -EBADF;
   }
 }
 
+ssize_t ceph_posix_pgread(int fd, void *buf, size_t count, off64_t offset,
+                          uint32_t *csvec, bool verify) {
+  CephFileRef* fr = getFileRef(fd);
+  if (0 == fr) {
+    return -EBADF;
+  }
+  // stored checksums are looked up while the data is read
+  PageCksFetch *fetch = 0;
+  if ((csvec || verify) && storesPageChecksums(*fr)) {
+    fetch = startPageCksFetch(*fr, offset, count);
+  }
+  ssize_t rc = ceph_posix_pread(fd, buf, count, offset);
+  size_t nbPages = rc > 0 ? XrdCephChecksum::pageCount(offset, rc) : 0;
+  std::vector<uint32_t> stored(nbPages);
+  std::vector<bool> known(nbPages, false);
+  size_t nbKnown = 0;
+  if (fetch) nbKnown = finishPageCksFetch(fetch, offset, rc > 0 ? rc : 0, stored, known);
+  if (rc <= 0 || (0 == csvec && !verify)) return rc;
+  if (!verify && nbKnown == nbPages) {
+    std::copy(stored.begin(), stored.end(), csvec);
+    __sync_fetch_and_add(&g_pageCksNbReused, nbPages);
+    return rc;
+  }
+  std::vector<uint32_t> computed(nbPages);
+  XrdCephChecksum::pageCrc32c((const unsigned char*)buf, rc, offset, &computed[0]);
+  __sync_fetch_and_add(&g_pageCksNbComputed, nbPages);
+  for (size_t i = 0; verify && i < nbPages; i++) {
+    if (known[i] && stored[i] != computed[i]) {
+      __sync_fetch_and_add(&g_pageCksNbMismatches, 1);
+      logwrapper((char*)"ceph_posix_pgread : checksum mismatch for %s at offset %lld",
+                 fr->name.c_str(), (long long)offset);
+      return -EDOM;
+    }
+  }
+  if (csvec) std::copy(computed.begin(), computed.end(), csvec);
+  return rc;
+}
+
 int ceph_posix_fstat(int fd, struct stat *buf) {
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
@@ -896,6 +6912,11 @@ int ceph_posix_fstat(int fd, struct stat *buf) {
     if (rc != 0) {
       return -rc;
     }
+    // compressed files may have blocks not yet written
+    if (fr->compress) {
+      XrdSysMutexHelper lock(fr->compress->mutex);
+      buf->st_size = fr->compress->map.size;
+    }
     buf->st_mtime = buf->st_atime;
     buf->st_ctime = buf->st_atime;
     buf->st_mode = 0666 | S_IFREG;
@@ -916,13 +6937,41 @@ int ceph_posix_stat(XrdOucEnv* env, const char *pathname, struct stat *buf) {
     return -EINVAL;
   }
   memset(buf, 0, sizeof(*buf));
-  int rc = striper->stat(file.name, (uint64_t*)&(buf->st_size), &(buf->st_atime));
+  if (g_metaCache && metaCacheStat(file, buf)) {
+    return 0;
+  }
+  int rc;
+  bool absent = negLookupIsAbsent(file);
+  if (absent && g_negLookupTrusted) {
+    // the negative lookup filter knows the file does not exist
+    rc = -ENOENT;
+  } else {
+    if (g_cephCoalesceReads) {
+      rc = coalescedStat(file, striper, (uint64_t*)&(buf->st_size), &(buf->st_atime));
+    } else {
+      rc = statWithDeadline(file, striper, (uint64_t*)&(buf->st_size), &(buf->st_atime), DL_STAT);
+    }
+    if (-ENOENT == rc && !absent) negLookupFalsePositive(file);
+    if (0 == rc && absent) negLookupStale(file);
+  }
+  if (g_metaCache) {
+    if (0 == rc) {
+      g_metaCache->putStat(fileCacheKey(file), buf->st_size, buf->st_atime);
+    } else if (-ENOENT == rc) {
+      g_metaCache->remove(fileCacheKey(file));
+    }
+  }
   if (rc != 0) {
     // for non existing file. Check that we did not open it for write recently
     // in that case, we return 0 size and current time
     if (-ENOENT == rc && isOpenForWrite(file.name)) {
       buf->st_size = 0;
       buf->st_atime = time(NULL);
+    } else if (-ENOENT == rc && g_cephNameIndexNbShards > 0 &&
+               nameIndexDirExists(file) > 0) {
+      // a pseudo directory of the name index
+      buf->st_mode = S_IFDIR | 0755;
+      return 0;
     } else {
       return -rc;
     }
@@ -937,6 +6986,7 @@ int ceph_posix_fsync(int fd) {
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_sync: fd %d", fd);
+    if (fr->compress) return compressFlush(*fr);
     return 0;
   } else {
     return -EBADF;
@@ -959,15 +7009,47 @@ int ceph_posix_fcntl(int fd, int cmd, ... /* arg */ ) {
   }
 }
 
+/// prefix of the xattrs holding the state of this plugin (tiering, compression,
+/// page checksums). They are hidden from clients, who could otherwise corrupt
+/// that state by changing them
+static const char g_internalXattrPrefix[] = "xrdceph.";
+
+static bool internalXattr(const char *name) {
+  return 0 == strncmp(name, g_internalXattrPrefix, sizeof(g_internalXattrPrefix)-1);
+}
+
 static ssize_t ceph_posix_internal_getxattr(const CephFile &file, const char* name,
                                             void* value, size_t size) {
+  if (internalXattr(name)) {
+    return -ENODATA;
+  }
   libradosstriper::RadosStriper *striper = getRadosStriper(file);
   if (0 == striper) {
     return -EINVAL;
   }
+  if (g_metaCache) {
+    std::string cached;
+    time_t validated;
+    // reloaded attributes are not revalidated in the background like stats,
+    // so they are only trusted once fetched again from ceph
+    if (g_metaCache->getXattr(fileCacheKey(file), name, cached, validated) &&
+        0 != validated && difftime(time(NULL), validated) < g_metaCacheTtl) {
+      __sync_fetch_and_add(&g_metaCacheNbHits, 1);
+      size_t returned_size = cached.size()<size?cached.size():size;
+      memcpy(value, cached.c_str(), returned_size);
+      return returned_size;
+    }
+    __sync_fetch_and_add(&g_metaCacheNbMisses, 1);
+  }
   ceph::bufferlist bl;
   int rc = striper->getxattr(file.name, name, bl);
+  if (-ENODATA == rc && g_cephOsdChecksums && !strcmp(name, "XrdCks.crc32c")) {
+    return osdChecksumXattr(file, striper, value, size);
+  }
   if (rc < 0) return rc;
+  if (g_metaCache) {
+    g_metaCache->putXattr(fileCacheKey(file), name, std::string(bl.c_str(), bl.length()));
+  }
   size_t returned_size = (size_t)rc<size?rc:size;
   bl.copy(0, returned_size, (char*)value);
   return returned_size;
@@ -993,6 +7075,9 @@ ssize_t ceph_posix_fgetxattr(int fd, const char* name,
 
 static ssize_t ceph_posix_internal_setxattr(const CephFile &file, const char* name,
                                             const void* value, size_t size, int flags) {
+  if (internalXattr(name)) {
+    return -EPERM;
+  }
   libradosstriper::RadosStriper *striper = getRadosStriper(file);
   if (0 == striper) {
     return -EINVAL;
@@ -1003,6 +7088,9 @@ static ssize_t ceph_posix_internal_setxattr(const CephFile &file, const char* na
   if (rc) {
     return -rc;
   }
+  if (g_metaCache) {
+    g_metaCache->putXattr(fileCacheKey(file), name, std::string((const char*)value, size));
+  }
   return 0;
 }
 
@@ -1026,6 +7114,9 @@ int ceph_posix_fsetxattr(int fd,
 }
 
 static int ceph_posix_internal_removexattr(const CephFile &file, const char* name) {
+  if (internalXattr(name)) {
+    return -EPERM;
+  }
   libradosstriper::RadosStriper *striper = getRadosStriper(file);
   if (0 == striper) {
     return -EINVAL;
@@ -1034,6 +7125,9 @@ static int ceph_posix_internal_removexattr(const CephFile &file, const char* nam
   if (rc) {
     return -rc;
   }
+  if (g_metaCache) {
+    g_metaCache->removeXattr(fileCacheKey(file), name);
+  }
   return 0;
 }
 
@@ -1070,6 +7164,7 @@ static int ceph_posix_internal_listxattrs(const CephFile &file, XrdSysXAttr::ALi
   for (std::map<std::string, ceph::bufferlist>::const_iterator it = attrset.begin();
        it != attrset.end();
        it++) {
+    if (internalXattr(it->first.c_str())) continue;
     XrdSysXAttr::AList* newItem = (XrdSysXAttr::AList*)malloc(sizeof(XrdSysXAttr::AList)+it->first.size());
     newItem->Next = *aPL;
     newItem->Vlen = it->second.length();
@@ -1135,6 +7230,9 @@ static int ceph_posix_internal_truncate(const CephFile &file, unsigned long long
   if (0 == striper) {
     return -EINVAL;
   }
+  invalidateCaches(file);
+  int rc = truncatePageChecksums(file, size);
+  if (rc) return rc;
   return striper->trunc(file.name, size);
 }
 
@@ -1142,6 +7240,9 @@ int ceph_posix_ftruncate(int fd, unsigned long long size) {
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_posix_ftruncate: fd %d, size %d", fd, size);
+    dropWriteChecksum(*fr);
+    int rc = compressTruncate(*fr, fr->compress, size);
+    if (rc) return rc;
     return ceph_posix_internal_truncate(*fr, size);
   } else {
     return -EBADF;
@@ -1152,59 +7253,842 @@ int ceph_posix_truncate(XrdOucEnv* env, const char *pathname, unsigned long long
   logwrapper((char*)"ceph_posix_truncate : %s", pathname);
   // minimal stat : only size and times are filled
   CephFile file = getCephFile(pathname, env);
+  int rc = reclaimSync(file);
+  if (rc) return rc;
+  rc = tierRecall(file);
+  if (rc) return rc;
+  rc = compressTruncate(file, 0, size);
+  if (rc) return rc;
+  if (deferTruncate(file, size, rc)) return rc;
   return ceph_posix_internal_truncate(file, size);
 }
 
-int ceph_posix_unlink(XrdOucEnv* env, const char *pathname) {
-  logwrapper((char*)"ceph_posix_unlink : %s", pathname);
-  // minimal stat : only size and times are filled
-  CephFile file = getCephFile(pathname, env);
+/// removes a file, deferring the removal of most objects of large ones unless
+/// deferred is false, e.g. when the objects are about to be rewritten
+static int unlinkFile(const CephFile &file, bool deferred = true) {
   libradosstriper::RadosStriper *striper = getRadosStriper(file);
   if (0 == striper) {
     return -EINVAL;
   }
-  return striper->remove(file.name);
+  invalidateCaches(file);
+  int rc = tierUnlink(file);
+  if (rc) return rc;
+  if (!deferred || !deferUnlink(file, rc)) rc = striper->remove(file.name);
+  if (0 == rc) {
+    negLookupRemoved(file);
+  }
+  if (g_cephNameIndexNbShards > 0 && (0 == rc || -ENOENT == rc)) {
+    nameIndexRemove(file);
+  }
+  return rc;
+}
+
+int ceph_posix_unlink(XrdOucEnv* env, const char *pathname) {
+  logwrapper((char*)"ceph_posix_unlink : %s", pathname);
+  return unlinkFile(getCephFile(pathname, env));
+}
+
+/// number of objects copied in parallel by server side copies
+static const unsigned int g_copyDepth = 32;
+/// number of files copied or renamed on the server side, and of failures
+unsigned long long g_copyNbFiles = 0;
+unsigned long long g_copyNbObjects = 0;
+unsigned long long g_copyNbFailed = 0;
+/// suffix of the copies made next to the existing files they replace, followed
+/// by a unique identifier, and number of such copies made
+static const char *g_copyTmpSuffix = ".xrdcephcp.";
+unsigned long long g_copyNbTmp = 0;
+
+/// copy of an object in flight
+struct ObjectCopy {
+  unsigned long long objectNo;
+  librados::AioCompletion *completion;
+};
+
+/// waits for the copy of an object. Missing source objects are holes of the file
+static int finishObjectCopy(ObjectCopy &copy) {
+  copy.completion->wait_for_complete();
+  int rc = copy.completion->get_return_value();
+  copy.completion->release();
+  if (-ENOENT == rc && copy.objectNo > 0) return 0;
+  return rc;
+}
+
+/// copies the objects of a file, in parallel, with copy_from operations run by
+/// the OSDs. As the data, xattrs and omap of each object are copied, the
+/// layout, size and checksums of the file are carried over. The first object
+/// is copied last, so that the destination only appears once complete, or not
+/// at all when firstObject is false
+static int copyObjects(const CephFile &src, const CephFile &dst, unsigned long long count,
+                       bool firstObject) {
+  librados::IoCtx *srcIoctx = getIoCtx(src);
+  librados::IoCtx *dstIoctx = getIoCtx(dst);
+  librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+  if (0 == srcIoctx || 0 == dstIoctx || 0 == cluster) {
+    return -EINVAL;
+  }
+  int rc = 0;
+  std::deque<ObjectCopy> inflight;
+  // objects are numbered from 1 to count, the first one being copied last
+  unsigned long long last = firstObject ? count : count - 1;
+  unsigned long long next = 1;
+  while (!inflight.empty() || (0 == rc && next <= last)) {
+    while (0 == rc && next <= last && inflight.size() < g_copyDepth) {
+      // the first object waits for all others
+      if (next == count && !inflight.empty()) break;
+      ObjectCopy copy;
+      copy.objectNo = next % count;
+      librados::ObjectWriteOperation op;
+      op.copy_from(getObjectName(src.name, copy.objectNo), *srcIoctx, 0, 0);
+      copy.completion = cluster->aio_create_completion();
+      rc = dstIoctx->aio_operate(getObjectName(dst.name, copy.objectNo), copy.completion, &op);
+      if (rc) {
+        copy.completion->release();
+        break;
+      }
+      inflight.push_back(copy);
+      next++;
+    }
+    if (inflight.empty()) break;
+    int copyRc = finishObjectCopy(inflight.front());
+    inflight.pop_front();
+    if (0 == rc && copyRc) rc = copyRc;
+  }
+  if (rc) {
+    // do not leave a partial copy behind
+    removeObjects(dstIoctx, dst.name, firstObject ? 0 : 1, count);
+    return rc;
+  }
+  __sync_fetch_and_add(&g_copyNbObjects, last);
+  return 0;
+}
+
+/// copies a file within the cluster, replacing the destination if it exists
+static int copyFile(const CephFile &src, const CephFile &dst) {
+  if (src.name == dst.name && src.pool == dst.pool) {
+    return -EINVAL;
+  }
+  // the OSDs can only copy objects within a cluster
+  if (homeCluster(src) != homeCluster(dst)) {
+    return -EXDEV;
+  }
+  librados::IoCtx *srcIoctx = getIoCtx(src);
+  if (0 == srcIoctx) {
+    return -EINVAL;
+  }
+  // the OSDs copy the data of the objects, which must be back in place
+  int rc = tierRecall(src);
+  if (rc) return rc;
+  // the destination is only replaced when the source exists
+  CephFile layout;
+  unsigned long long size;
+  rc = readStriperLayout(srcIoctx, src.name, layout, size);
+  if (rc) return rc;
+  rc = reclaimSync(dst);
+  if (rc) return rc;
+  unsigned long long count = std::max(1ULL, objectCount(layout, size));
+  librados::IoCtx *dstIoctx = getIoCtx(dst);
+  if (0 == dstIoctx) {
+    return -EINVAL;
+  }
+  CephFile dstLayout;
+  unsigned long long dstSize;
+  rc = readStriperLayout(dstIoctx, dst.name, dstLayout, dstSize);
+  if (rc && rc != -ENOENT) return rc;
+  if (0 == rc) {
+    // an existing destination is only replaced once the file was copied next
+    // to it, so that a failed copy leaves the destination untouched
+    CephFile tmp = dst;
+    std::ostringstream ss;
+    ss << dst.name << g_copyTmpSuffix << XrdCephTimer::nowMs() << '.' << getpid() << '.'
+       << __sync_fetch_and_add(&g_copyNbTmp, 1);
+    tmp.name = ss.str();
+    rc = copyObjects(src, tmp, count);
+    // the objects of the destination are removed at once, as a deferred removal
+    // would be queued for the reclaimer and later remove the copied objects
+    if (0 == rc) rc = unlinkFile(dst, false);
+    if (0 == rc || -ENOENT == rc) {
+      invalidateCaches(dst);
+      rc = copyObjects(tmp, dst, count);
+    }
+    removeObjects(dstIoctx, tmp.name, 0, count);
+  } else {
+    invalidateCaches(dst);
+    rc = copyObjects(src, dst, count);
+  }
+  if (rc) {
+    __sync_fetch_and_add(&g_copyNbFailed, 1);
+    return rc;
+  }
+  negLookupAdd(dst);
+  if (g_cephNameIndexNbShards > 0) {
+    nameIndexAdd(dst);
+  }
+  __sync_fetch_and_add(&g_copyNbFiles, 1);
+  return 0;
+}
+
+int ceph_posix_copy(XrdOucEnv* env1, const char *from, XrdOucEnv* env2, const char *to) {
+  logwrapper((char*)"ceph_posix_copy : %s to %s", from, to);
+  return copyFile(getCephFile(from, env1), getCephFile(to, env2));
+}
+
+int ceph_posix_rename(XrdOucEnv* env1, const char *from, XrdOucEnv* env2, const char *to) {
+  logwrapper((char*)"ceph_posix_rename : %s to %s", from, to);
+  CephFile src = getCephFile(from, env1);
+  int rc = copyFile(src, getCephFile(to, env2));
+  if (rc) return rc;
+  // the source is only removed once every object was copied
+  return unlinkFile(src);
+}
+
+/// appends the statistics of server side copies to a stream
+static void copyStats(std::ostringstream &ss) {
+  if (0 == g_copyNbFiles && 0 == g_copyNbFailed) return;
+  ss << "<copy>"
+     << "<files>" << g_copyNbFiles << "</files>"
+     << "<objects>" << g_copyNbObjects << "</objects>"
+     << "<failed>" << g_copyNbFailed << "</failed>"
+     << "</copy>";
+}
+
+/// number of files removed in parallel by bulk deletions
+/// may be overwritten by the xrdcephrm tool
+unsigned int g_cephBulkDeleteDepth = 64;
+
+/// removal of a file in flight during a bulk deletion
+struct BulkRemoval {
+  /// index of the file in the list to delete
+  size_t idx;
+  CephFile file;
+  librados::AioCompletion *completion;
+};
+
+/// records the result of the removal of a file, waiting for it if it is in flight
+static void finishBulkRemoval(BulkRemoval &removal, int rc, std::vector<int> &results) {
+  if (removal.completion) {
+    removal.completion->wait_for_complete();
+    rc = removal.completion->get_return_value();
+    removal.completion->release();
+  }
+  if (0 == rc) {
+    negLookupRemoved(removal.file);
+  }
+  if (g_cephNameIndexNbShards > 0 && (0 == rc || -ENOENT == rc)) {
+    nameIndexRemove(removal.file);
+  }
+  results[removal.idx] = rc;
+}
+
+/// removes a list of files, with up to g_cephBulkDeleteDepth removals in flight,
+/// spread over the connections to the cluster. results gets the return code
+/// of each removal, in the order of paths
+int ceph_posix_unlink_bulk(XrdOucEnv* env, const std::vector<std::string> &paths,
+                           std::vector<int> &results) {
+  logwrapper((char*)"ceph_posix_unlink_bulk : %d files", (int)paths.size());
+  results.assign(paths.size(), 0);
+  std::deque<BulkRemoval> inflight;
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (inflight.size() >= g_cephBulkDeleteDepth) {
+      finishBulkRemoval(inflight.front(), 0, results);
+      inflight.pop_front();
+    }
+    BulkRemoval removal;
+    removal.idx = i;
+    try {
+      removal.file = getCephFile(paths[i].c_str(), env);
+    } catch (std::exception &e) {
+      results[i] = -EINVAL;
+      continue;
+    }
+    // each file takes the next connection
+    libradosstriper::RadosStriper *striper = getRadosStriper(removal.file);
+    librados::Rados* cluster = checkAndCreateCluster(getCephPoolIdxAndIncrease());
+    if (0 == striper || 0 == cluster) {
+      results[i] = -EINVAL;
+      continue;
+    }
+    invalidateCaches(removal.file);
+    int rc = tierUnlink(removal.file);
+    if (rc) {
+      results[i] = rc;
+      continue;
+    }
+    if (deferUnlink(removal.file, rc)) {
+      removal.completion = 0;
+      finishBulkRemoval(removal, rc, results);
+      continue;
+    }
+    removal.completion = cluster->aio_create_completion();
+    rc = striper->aio_remove(removal.file.name, removal.completion);
+    if (rc) {
+      removal.completion->release();
+      results[i] = rc;
+      continue;
+    }
+    inflight.push_back(removal);
+  }
+  while (!inflight.empty()) {
+    finishBulkRemoval(inflight.front(), 0, results);
+    inflight.pop_front();
+  }
+  return 0;
+}
+
+/// parses the cephListShard entry of the environment, with syntax <i>/<n>
+/// fills shardIdx and nbShards. They are 0 and 1 when the entry is missing
+/// may throw std::invalid_argument or std::out_of_range in case of error
+static void getListShard(XrdOucEnv *env, unsigned int &shardIdx, unsigned int &nbShards) {
+  shardIdx = 0;
+  nbShards = 1;
+  if (0 == env) return;
+  char* cshard = env->Get("cephListShard");
+  if (0 == cshard) return;
+  std::string shard = cshard;
+  size_t slashPos = shard.find('/');
+  if (std::string::npos == slashPos) {
+    throw std::invalid_argument(shard);
+  }
+  shardIdx = stoui(shard.substr(0, slashPos));
+  nbShards = stoui(shard.substr(slashPos+1));
+  if (0 == nbShards || shardIdx >= nbShards) {
+    throw std::out_of_range(shard);
+  }
+}
+
+/// pushes a name to the listing queue, waiting for space if needed
+/// returns false if the listing was stopped in the mean time
+static bool pushListedName(DirIterator *dir, const std::string &name) {
+  XrdSysCondVarHelper lock(dir->m_cond);
+  while (dir->m_names.size() >= g_cephListQueueSize && !dir->m_stop) {
+    dir->m_cond.Wait();
+  }
+  if (dir->m_stop) return false;
+  dir->m_names.push_back(name);
+  dir->m_cond.Broadcast();
+  return true;
+}
+
+/// appends a string to a bufferlist using the ceph encoding,
+/// that is a little endian 32 bits length followed by the characters
+static void encodeString(ceph::bufferlist &bl, const std::string &s) {
+  unsigned int len = s.size();
+  char lenBuf[4];
+  for (unsigned int i = 0; i < 4; i++) {
+    lenBuf[i] = (len >> (8*i)) & 0xFF;
+  }
+  bl.append(lenBuf, 4);
+  bl.append(s.c_str(), len);
+}
+
+/// sets the server side filter used when listing pools
+/// type is either 'plain', in which case arg1 and arg2 are the name and the
+/// expected value of a user xattr, or the '<class>.<filter>' name of a filter
+/// provided by an object class, in which case arg1 is an optional argument
+/// given to it. A 0 or empty type removes the filter
+/// returns 0 or -EINVAL in case of invalid arguments
+int ceph_posix_set_listfilter(const char *type, const char *arg1, const char *arg2) {
+  ceph::bufferlist filter;
+  if (0 != type && 0 != *type) {
+    std::string stype = type;
+    if (stype == "plain") {
+      if (0 == arg1 || 0 == arg2) return -EINVAL;
+      encodeString(filter, stype);
+      // user xattrs are stored with a '_' prefix on the OSDs
+      encodeString(filter, std::string("_") + arg1);
+      encodeString(filter, arg2);
+    } else if (stype.find('.') != std::string::npos) {
+      encodeString(filter, stype);
+      if (0 != arg1) encodeString(filter, arg1);
+    } else {
+      return -EINVAL;
+    }
+  }
+  g_cephListFilter = filter;
+  g_cephListFilterSupported = true;
+  return 0;
+}
+
+/// lists one batch of objects, applying the server side filter when possible
+/// falls back to an unfiltered listing if the OSDs do not support the filter
+static int listBatch(librados::IoCtx *ioctx, const librados::ObjectCursor &start,
+                     const librados::ObjectCursor &finish,
+                     std::vector<librados::ObjectItem> *items,
+                     librados::ObjectCursor *next) {
+  if (g_cephListFilterSupported && g_cephListFilter.length() > 0) {
+    int rc = ioctx->object_list(start, finish, g_cephListBatchSize,
+                                g_cephListFilter, items, next);
+    if (rc != -EINVAL && rc != -EOPNOTSUPP) return rc;
+    if (g_cephListFilterSupported) {
+      logwrapper((char*)"ceph_posix_readdir : listing filter refused by OSDs, rc = %d, filtering locally", rc);
+      g_cephListFilterSupported = false;
+    }
+    items->clear();
+  }
+  return ioctx->object_list(start, finish, g_cephListBatchSize,
+                            ceph::bufferlist(), items, next);
+}
+
+/// scans one range of the object hash space and queues the file names found
+/// returns 0 or a negative error code
+static int listRange(DirIterator *dir, librados::IoCtx *ioctx,
+                     const librados::ObjectCursor &start,
+                     const librados::ObjectCursor &finish) {
+  librados::ObjectCursor cursor = start;
+  while (cursor < finish) {
+    std::vector<librados::ObjectItem> items;
+    int rc = listBatch(ioctx, cursor, finish, &items, &cursor);
+    if (rc < 0) return rc;
+    for (std::vector<librados::ObjectItem>::const_iterator it = items.begin();
+         it != items.end();
+         it++) {
+      // only keep the first object of each striped file. This is also
+      // checked when a server side filter is used, as filters may be loose
+      if (it->oid.size() < g_firstObjectSuffixLen ||
+          it->oid.compare(it->oid.size()-g_firstObjectSuffixLen,
+                          g_firstObjectSuffixLen, g_firstObjectSuffix)) {
+        continue;
+      }
+      if (!pushListedName(dir, it->oid.substr(0, it->oid.size()-g_firstObjectSuffixLen))) {
+        return 0;
+      }
+    }
+    if (ioctx->object_list_is_end(cursor)) break;
+  }
+  return 0;
+}
+
+/// entry point of the listing threads
+/// each thread takes ranges from the DirIterator until none is left
+static void* listWorker(void *arg) {
+  DirIterator *dir = (DirIterator*)arg;
+  // spread the listing threads over the connections to ceph
+  librados::IoCtx *ioctx = getIoCtx(dir->m_file);
+  int rc = (0 == ioctx) ? -EINVAL : 0;
+  while (0 == rc) {
+    std::pair<librados::ObjectCursor, librados::ObjectCursor> range;
+    {
+      XrdSysCondVarHelper lock(dir->m_cond);
+      if (dir->m_stop || dir->m_nextRange >= dir->m_ranges.size()) break;
+      range = dir->m_ranges[dir->m_nextRange];
+      dir->m_nextRange++;
+    }
+    rc = listRange(dir, ioctx, range.first, range.second);
+  }
+  XrdSysCondVarHelper lock(dir->m_cond);
+  if (rc < 0) {
+    logwrapper((char*)"ceph_posix_readdir : listing of pool %s failed, rc = %d",
+               dir->m_file.pool.c_str(), rc);
+    if (0 == dir->m_rc) dir->m_rc = rc;
+    dir->m_stop = true;
+  }
+  dir->m_nbActiveWorkers--;
+  dir->m_cond.Broadcast();
+  return 0;
+}
+
+/// stops the listing threads of a DirIterator and waits for them
+/// The DirIterator can only be deleted afterwards, as the threads use it
+static void stopListing(DirIterator *dir) {
+  {
+    XrdSysCondVarHelper lock(dir->m_cond);
+    dir->m_stop = true;
+    dir->m_cond.Broadcast();
+  }
+  for (std::vector<pthread_t>::const_iterator it = dir->m_workers.begin();
+       it != dir->m_workers.end();
+       it++) {
+    XrdSysThread::Join(*it, 0);
+  }
+  dir->m_workers.clear();
+}
+
+/// opens a listing of the whole pool, or of the given shard of it
+/// returns 0 and sets errno in case of failure
+static DirIterator* openPoolListing(const CephFile &file, unsigned int shardIdx,
+                                    unsigned int nbShards) {
+  librados::IoCtx *ioctx = getIoCtx(file);
+  if (0 == ioctx) {
+    errno = EINVAL;
+    return 0;
+  }
+  DirIterator* res = new DirIterator();
+  res->m_file = file;
+  // restrict ourselves to the requested shard of the pool and split it
+  // into ranges to be scanned in parallel
+  librados::ObjectCursor shardStart, shardFinish;
+  ioctx->object_list_slice(ioctx->object_list_begin(), ioctx->object_list_end(),
+                           shardIdx, nbShards, &shardStart, &shardFinish);
+  unsigned int nbRanges = g_cephListNbRanges > 0 ? g_cephListNbRanges : 1;
+  for (unsigned int i = 0; i < nbRanges; i++) {
+    librados::ObjectCursor start, finish;
+    ioctx->object_list_slice(shardStart, shardFinish, i, nbRanges, &start, &finish);
+    res->m_ranges.push_back(std::make_pair(start, finish));
+  }
+  // start the listing threads
+  unsigned int nbThreads = g_cephListNbThreads < nbRanges ? g_cephListNbThreads : nbRanges;
+  XrdSysCondVarHelper lock(res->m_cond);
+  for (unsigned int i = 0; i < nbThreads; i++) {
+    pthread_t tid;
+    // threads are joinable, as stopListing waits for them before the DirIterator goes
+    int rc = XrdSysThread::Run(&tid, listWorker, res, XRDSYSTHREAD_HOLD, "ceph pool listing");
+    if (rc) {
+      logwrapper((char*)"ceph_posix_opendir : unable to create listing thread, rc = %d", rc);
+      break;
+    }
+    res->m_workers.push_back(tid);
+    res->m_nbActiveWorkers++;
+  }
+  if (res->m_workers.empty()) {
+    lock.UnLock();
+    delete res;
+    errno = EAGAIN;
+    return 0;
+  }
+  return res;
+}
+
+/// opens a listing of a directory of the name index
+/// returns 0 and sets errno in case of failure
+static DirIterator* openIndexListing(const CephFile &file) {
+  int rc = nameIndexDirExists(file);
+  if (rc <= 0) {
+    errno = (0 == rc) ? ENOENT : -rc;
+    return 0;
+  }
+  librados::IoCtx *ioctx = nameIndexIoCtx(file);
+  if (0 == ioctx) {
+    errno = EINVAL;
+    return 0;
+  }
+  unsigned long long generation, building;
+  nameIndexGenerations(file, ioctx, generation, building);
+  std::string dir = nameIndexDirName(file.name);
+  DirIterator* res = new DirIterator();
+  res->m_file = file;
+  nameIndexDirObjects(file, dir, generation, res->m_indexObjects);
+  res->m_indexPrefix = nameIndexKeyPrefix(dir);
+  res->m_indexLastKey = res->m_indexPrefix;
+  res->m_indexMore = true;
+  res->m_indexDir = dir;
+  return res;
+}
+
+/// fetches the next batch of entries of a directory from the name index
+/// to be called with the DirIterator lock held
+/// returns 0 or a negative error code
+static int fillFromNameIndex(DirIterator *dir) {
+  librados::IoCtx *ioctx = nameIndexIoCtx(dir->m_file);
+  if (0 == ioctx) return -EINVAL;
+  std::map<std::string, ceph::bufferlist> values;
+  bool more = false;
+  int rc = ioctx->omap_get_vals2(dir->m_indexObjects[dir->m_indexNextObject],
+                                 dir->m_indexLastKey, dir->m_indexPrefix,
+                                 g_nameIndexBatchSize, &values, &more);
+  if (rc < 0 && rc != -ENOENT) return rc;
+  // a missing index object holds no entry of the directory
+  for (std::map<std::string, ceph::bufferlist>::const_iterator it = values.begin();
+       it != values.end();
+       it++) {
+    // note that directories keep their trailing '/' until returned by readdir
+    std::string entry = it->first.substr(dir->m_indexPrefix.size());
+    if (!entry.empty() && entry != "/") dir->m_names.push_back(entry);
+    dir->m_indexLastKey = it->first;
+  }
+  if (!more || values.empty()) {
+    // go on with the next object, if any
+    dir->m_indexNextObject++;
+    dir->m_indexLastKey = dir->m_indexPrefix;
+  }
+  dir->m_indexMore = dir->m_indexNextObject < dir->m_indexObjects.size();
+  return 0;
 }
 
 DIR* ceph_posix_opendir(XrdOucEnv* env, const char *pathname) {
   logwrapper((char*)"ceph_posix_opendir : %s", pathname);
-  // only accept root dir, as there is no concept of dirs in object stores
   CephFile file = getCephFile(pathname, env);
+  // with a name index, any directory known to the index can be listed
+  if (g_cephNameIndexNbShards > 0) {
+    return (DIR*)openIndexListing(file);
+  }
+  // otherwise only accept root dir, as there is no concept of dirs in object stores
   if (file.name.size() != 1 || file.name[0] != '/') {
     errno = -ENOENT;
     return 0;
   }
-  librados::IoCtx *ioctx = getIoCtx(file);
-  if (0 == ioctx) {
-    errno = EINVAL;
-    return 0;
+  unsigned int shardIdx, nbShards;
+  getListShard(env, shardIdx, nbShards);
+  return (DIR*)openPoolListing(file, shardIdx, nbShards);
+}
+
+/// gets the next name of a listing, waiting for the listing threads if needed
+/// to be called with the DirIterator lock held
+/// returns 1 if a name was found, 0 at the end of the listing or a negative error code
+static int nextDirName(DirIterator *dir, std::string &name) {
+  // the index objects of a directory may hold none of its entries
+  while (dir->m_names.empty() && dir->m_indexMore) {
+    int rc = fillFromNameIndex(dir);
+    if (rc < 0) return rc;
   }
-  DirIterator* res = new DirIterator();
-  res->m_iterator = ioctx->nobjects_begin();
-  res->m_ioctx = ioctx;
-  return (DIR*)res;
+  unsigned long long deadline = getDeadline(DL_LIST);
+  while (dir->m_names.empty() && dir->m_nbActiveWorkers > 0) {
+    if (!waitUntil(dir->m_cond, deadline)) {
+      deadlineExpired(DL_LIST);
+      return -ETIMEDOUT;
+    }
+  }
+  if (dir->m_names.empty()) {
+    return dir->m_rc;
+  }
+  name = dir->m_names.front();
+  dir->m_names.pop_front();
+  dir->m_cond.Broadcast();
+  return 1;
 }
 
-int ceph_posix_readdir(DIR *dirp, char *buff, int blen) {
-  librados::NObjectIterator &iterator = ((DirIterator*)dirp)->m_iterator;
-  librados::IoCtx *ioctx = ((DirIterator*)dirp)->m_ioctx;
-  while (iterator->get_oid().compare(iterator->get_oid().size()-17, 17, ".0000000000000000") &&
-         iterator != ioctx->nobjects_end()) {
-    iterator++;
-  }
-  if (iterator == ioctx->nobjects_end()) {
-    buff[0] = 0;
-  } else {
-    int l = iterator->get_oid().size()-17;
-    if (l < blen) blen = l;
-    strncpy(buff, iterator->get_oid().c_str(), blen-1);
-    buff[blen-1] = 0;
-    iterator++;
+/// copies a name returned by a listing into the readdir buffer
+/// trailing '/' of directories coming from the name index are dropped
+static void copyDirName(const std::string &name, char *buff, int blen) {
+  size_t l = name.size();
+  if (l > 1 && name[l-1] == '/') l--;
+  if (l >= (size_t)blen) l = blen-1;
+  strncpy(buff, name.c_str(), l);
+  buff[l] = 0;
+}
+
+/// issues asynchronous stats for the next entries of a listing, so that
+/// up to g_cephStatAheadWindow of them are in flight
+/// to be called with the DirIterator lock held
+/// returns 0 or a negative error code
+static int fillStatAhead(DirIterator *dir) {
+  while (dir->m_statAhead.size() < (g_cephStatAheadWindow > 0 ? g_cephStatAheadWindow : 1)) {
+    std::string name;
+    int rc = nextDirName(dir, name);
+    if (rc <= 0) return rc;
+    DirEntryStat *entry = new DirEntryStat(name);
+    dir->m_statAhead.push_back(entry);
+    // directories of the name index are not stat'ed
+    if (name[name.size()-1] == '/') continue;
+    CephFile file = dir->m_file;
+    file.name = dir->m_indexDir + name;
+    libradosstriper::RadosStriper *striper = getRadosStriper(file);
+    if (0 == striper) return -EINVAL;
+    entry->completion = librados::Rados::aio_create_completion();
+    rc = striper->aio_stat(file.name, entry->completion, &entry->size, &entry->mtime);
+    if (rc < 0) {
+      entry->completion->release();
+      entry->completion = 0;
+      return rc;
+    }
   }
   return 0;
 }
 
+/// waits for the stat of an entry to complete, so that its size and mtime
+/// can be used. Returns the result of the stat
+static int waitDirEntryStat(DirEntryStat *entry) {
+  int rc = 0;
+  if (entry->completion) {
+    entry->completion->wait_for_complete();
+    rc = entry->completion->get_return_value();
+    entry->completion->release();
+    entry->completion = 0;
+  }
+  return rc;
+}
+
+int ceph_posix_readdir(DIR *dirp, char *buff, int blen) {
+  return ceph_posix_readdir_stat(dirp, buff, blen, 0);
+}
+
+int ceph_posix_readdir_stat(DIR *dirp, char *buff, int blen, struct stat *buf) {
+  DirIterator *dir = (DirIterator*)dirp;
+  XrdSysCondVarHelper lock(dir->m_cond);
+  buff[0] = 0;
+  if (0 == buf) {
+    std::string name;
+    int rc = nextDirName(dir, name);
+    if (rc > 0) copyDirName(name, buff, blen);
+    return rc < 0 ? rc : 0;
+  }
+  // stats are pipelined : the ones of the next entries are issued ahead of time
+  while (true) {
+    int rc = fillStatAhead(dir);
+    if (rc < 0) return rc;
+    if (dir->m_statAhead.empty()) return 0;
+    DirEntryStat *entry = dir->m_statAhead.front();
+    dir->m_statAhead.pop_front();
+    std::string name = entry->name;
+    bool isDir = (0 == entry->completion);
+    rc = waitDirEntryStat(entry);
+    memset(buf, 0, sizeof(*buf));
+    buf->st_size = entry->size;
+    buf->st_atime = entry->mtime;
+    delete entry;
+    // files removed since they were listed are skipped
+    if (-ENOENT == rc) continue;
+    if (rc < 0) return rc;
+    if (isDir) {
+      buf->st_mode = S_IFDIR | 0755;
+      buf->st_atime = time(NULL);
+    } else {
+      buf->st_mode = 0666 | S_IFREG;
+    }
+    buf->st_mtime = buf->st_atime;
+    buf->st_ctime = buf->st_atime;
+    copyDirName(name, buff, blen);
+    return 0;
+  }
+}
+
 int ceph_posix_closedir(DIR *dirp) {
-  delete ((DirIterator*)dirp);
+  DirIterator *dir = (DirIterator*)dirp;
+  stopListing(dir);
+  // wait for the stats still in flight before dropping their buffers
+  while (!dir->m_statAhead.empty()) {
+    waitDirEntryStat(dir->m_statAhead.front());
+    delete dir->m_statAhead.front();
+    dir->m_statAhead.pop_front();
+  }
+  delete dir;
+  return 0;
+}
+
+/// removes the shards of a generation of the name index
+static int nameIndexClear(const CephFile &file, librados::IoCtx *ioctx,
+                          unsigned long long generation) {
+  for (unsigned int i = 0; i < g_cephNameIndexNbShards; i++) {
+    std::string shard = nameIndexShard(file, generation, i);
+    int rc = ioctx->remove(shard);
+    if (rc < 0 && rc != -ENOENT) {
+      logwrapper((char*)"nameIndexClear : unable to remove %s, rc = %d", shard.c_str(), rc);
+      return rc;
+    }
+  }
   return 0;
 }
+
+/// sets an xattr of the root object of the name index to a generation
+static int nameIndexSetGeneration(const CephFile &file, librados::IoCtx *ioctx,
+                                  const char *attr, unsigned long long generation) {
+  std::ostringstream ss;
+  ss << generation;
+  ceph::bufferlist bl;
+  bl.append(ss.str());
+  return ioctx->setxattr(metaObjectName(file, g_nameIndexRootObject), attr, bl);
+}
+
+/// rebuilds the name index of a pool from a full scan of it. The index is
+/// built in the shards of a new generation while the current ones stay in use,
+/// and swapped in once complete
+int ceph_posix_rebuild_index(XrdOucEnv* env, const char *pathname) {
+  logwrapper((char*)"ceph_posix_rebuild_index : %s", pathname);
+  if (0 == g_cephNameIndexNbShards) {
+    return -EINVAL;
+  }
+  CephFile file = getCephFile(pathname, env);
+  if (0 == getIoCtx(file)) {
+    return -EINVAL;
+  }
+  librados::IoCtx *ioctx = nameIndexIoCtx(file);
+  if (0 == ioctx) {
+    logwrapper((char*)"ceph_posix_rebuild_index : pool %s has no omap, a metadata pool is needed",
+               file.pool.c_str());
+    return -EOPNOTSUPP;
+  }
+  unsigned long long generation, building;
+  int rc = nameIndexReadState(file, ioctx, generation, building);
+  if (rc < 0) return rc;
+  if (building) {
+    logwrapper((char*)"ceph_posix_rebuild_index : dropping unfinished rebuild %llu of pool %s",
+               building, file.pool.c_str());
+    rc = nameIndexClear(file, ioctx, building);
+    if (rc < 0) return rc;
+  }
+  unsigned long long next = std::max(generation, building) + 1;
+  rc = nameIndexClear(file, ioctx, next);
+  if (0 == rc) rc = nameIndexSetGeneration(file, ioctx, "building", next);
+  if (rc < 0) return rc;
+  // let all gateways notice the rebuild, so that files created or removed
+  // while the pool is scanned are also recorded in the new shards
+  sleep(g_nameIndexStateTtl + 1);
+  // scan the pool and index all files found
+  DirIterator *dir = openPoolListing(file, 0, 1);
+  if (0 == dir) {
+    return -errno;
+  }
+  std::set<std::string> knownDirs;
+  NameIndexUpdates updates;
+  unsigned long long nbFiles = 0;
+  unsigned int nbPending = 0;
+  char name[MAXPATHLEN+1];
+  while (true) {
+    rc = ceph_posix_readdir((DIR*)dir, name, sizeof(name));
+    if (rc < 0 || 0 == name[0]) break;
+    nameIndexCollectEntries(file, name, next, knownDirs, updates);
+    nbFiles++;
+    nbPending++;
+    if (nbPending >= g_nameIndexBatchSize) {
+      rc = nameIndexWrite(ioctx, updates);
+      if (rc < 0) break;
+      updates.clear();
+      nbPending = 0;
+    }
+  }
+  if (0 == rc) {
+    rc = nameIndexWrite(ioctx, updates);
+  }
+  ceph_posix_closedir((DIR*)dir);
+  if (0 == rc) {
+    // swap the new shards in
+    std::ostringstream ss;
+    ss << next;
+    ceph::bufferlist bl;
+    bl.append(ss.str());
+    librados::ObjectWriteOperation op;
+    op.setxattr("generation", bl);
+    op.rmxattr("building");
+    rc = ioctx->operate(metaObjectName(file, g_nameIndexRootObject), &op);
+  }
+  logwrapper((char*)"ceph_posix_rebuild_index : indexed %llu files of pool %s in generation %llu, rc = %d",
+             nbFiles, file.pool.c_str(), next, rc);
+  if (rc < 0) {
+    // the current shards stay in use
+    ioctx->rmxattr(metaObjectName(file, g_nameIndexRootObject), "building");
+    nameIndexClear(file, ioctx, next);
+    return rc;
+  }
+  // the previous shards go once no gateway uses them anymore
+  sleep(g_nameIndexStateTtl + 1);
+  return nameIndexClear(file, ioctx, generation);
+}
+
+int ceph_posix_stats(char *buff, int blen) {
+  std::ostringstream ss;
+  ss << "<stats id=\"ceph\">";
+  negLookupStats(ss);
+  metaCacheStats(ss);
+  blockCacheStats(ss);
+  diskCacheStats(ss);
+  coalescingStats(ss);
+  hedgingStats(ss);
+  deadlineStats(ss);
+  clusterStats(ss);
+  readPolicyStats(ss);
+  admissionStats(ss);
+  ecAlignStats(ss);
+  writeCksStats(ss);
+  osdCksStats(ss);
+  pageCksStats(ss);
+  reclaimStats(ss);
+  copyStats(ss);
+  tierStats(ss);
+  compressStats(ss);
+  ss << "</stats>";
+  std::string stats = ss.str();
+  // without buffer, give an estimate of the space needed
+  if (0 == buff) return stats.size() + 1024;
+  if (stats.size() >= (size_t)blen) return 0;
+  strcpy(buff, stats.c_str());
+  return stats.size();
+}
@@ -30,8 +30,11 @@
 #define _XRD_CEPH_POSIX_H
 
 #include <sys/types.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <dirent.h>
+#include <string>
+#include <vector>
 #include <XrdOuc/XrdOucEnv.hh>
 #include <XrdSys/XrdSysXAttr.hh>
 
@@ -42,15 +45,21 @@ void ceph_posix_set_defaults(const char* value);
 void ceph_posix_disconnect_all();
 void ceph_posix_set_logfunc(void (*logfunc) (char *, va_list argp));
 int ceph_posix_open(XrdOucEnv* env, const char *pathname, int flags, mode_t mode);
+int ceph_posix_create(XrdOucEnv* env, const char *pathname, mode_t mode,
+                      int flags, bool exclusive);
 int ceph_posix_close(int fd);
 off_t ceph_posix_lseek(int fd, off_t offset, int whence);
 off64_t ceph_posix_lseek64(int fd, off64_t offset, int whence);
 ssize_t ceph_posix_write(int fd, const void *buf, size_t count);
 ssize_t ceph_posix_pwrite(int fd, const void *buf, size_t count, off64_t offset);
 ssize_t ceph_aio_write(int fd, XrdSfsAio *aiop, AioCB *cb);
+ssize_t ceph_posix_pgwrite(int fd, const void *buf, size_t count, off64_t offset,
+                           uint32_t *csvec, bool verify, bool calc);
 ssize_t ceph_posix_read(int fd, void *buf, size_t count);
 ssize_t ceph_posix_pread(int fd, void *buf, size_t count, off64_t offset);
 ssize_t ceph_aio_read(int fd, XrdSfsAio *aiop, AioCB *cb);
+ssize_t ceph_posix_pgread(int fd, void *buf, size_t count, off64_t offset,
+                          uint32_t *csvec, bool verify);
 int ceph_posix_fstat(int fd, struct stat *buf);
 int ceph_posix_stat(XrdOucEnv* env, const char *pathname, struct stat *buf);
 int ceph_posix_fsync(int fd);
@@ -70,8 +79,44 @@ int ceph_posix_statfs(long long *totalSpace, long long *freeSpace);
 int ceph_posix_truncate(XrdOucEnv* env, const char *pathname, unsigned long long size);
 int ceph_posix_ftruncate(int fd, unsigned long long size);
 int ceph_posix_unlink(XrdOucEnv* env, const char *pathname);
+int ceph_posix_copy(XrdOucEnv* env1, const char *from, XrdOucEnv* env2, const char *to);
+int ceph_posix_rename(XrdOucEnv* env1, const char *from, XrdOucEnv* env2, const char *to);
+int ceph_posix_unlink_bulk(XrdOucEnv* env, const std::vector<std::string> &paths,
+                           std::vector<int> &results);
 DIR* ceph_posix_opendir(XrdOucEnv* env, const char *pathname);
 int ceph_posix_readdir(DIR* dirp, char *buff, int blen);
+int ceph_posix_readdir_stat(DIR* dirp, char *buff, int blen, struct stat *buf);
 int ceph_posix_closedir(DIR *dirp);
+int ceph_posix_rebuild_index(XrdOucEnv* env, const char *pathname);
+int ceph_posix_set_listfilter(const char *type, const char *arg1, const char *arg2);
+int ceph_posix_set_neglookup(unsigned long long expectedNbFiles, double fpRate,
+                             unsigned int rebuildInterval, bool trusted);
+int ceph_posix_set_metacache(const char *path, unsigned long long maxEntries,
+                             unsigned int ttl);
+int ceph_posix_set_blockcache(unsigned long long size, unsigned long long blockSize);
+int ceph_posix_set_diskcache(const char *dir, unsigned long long size,
+                             unsigned long long segmentSize);
+int ceph_posix_set_hedging(unsigned int percentile, double budget, unsigned int minDelayMs);
+int ceph_posix_set_deadline(const char *opClass, unsigned int deadlineMs);
+int ceph_posix_set_admission(unsigned int maxOps, unsigned long long maxBytes,
+                             unsigned int perFileOps, unsigned long long perFileBytes,
+                             unsigned int targetLatencyMs, unsigned int maxQueue);
+int ceph_posix_set_ioshare(const char *userId, const char *op, double weight,
+                           unsigned long long clientCap);
+int ceph_posix_set_ecalign(const char *policy);
+int ceph_posix_set_metapool(const char *pool);
+int ceph_posix_set_nameindex(unsigned int nbShards, unsigned int dirShards);
+int ceph_posix_add_sizeclass(unsigned long long minSize, unsigned int nbStripes,
+                             unsigned long long stripeUnit, unsigned long long objectSize);
+int ceph_posix_set_writecks(const char *types);
+int ceph_posix_set_reclaim(unsigned long long minSize, unsigned int objectsPerSecond);
+int ceph_posix_add_cluster(const char *name, const char *confFile);
+int ceph_posix_set_federation(const char *pool, const char *clusters, unsigned int failoverMs);
+int ceph_posix_set_readpolicy(const char *pool, const char *policy);
+int ceph_posix_set_crushlocation(const char *location);
+int ceph_posix_set_tiering(const char *pool, const char *coldPool,
+                           unsigned int promoteOpens, unsigned int demoteDays);
+int ceph_posix_add_compression(const char *target, const char *codec, int level);
+int ceph_posix_stats(char *buff, int blen);
 
 #endif // __XRD_CEPH_POSIX__
@@ -0,0 +1,101 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#include <time.h>
+
+#include "XrdCeph/XrdCephTimer.hh"
+
+XrdCephTimer::XrdCephTimer() : m_nextId(1), m_started(false), m_stop(false), m_tid(0) {}
+
+XrdCephTimer::~XrdCephTimer() {
+  bool started;
+  {
+    XrdSysCondVarHelper lock(m_cond);
+    m_stop = true;
+    started = m_started;
+    m_cond.Signal();
+  }
+  if (started) XrdSysThread::Join(m_tid, 0);
+}
+
+unsigned long long XrdCephTimer::nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+unsigned long long XrdCephTimer::schedule(unsigned int delayMs, Callback *cb, void *arg) {
+  XrdSysCondVarHelper lock(m_cond);
+  if (m_stop) return 0;
+  if (!m_started) {
+    if (XrdSysThread::Run(&m_tid, run, this, XRDSYSTHREAD_HOLD, "ceph timer")) return 0;
+    m_started = true;
+  }
+  unsigned long long id = m_nextId++;
+  unsigned long long due = nowMs() + delayMs;
+  Event &e = m_events[EventKey(due, id)];
+  e.cb = cb;
+  e.arg = arg;
+  m_dueTimes[id] = due;
+  // wake up the thread in case this event is due before the ones it waits for
+  if (m_events.begin()->first.second == id) m_cond.Signal();
+  return id;
+}
+
+bool XrdCephTimer::cancel(unsigned long long id) {
+  XrdSysCondVarHelper lock(m_cond);
+  std::map<unsigned long long, unsigned long long>::iterator it = m_dueTimes.find(id);
+  if (it == m_dueTimes.end()) return false;
+  m_events.erase(EventKey(it->second, id));
+  m_dueTimes.erase(it);
+  return true;
+}
+
+void* XrdCephTimer::run(void *arg) {
+  ((XrdCephTimer*)arg)->loop();
+  return 0;
+}
+
+void XrdCephTimer::loop() {
+  m_cond.Lock();
+  while (!m_stop) {
+    if (m_events.empty()) {
+      m_cond.Wait();
+      continue;
+    }
+    unsigned long long now = nowMs();
+    std::map<EventKey, Event>::iterator it = m_events.begin();
+    if (it->first.first > now) {
+      m_cond.WaitMS(it->first.first - now);
+      continue;
+    }
+    Event e = it->second;
+    m_dueTimes.erase(it->first.second);
+    m_events.erase(it);
+    m_cond.UnLock();
+    e.cb(e.arg);
+    m_cond.Lock();
+  }
+  m_cond.UnLock();
+}
@@ -0,0 +1,106 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+
+#ifndef __XRD_CEPH_TIMER_HH__
+#define __XRD_CEPH_TIMER_HH__
+
+#include <map>
+#include <pthread.h>
+#include "XrdSys/XrdSysPthread.hh"
+
+//------------------------------------------------------------------------------
+//! Simple timer calling functions after given delays, from a single
+//! dedicated thread started on first use.
+//!
+//! Callbacks are called without any lock held, and may thus schedule or
+//! cancel other events. They should be short, as they delay the next events.
+//------------------------------------------------------------------------------
+
+class XrdCephTimer {
+
+public:
+
+  /// type of the functions called by the timer
+  typedef void (Callback)(void *arg);
+
+  //------------------------------------------------------------------------------
+  //! Constructor
+  //------------------------------------------------------------------------------
+  XrdCephTimer();
+
+  //------------------------------------------------------------------------------
+  //! Destructor, stopping the timer thread. Pending events are dropped
+  //------------------------------------------------------------------------------
+  ~XrdCephTimer();
+
+  //------------------------------------------------------------------------------
+  //! Schedules a call to cb(arg) in delayMs milliseconds
+  //!
+  //! @return an identifier of the event, to be used for cancellation, or 0
+  //!         if the timer thread could not be started
+  //------------------------------------------------------------------------------
+  unsigned long long schedule(unsigned int delayMs, Callback *cb, void *arg);
+
+  //------------------------------------------------------------------------------
+  //! Cancels an event
+  //!
+  //! @return true if the event was cancelled, false if it was already called
+  //!         or is being called
+  //------------------------------------------------------------------------------
+  bool cancel(unsigned long long id);
+
+  //------------------------------------------------------------------------------
+  //! Current time of the monotonic clock used by the timer, in milliseconds
+  //------------------------------------------------------------------------------
+  static unsigned long long nowMs();
+
+private:
+
+  /// entry point of the timer thread
+  static void* run(void *arg);
+
+  /// main loop of the timer thread
+  void loop();
+
+  /// a scheduled event
+  struct Event {
+    Callback *cb;
+    void *arg;
+  };
+
+  /// scheduled events, by due time and identifier
+  typedef std::pair<unsigned long long, unsigned long long> EventKey;
+  std::map<EventKey, Event> m_events;
+  /// due time of scheduled events, by identifier
+  std::map<unsigned long long, unsigned long long> m_dueTimes;
+  unsigned long long m_nextId;
+  bool m_started;
+  bool m_stop;
+  pthread_t m_tid;
+  /// protects all members above and wakes up the timer thread
+  XrdSysCondVar m_cond;
+
+};
+
+#endif /* __XRD_CEPH_TIMER_HH__ */
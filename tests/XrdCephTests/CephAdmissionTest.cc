@@ -0,0 +1,230 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <XrdCeph/XrdCephAdmission.hh>
+#include <XrdCeph/XrdCephTimer.hh>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephAdmissionTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephAdmissionTest );
+      CPPUNIT_TEST( GlobalLimitTest );
+      CPPUNIT_TEST( OwnerLimitTest );
+      CPPUNIT_TEST( QueueFullTest );
+      CPPUNIT_TEST( AdaptationTest );
+      CPPUNIT_TEST( ClientCapTest );
+      CPPUNIT_TEST( FairQueueingTest );
+    CPPUNIT_TEST_SUITE_END();
+    void GlobalLimitTest();
+    void OwnerLimitTest();
+    void QueueFullTest();
+    void AdaptationTest();
+    void ClientCapTest();
+    void FairQueueingTest();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephAdmissionTest );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+static XrdCephAdmission::Flow makeFlow(const char *name) {
+  XrdCephAdmission::Flow flow;
+  flow.name = name;
+  return flow;
+}
+
+static std::string getStat(XrdCephAdmission &admission, const std::string &tag) {
+  std::ostringstream ss;
+  admission.stats(ss);
+  std::string s = ss.str();
+  size_t start = s.find("<" + tag + ">");
+  size_t end = s.find("</" + tag + ">");
+  if (start == std::string::npos || end == std::string::npos) return "";
+  start += tag.size() + 2;
+  return s.substr(start, end - start);
+}
+
+/// an operation run in its own thread, recording the order of admissions
+struct QueuedOp {
+  XrdCephAdmission *admission;
+  int owner;
+  XrdCephAdmission::Flow flow;
+  std::vector<std::string> *order;
+  XrdSysMutex *mutex;
+  int rc;
+};
+
+static void* runQueuedOp(void *arg) {
+  QueuedOp *op = (QueuedOp*)arg;
+  op->rc = op->admission->acquire(op->owner, 100, 0, op->flow);
+  if (0 == op->rc) {
+    {
+      XrdSysMutexHelper lock(*op->mutex);
+      op->order->push_back(op->flow.name);
+    }
+    op->admission->release(op->owner, 100, 0);
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+// Global limit of operations in flight
+//------------------------------------------------------------------------------
+void CephAdmissionTest::GlobalLimitTest() {
+  XrdCephAdmission admission(2, 1000, 0, 0, 1000, 10);
+  XrdCephAdmission::Flow flow = makeFlow("f");
+  CPPUNIT_ASSERT(0 == admission.acquire(1, 100, 0, flow));
+  CPPUNIT_ASSERT(0 == admission.acquire(2, 100, 0, flow));
+  CPPUNIT_ASSERT(-ETIMEDOUT == admission.acquire(3, 100, 50, flow));
+  admission.release(1, 100, 1);
+  CPPUNIT_ASSERT(0 == admission.acquire(3, 100, 50, flow));
+  // the byte limit applies as well
+  admission.release(2, 100, 1);
+  CPPUNIT_ASSERT(-ETIMEDOUT == admission.acquire(4, 950, 50, flow));
+  // but a large operation goes when nothing is in flight
+  admission.release(3, 100, 1);
+  CPPUNIT_ASSERT(0 == admission.acquire(4, 5000, 50, flow));
+  admission.release(4, 5000, 1);
+  CPPUNIT_ASSERT("0" == getStat(admission, "ops"));
+  CPPUNIT_ASSERT("0" == getStat(admission, "bytes"));
+  CPPUNIT_ASSERT("2" == getStat(admission, "timedout"));
+}
+
+//------------------------------------------------------------------------------
+// Limits per owner
+//------------------------------------------------------------------------------
+void CephAdmissionTest::OwnerLimitTest() {
+  XrdCephAdmission admission(10, 10000, 1, 0, 1000, 10);
+  XrdCephAdmission::Flow flow = makeFlow("f");
+  CPPUNIT_ASSERT(0 == admission.acquire(1, 100, 0, flow));
+  CPPUNIT_ASSERT(-ETIMEDOUT == admission.acquire(1, 100, 50, flow));
+  CPPUNIT_ASSERT(0 == admission.acquire(2, 100, 50, flow));
+  // an operation not sent is released without affecting the window
+  admission.release(1, 100);
+  CPPUNIT_ASSERT(0 == admission.acquire(1, 100, 50, flow));
+  CPPUNIT_ASSERT("10" == getStat(admission, "window"));
+}
+
+//------------------------------------------------------------------------------
+// Operations are pushed back when the queue is full
+//------------------------------------------------------------------------------
+void CephAdmissionTest::QueueFullTest() {
+  XrdCephAdmission admission(1, 1000, 0, 0, 1000, 0);
+  XrdCephAdmission::Flow flow = makeFlow("f");
+  CPPUNIT_ASSERT(0 == admission.acquire(1, 100, 0, flow));
+  CPPUNIT_ASSERT(-EBUSY == admission.acquire(2, 100, 0, flow));
+  CPPUNIT_ASSERT("1" == getStat(admission, "rejected"));
+}
+
+//------------------------------------------------------------------------------
+// The window is halved by slow completions and grows back with fast ones
+//------------------------------------------------------------------------------
+void CephAdmissionTest::AdaptationTest() {
+  XrdCephAdmission admission(8, 8000, 0, 0, 10, 10);
+  XrdCephAdmission::Flow flow = makeFlow("f");
+  CPPUNIT_ASSERT(0 == admission.acquire(1, 100, 0, flow));
+  admission.release(1, 100, 100);
+  CPPUNIT_ASSERT("4" == getStat(admission, "window"));
+  // a second slow completion right away does not decrease the window again
+  CPPUNIT_ASSERT(0 == admission.acquire(1, 100, 0, flow));
+  admission.release(1, 100, 100);
+  CPPUNIT_ASSERT("4" == getStat(admission, "window"));
+  for (int i = 0; i < 4; i++) {
+    CPPUNIT_ASSERT(0 == admission.acquire(i, 100, 0, flow));
+  }
+  CPPUNIT_ASSERT(-ETIMEDOUT == admission.acquire(4, 100, 50, flow));
+  // each window of fast completions grows the window by about one
+  for (int i = 0; i < 4; i++) {
+    admission.release(i, 100, 1);
+  }
+  CPPUNIT_ASSERT("4" == getStat(admission, "window"));
+  CPPUNIT_ASSERT(0 == admission.acquire(1, 100, 0, flow));
+  admission.release(1, 100, 1);
+  CPPUNIT_ASSERT("5" == getStat(admission, "window"));
+  CPPUNIT_ASSERT("1" == getStat(admission, "decreases"));
+}
+
+//------------------------------------------------------------------------------
+// Bandwidth cap of clients
+//------------------------------------------------------------------------------
+void CephAdmissionTest::ClientCapTest() {
+  XrdCephAdmission admission(10, 1ULL << 30, 0, 0, 1000, 10);
+  XrdCephAdmission::Flow flow = makeFlow("f");
+  flow.client = "client1";
+  flow.clientCap = 10000;
+  // a first operation of twice the cap puts the bucket one second in debt
+  CPPUNIT_ASSERT(0 == admission.acquire(1, 20000, 0, flow));
+  admission.release(1, 20000, 1);
+  CPPUNIT_ASSERT(-ETIMEDOUT == admission.acquire(1, 100, 200, flow));
+  // other clients are not affected
+  XrdCephAdmission::Flow other = flow;
+  other.client = "client2";
+  CPPUNIT_ASSERT(0 == admission.acquire(2, 100, 50, other));
+  admission.release(2, 100, 1);
+  unsigned long long start = XrdCephTimer::nowMs();
+  CPPUNIT_ASSERT(0 == admission.acquire(1, 100, 0, flow));
+  CPPUNIT_ASSERT(XrdCephTimer::nowMs() - start >= 600);
+  CPPUNIT_ASSERT("2" == getStat(admission, "capped"));
+}
+
+//------------------------------------------------------------------------------
+// Waiting operations are served fairly between flows, not in arrival order
+//------------------------------------------------------------------------------
+void CephAdmissionTest::FairQueueingTest() {
+  XrdCephAdmission admission(1, 1000, 0, 0, 1000, 10);
+  CPPUNIT_ASSERT(0 == admission.acquire(0, 100, 0, makeFlow("x")));
+  std::vector<std::string> order;
+  XrdSysMutex mutex;
+  const char *flows[3] = {"a", "a", "b"};
+  QueuedOp ops[3];
+  pthread_t tids[3];
+  for (int i = 0; i < 3; i++) {
+    ops[i].admission = &admission;
+    ops[i].owner = i + 1;
+    ops[i].flow = makeFlow(flows[i]);
+    ops[i].order = &order;
+    ops[i].mutex = &mutex;
+    ops[i].rc = -1;
+    CPPUNIT_ASSERT(0 == pthread_create(&tids[i], 0, runQueuedOp, &ops[i]));
+    // make sure the operations are queued in order
+    for (int j = 0; j < 100 && getStat(admission, "queued") != std::string(1, '1' + i); j++) {
+      usleep(10000);
+    }
+  }
+  CPPUNIT_ASSERT("3" == getStat(admission, "queued"));
+  admission.release(0, 100, 1);
+  for (int i = 0; i < 3; i++) {
+    pthread_join(tids[i], 0);
+    CPPUNIT_ASSERT(0 == ops[i].rc);
+  }
+  // the second operation of flow a goes after the first one of flow b
+  CPPUNIT_ASSERT(3 == order.size());
+  CPPUNIT_ASSERT("a" == order[0]);
+  CPPUNIT_ASSERT("b" == order[1]);
+  CPPUNIT_ASSERT("a" == order[2]);
+}
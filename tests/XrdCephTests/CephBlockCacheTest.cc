@@ -0,0 +1,184 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <XrdCeph/XrdCephBlockCache.hh>
+#include <sstream>
+#include <string>
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephBlockCacheTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephBlockCacheTest );
+      CPPUNIT_TEST( GetPutTest );
+      CPPUNIT_TEST( VersionTest );
+      CPPUNIT_TEST( InvalidateTest );
+      CPPUNIT_TEST( SizeLimitTest );
+      CPPUNIT_TEST( ScanResistanceTest );
+    CPPUNIT_TEST_SUITE_END();
+    void GetPutTest();
+    void VersionTest();
+    void InvalidateTest();
+    void SizeLimitTest();
+    void ScanResistanceTest();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephBlockCacheTest );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+static std::string blockData(unsigned int n, size_t len) {
+  std::string data(len, 'a' + n % 26);
+  return data;
+}
+
+static std::string scanFile(unsigned int n) {
+  std::ostringstream ss;
+  ss << "/scan/file" << n;
+  return ss.str();
+}
+
+static bool isCached(XrdCephBlockCache &cache, const std::string &file,
+                     unsigned long long block) {
+  char buf[1];
+  return cache.get(file, 1, block, 0, 1, buf) >= 0;
+}
+
+//------------------------------------------------------------------------------
+// Plain gets and puts
+//------------------------------------------------------------------------------
+void CephBlockCacheTest::GetPutTest() {
+  XrdCephBlockCache cache(1000, 100);
+  CPPUNIT_ASSERT(100 == cache.blockSize());
+  char buf[100];
+  CPPUNIT_ASSERT(-1 == cache.get("/f", 1, 0, 0, 100, buf));
+  std::string full = blockData(0, 100);
+  cache.put("/f", 1, 0, full.c_str(), full.size());
+  CPPUNIT_ASSERT(100 == cache.get("/f", 1, 0, 0, 100, buf));
+  CPPUNIT_ASSERT(full == std::string(buf, 100));
+  CPPUNIT_ASSERT(10 == cache.get("/f", 1, 0, 90, 50, buf));
+  // last block of a file, shorter than the block size
+  std::string last = blockData(1, 30);
+  cache.put("/f", 1, 1, last.c_str(), last.size());
+  CPPUNIT_ASSERT(20 == cache.get("/f", 1, 1, 10, 100, buf));
+  CPPUNIT_ASSERT(last.substr(10) == std::string(buf, 20));
+  CPPUNIT_ASSERT(0 == cache.get("/f", 1, 1, 40, 10, buf));
+  // blocks larger than the block size are not cached
+  std::string big = blockData(2, 200);
+  cache.put("/f", 1, 2, big.c_str(), big.size());
+  CPPUNIT_ASSERT(-1 == cache.get("/f", 1, 2, 0, 100, buf));
+  unsigned long long usedSize, nbBlocks, nbHits, nbMisses, nbEvictions;
+  cache.stats(usedSize, nbBlocks, nbHits, nbMisses, nbEvictions);
+  CPPUNIT_ASSERT(130 == usedSize);
+  CPPUNIT_ASSERT(2 == nbBlocks);
+  CPPUNIT_ASSERT(4 == nbHits);
+  CPPUNIT_ASSERT(2 == nbMisses);
+  CPPUNIT_ASSERT(0 == nbEvictions);
+}
+
+//------------------------------------------------------------------------------
+// A new version of a file drops its cached blocks
+//------------------------------------------------------------------------------
+void CephBlockCacheTest::VersionTest() {
+  XrdCephBlockCache cache(1000, 100);
+  std::string data = blockData(0, 100);
+  cache.put("/f", 1, 0, data.c_str(), data.size());
+  char buf[100];
+  CPPUNIT_ASSERT(-1 == cache.get("/f", 2, 0, 0, 100, buf));
+  // the stale block is gone, even for the old version
+  CPPUNIT_ASSERT(-1 == cache.get("/f", 1, 0, 0, 100, buf));
+  std::string newData = blockData(1, 100);
+  cache.put("/f", 2, 0, newData.c_str(), newData.size());
+  CPPUNIT_ASSERT(100 == cache.get("/f", 2, 0, 0, 100, buf));
+  CPPUNIT_ASSERT(newData == std::string(buf, 100));
+  unsigned long long usedSize, nbBlocks, nbHits, nbMisses, nbEvictions;
+  cache.stats(usedSize, nbBlocks, nbHits, nbMisses, nbEvictions);
+  CPPUNIT_ASSERT(100 == usedSize);
+  CPPUNIT_ASSERT(1 == nbBlocks);
+}
+
+//------------------------------------------------------------------------------
+// Invalidation only drops the blocks of the given file
+//------------------------------------------------------------------------------
+void CephBlockCacheTest::InvalidateTest() {
+  XrdCephBlockCache cache(10000, 100);
+  std::string data = blockData(0, 100);
+  for (unsigned int i = 0; i < 5; i++) {
+    cache.put("/f", 1, i, data.c_str(), data.size());
+    cache.put("/f2", 1, i, data.c_str(), data.size());
+    cache.put("/e", 1, i, data.c_str(), data.size());
+  }
+  cache.invalidate("/f");
+  for (unsigned int i = 0; i < 5; i++) {
+    CPPUNIT_ASSERT(!isCached(cache, "/f", i));
+    CPPUNIT_ASSERT(isCached(cache, "/f2", i));
+    CPPUNIT_ASSERT(isCached(cache, "/e", i));
+  }
+  unsigned long long usedSize, nbBlocks, nbHits, nbMisses, nbEvictions;
+  cache.stats(usedSize, nbBlocks, nbHits, nbMisses, nbEvictions);
+  CPPUNIT_ASSERT(1000 == usedSize);
+  CPPUNIT_ASSERT(10 == nbBlocks);
+}
+
+//------------------------------------------------------------------------------
+// The cached data never exceed the configured size
+//------------------------------------------------------------------------------
+void CephBlockCacheTest::SizeLimitTest() {
+  XrdCephBlockCache cache(1000, 100);
+  unsigned long long usedSize, nbBlocks, nbHits, nbMisses, nbEvictions;
+  for (unsigned int i = 0; i < 200; i++) {
+    std::string data = blockData(i, 50 + i % 51);
+    cache.put(scanFile(i % 7), 1, i, data.c_str(), data.size());
+    // reread some blocks so that they get promoted
+    if (i >= 3 && i % 3 == 0) isCached(cache, scanFile((i - 3) % 7), i - 3);
+    cache.stats(usedSize, nbBlocks, nbHits, nbMisses, nbEvictions);
+    CPPUNIT_ASSERT(usedSize <= 1000);
+  }
+  CPPUNIT_ASSERT(nbEvictions > 0);
+  CPPUNIT_ASSERT(nbBlocks + nbEvictions == 200);
+}
+
+//------------------------------------------------------------------------------
+// Blocks requested again survive a scan of the cache
+//------------------------------------------------------------------------------
+void CephBlockCacheTest::ScanResistanceTest() {
+  // 8 blocks, A1in holding a quarter of them
+  XrdCephBlockCache cache(800, 100);
+  std::string data = blockData(0, 100);
+  cache.put("/hot", 1, 0, data.c_str(), data.size());
+  cache.put("/cold", 1, 0, data.c_str(), data.size());
+  for (unsigned int i = 0; i < 8; i++) {
+    cache.put(scanFile(i), 1, 0, data.c_str(), data.size());
+  }
+  // both went through A1in and were evicted
+  CPPUNIT_ASSERT(!isCached(cache, "/hot", 0));
+  CPPUNIT_ASSERT(!isCached(cache, "/cold", 0));
+  // requested again while remembered, the hot block enters the main list
+  cache.put("/hot", 1, 0, data.c_str(), data.size());
+  for (unsigned int i = 100; i < 1100; i++) {
+    cache.put(scanFile(i), 1, 0, data.c_str(), data.size());
+  }
+  CPPUNIT_ASSERT(isCached(cache, "/hot", 0));
+  // while the once seen blocks were flushed by the scan
+  for (unsigned int i = 100; i < 1090; i++) {
+    CPPUNIT_ASSERT(!isCached(cache, scanFile(i), 0));
+  }
+}
@@ -0,0 +1,105 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <XrdCeph/XrdCephBloomFilter.hh>
+#include <sstream>
+#include <string>
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephBloomFilterTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephBloomFilterTest );
+      CPPUNIT_TEST( SizingTest );
+      CPPUNIT_TEST( NoFalseNegativeTest );
+      CPPUNIT_TEST( FalsePositiveRateTest );
+    CPPUNIT_TEST_SUITE_END();
+    void SizingTest();
+    void NoFalseNegativeTest();
+    void FalsePositiveRateTest();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephBloomFilterTest );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+static std::string fileName(const char *prefix, unsigned int n) {
+  std::ostringstream ss;
+  ss << "/" << prefix << "/file" << n;
+  return ss.str();
+}
+
+//------------------------------------------------------------------------------
+// Sizing
+//------------------------------------------------------------------------------
+void CephBloomFilterTest::SizingTest() {
+  // 1% needs about 9.6 bits per entry and 7 hashes
+  XrdCephBloomFilter filter(1000, 0.01);
+  CPPUNIT_ASSERT(0 == filter.nbBits() % 64);
+  CPPUNIT_ASSERT(filter.nbBits() >= 9585 && filter.nbBits() < 9585 + 64);
+  CPPUNIT_ASSERT(7 == filter.nbHashes());
+  CPPUNIT_ASSERT(0 == filter.nbEntries());
+  CPPUNIT_ASSERT(0.0 == filter.expectedFpRate());
+  // degenerate parameters still give a usable filter
+  XrdCephBloomFilter tiny(0, 2.0);
+  CPPUNIT_ASSERT(tiny.nbBits() >= 64);
+  CPPUNIT_ASSERT(tiny.nbHashes() >= 1);
+  tiny.add("/a");
+  CPPUNIT_ASSERT(tiny.mayContain("/a"));
+}
+
+//------------------------------------------------------------------------------
+// Entries added are always found
+//------------------------------------------------------------------------------
+void CephBloomFilterTest::NoFalseNegativeTest() {
+  XrdCephBloomFilter filter(10000, 0.01);
+  for (unsigned int i = 0; i < 10000; i++) {
+    filter.add(fileName("data", i));
+  }
+  CPPUNIT_ASSERT(10000 == filter.nbEntries());
+  for (unsigned int i = 0; i < 10000; i++) {
+    CPPUNIT_ASSERT(filter.mayContain(fileName("data", i)));
+  }
+  // the filter outgrown by 4 times still has no false negative
+  for (unsigned int i = 10000; i < 40000; i++) {
+    filter.add(fileName("data", i));
+  }
+  for (unsigned int i = 0; i < 40000; i++) {
+    CPPUNIT_ASSERT(filter.mayContain(fileName("data", i)));
+  }
+}
+
+//------------------------------------------------------------------------------
+// False positive rate close to the targeted one
+//------------------------------------------------------------------------------
+void CephBloomFilterTest::FalsePositiveRateTest() {
+  XrdCephBloomFilter filter(20000, 0.01);
+  for (unsigned int i = 0; i < 20000; i++) {
+    filter.add(fileName("data", i));
+  }
+  CPPUNIT_ASSERT(filter.expectedFpRate() > 0.005 && filter.expectedFpRate() < 0.015);
+  unsigned int nbFalsePositives = 0;
+  for (unsigned int i = 0; i < 100000; i++) {
+    if (filter.mayContain(fileName("missing", i))) nbFalsePositives++;
+  }
+  // 1% of 100000 is 1000, a factor 2 is a generous margin
+  CPPUNIT_ASSERT(nbFalsePositives > 500 && nbFalsePositives < 2000);
+}
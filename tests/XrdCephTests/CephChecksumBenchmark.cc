@@ -0,0 +1,96 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <XrdCeph/XrdCephChecksum.hh>
+#include <zlib.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <vector>
+#include <iostream>
+
+#define MB 1024*1024
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephChecksumBenchmark: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephChecksumBenchmark );
+      CPPUNIT_TEST( KernelsBenchmark );
+    CPPUNIT_TEST_SUITE_END();
+    void KernelsBenchmark();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephChecksumBenchmark );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+static std::vector<unsigned char> randomData(size_t size) {
+  std::vector<unsigned char> data(size);
+  srand(42);
+  for (size_t i = 0; i < size; i++) {
+    data[i] = (i % 7 == 0) ? 0xff : rand();
+  }
+  return data;
+}
+
+static double elapsed(const struct timeval &start) {
+  struct timeval now;
+  gettimeofday(&now, 0);
+  return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1e6;
+}
+
+//------------------------------------------------------------------------------
+// Benchmark of the kernels against zlib
+//------------------------------------------------------------------------------
+void CephChecksumBenchmark::KernelsBenchmark() {
+  const size_t size = 64*MB;
+  const unsigned int nbRounds = 4;
+  std::vector<unsigned char> data = randomData(size);
+  const unsigned char *buf = &data[0];
+  struct timeval start;
+  volatile uint32_t sink = 0;
+  gettimeofday(&start, 0);
+  for (unsigned int i = 0; i < nbRounds; i++) sink += adler32(1, buf, size);
+  std::cout << "adler32 zlib   : " << nbRounds * size / (MB) / elapsed(start) << " MB/s" << std::endl;
+  gettimeofday(&start, 0);
+  for (unsigned int i = 0; i < nbRounds; i++) sink += XrdCephChecksum::adler32Scalar(1, buf, size);
+  std::cout << "adler32 scalar : " << nbRounds * size / (MB) / elapsed(start) << " MB/s" << std::endl;
+  if (XrdCephChecksum::hasAvx2()) {
+    gettimeofday(&start, 0);
+    for (unsigned int i = 0; i < nbRounds; i++) sink += XrdCephChecksum::adler32Avx2(1, buf, size);
+    std::cout << "adler32 avx2   : " << nbRounds * size / (MB) / elapsed(start) << " MB/s" << std::endl;
+  }
+  gettimeofday(&start, 0);
+  for (unsigned int i = 0; i < nbRounds; i++) sink += crc32(0, buf, size);
+  std::cout << "crc32 zlib     : " << nbRounds * size / (MB) / elapsed(start) << " MB/s" << std::endl;
+  gettimeofday(&start, 0);
+  for (unsigned int i = 0; i < nbRounds; i++) sink += XrdCephChecksum::crc32cScalar(0, buf, size);
+  std::cout << "crc32c scalar  : " << nbRounds * size / (MB) / elapsed(start) << " MB/s" << std::endl;
+  if (XrdCephChecksum::hasSse42()) {
+    gettimeofday(&start, 0);
+    for (unsigned int i = 0; i < nbRounds; i++) sink += XrdCephChecksum::crc32cSse42(0, buf, size);
+    std::cout << "crc32c sse4.2  : " << nbRounds * size / (MB) / elapsed(start) << " MB/s" << std::endl;
+  }
+  std::vector<uint32_t> csvec(XrdCephChecksum::pageCount(0, size));
+  gettimeofday(&start, 0);
+  for (unsigned int i = 0; i < nbRounds; i++) XrdCephChecksum::pageCrc32c(buf, size, 0, &csvec[0]);
+  std::cout << "crc32c pages   : " << nbRounds * size / (MB) / elapsed(start) << " MB/s" << std::endl;
+}
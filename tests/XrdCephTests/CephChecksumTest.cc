@@ -0,0 +1,224 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <XrdCeph/XrdCephChecksum.hh>
+#include <zlib.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephChecksumTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephChecksumTest );
+      CPPUNIT_TEST( Adler32Test );
+      CPPUNIT_TEST( Crc32cTest );
+      CPPUNIT_TEST( Crc32cCombineTest );
+      CPPUNIT_TEST( StripedCrc32cTest );
+      CPPUNIT_TEST( PageCrc32cTest );
+    CPPUNIT_TEST_SUITE_END();
+    void Adler32Test();
+    void Crc32cTest();
+    void Crc32cCombineTest();
+    void StripedCrc32cTest();
+    void PageCrc32cTest();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephChecksumTest );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+static std::vector<unsigned char> randomData(size_t size) {
+  std::vector<unsigned char> data(size);
+  srand(42);
+  for (size_t i = 0; i < size; i++) {
+    // runs of 0xff stress the overflow of the adler32 sums
+    data[i] = (i % 7 == 0) ? 0xff : rand();
+  }
+  return data;
+}
+
+/// bitwise crc32c, as a reference
+static uint32_t referenceCrc32c(uint32_t crc, const unsigned char *buf, size_t len) {
+  crc = ~crc;
+  while (len--) {
+    crc ^= *buf++;
+    for (unsigned int k = 0; k < 8; k++) {
+      crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+/// lengths and offsets exercising the tails and the block boundaries of the kernels
+static const size_t lengths[] = {0, 1, 7, 31, 32, 33, 5551, 5552, 5553,
+                                 12287, 12288, 12289, 50001, 99999};
+static const size_t nbLengths = sizeof(lengths) / sizeof(lengths[0]);
+
+/// mock of the OSDs : stripes data as libradosstriper does and returns the
+/// crc32c of each stripe unit of each object, as the checksum op of rados does
+static std::vector<std::vector<uint32_t> > osdCrc32c(const std::vector<unsigned char> &data,
+                                                     size_t su, size_t sc, size_t objectSize) {
+  std::vector<std::vector<std::string> > units;
+  size_t stripesPerObject = objectSize / su;
+  for (size_t blockNo = 0; blockNo * su < data.size(); blockNo++) {
+    size_t stripeNo = blockNo / sc;
+    size_t objectNo = (stripeNo / stripesPerObject) * sc + blockNo % sc;
+    size_t len = std::min(su, data.size() - blockNo * su);
+    if (objectNo >= units.size()) units.resize(objectNo + 1);
+    CPPUNIT_ASSERT(units[objectNo].size() == stripeNo % stripesPerObject);
+    units[objectNo].push_back(std::string((const char*)&data[blockNo * su], len));
+  }
+  std::vector<std::vector<uint32_t> > crcs(units.size());
+  for (size_t i = 0; i < units.size(); i++) {
+    for (size_t j = 0; j < units[i].size(); j++) {
+      crcs[i].push_back(referenceCrc32c(0, (const unsigned char*)units[i][j].data(),
+                                        units[i][j].size()));
+    }
+  }
+  return crcs;
+}
+
+//------------------------------------------------------------------------------
+// Adler32 test
+//------------------------------------------------------------------------------
+void CephChecksumTest::Adler32Test() {
+  std::vector<unsigned char> data = randomData(100003);
+  for (size_t i = 0; i < nbLengths; i++) {
+    for (size_t offset = 0; offset < 4; offset++) {
+      const unsigned char *buf = &data[offset];
+      uint32_t expected = adler32(1, buf, lengths[i]);
+      CPPUNIT_ASSERT(XrdCephChecksum::adler32Scalar(1, buf, lengths[i]) == expected);
+      if (XrdCephChecksum::hasAvx2()) {
+        CPPUNIT_ASSERT(XrdCephChecksum::adler32Avx2(1, buf, lengths[i]) == expected);
+      }
+      // incremental computation
+      size_t half = lengths[i] / 2;
+      uint32_t value = XrdCephChecksum::adler32(1, buf, half);
+      value = XrdCephChecksum::adler32(value, buf + half, lengths[i] - half);
+      CPPUNIT_ASSERT(value == expected);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Crc32c test
+//------------------------------------------------------------------------------
+void CephChecksumTest::Crc32cTest() {
+  // standard check value of crc32c
+  CPPUNIT_ASSERT(XrdCephChecksum::crc32c(0, (const unsigned char*)"123456789", 9) == 0xe3069283);
+  std::vector<unsigned char> data = randomData(100003);
+  for (size_t i = 0; i < nbLengths; i++) {
+    for (size_t offset = 0; offset < 4; offset++) {
+      const unsigned char *buf = &data[offset];
+      uint32_t expected = referenceCrc32c(0, buf, lengths[i]);
+      CPPUNIT_ASSERT(XrdCephChecksum::crc32cScalar(0, buf, lengths[i]) == expected);
+      if (XrdCephChecksum::hasSse42()) {
+        CPPUNIT_ASSERT(XrdCephChecksum::crc32cSse42(0, buf, lengths[i]) == expected);
+      }
+      size_t third = lengths[i] / 3;
+      uint32_t value = XrdCephChecksum::crc32c(0, buf, third);
+      value = XrdCephChecksum::crc32c(value, buf + third, lengths[i] - third);
+      CPPUNIT_ASSERT(value == expected);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Crc32c combination test
+//------------------------------------------------------------------------------
+void CephChecksumTest::Crc32cCombineTest() {
+  std::vector<unsigned char> data = randomData(100003);
+  const unsigned char *buf = &data[0];
+  for (size_t i = 0; i < nbLengths; i++) {
+    for (size_t j = 0; j < nbLengths; j++) {
+      if (lengths[i] + lengths[j] > data.size()) continue;
+      uint32_t crc1 = XrdCephChecksum::crc32c(0, buf, lengths[i]);
+      uint32_t crc2 = XrdCephChecksum::crc32c(0, buf + lengths[i], lengths[j]);
+      uint32_t expected = XrdCephChecksum::crc32c(0, buf, lengths[i] + lengths[j]);
+      CPPUNIT_ASSERT(XrdCephChecksum::crc32cCombine(crc1, crc2, lengths[j]) == expected);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Crc32c of striped files test
+//------------------------------------------------------------------------------
+void CephChecksumTest::StripedCrc32cTest() {
+  // stripe unit, stripe count and object size
+  static const size_t layouts[][3] = {{4096, 1, 4096}, {4096, 1, 16384}, {1000, 3, 4000},
+                                      {512, 4, 512}, {65536, 2, 131072}};
+  static const size_t sizes[] = {0, 1, 999, 1000, 1001, 4096, 12000, 12001, 40000, 300007};
+  std::vector<unsigned char> all = randomData(300007);
+  for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      std::vector<unsigned char> data(all.begin(), all.begin() + sizes[i]);
+      std::vector<std::vector<uint32_t> > crcs =
+        osdCrc32c(data, layouts[l][0], layouts[l][1], layouts[l][2]);
+      uint32_t crc;
+      CPPUNIT_ASSERT(XrdCephChecksum::stripedCrc32c(crcs, sizes[i], layouts[l][0], layouts[l][1],
+                                                    layouts[l][2], crc));
+      CPPUNIT_ASSERT(crc == referenceCrc32c(0, data.empty() ? 0 : &data[0], data.size()));
+      // a missing stripe unit is detected
+      if (!crcs.empty()) {
+        crcs.back().pop_back();
+        CPPUNIT_ASSERT(!XrdCephChecksum::stripedCrc32c(crcs, sizes[i], layouts[l][0],
+                                                       layouts[l][1], layouts[l][2], crc));
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Page crc32c test
+//------------------------------------------------------------------------------
+void CephChecksumTest::PageCrc32cTest() {
+  static const unsigned long long offsets[] = {0, 1, 4095, 4096, 8191, 12345};
+  std::vector<unsigned char> data = randomData(100003);
+  for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+    for (size_t i = 0; i < nbLengths; i++) {
+      unsigned long long offset = offsets[o];
+      size_t len = lengths[i];
+      size_t nbPages = XrdCephChecksum::pageCount(offset, len);
+      std::vector<uint32_t> csvec(nbPages + 1, 0xdeadbeef);
+      XrdCephChecksum::pageCrc32c(&data[0], len, offset, &csvec[0]);
+      // check each page against the reference, and that nothing is written past the end
+      size_t done = 0;
+      for (size_t p = 0; p < nbPages; p++) {
+        size_t pageLen = XrdCephChecksum::PageSize - (offset + done) % XrdCephChecksum::PageSize;
+        if (pageLen > len - done) pageLen = len - done;
+        CPPUNIT_ASSERT(csvec[p] == referenceCrc32c(0, &data[done], pageLen));
+        done += pageLen;
+      }
+      CPPUNIT_ASSERT(done == len);
+      CPPUNIT_ASSERT(csvec[nbPages] == 0xdeadbeef);
+      if (0 == offset % XrdCephChecksum::PageSize && XrdCephChecksum::hasSse42()) {
+        std::vector<uint32_t> sse(len / XrdCephChecksum::PageSize + 1);
+        std::vector<uint32_t> scalar(len / XrdCephChecksum::PageSize + 1);
+        XrdCephChecksum::crc32cPagesSse42(&data[0], len / XrdCephChecksum::PageSize, &sse[0]);
+        XrdCephChecksum::crc32cPagesScalar(&data[0], len / XrdCephChecksum::PageSize, &scalar[0]);
+        CPPUNIT_ASSERT(sse == scalar);
+      }
+    }
+  }
+}
@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <XrdCeph/XrdCephCompress.hh>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+
+#define MB (1024*1024)
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephCompressBenchmark: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephCompressBenchmark );
+      CPPUNIT_TEST( CodecsBenchmark );
+    CPPUNIT_TEST_SUITE_END();
+    void CodecsBenchmark();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephCompressBenchmark );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+static const XrdCephCompress::Codec codecs[] = {XrdCephCompress::LZ4, XrdCephCompress::ZSTD};
+static const size_t nbCodecs = sizeof(codecs) / sizeof(codecs[0]);
+
+/// log like text, compressing a few times as the data we store
+static std::string textData(size_t size) {
+  static const char *levels[] = {"INFO", "DEBUG", "WARNING", "ERROR"};
+  static const char *words[] = {"open", "read", "write", "close", "stat", "sync"};
+  std::string data;
+  data.reserve(size + 256);
+  srand(42);
+  char line[256];
+  for (unsigned int i = 0; data.size() < size; i++) {
+    snprintf(line, sizeof(line), "2021-03-%02d %02d:%02d:%02d.%03d %s fd=%d %s offset=%d len=%d rc=%d\n",
+             1 + i / 86400000 % 28, i / 3600000 % 24, i / 60000 % 60, i / 1000 % 60, i % 1000,
+             levels[rand() % 4], rand() % 1000, words[rand() % 6], rand(), rand() % 65536,
+             rand() % 16 ? 0 : -(rand() % 128));
+    data += line;
+  }
+  data.resize(size);
+  return data;
+}
+
+static double elapsed(const struct timeval &start) {
+  struct timeval now;
+  gettimeofday(&now, 0);
+  return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1e6;
+}
+
+
+//------------------------------------------------------------------------------
+// Benchmark of the codecs on one core, and their effect on transfers. A stream
+// compresses (or decompresses) on one core while the network carries the
+// compressed data, so its rate is the lowest of both
+//------------------------------------------------------------------------------
+void CephCompressBenchmark::CodecsBenchmark() {
+  const size_t blockSize = 4*MB;
+  const size_t size = 64*MB;
+  const double linkRates[] = {1250, 3125};   // 10 and 25 Gb/s, in MB/s
+  std::string data = textData(size);
+  std::string back(blockSize, 0);
+  for (size_t c = 0; c < nbCodecs; c++) {
+    if (!XrdCephCompress::available(codecs[c])) continue;
+    std::vector<std::string> blocks(size / blockSize);
+    struct timeval start;
+    gettimeofday(&start, 0);
+    size_t stored = 0;
+    for (size_t b = 0; b < blocks.size(); b++) {
+      uint32_t entry = XrdCephCompress::compress(codecs[c], 0, data.data() + b * blockSize,
+                                                 blockSize, blocks[b]);
+      stored += XrdCephCompress::storedLength(entry);
+    }
+    double compressRate = size / (MB) / elapsed(start);
+    gettimeofday(&start, 0);
+    for (size_t b = 0; b < blocks.size(); b++) {
+      if (blocks[b].empty()) continue;
+      XrdCephCompress::decompress(codecs[c], blocks[b].data(), blocks[b].size(), &back[0], back.size());
+    }
+    double decompressRate = size / (MB) / elapsed(start);
+    double ratio = (double)size / stored;
+    std::cout << XrdCephCompress::codecName(codecs[c]) << " : ratio " << ratio
+              << ", compression " << compressRate << " MB/s per core"
+              << ", decompression " << decompressRate << " MB/s per core" << std::endl;
+    for (size_t l = 0; l < sizeof(linkRates) / sizeof(linkRates[0]); l++) {
+      std::cout << "  link at " << linkRates[l] << " MB/s : writes "
+                << std::min(compressRate, linkRates[l] * ratio) << " MB/s, reads "
+                << std::min(decompressRate, linkRates[l] * ratio) << " MB/s per stream, instead of "
+                << linkRates[l] << " MB/s uncompressed. Filling it takes "
+                << linkRates[l] * ratio / compressRate << " cores" << std::endl;
+    }
+  }
+}
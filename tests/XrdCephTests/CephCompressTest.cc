@@ -0,0 +1,189 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <XrdCeph/XrdCephCompress.hh>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#define MB (1024*1024)
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephCompressTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephCompressTest );
+      CPPUNIT_TEST( CodecNameTest );
+      CPPUNIT_TEST( RoundTripTest );
+      CPPUNIT_TEST( IncompressibleTest );
+      CPPUNIT_TEST( BlockMapTest );
+    CPPUNIT_TEST_SUITE_END();
+    void CodecNameTest();
+    void RoundTripTest();
+    void IncompressibleTest();
+    void BlockMapTest();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephCompressTest );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+static const XrdCephCompress::Codec codecs[] = {XrdCephCompress::LZ4, XrdCephCompress::ZSTD};
+static const size_t nbCodecs = sizeof(codecs) / sizeof(codecs[0]);
+
+/// log like text, compressing a few times as the data we store
+static std::string textData(size_t size) {
+  static const char *levels[] = {"INFO", "DEBUG", "WARNING", "ERROR"};
+  static const char *words[] = {"open", "read", "write", "close", "stat", "sync"};
+  std::string data;
+  data.reserve(size + 256);
+  srand(42);
+  char line[256];
+  for (unsigned int i = 0; data.size() < size; i++) {
+    snprintf(line, sizeof(line), "2021-03-%02d %02d:%02d:%02d.%03d %s fd=%d %s offset=%d len=%d rc=%d\n",
+             1 + i / 86400000 % 28, i / 3600000 % 24, i / 60000 % 60, i / 1000 % 60, i % 1000,
+             levels[rand() % 4], rand() % 1000, words[rand() % 6], rand(), rand() % 65536,
+             rand() % 16 ? 0 : -(rand() % 128));
+    data += line;
+  }
+  data.resize(size);
+  return data;
+}
+
+static std::string randomData(size_t size) {
+  std::string data(size, 0);
+  srand(42);
+  for (size_t i = 0; i < size; i++) data[i] = rand();
+  return data;
+}
+
+//------------------------------------------------------------------------------
+// Names of the codecs, as given in the configuration
+//------------------------------------------------------------------------------
+void CephCompressTest::CodecNameTest() {
+  XrdCephCompress::Codec codec;
+  CPPUNIT_ASSERT(XrdCephCompress::codecFromName("lz4", codec));
+  CPPUNIT_ASSERT(XrdCephCompress::LZ4 == codec);
+  CPPUNIT_ASSERT(XrdCephCompress::codecFromName("zstd", codec));
+  CPPUNIT_ASSERT(XrdCephCompress::ZSTD == codec);
+  CPPUNIT_ASSERT(XrdCephCompress::codecFromName("none", codec));
+  CPPUNIT_ASSERT(XrdCephCompress::NONE == codec);
+  CPPUNIT_ASSERT(!XrdCephCompress::codecFromName("gzip", codec));
+  CPPUNIT_ASSERT(XrdCephCompress::available(XrdCephCompress::NONE));
+  CPPUNIT_ASSERT(!strcmp("zstd", XrdCephCompress::codecName(XrdCephCompress::ZSTD)));
+}
+
+//------------------------------------------------------------------------------
+// Blocks of several sizes go through each codec and come back unchanged
+//------------------------------------------------------------------------------
+void CephCompressTest::RoundTripTest() {
+  std::string data = textData(4*MB);
+  size_t lengths[] = {1, 100, 4096, 65537, 1*MB, 4*MB};
+  for (size_t c = 0; c < nbCodecs; c++) {
+    if (!XrdCephCompress::available(codecs[c])) continue;
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+      std::string out;
+      uint32_t entry = XrdCephCompress::compress(codecs[c], 0, data.data(), lengths[l], out);
+      std::string back(4*MB, 0);
+      if (XrdCephCompress::isRaw(entry)) {
+        // only tiny blocks do not shrink
+        CPPUNIT_ASSERT(lengths[l] < 4096);
+        CPPUNIT_ASSERT(out.empty());
+        CPPUNIT_ASSERT(lengths[l] == XrdCephCompress::storedLength(entry));
+        continue;
+      }
+      CPPUNIT_ASSERT(out.size() == XrdCephCompress::storedLength(entry));
+      CPPUNIT_ASSERT(out.size() < lengths[l]);
+      long len = XrdCephCompress::decompress(codecs[c], out.data(), out.size(), &back[0], back.size());
+      CPPUNIT_ASSERT((long)lengths[l] == len);
+      CPPUNIT_ASSERT(0 == data.compare(0, len, back, 0, len));
+    }
+    // corrupted data is detected rather than returned
+    std::string out;
+    XrdCephCompress::compress(codecs[c], 0, data.data(), 1*MB, out);
+    std::string back(1*MB, 0);
+    CPPUNIT_ASSERT(-1L == XrdCephCompress::decompress(codecs[c], out.data(), out.size() / 2,
+                                                          &back[0], back.size()));
+  }
+}
+
+//------------------------------------------------------------------------------
+// Random data is stored as is, as without codec
+//------------------------------------------------------------------------------
+void CephCompressTest::IncompressibleTest() {
+  std::string data = randomData(1*MB);
+  for (size_t c = 0; c < nbCodecs; c++) {
+    std::string out;
+    uint32_t entry = XrdCephCompress::compress(codecs[c], 0, data.data(), data.size(), out);
+    CPPUNIT_ASSERT(XrdCephCompress::isRaw(entry));
+    CPPUNIT_ASSERT(data.size() == XrdCephCompress::storedLength(entry));
+    CPPUNIT_ASSERT(out.empty());
+  }
+  std::string out;
+  uint32_t entry = XrdCephCompress::compress(XrdCephCompress::NONE, 0, data.data(), 100, out);
+  CPPUNIT_ASSERT(((uint32_t)100 | XrdCephCompress::RawBlock) == entry);
+}
+
+//------------------------------------------------------------------------------
+// Encoding of the map in a header and chunks, and its truncation
+//------------------------------------------------------------------------------
+void CephCompressTest::BlockMapTest() {
+  XrdCephBlockMap map;
+  map.codec = XrdCephCompress::ZSTD;
+  map.level = 3;
+  map.blockSize = 4*MB;
+  map.size = 10000ULL * 4*MB + 12345;
+  for (unsigned long long b = 0; b <= 10000; b++) {
+    map.setEntry(b, b % 3 ? (uint32_t)(b * 97 % (4*MB)) : (uint32_t)(4*MB) | XrdCephCompress::RawBlock);
+  }
+  CPPUNIT_ASSERT((size_t)3 == map.nbChunks());
+  XrdCephBlockMap decoded;
+  size_t nbEntries;
+  CPPUNIT_ASSERT(decoded.decodeHeader(map.encodeHeader(), nbEntries));
+  CPPUNIT_ASSERT((size_t)10001 == nbEntries);
+  CPPUNIT_ASSERT(XrdCephCompress::ZSTD == decoded.codec);
+  CPPUNIT_ASSERT(3 == decoded.level);
+  CPPUNIT_ASSERT(map.blockSize == decoded.blockSize);
+  CPPUNIT_ASSERT(map.size == decoded.size);
+  for (size_t i = 0; i < map.nbChunks(); i++) {
+    CPPUNIT_ASSERT(decoded.decodeChunk(i, map.encodeChunk(i)));
+  }
+  CPPUNIT_ASSERT(map.entries == decoded.entries);
+  CPPUNIT_ASSERT(!decoded.decodeChunk(3, map.encodeChunk(2)));
+  CPPUNIT_ASSERT(!decoded.decodeChunk(0, map.encodeChunk(2)));
+  // blocks never written read as holes
+  CPPUNIT_ASSERT((uint32_t)0 == map.entry(20000));
+  CPPUNIT_ASSERT(4ULL*MB == map.blockLength(0));
+  CPPUNIT_ASSERT(12345ULL == map.blockLength(10000));
+  CPPUNIT_ASSERT(0ULL == map.blockLength(10001));
+  map.truncate(4*MB + 1);
+  CPPUNIT_ASSERT((size_t)2 == map.entries.size());
+  CPPUNIT_ASSERT(1ULL == map.blockLength(1));
+  map.truncate(0);
+  CPPUNIT_ASSERT(map.entries.empty());
+  // headers claiming more blocks than the file has are refused
+  CPPUNIT_ASSERT(!decoded.decodeHeader("1 lz4 0 4096 4096 2", nbEntries));
+  CPPUNIT_ASSERT(!decoded.decodeHeader("2 lz4 0 4096 4096 1", nbEntries));
+  CPPUNIT_ASSERT(!decoded.decodeHeader("1 gzip 0 4096 4096 1", nbEntries));
+}
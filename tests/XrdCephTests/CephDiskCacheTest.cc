@@ -0,0 +1,196 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <XrdCeph/XrdCephDiskCache.hh>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephDiskCacheTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephDiskCacheTest );
+      CPPUNIT_TEST( ReadWriteTest );
+      CPPUNIT_TEST( VersionTest );
+      CPPUNIT_TEST( EvictionTest );
+      CPPUNIT_TEST( ReloadTest );
+    CPPUNIT_TEST_SUITE_END();
+    void setUp();
+    void tearDown();
+    void ReadWriteTest();
+    void VersionTest();
+    void EvictionTest();
+    void ReloadTest();
+  private:
+    std::string m_dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephDiskCacheTest );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+void CephDiskCacheTest::setUp() {
+  char dir[] = "/tmp/CephDiskCacheTest.XXXXXX";
+  CPPUNIT_ASSERT(0 != mkdtemp(dir));
+  m_dir = dir;
+}
+
+void CephDiskCacheTest::tearDown() {
+  DIR *dir = opendir(m_dir.c_str());
+  if (dir) {
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+      if (strcmp(ent->d_name, ".") && strcmp(ent->d_name, "..")) {
+        unlink((m_dir + '/' + ent->d_name).c_str());
+      }
+    }
+    closedir(dir);
+  }
+  rmdir(m_dir.c_str());
+}
+
+static std::string segmentData(unsigned int n, size_t len) {
+  std::string data(len, 'a' + n % 26);
+  return data;
+}
+
+static bool isCached(XrdCephDiskCache &cache, const std::string &file,
+                     unsigned long long version, unsigned long long segment) {
+  char buf[1];
+  return cache.read(file, version, segment, 0, 1, buf) >= 0;
+}
+
+//------------------------------------------------------------------------------
+// Plain reads and writes
+//------------------------------------------------------------------------------
+void CephDiskCacheTest::ReadWriteTest() {
+  XrdCephDiskCache cache(m_dir, 10000, 100);
+  CPPUNIT_ASSERT(0 == cache.load());
+  CPPUNIT_ASSERT(100 == cache.segmentSize());
+  char buf[100];
+  CPPUNIT_ASSERT(-1 == cache.read("/f", 1, 0, 0, 100, buf));
+  std::string full = segmentData(0, 100);
+  cache.write("/f", 1, 0, full.c_str(), full.size());
+  CPPUNIT_ASSERT(100 == cache.read("/f", 1, 0, 0, 100, buf));
+  CPPUNIT_ASSERT(full == std::string(buf, 100));
+  CPPUNIT_ASSERT(10 == cache.read("/f", 1, 0, 90, 50, buf));
+  // last segment of a file, shorter than the segment size
+  std::string last = segmentData(1, 30);
+  cache.write("/f", 1, 1, last.c_str(), last.size());
+  CPPUNIT_ASSERT(20 == cache.read("/f", 1, 1, 10, 100, buf));
+  CPPUNIT_ASSERT(last.substr(10) == std::string(buf, 20));
+  CPPUNIT_ASSERT(0 == cache.read("/f", 1, 1, 40, 10, buf));
+  // data larger than a segment are not cached
+  std::string big = segmentData(2, 200);
+  cache.write("/f", 1, 2, big.c_str(), big.size());
+  CPPUNIT_ASSERT(!isCached(cache, "/f", 1, 2));
+  unsigned long long usedSize, nbEntries;
+  cache.stats(usedSize, nbEntries);
+  CPPUNIT_ASSERT(130 == usedSize);
+  CPPUNIT_ASSERT(2 == nbEntries);
+  cache.invalidate("/f");
+  CPPUNIT_ASSERT(!isCached(cache, "/f", 1, 0));
+  cache.stats(usedSize, nbEntries);
+  CPPUNIT_ASSERT(0 == usedSize);
+  CPPUNIT_ASSERT(0 == nbEntries);
+}
+
+//------------------------------------------------------------------------------
+// A new version of a file drops its cached segments
+//------------------------------------------------------------------------------
+void CephDiskCacheTest::VersionTest() {
+  XrdCephDiskCache cache(m_dir, 10000, 100);
+  CPPUNIT_ASSERT(0 == cache.load());
+  std::string data = segmentData(0, 100);
+  cache.write("/f", 1, 0, data.c_str(), data.size());
+  CPPUNIT_ASSERT(!isCached(cache, "/f", 2, 0));
+  CPPUNIT_ASSERT(!isCached(cache, "/f", 1, 0));
+  std::string newData = segmentData(1, 100);
+  cache.write("/f", 2, 0, newData.c_str(), newData.size());
+  char buf[100];
+  CPPUNIT_ASSERT(100 == cache.read("/f", 2, 0, 0, 100, buf));
+  CPPUNIT_ASSERT(newData == std::string(buf, 100));
+}
+
+//------------------------------------------------------------------------------
+// Least recently used segments are evicted first
+//------------------------------------------------------------------------------
+void CephDiskCacheTest::EvictionTest() {
+  XrdCephDiskCache cache(m_dir, 500, 100);
+  CPPUNIT_ASSERT(0 == cache.load());
+  std::string data = segmentData(0, 100);
+  for (unsigned int i = 0; i < 5; i++) {
+    cache.write("/f", 1, i, data.c_str(), data.size());
+  }
+  // segment 0 becomes the most recently used
+  CPPUNIT_ASSERT(isCached(cache, "/f", 1, 0));
+  cache.write("/f", 1, 5, data.c_str(), data.size());
+  CPPUNIT_ASSERT(!isCached(cache, "/f", 1, 1));
+  CPPUNIT_ASSERT(isCached(cache, "/f", 1, 0));
+  for (unsigned int i = 2; i < 6; i++) {
+    CPPUNIT_ASSERT(isCached(cache, "/f", 1, i));
+  }
+  unsigned long long usedSize, nbEntries;
+  cache.stats(usedSize, nbEntries);
+  CPPUNIT_ASSERT(500 == usedSize);
+  CPPUNIT_ASSERT(5 == nbEntries);
+}
+
+//------------------------------------------------------------------------------
+// Entries survive restarts, unless invalid or of another segment size
+//------------------------------------------------------------------------------
+void CephDiskCacheTest::ReloadTest() {
+  std::string data = segmentData(0, 100);
+  {
+    XrdCephDiskCache cache(m_dir, 10000, 100);
+    CPPUNIT_ASSERT(0 == cache.load());
+    cache.write("/f", 1, 0, data.c_str(), data.size());
+    cache.write("/f", 1, 1, data.c_str(), 50);
+  }
+  // garbage and leftover temporary files are dropped
+  int fd = open((m_dir + "/garbage").c_str(), O_WRONLY | O_CREAT, 0600);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(7 == write(fd, "garbage", 7));
+  close(fd);
+  fd = open((m_dir + "/.tmp.0").c_str(), O_WRONLY | O_CREAT, 0600);
+  CPPUNIT_ASSERT(fd >= 0);
+  close(fd);
+  {
+    XrdCephDiskCache cache(m_dir, 10000, 100);
+    CPPUNIT_ASSERT(2 == cache.load());
+    char buf[100];
+    CPPUNIT_ASSERT(100 == cache.read("/f", 1, 0, 0, 100, buf));
+    CPPUNIT_ASSERT(data == std::string(buf, 100));
+    CPPUNIT_ASSERT(50 == cache.read("/f", 1, 1, 0, 100, buf));
+    CPPUNIT_ASSERT(access((m_dir + "/garbage").c_str(), F_OK));
+    CPPUNIT_ASSERT(access((m_dir + "/.tmp.0").c_str(), F_OK));
+  }
+  {
+    // segments do not cover the same ranges with another segment size
+    XrdCephDiskCache cache(m_dir, 10000, 200);
+    CPPUNIT_ASSERT(0 == cache.load());
+    CPPUNIT_ASSERT(!isCached(cache, "/f", 1, 0));
+  }
+}
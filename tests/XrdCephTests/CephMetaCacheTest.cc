@@ -0,0 +1,245 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <XrdCeph/XrdCephMetaCache.hh>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephMetaCacheTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephMetaCacheTest );
+      CPPUNIT_TEST( ReplayTest );
+      CPPUNIT_TEST( TruncatedLogTest );
+      CPPUNIT_TEST( CorruptedLogTest );
+      CPPUNIT_TEST( CompactionTest );
+      CPPUNIT_TEST( EvictionTest );
+    CPPUNIT_TEST_SUITE_END();
+    void setUp();
+    void tearDown();
+    void ReplayTest();
+    void TruncatedLogTest();
+    void CorruptedLogTest();
+    void CompactionTest();
+    void EvictionTest();
+  private:
+    std::string m_dir;
+    std::string m_log;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephMetaCacheTest );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+void CephMetaCacheTest::setUp() {
+  char dir[] = "/tmp/CephMetaCacheTest.XXXXXX";
+  CPPUNIT_ASSERT(0 != mkdtemp(dir));
+  m_dir = dir;
+  m_log = m_dir + "/metacache";
+}
+
+void CephMetaCacheTest::tearDown() {
+  unlink(m_log.c_str());
+  unlink((m_log + ".tmp").c_str());
+  rmdir(m_dir.c_str());
+}
+
+static bool hasStat(XrdCephMetaCache &cache, const std::string &key,
+                    unsigned long long size) {
+  unsigned long long cachedSize;
+  time_t mtime, validated;
+  return cache.getStat(key, cachedSize, mtime, validated) && cachedSize == size;
+}
+
+/// overwrites a byte of a file
+static void corrupt(const std::string &path, off_t offset) {
+  int fd = open(path.c_str(), O_RDWR);
+  CPPUNIT_ASSERT(fd >= 0);
+  char c;
+  CPPUNIT_ASSERT(1 == pread(fd, &c, 1, offset));
+  c ^= 0xff;
+  CPPUNIT_ASSERT(1 == pwrite(fd, &c, 1, offset));
+  close(fd);
+}
+
+//------------------------------------------------------------------------------
+// Stats, xattrs and removals are replayed from the log
+//------------------------------------------------------------------------------
+void CephMetaCacheTest::ReplayTest() {
+  {
+    XrdCephMetaCache cache(100);
+    CPPUNIT_ASSERT(0 == cache.load(m_log));
+    cache.putStat("/a", 1, 10);
+    cache.putXattr("/a", "user.x", "1");
+    cache.putXattr("/a", "user.y", "2");
+    cache.removeXattr("/a", "user.y");
+    cache.putStat("/b", 2, 20);
+    cache.putXattr("/b", "user.x", "3");
+    // a changed file loses its xattrs
+    cache.putStat("/b", 4, 40);
+    cache.putStat("/c", 3, 30);
+    cache.remove("/c");
+    CPPUNIT_ASSERT(2 == cache.nbEntries());
+  }
+  XrdCephMetaCache cache(100);
+  CPPUNIT_ASSERT(2 == cache.load(m_log));
+  unsigned long long size;
+  time_t mtime, validated;
+  CPPUNIT_ASSERT(cache.getStat("/a", size, mtime, validated));
+  CPPUNIT_ASSERT(1 == size);
+  CPPUNIT_ASSERT(10 == mtime);
+  // reloaded entries are not validated
+  CPPUNIT_ASSERT(0 == validated);
+  std::string value;
+  CPPUNIT_ASSERT(cache.getXattr("/a", "user.x", value, validated));
+  CPPUNIT_ASSERT("1" == value);
+  CPPUNIT_ASSERT(0 == validated);
+  CPPUNIT_ASSERT(!cache.getXattr("/a", "user.y", value, validated));
+  CPPUNIT_ASSERT(hasStat(cache, "/b", 4));
+  CPPUNIT_ASSERT(!cache.getXattr("/b", "user.x", value, validated));
+  CPPUNIT_ASSERT(!hasStat(cache, "/c", 3));
+}
+
+//------------------------------------------------------------------------------
+// A truncated record at the end of the log is ignored
+//------------------------------------------------------------------------------
+void CephMetaCacheTest::TruncatedLogTest() {
+  {
+    XrdCephMetaCache cache(100);
+    CPPUNIT_ASSERT(0 == cache.load(m_log));
+    cache.putStat("/a", 1, 10);
+    cache.putStat("/b", 2, 20);
+    cache.putStat("/c", 3, 30);
+    CPPUNIT_ASSERT(0 == truncate(m_log.c_str(), cache.logSize() - 3));
+  }
+  {
+    XrdCephMetaCache cache(100);
+    CPPUNIT_ASSERT(2 == cache.load(m_log));
+    CPPUNIT_ASSERT(hasStat(cache, "/a", 1));
+    CPPUNIT_ASSERT(hasStat(cache, "/b", 2));
+    CPPUNIT_ASSERT(!hasStat(cache, "/c", 3));
+    // the truncated tail is dropped, so that new records can be read back
+    cache.putStat("/d", 4, 40);
+  }
+  XrdCephMetaCache cache(100);
+  CPPUNIT_ASSERT(3 == cache.load(m_log));
+  CPPUNIT_ASSERT(hasStat(cache, "/d", 4));
+}
+
+//------------------------------------------------------------------------------
+// Replay stops at the first corrupted record, and logs of unknown format are
+// ignored
+//------------------------------------------------------------------------------
+void CephMetaCacheTest::CorruptedLogTest() {
+  unsigned long long sizeBeforeB;
+  {
+    XrdCephMetaCache cache(100);
+    CPPUNIT_ASSERT(0 == cache.load(m_log));
+    cache.putStat("/a", 1, 10);
+    sizeBeforeB = cache.logSize();
+    cache.putStat("/b", 2, 20);
+    cache.putStat("/c", 3, 30);
+  }
+  // last byte of the record of /b, that is of its mtime
+  corrupt(m_log, sizeBeforeB + 8 + 1 + 4 + 2 + 8 + 7);
+  {
+    XrdCephMetaCache cache(100);
+    CPPUNIT_ASSERT(1 == cache.load(m_log));
+    CPPUNIT_ASSERT(hasStat(cache, "/a", 1));
+    CPPUNIT_ASSERT(!hasStat(cache, "/b", 2));
+    CPPUNIT_ASSERT(!hasStat(cache, "/c", 3));
+  }
+  corrupt(m_log, 0);
+  XrdCephMetaCache cache(100);
+  CPPUNIT_ASSERT(0 == cache.load(m_log));
+  CPPUNIT_ASSERT(!hasStat(cache, "/a", 1));
+}
+
+//------------------------------------------------------------------------------
+// Logs dominated by obsolete records are compacted, at load and while in use
+//------------------------------------------------------------------------------
+void CephMetaCacheTest::CompactionTest() {
+  unsigned long long compactSize;
+  {
+    XrdCephMetaCache cache(100);
+    CPPUNIT_ASSERT(0 == cache.load(m_log));
+    cache.putStat("/a", 1, 10);
+    cache.putXattr("/a", "user.x", "1");
+    compactSize = cache.logSize();
+    for (unsigned int i = 0; i < 1000; i++) {
+      cache.putXattr("/a", "user.y", i % 2 ? "1" : "2");
+    }
+    cache.removeXattr("/a", "user.y");
+    CPPUNIT_ASSERT(cache.logSize() > compactSize);
+  }
+  {
+    XrdCephMetaCache cache(100);
+    CPPUNIT_ASSERT(1 == cache.load(m_log));
+    CPPUNIT_ASSERT(compactSize == cache.logSize());
+    // enough updates of a single file trigger a compaction
+    unsigned long long maxSize = 0;
+    for (unsigned int i = 0; i < 150000; i++) {
+      cache.putStat("/a", 2 + i % 2, 10);
+      if (cache.logSize() > maxSize) maxSize = cache.logSize();
+    }
+    CPPUNIT_ASSERT(cache.logSize() < maxSize);
+  }
+  XrdCephMetaCache cache(100);
+  CPPUNIT_ASSERT(1 == cache.load(m_log));
+  CPPUNIT_ASSERT(hasStat(cache, "/a", 3));
+  std::string value;
+  time_t validated;
+  // a changed file loses its xattrs
+  CPPUNIT_ASSERT(!cache.getXattr("/a", "user.x", value, validated));
+  CPPUNIT_ASSERT(access((m_log + ".tmp").c_str(), F_OK));
+}
+
+//------------------------------------------------------------------------------
+// Least recently used files are dropped when the cache is full, also from
+// the log
+//------------------------------------------------------------------------------
+void CephMetaCacheTest::EvictionTest() {
+  {
+    XrdCephMetaCache cache(3);
+    CPPUNIT_ASSERT(0 == cache.load(m_log));
+    cache.putStat("/a", 1, 10);
+    cache.putStat("/b", 2, 20);
+    cache.putStat("/c", 3, 30);
+    // /a becomes the most recently used
+    CPPUNIT_ASSERT(hasStat(cache, "/a", 1));
+    cache.putStat("/d", 4, 40);
+    CPPUNIT_ASSERT(3 == cache.nbEntries());
+    CPPUNIT_ASSERT(!hasStat(cache, "/b", 2));
+    CPPUNIT_ASSERT(hasStat(cache, "/a", 1));
+    CPPUNIT_ASSERT(hasStat(cache, "/c", 3));
+    CPPUNIT_ASSERT(hasStat(cache, "/d", 4));
+  }
+  XrdCephMetaCache cache(3);
+  CPPUNIT_ASSERT(3 == cache.load(m_log));
+  CPPUNIT_ASSERT(!hasStat(cache, "/b", 2));
+  CPPUNIT_ASSERT(hasStat(cache, "/a", 1));
+  CPPUNIT_ASSERT(hasStat(cache, "/c", 3));
+  CPPUNIT_ASSERT(hasStat(cache, "/d", 4));
+}
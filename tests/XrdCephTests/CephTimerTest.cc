@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <XrdCeph/XrdCephTimer.hh>
+#include <unistd.h>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephTimerTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephTimerTest );
+      CPPUNIT_TEST( OrderTest );
+      CPPUNIT_TEST( CancelTest );
+      CPPUNIT_TEST( RescheduleTest );
+      CPPUNIT_TEST( StopTest );
+    CPPUNIT_TEST_SUITE_END();
+    void OrderTest();
+    void CancelTest();
+    void RescheduleTest();
+    void StopTest();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephTimerTest );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+/// records the events called and when
+struct CallLog {
+  std::vector<int> ids;
+  std::vector<unsigned long long> timesMs;
+  XrdSysMutex mutex;
+};
+
+/// an event recording its call
+struct LoggedEvent {
+  CallLog *log;
+  int id;
+};
+
+static void logCall(void *arg) {
+  LoggedEvent *e = (LoggedEvent*)arg;
+  XrdSysMutexHelper lock(e->log->mutex);
+  e->log->ids.push_back(e->id);
+  e->log->timesMs.push_back(XrdCephTimer::nowMs());
+}
+
+static size_t nbCalls(CallLog &log) {
+  XrdSysMutexHelper lock(log.mutex);
+  return log.ids.size();
+}
+
+/// waits for a given number of calls, at most 5s
+static bool waitCalls(CallLog &log, size_t n) {
+  for (unsigned int i = 0; i < 500 && nbCalls(log) < n; i++) usleep(10000);
+  return nbCalls(log) >= n;
+}
+
+/// an event scheduling itself again until its count drops to 0
+struct RepeatedEvent {
+  XrdCephTimer *timer;
+  int count;
+  CallLog *log;
+};
+
+static void repeatCall(void *arg) {
+  RepeatedEvent *e = (RepeatedEvent*)arg;
+  {
+    XrdSysMutexHelper lock(e->log->mutex);
+    e->log->ids.push_back(e->count);
+  }
+  if (--e->count > 0) e->timer->schedule(1, repeatCall, e);
+}
+
+//------------------------------------------------------------------------------
+// Events are called in the order of their due times, not too early
+//------------------------------------------------------------------------------
+void CephTimerTest::OrderTest() {
+  XrdCephTimer timer;
+  CallLog log;
+  LoggedEvent events[3] = {{&log, 0}, {&log, 1}, {&log, 2}};
+  unsigned long long start = XrdCephTimer::nowMs();
+  CPPUNIT_ASSERT(0 != timer.schedule(200, logCall, &events[2]));
+  CPPUNIT_ASSERT(0 != timer.schedule(100, logCall, &events[1]));
+  CPPUNIT_ASSERT(0 != timer.schedule(0, logCall, &events[0]));
+  CPPUNIT_ASSERT(waitCalls(log, 3));
+  for (int i = 0; i < 3; i++) {
+    CPPUNIT_ASSERT(i == log.ids[i]);
+    CPPUNIT_ASSERT(log.timesMs[i] >= start + 100 * i);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Cancelled events are not called
+//------------------------------------------------------------------------------
+void CephTimerTest::CancelTest() {
+  XrdCephTimer timer;
+  CallLog log;
+  LoggedEvent events[2] = {{&log, 0}, {&log, 1}};
+  unsigned long long id0 = timer.schedule(100, logCall, &events[0]);
+  unsigned long long id1 = timer.schedule(50, logCall, &events[1]);
+  CPPUNIT_ASSERT(0 != id0 && 0 != id1 && id0 != id1);
+  CPPUNIT_ASSERT(timer.cancel(id0));
+  CPPUNIT_ASSERT(!timer.cancel(id0));
+  CPPUNIT_ASSERT(waitCalls(log, 1));
+  // an event already called cannot be cancelled
+  CPPUNIT_ASSERT(!timer.cancel(id1));
+  usleep(200000);
+  CPPUNIT_ASSERT(1 == nbCalls(log));
+  CPPUNIT_ASSERT(1 == log.ids[0]);
+}
+
+//------------------------------------------------------------------------------
+// Callbacks may schedule new events
+//------------------------------------------------------------------------------
+void CephTimerTest::RescheduleTest() {
+  XrdCephTimer timer;
+  CallLog log;
+  RepeatedEvent e = {&timer, 5, &log};
+  CPPUNIT_ASSERT(0 != timer.schedule(1, repeatCall, &e));
+  CPPUNIT_ASSERT(waitCalls(log, 5));
+  for (int i = 0; i < 5; i++) {
+    CPPUNIT_ASSERT(5 - i == log.ids[i]);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Destroying the timer stops its thread and drops pending events
+//------------------------------------------------------------------------------
+void CephTimerTest::StopTest() {
+  CallLog log;
+  LoggedEvent event = {&log, 0};
+  {
+    XrdCephTimer unused;
+  }
+  {
+    XrdCephTimer timer;
+    CPPUNIT_ASSERT(0 != timer.schedule(100000, logCall, &event));
+  }
+  CPPUNIT_ASSERT(0 == nbCalls(log));
+}